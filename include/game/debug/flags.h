@@ -27,6 +27,20 @@ struct debug_flags_t {
   uint32_t draw_collided_face : 1;
   uint32_t draw_status : 1;
   uint32_t draw_step_up : 1;
+  uint32_t use_scalar_collision : 1;
+  uint32_t use_analytic_toi : 1;
+  uint32_t validate_toi : 1;
+  uint32_t disable_candidate_cache : 1;
+  uint32_t use_legacy_buckets : 1;
+  uint32_t diff_buckets : 1;
+  uint32_t record_collision : 1;
+  uint32_t rebuild_bvh : 1;
+  uint32_t use_wide_bvh : 1;
+  uint32_t count_collision_work : 1;
+  uint32_t disable_fused_queries : 1;
+  uint32_t keep_internal_contacts : 1;
+  uint32_t disable_ground_grid : 1;
+  uint32_t use_merged_sweep_bounds : 1;
 } debug_flags_t;
 
 extern debug_flags_t g_debug_flags;
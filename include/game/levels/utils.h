@@ -26,6 +26,7 @@ typedef struct font_runtime_t font_runtime_t;
 typedef struct level_context_t level_context_t;
 typedef struct pipeline_t pipeline_t;
 typedef struct scene_t scene_t;
+typedef struct trigger_volume_t trigger_volume_t;
 
 scene_t*
 load_scene(
@@ -45,6 +46,17 @@ create_default_light(
   scene_t *scene,
   const allocator_t *allocator);
 
+/**
+ * Writes the volumes of the nodes named "trigger_box", "trigger_sphere" and
+ * "trigger_capsule" (any suffix) to 'volumes', up to 'capacity'. Returns the
+ * number of trigger nodes in the scene, 'volumes' can be NULL to count them.
+ */
+uint32_t
+load_trigger_volumes(
+  scene_t *scene,
+  trigger_volume_t *volumes,
+  const uint32_t capacity);
+
 void
 setup_view_projection_pipeline(
   const level_context_t *context,
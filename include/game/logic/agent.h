@@ -0,0 +1,88 @@
+/**
+ * @file agent.h
+ * @author khalilhenoud@gmail.com
+ * @brief capsule character controller, the player and the npcs share it.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef AGENT_H
+#define AGENT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <game/logic/collision_context.h>
+#include <game/logic/collision_data.h>
+#include <math/capsule.h>
+#include <math/vector3f.h>
+
+#define AGENT_REFERENCE_FRAME_TIME    0.033f
+
+
+typedef struct allocator_t allocator_t;
+typedef struct collision_mesh_t collision_mesh_t;
+
+// the movement requested for the frame, in [-1, 1] relative to the agent basis.
+// 'vertical' is only used when flying.
+typedef
+struct agent_input_t {
+  float strafe;
+  float forward;
+  float vertical;
+  uint32_t jump;
+} agent_input_t;
+
+// NOTE: 'right' and 'forward' are the xz basis the input is relative to, set
+// by whoever drives the agent. The collision mesh is shared and read only, the
+// agents can be updated concurrently as long as each has its own context.
+typedef
+struct agent_t {
+  vector3f velocity;
+  vector3f velocity_limit;
+  vector3f acceleration;
+  vector3f right;
+  vector3f forward;
+  float gravity;
+  float friction;
+  float jump_velocity;
+  float snap_velocity;
+  float snap_shift;
+  float energy_cutoff;
+  capsule_t capsule;
+  uint32_t is_flying;
+  uint32_t on_solid_floor;
+  uint32_t draw_debug;
+  collision_context_t context;
+} agent_t;
+
+void
+agent_setup(
+  agent_t *agent,
+  point3f position,
+  collision_mesh_t *mesh,
+  const allocator_t *allocator);
+
+void
+agent_cleanup(agent_t *agent);
+
+/**
+ * Moves the agent by its velocity against the collision mesh, 'delta_time' is
+ * the fixed simulation step, used as is. The motion scales relative to
+ * AGENT_REFERENCE_FRAME_TIME. Returns the flags of the faces collided with.
+ */
+collision_flags_t
+agent_update(
+  agent_t *agent,
+  const agent_input_t *input,
+  float delta_time);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,82 @@
+/**
+ * @file agent_pool.h
+ * @author khalilhenoud@gmail.com
+ * @brief fixed capacity pool of npc agents updated in parallel batches.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef AGENT_POOL_H
+#define AGENT_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <math/vector3f.h>
+
+#define AGENT_POOL_BATCH_SIZE     8
+#define AGENT_POOL_NONE           ((uint32_t)-1)
+
+
+typedef struct agent_t agent_t;
+typedef struct allocator_t allocator_t;
+typedef struct collision_mesh_t collision_mesh_t;
+
+// the npcs walk straight and pick a new heading when they hit a wall.
+typedef
+struct agent_wander_t {
+  float heading;
+  uint32_t seed;
+  uint32_t flags;
+} agent_wander_t;
+
+// NOTE: the arrays are allocated once at capacity, nothing is allocated or
+// moved while the batch update runs.
+typedef
+struct agent_pool_t {
+  agent_t *agents;
+  agent_wander_t *wander;
+  uint32_t count;
+  uint32_t capacity;
+  collision_mesh_t *mesh;
+  const allocator_t *allocator;
+} agent_pool_t;
+
+void
+agent_pool_setup(
+  agent_pool_t *pool,
+  const uint32_t capacity,
+  collision_mesh_t *mesh,
+  const allocator_t *allocator);
+
+void
+agent_pool_cleanup(agent_pool_t *pool);
+
+/**
+ * Returns the index of the new agent, or AGENT_POOL_NONE if the pool is full.
+ */
+uint32_t
+agent_pool_spawn(
+  agent_pool_t *pool,
+  point3f position);
+
+/**
+ * Updates all the agents by the fixed step 'delta_time', unclamped so they
+ * keep pace with the player, fanned out in batches of AGENT_POOL_BATCH_SIZE
+ * over the job system. The update is serial while a validation mode that
+ * records global state is toggled through the debug flags.
+ */
+void
+agent_pool_update(
+  agent_pool_t *pool,
+  float delta_time);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
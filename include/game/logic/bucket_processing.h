@@ -23,11 +23,21 @@ extern "C" {
 typedef struct bvh_t bvh_t;
 typedef struct bvh_aabb_t bvh_aabb_t;
 typedef struct capsule_t capsule_t;
+typedef struct collision_counters_t collision_counters_t;
+typedef struct collision_mesh_t collision_mesh_t;
+
+// results of running the pairwise and the plane key bucketing side by side.
+typedef
+struct bucket_diff_stats_t {
+  uint32_t runs;
+  uint32_t bucket_mismatches;
+  uint32_t result_mismatches;
+} bucket_diff_stats_t;
 
 collision_flags_t
 get_averaged_normal_filtered(
   const vector3f *orientation,
-  bvh_t *const bvh,
+  collision_mesh_t *const mesh,
   vector3f *averaged,
   intersection_info_t collision_info[256],
   const uint32_t info_used,
@@ -40,14 +50,23 @@ get_averaged_normal_filtered(
  * This is important for not over-representing face normals in collision
  * calculation. It also serves to cull groups that nullify each other's
  * contributions. 'collision_info' is modified in this process, and an updated
- * 'info_used' is returned.
+ * 'info_used' is returned. The buckets formed and removed are added to
+ * 'counters' when counting the collision work, it can be NULL.
  */
 uint32_t
 process_collision_info(
-  bvh_t *const bvh,
+  collision_mesh_t *const mesh,
   const vector3f *velocity,
   intersection_info_t collision_info[256],
-  uint32_t info_used);
+  uint32_t info_used,
+  collision_counters_t *counters);
+
+/**
+ * Accumulated since startup, updated while the bucket diff is toggled through
+ * the debug flags.
+ */
+const bucket_diff_stats_t *
+get_bucket_diff_stats(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,68 @@
+/**
+ * @file bvh_build.h
+ * @author khalilhenoud@gmail.com
+ * @brief binned surface area heuristic bvh builder and quality metrics.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef BVH_BUILD_H
+#define BVH_BUILD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define BVH_BUILD_BINS            16
+#define BVH_BUILD_MAX_LEAF_SIZE   8
+// leaf sizes 1 to BVH_BUILD_MAX_LEAF_SIZE, the last entry counts the larger.
+#define BVH_BUILD_HISTOGRAM_SIZE  (BVH_BUILD_MAX_LEAF_SIZE + 1)
+
+
+typedef struct allocator_t allocator_t;
+typedef struct bvh_t bvh_t;
+
+// NOTE: 'sah_cost' is the expected cost of a query relative to the root area,
+// an internal node costs 1 and a face a quarter since the faces are culled in
+// packets of 4. 'build_ms' is only set by the builder.
+typedef
+struct bvh_build_stats_t {
+  float sah_cost;
+  uint32_t max_depth;
+  uint32_t node_count;
+  uint32_t leaf_count;
+  uint32_t leaf_histogram[BVH_BUILD_HISTOGRAM_SIZE];
+  float build_ms;
+} bvh_build_stats_t;
+
+/**
+ * Measures the tree reachable from the root, the walk stack is sized from the
+ * node count so any depth fits.
+ */
+void
+bvh_build_metrics(
+  const bvh_t *bvh,
+  bvh_build_stats_t *stats,
+  const allocator_t *allocator);
+
+/**
+ * Rebuilds the nodes of 'bvh' from its faces with a binned SAH builder, the
+ * subtrees are built across the job system workers. The faces, normals and
+ * bounds are reordered so every leaf covers a contiguous range, the layout is
+ * the one the scene bvh uses. Anything indexing the faces must be built after.
+ */
+void
+bvh_build_sah(
+  bvh_t *bvh,
+  bvh_build_stats_t *stats,
+  const allocator_t *allocator);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
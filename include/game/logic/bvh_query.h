@@ -0,0 +1,242 @@
+/**
+ * @file bvh_query.h
+ * @author khalilhenoud@gmail.com
+ * @brief stack based bvh traversal that streams the candidate faces.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef BVH_QUERY_H
+#define BVH_QUERY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <game/logic/collision_variant.h>
+
+#define BVH_QUERY_STACK_SIZE      64
+
+
+typedef struct allocator_t allocator_t;
+typedef struct bvh_aabb_t bvh_aabb_t;
+typedef struct capsule_t capsule_t;
+typedef struct collision_mesh_t collision_mesh_t;
+typedef struct vector3f vector3f;
+
+typedef
+struct face_list_t {
+  uint32_t *indices;
+  uint32_t count;
+  uint32_t capacity;
+  const allocator_t *allocator;
+} face_list_t;
+
+// NOTE: the segment the capsule center travels, 'extents' are the half extents
+// of the capsule bounds. A box can only be touched by the moving capsule if the
+// segment crosses the box grown by 'extents', a much tighter test than the
+// merged start and end bounds for diagonal and long sweeps.
+typedef
+struct bvh_sweep_t {
+  float origin[3];
+  float delta[3];
+  float extents[3];
+} bvh_sweep_t;
+
+void
+face_list_setup(
+  face_list_t *list,
+  const uint32_t capacity,
+  const allocator_t *allocator);
+
+void
+face_list_cleanup(face_list_t *list);
+
+void
+face_list_push(face_list_t *list, const uint32_t index);
+
+/**
+ * Grows a traversal stack full at '*capacity' entries of 'size' bytes. The
+ * traversals start on a fixed 'local' array of BVH_QUERY_STACK_SIZE entries,
+ * it is copied to the heap the first time a deep tree fills it. Returns the
+ * new entries, the caller frees them once done unless they are 'local'.
+ */
+void *
+bvh_stack_grow(
+  void *entries,
+  const void *local,
+  uint32_t *capacity,
+  const uint32_t size,
+  const allocator_t *allocator);
+
+/**
+ * Return 0 to stop the traversal, anything else to continue.
+ */
+typedef int32_t (*bvh_face_callback_t)(uint32_t face_index, void *user_data);
+
+/**
+ * Sets 'sweep' to the capsule moving along 'displacement', the capsule extents
+ * are scaled by 'multiplier' the same way 'populate_capsule_aabb' does.
+ */
+void
+bvh_sweep_setup(
+  bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  const vector3f *displacement,
+  const float multiplier);
+
+/**
+ * Returns 1 if the swept capsule bounds can overlap 'bounds', a slab test of
+ * the center segment against 'bounds' grown by the capsule extents.
+ */
+int32_t
+bvh_sweep_intersects(
+  const bvh_sweep_t *sweep,
+  const bvh_aabb_t *bounds);
+
+/**
+ * Walks the bvh with an explicit stack and calls 'callback' for every face
+ * whose bounds overlap 'bounds', callers need not test the face bounds again.
+ * If 'capsule' is not NULL, faces whose plane is out of the capsule's reach are
+ * skipped as well. Returns 0 if the callback stopped the traversal, else 1.
+ * The quantized 4 wide tree is walked instead when toggled and up to date, the
+ * face grid is used instead of either when it is the mesh broadphase.
+ */
+int32_t
+bvh_query_faces(
+  const collision_mesh_t *mesh,
+  bvh_aabb_t *bounds,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data);
+
+/**
+ * Same as 'bvh_query_faces', the number of nodes visited (grid cells when the
+ * grid serves the query) is added to 'visited' if not NULL.
+ */
+int32_t
+bvh_query_faces_counted(
+  const collision_mesh_t *mesh,
+  bvh_aabb_t *bounds,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data,
+  uint32_t *visited);
+
+/**
+ * Same as 'bvh_query_faces_counted', the nodes and faces missed by 'sweep' are
+ * skipped as well when it is not NULL. 'bounds' must contain the swept bounds.
+ */
+int32_t
+bvh_query_faces_swept(
+  const collision_mesh_t *mesh,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data,
+  uint32_t *visited);
+
+/**
+ * Streams the faces [first, first + count) of a leaf the same way, the faces
+ * are culled against 'bounds' and the capsule plane in packets, then against
+ * 'sweep' if not NULL.
+ */
+int32_t
+bvh_query_leaf(
+  const collision_mesh_t *mesh,
+  const uint32_t first,
+  const uint32_t count,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data);
+
+/**
+ * Appends the faces 'bvh_query_faces' would stream to 'out', there is no limit
+ * on the number of faces returned. Returns the number of faces appended.
+ */
+uint32_t
+bvh_gather_faces(
+  const collision_mesh_t *mesh,
+  bvh_aabb_t *bounds,
+  const capsule_t *capsule,
+  face_list_t *out);
+
+/**
+ * Same contract as 'bvh_query_faces' but walks the faces in 'list' instead of
+ * the bvh, the relative order of the list is preserved.
+ */
+int32_t
+face_list_query(
+  const collision_mesh_t *mesh,
+  const face_list_t *list,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data);
+
+/**
+ * Returns 1 if a query of 'bounds', 'sweep' and 'capsule' would stream the face
+ * 'i', the same bounds, sweep and plane rejection the queries run.
+ */
+int32_t
+bvh_query_accepts_face(
+  const collision_mesh_t *mesh,
+  const uint32_t i,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule);
+
+// NOTE: the queries reading the broadphase flags are compiled per collision
+// variant, the names above dispatch on g_collision_variant. The hot path units
+// call the variant they are compiled into directly, per face and per leaf.
+int32_t
+COLLISION_VARIANT(bvh_query_leaf)(
+  const collision_mesh_t *mesh,
+  const uint32_t first,
+  const uint32_t count,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data);
+
+int32_t
+COLLISION_VARIANT(bvh_query_faces_swept)(
+  const collision_mesh_t *mesh,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data,
+  uint32_t *visited);
+
+int32_t
+COLLISION_VARIANT(face_list_query)(
+  const collision_mesh_t *mesh,
+  const face_list_t *list,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data);
+
+int32_t
+COLLISION_VARIANT(bvh_query_accepts_face)(
+  const collision_mesh_t *mesh,
+  const uint32_t i,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
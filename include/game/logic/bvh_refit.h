@@ -0,0 +1,107 @@
+/**
+ * @file bvh_refit.h
+ * @author khalilhenoud@gmail.com
+ * @brief moves groups of level faces and refits the bvh bottom up.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef BVH_REFIT_H
+#define BVH_REFIT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <math/vector3f.h>
+
+#define BVH_REFIT_NONE            ((uint32_t)-1)
+#define BVH_REFIT_MAX_GROUPS      16
+// the tree is rebuilt once its cost grows past this ratio of the built cost.
+#define BVH_REFIT_REBUILD_RATIO   1.5f
+
+
+typedef struct allocator_t allocator_t;
+typedef struct collision_mesh_t collision_mesh_t;
+typedef struct face_t face_t;
+typedef struct matrix4f matrix4f;
+
+// NOTE: the group faces are moved rigidly from their pose when the group was
+// added, 'rest' and 'rest_normals' hold that pose.
+typedef
+struct bvh_refit_group_t {
+  uint32_t *faces;
+  face_t *rest;
+  vector3f *rest_normals;
+  uint32_t count;
+} bvh_refit_group_t;
+
+// NOTE: 'parents' is per node and 'leaves' maps every face to its leaf node.
+// 'cost' is the surface area heuristic of the tree (node areas weighted by
+// their face count, 1 for the internal nodes) relative to the root area,
+// 'built_cost' is its value when the tree was last built.
+typedef
+struct bvh_refit_t {
+  collision_mesh_t *mesh;
+  uint32_t *parents;
+  uint32_t *leaves;
+  uint32_t *dirty;
+  uint8_t *is_dirty;
+  uint32_t dirty_count;
+  bvh_refit_group_t groups[BVH_REFIT_MAX_GROUPS];
+  uint32_t group_count;
+  float area_sum;
+  float cost;
+  float built_cost;
+  uint32_t refits;
+  uint32_t rebuilds;
+  const allocator_t *allocator;
+} bvh_refit_t;
+
+void
+bvh_refit_setup(
+  bvh_refit_t *refit,
+  collision_mesh_t *mesh,
+  const allocator_t *allocator);
+
+void
+bvh_refit_cleanup(bvh_refit_t *refit);
+
+/**
+ * Makes 'faces' a dynamic group moved through 'bvh_refit_move_group', the
+ * faces are split from the static plane clusters. Returns the group index or
+ * BVH_REFIT_NONE if all the groups are used.
+ */
+uint32_t
+bvh_refit_add_group(
+  bvh_refit_t *refit,
+  const uint32_t *faces,
+  const uint32_t count);
+
+/**
+ * Places the group faces at 'rotation' * rest + 'translation', only the upper
+ * 3x3 of 'rotation' is used. The bvh is refit on the next update.
+ */
+void
+bvh_refit_move_group(
+  bvh_refit_t *refit,
+  const uint32_t group,
+  const matrix4f *rotation,
+  const vector3f *translation);
+
+/**
+ * Refits the leaves holding the moved faces and their ancestors, rebuilds the
+ * tree when the cost degraded past BVH_REFIT_REBUILD_RATIO. Must not run while
+ * the mesh is being queried.
+ */
+void
+bvh_refit_update(bvh_refit_t *refit);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
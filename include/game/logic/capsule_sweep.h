@@ -0,0 +1,75 @@
+/**
+ * @file capsule_sweep.h
+ * @author khalilhenoud@gmail.com
+ * @brief closed form swept capsule against face time of impact.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef CAPSULE_SWEEP_H
+#define CAPSULE_SWEEP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <math/vector3f.h>
+
+
+typedef struct capsule_t capsule_t;
+typedef struct face_t face_t;
+
+typedef
+enum {
+  SWEEP_FEATURE_NONE,
+  SWEEP_FEATURE_FACE,
+  SWEEP_FEATURE_EDGE,
+  SWEEP_FEATURE_VERTEX
+} sweep_feature_t;
+
+// 'normal' points from the face towards the capsule. 'feature_index' is the
+// edge (points[i], points[(i + 1) % 3]) or the vertex 'i' that was hit.
+typedef
+struct sweep_result_t {
+  float time;
+  vector3f normal;
+  sweep_feature_t feature;
+  uint32_t feature_index;
+} sweep_result_t;
+
+/**
+ * Finds the exact time in [0, 1] the capsule moving along 'displacement' first
+ * touches the face. The face interior is tested against the capsule spheres,
+ * then the edges against the spheres and the cylinder, then the vertices.
+ * A capsule that already overlaps the face reports a time of 0.
+ * Returns 1 if a contact was found, 0 otherwise.
+ */
+int32_t
+sweep_capsule_face(
+  const capsule_t *capsule,
+  const face_t *face,
+  const vector3f *normal,
+  const vector3f *displacement,
+  sweep_result_t *result);
+
+/**
+ * Same contract as the iterative 'find_capsule_face_intersection_time', the
+ * exact time is pulled back by 'limit_distance' so the capsule is left just
+ * short of the face. Returns 1 if there is no contact.
+ */
+float
+sweep_capsule_face_time(
+  const capsule_t *capsule,
+  const face_t *face,
+  const vector3f *normal,
+  const vector3f *displacement,
+  const float limit_distance);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
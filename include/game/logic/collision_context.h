@@ -0,0 +1,120 @@
+/**
+ * @file collision_context.h
+ * @author khalilhenoud@gmail.com
+ * @brief per agent state used by the capsule collision queries.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef COLLISION_CONTEXT_H
+#define COLLISION_CONTEXT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <game/logic/bvh_query.h>
+#include <game/logic/collision_counters.h>
+#include <spatial/bvh/bvh.h>
+
+
+typedef struct allocator_t allocator_t;
+typedef struct capsule_t capsule_t;
+typedef struct collision_mesh_t collision_mesh_t;
+typedef struct vector3f vector3f;
+
+// NOTE: the mesh is shared and read only, the rest is owned by whoever issues
+// the queries, one context per agent.
+typedef
+struct collision_context_t {
+  collision_mesh_t *mesh;
+  face_list_t candidates;
+
+  // faces gathered once in the inflated 'cache_bounds', any query contained in
+  // the bounds is answered from the list instead of walking the bvh. The list
+  // is stale once the mesh revision moves past 'cache_revision'.
+  face_list_t cache;
+  bvh_aabb_t cache_bounds;
+  uint32_t cache_valid;
+  uint32_t cache_revision;
+
+  // the work done since the owner last reset them, see 'count_collision_work'.
+  collision_counters_t counters;
+} collision_context_t;
+
+void
+collision_context_setup(
+  collision_context_t *context,
+  collision_mesh_t *mesh,
+  const allocator_t *allocator);
+
+void
+collision_context_cleanup(collision_context_t *context);
+
+/**
+ * Makes sure the candidate cache covers the capsule swept along 'displacement',
+ * the cache is rebuilt with some slack only when the sweep leaves its bounds.
+ * Should be called once per update before issuing the queries.
+ */
+void
+collision_context_prefetch(
+  collision_context_t *context,
+  const capsule_t *capsule,
+  const vector3f *displacement);
+
+/**
+ * Same contract as 'bvh_query_faces_swept', served from the cache when it
+ * covers 'bounds' and from the bvh otherwise.
+ */
+int32_t
+collision_context_query_faces(
+  collision_context_t *context,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data);
+
+/**
+ * Same contract as 'bvh_gather_faces', see 'collision_context_query_faces'.
+ */
+uint32_t
+collision_context_gather_faces(
+  collision_context_t *context,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  face_list_t *out);
+
+// NOTE: the variant matching the including unit, see 'bvh_query.h'.
+void
+COLLISION_VARIANT(collision_context_prefetch)(
+  collision_context_t *context,
+  const capsule_t *capsule,
+  const vector3f *displacement);
+
+int32_t
+COLLISION_VARIANT(collision_context_query_faces)(
+  collision_context_t *context,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data);
+
+uint32_t
+COLLISION_VARIANT(collision_context_gather_faces)(
+  collision_context_t *context,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  face_list_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
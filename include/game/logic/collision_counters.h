@@ -0,0 +1,86 @@
+/**
+ * @file collision_counters.h
+ * @author khalilhenoud@gmail.com
+ * @brief per frame collision work counters, streamed to a csv file.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef COLLISION_COUNTERS_H
+#define COLLISION_COUNTERS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <math/vector3f.h>
+
+
+// NOTE: every collision context owns its counters, they are summed once the
+// agents are done updating. Only the debug variant of the hot path counts.
+// 'nodes_visited' counts the bvh nodes (or grid cells) of the queries that
+// missed the candidate cache. 'toi_iterations' is the iteration budget handed
+// to the iterative solver, which does not report how many it used, and 1 per
+// closed form solve.
+typedef
+struct collision_counters_t {
+  uint32_t queries;
+  uint32_t nodes_visited;
+  uint32_t faces_tested;
+  uint32_t post_displacement_rejects;
+  uint32_t toi_solves;
+  uint32_t toi_iterations;
+  uint32_t buckets_formed;
+  uint32_t buckets_removed;
+  uint32_t sweep_steps;
+} collision_counters_t;
+
+void
+collision_counters_reset(collision_counters_t *counters);
+
+void
+collision_counters_add(
+  collision_counters_t *total,
+  const collision_counters_t *counters);
+
+/**
+ * Writes the counters as debug text lines starting at 'y'.
+ */
+void
+collision_counters_draw(
+  const collision_counters_t *counters,
+  const float x,
+  const float y);
+
+/**
+ * Opens 'path' for writing and writes the csv header, returns 0 on failure.
+ */
+uint32_t
+collision_counters_open(const char *path);
+
+void
+collision_counters_close(void);
+
+uint32_t
+collision_counters_is_open(void);
+
+/**
+ * Appends a row for the frame, 'position' locates the geometry the player was
+ * colliding with.
+ */
+void
+collision_counters_write(
+  const uint64_t frame,
+  const float frame_ms,
+  const uint32_t agents,
+  const point3f *position,
+  const collision_counters_t *counters);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
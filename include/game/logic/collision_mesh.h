@@ -0,0 +1,130 @@
+/**
+ * @file collision_mesh.h
+ * @author khalilhenoud@gmail.com
+ * @brief per level collision data, the bvh and the structures derived from it.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef COLLISION_MESH_H
+#define COLLISION_MESH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <game/logic/face_adjacency.h>
+#include <game/logic/face_grid.h>
+#include <game/logic/face_packets.h>
+#include <game/logic/ground_grid.h>
+#include <game/logic/wide_bvh.h>
+
+#define PLANE_CLUSTER_NONE        ((uint32_t)-1)
+
+
+typedef struct allocator_t allocator_t;
+typedef struct bvh_t bvh_t;
+typedef struct face_t face_t;
+
+typedef
+enum {
+  FACE_COLOR_FLOOR,
+  FACE_COLOR_CEILING,
+  FACE_COLOR_WALL,
+  FACE_COLOR_COUNT
+} face_color_index_t;
+
+typedef
+enum {
+  COLLISION_BROADPHASE_BVH,
+  COLLISION_BROADPHASE_GRID,
+  COLLISION_BROADPHASE_COUNT
+} collision_broadphase_t;
+
+// NOTE: 'flag' is a collision_flags_t and 'color' a face_color_index_t, both
+// are narrowed to keep the entry at 8 bytes.
+typedef
+struct face_metadata_t {
+  float distance;
+  uint8_t flag;
+  uint8_t color;
+  uint16_t reserved;
+} face_metadata_t;
+
+// NOTE: the bvh is owned by the scene, everything else is built from it when
+// the level is loaded and is read only while the agents update. The dynamic
+// faces are moved in between, 'revision' is bumped every time they do.
+// 'wide' is the 4 wide copy of the bvh, only valid at its own revision.
+// 'grid' is empty until set up by the level, 'broadphase' is the structure
+// the queries go through (a collision_broadphase_t), the bvh is used whenever
+// the grid is empty or stale.
+// 'ground' bins the floor faces for the snap probes, empty until set up by
+// the level and bypassed when stale like 'grid'.
+// 'extended' holds the bvh faces grown by 'extension', used when snapping.
+// 'clusters' maps every face to the id of its plane (coplanar faces facing the
+// same way share an id), 'opposites' maps a cluster to the cluster of the
+// opposite facing plane or PLANE_CLUSTER_NONE, the links are mutual.
+// 'adjacency' pairs the face edges and flags the ones inside a plane cluster.
+// 'allocator' is the one the mesh was loaded with, the traversals of a tree
+// too deep for their fixed stacks spill to it.
+typedef
+struct collision_mesh_t {
+  bvh_t *bvh;
+  face_packets_t packets;
+  wide_bvh_t wide;
+  face_grid_t grid;
+  ground_grid_t ground;
+  uint32_t broadphase;
+  face_metadata_t *metadata;
+  face_t *extended;
+  float extension;
+  uint32_t face_count;
+  uint32_t *clusters;
+  uint32_t *opposites;
+  uint32_t cluster_count;
+  face_adjacency_t adjacency;
+  uint32_t revision;
+  const allocator_t *allocator;
+} collision_mesh_t;
+
+collision_mesh_t *
+load_collision_mesh(
+  bvh_t *bvh,
+  const float extension,
+  const allocator_t *allocator);
+
+void
+free_collision_mesh(
+  collision_mesh_t *mesh,
+  const allocator_t *allocator);
+
+/**
+ * Refreshes the metadata, the extended face and the packet lane of the face
+ * 'index' after its points, normal and bounds changed in the bvh.
+ */
+void
+collision_mesh_update_face(
+  collision_mesh_t *mesh,
+  const uint32_t index);
+
+/**
+ * Moves 'faces' to new plane clusters so they can leave the static planes they
+ * shared a cluster with, the faces that shared a cluster keep sharing one. Only
+ * valid as long as 'faces' move rigidly together. The internal features along
+ * the split are updated.
+ */
+void
+collision_mesh_split_clusters(
+  collision_mesh_t *mesh,
+  const uint32_t *faces,
+  const uint32_t count,
+  const allocator_t *allocator);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,151 @@
+/**
+ * @file collision_recorder.h
+ * @author khalilhenoud@gmail.com
+ * @brief serializes the collision queries to a file to replay them offline.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef COLLISION_RECORDER_H
+#define COLLISION_RECORDER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <game/logic/collision_data.h>
+#include <math/capsule.h>
+#include <math/vector3f.h>
+
+#define COLLISION_RECORD_ROOM_LENGTH    256
+#define COLLISION_RECORD_MAX_CONTEXTS   1024
+
+
+typedef struct collision_context_t collision_context_t;
+
+typedef
+enum {
+  COLLISION_RECORD_PREFETCH,
+  COLLISION_RECORD_TIME_OF_IMPACT,
+  COLLISION_RECORD_PROBE,
+  COLLISION_RECORD_COUNT
+} collision_record_type_t;
+
+// NOTE: the query affecting debug flags, broadphase and bvh layout in use when
+// the recording was opened, written to the header for the replay to apply. A
+// rebuilt bvh has its faces reordered, the replay must rebuild it the same.
+// 'moved faces' is set as soon as any face was refit away from the static
+// room, such a recording cannot be replayed against it.
+typedef
+enum {
+  COLLISION_RECORD_SCALAR = 1 << 0,
+  COLLISION_RECORD_NO_CACHE = 1 << 1,
+  COLLISION_RECORD_LEGACY_BUCKETS = 1 << 2,
+  COLLISION_RECORD_WIDE_BVH = 1 << 3,
+  COLLISION_RECORD_GRID = 1 << 4,
+  COLLISION_RECORD_NO_FUSION = 1 << 5,
+  COLLISION_RECORD_INTERNAL_CONTACTS = 1 << 6,
+  COLLISION_RECORD_NO_GROUND_GRID = 1 << 7,
+  COLLISION_RECORD_MERGED_SWEEP_BOUNDS = 1 << 8,
+  COLLISION_RECORD_REBUILT_BVH = 1 << 9,
+  COLLISION_RECORD_MOVED_FACES = 1 << 10
+} collision_record_setting_t;
+
+// NOTE: 'context' identifies the collision context that issued the query, the
+// contexts are numbered in the order they are first seen. 'analytic' is the
+// solver used when recording. The hits are only set for the time of impact and
+// the probes, a probe is a fused probe against the floor faces only, not a
+// time of impact against every face.
+typedef
+struct collision_record_t {
+  collision_record_type_t type;
+  uint32_t context;
+  capsule_t capsule;
+  vector3f displacement;
+  uint32_t iterations;
+  float limit_distance;
+  uint32_t analytic;
+  uint32_t hit_count;
+  intersection_info_t hits[256];
+} collision_record_t;
+
+/**
+ * Starts writing the queries to 'path', any previous recording is closed. The
+ * current debug flags and 'settings', the collision_record_setting_t bits of
+ * the level the flags do not hold (grid, rebuilt bvh), are written to the
+ * header. Returns 0 if the file could not be created. Recording is not
+ * thread safe, the queries must be issued serially while it is open.
+ */
+uint32_t
+collision_recorder_open(
+  const char *path,
+  const char *room,
+  const uint32_t settings);
+
+void
+collision_recorder_close(void);
+
+uint32_t
+collision_recorder_is_open(void);
+
+/**
+ * Adds 'settings' (collision_record_setting_t bits) to the header of the open
+ * recording, for the level state that changes while recording.
+ */
+void
+collision_recorder_add_settings(const uint32_t settings);
+
+void
+collision_recorder_prefetch(
+  const collision_context_t *context,
+  const capsule_t *capsule,
+  const vector3f *displacement);
+
+void
+collision_recorder_time_of_impact(
+  const collision_context_t *context,
+  const capsule_t *capsule,
+  const vector3f *displacement,
+  const uint32_t iterations,
+  const float limit_distance,
+  const intersection_info_t *hits,
+  const uint32_t hit_count);
+
+void
+collision_recorder_probe(
+  const collision_context_t *context,
+  const capsule_t *capsule,
+  const vector3f *displacement,
+  const uint32_t iterations,
+  const float limit_distance,
+  const intersection_info_t *hits,
+  const uint32_t hit_count);
+
+/**
+ * Reads the file header, 'room' receives the name of the room the queries were
+ * recorded in and 'settings' the collision_record_setting_t bits. Returns 0 if
+ * the file is not a collision recording.
+ */
+uint32_t
+collision_record_read_header(
+  FILE *file,
+  char room[COLLISION_RECORD_ROOM_LENGTH],
+  uint32_t *settings);
+
+/**
+ * Reads the next record, returns 0 at the end of the file.
+ */
+uint32_t
+collision_record_read(
+  FILE *file,
+  collision_record_t *record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
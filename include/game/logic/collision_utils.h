@@ -20,22 +20,51 @@ extern "C" {
 #include <game/logic/collision_data.h>
 #include <math/vector3f.h>
 
+#define FUSED_QUERY_MAX     4
+
 
-typedef struct bvh_t bvh_t;
 typedef struct bvh_aabb_t bvh_aabb_t;
 typedef struct capsule_t capsule_t;
+typedef struct collision_context_t collision_context_t;
+typedef struct collision_mesh_t collision_mesh_t;
+typedef struct face_t face_t;
+
+typedef
+enum fused_query_type_t {
+  FUSED_QUERY_SWEEP,
+  FUSED_QUERY_OVERLAP,
+  FUSED_QUERY_PROBE
+} fused_query_type_t;
+
+// NOTE: a sub query of 'get_fused_queries'. The sweeps and the probes write
+// the faces hit at the earliest time of impact to 'hits' (256 entries) and
+// their count to 'hit_count', same as 'get_time_of_impact'. A probe is a
+// vertical sweep against the floor faces only, whether the ground grid or the
+// traversal answers it, and also reports its first floor hit in
+// 'floor_index', or -1. The overlaps set 'valid', same as
+// 'is_in_valid_space'.
+typedef
+struct fused_query_t {
+  fused_query_type_t type;
+  capsule_t *capsule;
+  vector3f displacement;
+  intersection_info_t *hits;
+  uint32_t hit_count;
+  int32_t floor_index;
+  int32_t valid;
+} fused_query_t;
 
 uint32_t
-is_floor(bvh_t *bvh, uint32_t index);
+is_floor(const collision_mesh_t *mesh, uint32_t index);
 
 uint32_t
-is_ceiling(bvh_t *bvh, uint32_t index);
+is_ceiling(const collision_mesh_t *mesh, uint32_t index);
 
 debug_color_t
-get_debug_color(bvh_t *bvh, uint32_t index);
+get_debug_color(const collision_mesh_t *mesh, uint32_t index);
 
 collision_flags_t
-get_collision_flag(bvh_t *bvh, uint32_t index);
+get_collision_flag(const collision_mesh_t *mesh, uint32_t index);
 
 void
 populate_capsule_aabb(
@@ -52,23 +81,57 @@ populate_moving_capsule_aabb(
 
 int32_t
 is_in_valid_space(
-  bvh_t *bvh,
+  collision_context_t *context,
   capsule_t *capsule);
 
 void
 ensure_in_valid_space(
-  bvh_t *bvh,
+  collision_context_t *context,
   capsule_t *capsule);
 
+/**
+ * Returns the capsule face time of impact, from the closed form solver or from
+ * the iterative one depending on the debug flags. The sweep is recorded for
+ * validation if toggled. The release variant always uses the iterative one.
+ */
+float
+get_face_time_of_impact(
+  capsule_t capsule,
+  face_t *face,
+  vector3f *normal,
+  vector3f displacement,
+  const uint32_t iterations,
+  const float limit_distance);
+
+/**
+ * Sweeps the capsule along 'displacement' and returns the faces hit at the
+ * earliest time of impact. The candidate faces are gathered into the context,
+ * in packets unless the scalar reference path is toggled through the debug
+ * flags, both produce the same hits in the same order.
+ */
 uint32_t
 get_time_of_impact(
-  bvh_t *bvh,
+  collision_context_t *context,
   capsule_t *capsule,
   vector3f displacement,
   intersection_info_t collision_info[256],
   const uint32_t iterations,
   const float limit_distance);
 
+/**
+ * Answers up to FUSED_QUERY_MAX queries in a single traversal of the bounds
+ * they cover together, each face is loaded once and tested against the
+ * queries it concerns. The results are the same as issuing the queries one by
+ * one, which is done instead when toggled through the debug flags.
+ */
+void
+get_fused_queries(
+  collision_context_t *context,
+  fused_query_t *queries,
+  const uint32_t count,
+  const uint32_t iterations,
+  const float limit_distance);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,56 @@
+/**
+ * @file collision_variant.h
+ * @author khalilhenoud@gmail.com
+ * @brief debug and release variants of the collision hot path.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef COLLISION_VARIANT_H
+#define COLLISION_VARIANT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+// NOTE: the hot path sources are compiled twice, the '*_release.c' units
+// include them with COLLISION_RELEASE defined. The debug flags read through
+// COLLISION_DEBUG_FLAG fold to 0 in the release variant, taking the debug
+// draws, the recorder hooks and the broadphase switches (scalar, wide bvh, no
+// cache) out with them. The public entry points are
+// defined as COLLISION_VARIANT(name) and dispatched from the debug unit.
+#if defined(COLLISION_RELEASE)
+#define COLLISION_DEBUG_ENABLED       0
+#define COLLISION_DEBUG_FLAG(name)    0
+#define COLLISION_VARIANT(name)       name##_release
+#else
+#define COLLISION_DEBUG_ENABLED       1
+#define COLLISION_DEBUG_FLAG(name)    (g_debug_flags.name)
+#define COLLISION_VARIANT(name)       name##_debug
+#endif
+
+
+typedef
+enum {
+  COLLISION_VARIANT_DEBUG,
+  COLLISION_VARIANT_RELEASE
+} collision_variant_t;
+
+extern collision_variant_t g_collision_variant;
+
+/**
+ * Picks the release variant unless one of the debug flags the hot path reads
+ * is set. Must not be called while the agents are updating.
+ */
+void
+collision_variant_select(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,86 @@
+/**
+ * @file face_adjacency.h
+ * @author khalilhenoud@gmail.com
+ * @brief edge adjacency of the bvh faces and their internal features.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef FACE_ADJACENCY_H
+#define FACE_ADJACENCY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <math/vector3f.h>
+
+#define FACE_ADJACENCY_NONE       ((uint32_t)-1)
+
+// the features of a face, edge 'i' goes from point 'i' to point 'i + 1'.
+#define FACE_FEATURE_INTERIOR     0
+#define FACE_FEATURE_EDGE(i)      (1 + (i))
+#define FACE_FEATURE_VERTEX(i)    (4 + (i))
+
+
+typedef struct allocator_t allocator_t;
+typedef struct bvh_t bvh_t;
+typedef struct face_t face_t;
+
+// NOTE: 'neighbors' holds 3 entries per face, the face across every edge or
+// FACE_ADJACENCY_NONE when the edge is open or shared by more than 2 faces.
+// An edge is internal when its neighbor is in the same plane cluster, a vertex
+// when both edges of the face meeting at it are. Bit 'feature - 1' of
+// 'internal' is set for every internal feature of the face.
+typedef
+struct face_adjacency_t {
+  uint32_t *neighbors;
+  uint8_t *internal;
+  uint32_t face_count;
+  uint32_t internal_edges;
+} face_adjacency_t;
+
+/**
+ * Pairs the face edges sharing both their (quantized) points, 'clusters' maps
+ * every face to its plane cluster.
+ */
+void
+face_adjacency_setup(
+  face_adjacency_t *adjacency,
+  bvh_t *bvh,
+  const uint32_t *clusters,
+  const allocator_t *allocator);
+
+void
+face_adjacency_cleanup(
+  face_adjacency_t *adjacency,
+  const allocator_t *allocator);
+
+/**
+ * Reevaluates the internal features of 'faces' and of their neighbors after
+ * the clusters of 'faces' changed.
+ */
+void
+face_adjacency_update(
+  face_adjacency_t *adjacency,
+  const uint32_t *clusters,
+  const uint32_t *faces,
+  const uint32_t count);
+
+/**
+ * Returns the feature of 'face' closest to 'point', the point is expected to
+ * be close to the face plane.
+ */
+uint32_t
+face_contact_feature(
+  const face_t *face,
+  const point3f *point);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,116 @@
+/**
+ * @file face_grid.h
+ * @author khalilhenoud@gmail.com
+ * @brief uniform spatial hash over the level faces, an alternative broadphase.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef FACE_GRID_H
+#define FACE_GRID_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define FACE_GRID_CELL_SCALE        4.f
+#define FACE_GRID_MAX_FACE_CELLS    64
+#define FACE_GRID_MAX_QUERY_CELLS   256
+#define FACE_GRID_QUERY_CAPACITY    1024
+#define FACE_GRID_OVERFLOW          ((uint32_t)-1)
+
+
+typedef struct allocator_t allocator_t;
+typedef struct bvh_t bvh_t;
+typedef struct bvh_aabb_t bvh_aabb_t;
+typedef struct capsule_t capsule_t;
+typedef struct collision_mesh_t collision_mesh_t;
+
+// NOTE: the cells are hashed into 'table_size' buckets, bucket 'i' holds the
+// faces [starts[i], starts[i + 1]) of 'faces' in ascending order. A face is
+// stored in every cell its bounds overlap, unless it overlaps more than
+// FACE_GRID_MAX_FACE_CELLS in which case it goes to 'large' and is tested by
+// every query. 'revision' is the mesh revision the grid was built from.
+typedef
+struct face_grid_t {
+  uint32_t *starts;
+  uint32_t *faces;
+  uint32_t *large;
+  uint32_t large_count;
+  uint32_t table_size;
+  uint32_t entry_count;
+  uint32_t revision;
+  float cell_size;
+  float inverse_cell_size;
+} face_grid_t;
+
+// the average time per query through each broadphase over the same queries.
+// 'mismatches' counts the queries that did not return the same faces.
+typedef
+struct face_grid_stats_t {
+  uint32_t queries;
+  uint32_t mismatches;
+  uint32_t bytes;
+  double bvh_us;
+  double grid_us;
+} face_grid_stats_t;
+
+/**
+ * Hashes the faces of 'bvh' in cells sized relative to 'capsule_radius'.
+ */
+void
+face_grid_setup(
+  face_grid_t *grid,
+  const bvh_t *bvh,
+  const float capsule_radius,
+  const uint32_t revision,
+  const allocator_t *allocator);
+
+void
+face_grid_cleanup(
+  face_grid_t *grid,
+  const allocator_t *allocator);
+
+/**
+ * Writes the faces whose bounds overlap 'bounds' to 'out' in ascending order
+ * and without duplicates. Returns their count, or FACE_GRID_OVERFLOW if the
+ * query spans too many cells or more than 'capacity' faces; the caller is
+ * expected to fall back on the bvh in that case.
+ */
+uint32_t
+face_grid_gather(
+  const face_grid_t *grid,
+  const bvh_t *bvh,
+  const bvh_aabb_t *bounds,
+  uint32_t *out,
+  const uint32_t capacity);
+
+/**
+ * Returns the number of cells 'face_grid_gather' walks for 'bounds'.
+ */
+uint32_t
+face_grid_query_cells(
+  const face_grid_t *grid,
+  const bvh_aabb_t *bounds);
+
+/**
+ * Times the bounds of 'capsule' centered on every 'stride'th face through the
+ * bvh and the grid broadphase of 'mesh', the mesh broadphase is restored. A
+ * 'stride' of 0 only fills the grid size.
+ */
+void
+face_grid_benchmark(
+  collision_mesh_t *mesh,
+  const capsule_t *capsule,
+  const uint32_t stride,
+  face_grid_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
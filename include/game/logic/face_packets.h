@@ -0,0 +1,106 @@
+/**
+ * @file face_packets.h
+ * @author khalilhenoud@gmail.com
+ * @brief structure of arrays repacking of the bvh faces for batched rejection.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef FACE_PACKETS_H
+#define FACE_PACKETS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define FACE_PACKET_WIDTH         4
+
+
+typedef struct allocator_t allocator_t;
+typedef struct bvh_t bvh_t;
+typedef struct bvh_aabb_t bvh_aabb_t;
+typedef struct capsule_t capsule_t;
+
+// NOTE: packet 'i' holds the faces [i * 4, i * 4 + 4) of the bvh, the bvh
+// leaves reference contiguous face ranges so a leaf maps to a packet range.
+typedef
+struct face_packet_t {
+  float min[3][FACE_PACKET_WIDTH];
+  float max[3][FACE_PACKET_WIDTH];
+  float normal[3][FACE_PACKET_WIDTH];
+  float distance[FACE_PACKET_WIDTH];
+} face_packet_t;
+
+typedef
+struct face_packets_t {
+  face_packet_t *packets;
+  uint32_t count;
+  uint32_t face_count;
+} face_packets_t;
+
+void
+face_packets_setup(
+  face_packets_t *packets,
+  bvh_t *bvh,
+  const allocator_t *allocator);
+
+void
+face_packets_cleanup(
+  face_packets_t *packets,
+  const allocator_t *allocator);
+
+/**
+ * Reloads the lane of the face 'index' from the bvh, its bounds, normal and
+ * points must be up to date.
+ */
+void
+face_packets_update(
+  face_packets_t *packets,
+  bvh_t *bvh,
+  const uint32_t index);
+
+/**
+ * Returns a lane mask (bit 'i' is face 'packet * 4 + i') of the faces whose
+ * bounds overlap 'bounds'.
+ */
+uint32_t
+face_packet_bounds_mask(
+  const face_packet_t *packet,
+  const bvh_aabb_t *bounds);
+
+/**
+ * Returns a lane mask of the faces whose plane is within reach of the capsule,
+ * the capsule radius is scaled by 'multiplier' to keep the test conservative.
+ * A face outside the mask cannot be touched by the capsule.
+ */
+uint32_t
+face_packet_plane_mask(
+  const face_packet_t *packet,
+  const capsule_t *capsule,
+  const float multiplier);
+
+/**
+ * Runs the bounds and the plane rejection on the faces [first, last), the
+ * surviving face indices are written in order to 'out'. Returns their count.
+ * The plane rejection is skipped if 'capsule' is NULL.
+ * 'out' must hold at least (last - first) entries.
+ */
+uint32_t
+face_packets_cull(
+  const face_packets_t *packets,
+  const uint32_t first,
+  const uint32_t last,
+  const bvh_aabb_t *bounds,
+  const capsule_t *capsule,
+  const float multiplier,
+  uint32_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,55 @@
+/**
+ * @file fixed_step.h
+ * @author khalilhenoud@gmail.com
+ * @brief accumulator splitting the frame time into fixed simulation ticks.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef FIXED_STEP_H
+#define FIXED_STEP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+// a hitch longer than this many ticks is dropped rather than caught up on.
+#define FIXED_STEP_MAX_TICKS      8
+
+
+typedef
+struct fixed_step_t {
+  float step;
+  float accumulator;
+  uint32_t rate;
+} fixed_step_t;
+
+void
+fixed_step_setup(
+  fixed_step_t *fixed_step,
+  const uint32_t rate);
+
+/**
+ * Adds the frame time and returns the number of ticks to simulate, the
+ * remainder is carried over to the next frame.
+ */
+uint32_t
+fixed_step_advance(
+  fixed_step_t *fixed_step,
+  const float delta_time);
+
+/**
+ * Returns how far the render time is between the last two ticks, in [0, 1).
+ */
+float
+fixed_step_alpha(const fixed_step_t *fixed_step);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
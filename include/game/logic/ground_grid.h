@@ -0,0 +1,84 @@
+/**
+ * @file ground_grid.h
+ * @author khalilhenoud@gmail.com
+ * @brief 2d grid of the floor faces, answers the vertical snap probes.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef GROUND_GRID_H
+#define GROUND_GRID_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define GROUND_GRID_CELL_SCALE        2.f
+#define GROUND_GRID_MAX_CELLS         (1u << 20)
+#define GROUND_GRID_MAX_QUERY_CELLS   64
+#define GROUND_GRID_QUERY_CAPACITY    256
+#define GROUND_GRID_OVERFLOW          ((uint32_t)-1)
+
+
+typedef struct allocator_t allocator_t;
+typedef struct bvh_aabb_t bvh_aabb_t;
+typedef struct collision_mesh_t collision_mesh_t;
+
+// NOTE: the cells cover the xz bounds of the floor faces, cell (x, z) is at
+// 'x + z * cells[0]' and holds the floor faces [starts[i], starts[i + 1]) of
+// 'faces' in ascending order, those whose bounds overlap it in xz. 'heights'
+// holds the min and max height of the faces of every cell, an empty cell has
+// an empty range. 'revision' is the mesh revision the grid was built from.
+typedef
+struct ground_grid_t {
+  uint32_t *starts;
+  uint32_t *faces;
+  float *heights;
+  uint32_t cells[2];
+  uint32_t entry_count;
+  uint32_t floor_count;
+  uint32_t revision;
+  float origin[2];
+  float cell_size;
+  float inverse_cell_size;
+} ground_grid_t;
+
+/**
+ * Bins the floor faces of 'mesh' in cells sized relative to 'capsule_radius',
+ * the cells grow if the floor would need more than GROUND_GRID_MAX_CELLS.
+ */
+void
+ground_grid_setup(
+  ground_grid_t *grid,
+  const collision_mesh_t *mesh,
+  const float capsule_radius,
+  const allocator_t *allocator);
+
+void
+ground_grid_cleanup(
+  ground_grid_t *grid,
+  const allocator_t *allocator);
+
+/**
+ * Writes the floor faces whose bounds overlap 'bounds' to 'out' in ascending
+ * order and without duplicates, the cells out of the vertical range of
+ * 'bounds' are skipped. Returns their count, or GROUND_GRID_OVERFLOW if the
+ * query spans too many cells or more than 'capacity' faces.
+ */
+uint32_t
+ground_grid_gather(
+  const ground_grid_t *grid,
+  const collision_mesh_t *mesh,
+  bvh_aabb_t *bounds,
+  uint32_t *out,
+  const uint32_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
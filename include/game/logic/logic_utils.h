@@ -0,0 +1,44 @@
+/**
+ * @file logic_utils.h
+ * @author khalilhenoud@gmail.com
+ * @brief small helpers shared by the logic modules.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef LOGIC_UTILS_H
+#define LOGIC_UTILS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+
+/**
+ * Wall clock time in microseconds, for timing the builds and the benchmarks.
+ */
+double
+get_microseconds(void);
+
+/**
+ * qsort comparator for uint64_t.
+ */
+int
+compare_uint64(const void *lhs, const void *rhs);
+
+/**
+ * Sorts 'values' in ascending order and drops the repeated ones, returns the
+ * number of values left.
+ */
+uint32_t
+sort_unique_uint32(uint32_t *values, const uint32_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,241 @@
+/**
+ * @file navmesh.h
+ * @author khalilhenoud@gmail.com
+ * @brief convex polygons merged from the floor faces, with an a* path query.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef NAVMESH_H
+#define NAVMESH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <math/vector3f.h>
+
+#define NAVMESH_MAX_VERTICES        8
+#define NAVMESH_CELL_SCALE          4.f
+#define NAVMESH_MAX_CELLS           (1u << 18)
+#define NAVMESH_NONE                ((uint32_t)-1)
+
+
+typedef struct allocator_t allocator_t;
+typedef struct collision_mesh_t collision_mesh_t;
+
+// NOTE: the vertices [first_vertex, first_vertex + vertex_count) of the mesh
+// are the convex outline of the polygon in the winding of its faces, the links
+// [first_link, first_link + link_count) leave it. 'normal' and 'distance' are
+// the plane of the polygon, every face merged in it shares that plane.
+typedef
+struct navmesh_polygon_t {
+  uint32_t first_vertex;
+  uint32_t vertex_count;
+  uint32_t first_link;
+  uint32_t link_count;
+  point3f center;
+  vector3f normal;
+  float distance;
+  float min[2];
+  float max[2];
+} navmesh_polygon_t;
+
+// NOTE: 'portal' is the segment crossed to reach 'polygon', the shared edge of
+// the two polygons or, for a step, the overlap of their facing edges taken on
+// the higher one. Bit i of 'corners' is set if portal[i] is on the navmesh
+// boundary, the path keeps 'radius' off those ends only.
+typedef
+struct navmesh_link_t {
+  uint32_t polygon;
+  uint32_t is_step;
+  uint32_t corners;
+  point3f portal[2];
+} navmesh_link_t;
+
+// NOTE: the floor faces (see 'is_floor') sharing a plane cluster are merged
+// into convex polygons of at most NAVMESH_MAX_VERTICES vertices. Polygons are
+// linked across the edges they share and across steps, facing edges at most
+// 'step_height' apart vertically with an overlap the capsule fits through.
+// The path corners keep 'radius' off the portal ends. The polygons are binned
+// in an xz grid, cell (x, z) holds [starts[i], starts[i + 1]) of 'cells' with
+// i = x + z * cell_count[0]. The navmesh does not follow the dynamic faces.
+typedef
+struct navmesh_t {
+  navmesh_polygon_t *polygons;
+  point3f *vertices;
+  navmesh_link_t *links;
+  uint32_t polygon_count;
+  uint32_t vertex_count;
+  uint32_t link_count;
+  uint32_t step_links;
+  uint32_t *starts;
+  uint32_t *cells;
+  uint32_t cell_count[2];
+  float origin[2];
+  float cell_size;
+  float inverse_cell_size;
+  float radius;
+  float step_height;
+  float build_ms;
+} navmesh_t;
+
+typedef
+enum {
+  NAVMESH_SEARCH_RUNNING,
+  NAVMESH_SEARCH_FOUND,
+  NAVMESH_SEARCH_FAILED
+} navmesh_search_status_t;
+
+typedef
+struct navmesh_open_t {
+  float cost;
+  uint32_t polygon;
+} navmesh_open_t;
+
+// NOTE: the state of one search, sized for a navmesh. A search can be advanced
+// a few expansions at a time, it only reads the navmesh so any number of them
+// can run concurrently on separate queries. 'stamp' tags the per polygon
+// entries written by the current search, nothing is cleared in between. A
+// polygon is entered from 'parents' through the link 'via', at 'positions'.
+typedef
+struct navmesh_query_t {
+  float *costs;
+  point3f *positions;
+  uint32_t *parents;
+  uint32_t *via;
+  uint32_t *opened;
+  uint32_t *closed;
+  uint32_t *corridor;
+  navmesh_open_t *open;
+  uint32_t open_count;
+  uint32_t open_capacity;
+  uint32_t polygon_count;
+  uint32_t stamp;
+  uint32_t start_polygon;
+  uint32_t goal_polygon;
+  uint32_t status;
+  uint32_t expanded;
+  point3f start;
+  point3f goal;
+} navmesh_query_t;
+
+// the build time and the path throughput of the navmesh of a room.
+typedef
+struct navmesh_stats_t {
+  uint32_t polygons;
+  uint32_t links;
+  uint32_t step_links;
+  uint32_t bytes;
+  uint32_t paths;
+  uint32_t found;
+  float build_ms;
+  float average_points;
+  float average_expanded;
+  double paths_per_second;
+} navmesh_stats_t;
+
+/**
+ * Builds the navmesh from the floor faces of 'mesh', 'radius' and
+ * 'step_height' are those of the capsule walking it.
+ */
+void
+navmesh_setup(
+  navmesh_t *navmesh,
+  const collision_mesh_t *mesh,
+  const float radius,
+  const float step_height,
+  const allocator_t *allocator);
+
+void
+navmesh_cleanup(
+  navmesh_t *navmesh,
+  const allocator_t *allocator);
+
+/**
+ * Returns the highest polygon containing 'point' in xz that is at most
+ * 'step_height' above it, else the closest one vertically containing it, else
+ * NAVMESH_NONE. 'out' is set to the point on the polygon plane if not NULL.
+ */
+uint32_t
+navmesh_find_polygon(
+  const navmesh_t *navmesh,
+  const point3f *point,
+  point3f *out);
+
+void
+navmesh_query_setup(
+  navmesh_query_t *query,
+  const navmesh_t *navmesh,
+  const allocator_t *allocator);
+
+void
+navmesh_query_cleanup(
+  navmesh_query_t *query,
+  const allocator_t *allocator);
+
+/**
+ * Starts a search from 'start' to 'goal', returns a navmesh_search_status_t.
+ * The search fails right away if either point is off the navmesh.
+ */
+uint32_t
+navmesh_query_begin(
+  navmesh_query_t *query,
+  const navmesh_t *navmesh,
+  const point3f *start,
+  const point3f *goal);
+
+/**
+ * Expands at most 'max_expansions' polygons of the running search, returns a
+ * navmesh_search_status_t.
+ */
+uint32_t
+navmesh_query_step(
+  navmesh_query_t *query,
+  const navmesh_t *navmesh,
+  const uint32_t max_expansions);
+
+/**
+ * Writes the corners of the path of a found search to 'path', from the start
+ * to the goal included, the portals are string pulled. Returns the number of
+ * points written, at most 'capacity'.
+ */
+uint32_t
+navmesh_query_path(
+  navmesh_query_t *query,
+  const navmesh_t *navmesh,
+  point3f *path,
+  const uint32_t capacity);
+
+/**
+ * Runs a whole search, returns the number of points written to 'path' or 0 if
+ * there is no path.
+ */
+uint32_t
+navmesh_find_path(
+  navmesh_query_t *query,
+  const navmesh_t *navmesh,
+  const point3f *start,
+  const point3f *goal,
+  point3f *path,
+  const uint32_t capacity);
+
+/**
+ * Times 'paths' searches between pseudo random polygon centers. With 0
+ * 'paths' only the build stats are filled.
+ */
+void
+navmesh_benchmark(
+  const navmesh_t *navmesh,
+  navmesh_query_t *query,
+  const uint32_t paths,
+  navmesh_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,174 @@
+/**
+ * @file path_scheduler.h
+ * @author khalilhenoud@gmail.com
+ * @brief queued navmesh path requests solved under a per frame time budget.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef PATH_SCHEDULER_H
+#define PATH_SCHEDULER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <game/logic/navmesh.h>
+#include <math/vector3f.h>
+
+#define PATH_SCHEDULER_MAX_POINTS     32
+#define PATH_SCHEDULER_MAX_ACTIVE     16
+#define PATH_SCHEDULER_SLICE          32
+#define PATH_SCHEDULER_ROUNDS         4
+#define PATH_CACHE_WAYS               4
+#define PATH_SCHEDULER_NONE           ((uint32_t)-1)
+
+
+typedef struct allocator_t allocator_t;
+
+typedef
+enum {
+  PATH_REQUEST_FREE,
+  PATH_REQUEST_QUEUED,
+  PATH_REQUEST_RUNNING,
+  PATH_REQUEST_FOUND,
+  PATH_REQUEST_FAILED
+} path_request_status_t;
+
+// NOTE: 'points' is the string pulled path once the request is FOUND, the
+// start and the goal included. Paths longer than PATH_SCHEDULER_MAX_POINTS
+// are cut short, the caller requests again from the last point. 'cells' are
+// the cache cells of the start and the goal.
+typedef
+struct path_request_t {
+  point3f start;
+  point3f goal;
+  int32_t cells[2][3];
+  uint32_t status;
+  uint32_t count;
+  point3f points[PATH_SCHEDULER_MAX_POINTS];
+} path_request_t;
+
+// NOTE: a cache entry is the result of a search between two cells, a path or
+// the lack of one (count is 0). A hit swaps the cached ends for the requested
+// ones, the cells are small enough for the corners to stay valid. 'frame' is
+// the last frame the entry was used in, 0 when unused. The least recently used
+// way of a set is replaced.
+typedef
+struct path_cache_entry_t {
+  int32_t cells[2][3];
+  uint64_t frame;
+  uint32_t count;
+  point3f points[PATH_SCHEDULER_MAX_POINTS];
+} path_cache_entry_t;
+
+// the work of the last update, 'waiting' is the queue left for the next one.
+typedef
+struct path_scheduler_stats_t {
+  uint32_t waiting;
+  uint32_t started;
+  uint32_t found;
+  uint32_t failed;
+  uint32_t cache_hits;
+  uint32_t expanded;
+  uint32_t running;
+  uint32_t slices;
+  float update_ms;
+  float budget_ms;
+} path_scheduler_stats_t;
+
+// NOTE: the requests are handles into 'requests', 'queue' is a ring of the
+// handles waiting for a search. Every active search owns queries[i], the active
+// searches are advanced concurrently on the job system in a few rounds so the
+// finished ones are replaced within the frame. The searches left running when
+// the budget is spent resume next frame. The cache is keyed by the cells (of
+// size 'cell_size') of the start and the goal and is only touched on the
+// calling thread, it has 'set_count' * PATH_CACHE_WAYS entries.
+typedef
+struct path_scheduler_t {
+  const navmesh_t *navmesh;
+  path_request_t *requests;
+  uint32_t capacity;
+  uint32_t *queue;
+  uint32_t queue_first;
+  uint32_t queue_count;
+  navmesh_query_t queries[PATH_SCHEDULER_MAX_ACTIVE];
+  uint32_t active[PATH_SCHEDULER_MAX_ACTIVE];
+  uint32_t active_count;
+  path_cache_entry_t *cache;
+  uint32_t set_count;
+  float cell_size;
+  uint64_t frame;
+  path_scheduler_stats_t stats;
+  const allocator_t *allocator;
+} path_scheduler_t;
+
+/**
+ * 'capacity' is the number of requests in flight, 'cache_sets' is rounded up
+ * to a power of 2. The navmesh must outlive the scheduler.
+ */
+void
+path_scheduler_setup(
+  path_scheduler_t *scheduler,
+  const navmesh_t *navmesh,
+  const uint32_t capacity,
+  const uint32_t cache_sets,
+  const allocator_t *allocator);
+
+void
+path_scheduler_cleanup(path_scheduler_t *scheduler);
+
+/**
+ * Queues a path request, returns its handle or PATH_SCHEDULER_NONE if all the
+ * requests are in flight. The handle stays valid until released.
+ */
+uint32_t
+path_scheduler_request(
+  path_scheduler_t *scheduler,
+  const point3f *start,
+  const point3f *goal);
+
+/**
+ * Returns the path_request_status_t of 'handle'.
+ */
+uint32_t
+path_scheduler_status(
+  const path_scheduler_t *scheduler,
+  const uint32_t handle);
+
+/**
+ * Returns the request behind 'handle', its points are valid once FOUND.
+ */
+const path_request_t *
+path_scheduler_get(
+  const path_scheduler_t *scheduler,
+  const uint32_t handle);
+
+/**
+ * Frees 'handle', a queued or running request is cancelled.
+ */
+void
+path_scheduler_release(
+  path_scheduler_t *scheduler,
+  const uint32_t handle);
+
+/**
+ * Starts the queued requests and advances the searches until they are all
+ * done or 'budget_ms' of wall time is spent. Called once per frame.
+ */
+void
+path_scheduler_update(
+  path_scheduler_t *scheduler,
+  const float budget_ms);
+
+void
+path_scheduler_clear_cache(path_scheduler_t *scheduler);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
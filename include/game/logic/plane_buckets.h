@@ -0,0 +1,66 @@
+/**
+ * @file plane_buckets.h
+ * @author khalilhenoud@gmail.com
+ * @brief groups the collision hits per plane using the mesh plane clusters.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef PLANE_BUCKETS_H
+#define PLANE_BUCKETS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <game/logic/collision_data.h>
+
+#define PLANE_BUCKET_NONE         ((uint32_t)-1)
+
+
+typedef struct collision_mesh_t collision_mesh_t;
+
+// NOTE: bucket 'i' spans collision_info[offsets[i], offsets[i] + counts[i]),
+// 'partners[i]' is the bucket with the opposite facing plane if any.
+typedef
+struct plane_buckets_t {
+  uint32_t counts[256];
+  uint32_t offsets[256];
+  uint32_t partners[256];
+  uint32_t count;
+} plane_buckets_t;
+
+/**
+ * Same grouping as the pairwise 'sort_in_buckets', buckets of coplanar faces
+ * facing the same way, in O(n log n) using the plane clusters of the mesh and
+ * integer compares only. The buckets are ordered by the last occurrence of
+ * their plane in 'collision_info', the faces of a bucket by descending
+ * position. Returns the bucket count.
+ */
+uint32_t
+sort_in_plane_buckets(
+  const collision_mesh_t *mesh,
+  intersection_info_t collision_info[256],
+  const uint32_t info_used,
+  plane_buckets_t *buckets);
+
+/**
+ * Removes the opposite facing bucket pairs that cancel each other out, same
+ * rules as 'process_buckets'. The removal is done in place, 'buckets' stays
+ * valid. Returns the remaining number of collision_info.
+ */
+uint32_t
+process_plane_buckets(
+  const collision_mesh_t *mesh,
+  intersection_info_t collision_info[256],
+  const uint32_t info_used,
+  plane_buckets_t *buckets);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -18,19 +18,51 @@ extern "C" {
 #include <stdint.h>
 #include <math/vector3f.h>
 
+#define PLAYER_CAPSULE_RADIUS       16.f
+#define PLAYER_CAPSULE_HALF_HEIGHT  12.f
 
-typedef struct bvh_t bvh_t;
+
+typedef struct allocator_t allocator_t;
 typedef struct camera_t camera_t;
+typedef struct collision_context_t collision_context_t;
+typedef struct collision_mesh_t collision_mesh_t;
 
 void
 player_init(
   point3f player_start,
   float player_angle,
   camera_t *camera,
-  bvh_t *bvh);
+  collision_mesh_t *mesh,
+  const allocator_t *allocator);
+
+void
+player_cleanup(void);
+
+point3f
+player_get_position(void);
 
+collision_context_t *
+player_get_context(void);
+
+/**
+ * Called once per rendered frame, turns the camera, applies the held speed keys
+ * and latches the triggered keys for the next tick.
+ */
+void
+player_input(float delta_time);
+
+/**
+ * Advances the player simulation by one fixed 'step'.
+ */
+void
+player_tick(float step);
+
+/**
+ * Places the camera between the last two ticks, 'alpha' in [0, 1) is the
+ * fraction of a step the render time is past the last tick.
+ */
 void
-player_update(float delta_time);
+player_render(float alpha);
 
 #ifdef __cplusplus
 }
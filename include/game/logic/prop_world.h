@@ -0,0 +1,174 @@
+/**
+ * @file prop_world.h
+ * @author khalilhenoud@gmail.com
+ * @brief rigid props colliding with the level and with each other, the resting
+ * islands are put to sleep.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef PROP_WORLD_H
+#define PROP_WORLD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <math/capsule.h>
+#include <math/vector3f.h>
+
+#define PROP_WORLD_NONE             ((uint32_t)-1)
+#define PROP_WORLD_BUCKETS          (1u << 14)
+#define PROP_MAX_FACE_CONTACTS      4
+#define PROP_CONTACT_WORLD          0x80000000u
+#define PROP_SOLVER_ITERATIONS      8
+#define PROP_GRAVITY                900.f
+#define PROP_SLEEP_SPEED            4.f
+#define PROP_SLEEP_TIME             0.5f
+
+
+typedef struct allocator_t allocator_t;
+typedef struct collision_mesh_t collision_mesh_t;
+
+typedef
+enum {
+  PROP_SHAPE_BOX,
+  PROP_SHAPE_SPHERE,
+  PROP_SHAPE_CAPSULE
+} prop_shape_t;
+
+// NOTE: every prop collides as the upright capsule 'capsule', a sphere has no
+// half height and a box is rounded into the capsule around its half extents
+// 'extents'. The props do not rotate, the capsule face helpers only handle
+// upright capsules. A sleeping prop has 'awake_index' PROP_WORLD_NONE and
+// is not touched by the step until an awake prop reaches it. 'next' and
+// 'previous' link the props of a bucket of the hash grid, 'bucket' is the one
+// of the cell holding the capsule center.
+typedef
+struct prop_body_t {
+  capsule_t capsule;
+  vector3f velocity;
+  vector3f extents;
+  uint32_t shape;
+  float inverse_mass;
+  float sleep_time;
+  uint32_t awake_index;
+  uint32_t bucket;
+  uint32_t next;
+  uint32_t previous;
+  uint32_t island;
+  uint32_t stamp;
+} prop_body_t;
+
+// NOTE: 'b' is a prop or PROP_CONTACT_WORLD | face index. 'normal' points from
+// 'b' to 'a'. The impulses are carried over to the same pair on the next step
+// to warm start the solver.
+typedef
+struct prop_contact_t {
+  uint32_t a;
+  uint32_t b;
+  vector3f normal;
+  float depth;
+  float normal_impulse;
+  vector3f friction_impulse;
+} prop_contact_t;
+
+// the work of the last step.
+typedef
+struct prop_world_stats_t {
+  uint32_t bodies;
+  uint32_t awake;
+  uint32_t islands;
+  uint32_t slept;
+  uint32_t woken;
+  uint32_t contacts;
+  uint32_t face_contacts;
+  uint32_t warm_started;
+  float step_ms;
+} prop_world_stats_t;
+
+// NOTE: the awake props are listed in 'awake', a step only walks them and the
+// contacts they make. The hash grid has cells of 'cell_size', twice the
+// bounding radius of the largest prop, so a prop only meets the props of the
+// 27 cells around its own. 'contacts' are sorted by (a, b) once built, the
+// previous ones are kept in 'cached' for the warm start.
+typedef
+struct prop_world_t {
+  const collision_mesh_t *mesh;
+  prop_body_t *bodies;
+  uint32_t count;
+  uint32_t capacity;
+  uint32_t *awake;
+  uint32_t awake_count;
+  uint32_t *buckets;
+  float cell_size;
+  uint32_t stamp;
+  prop_contact_t *contacts;
+  prop_contact_t *cached;
+  uint32_t contact_count;
+  uint32_t cached_count;
+  uint32_t contact_capacity;
+  prop_contact_t *face_contacts;
+  uint32_t *face_counts;
+  prop_world_stats_t stats;
+  const allocator_t *allocator;
+} prop_world_t;
+
+/**
+ * 'max_radius' bounds the capsule of any prop added later, radius plus half
+ * height. 'mesh' can be NULL, the props then only collide with each other.
+ */
+void
+prop_world_setup(
+  prop_world_t *world,
+  const collision_mesh_t *mesh,
+  const uint32_t capacity,
+  const float max_radius,
+  const allocator_t *allocator);
+
+void
+prop_world_cleanup(prop_world_t *world);
+
+/**
+ * Adds an awake prop, 'extents' are the half extents of a box, the radius of
+ * a sphere in extents[0] or the radius and the half height of a capsule in
+ * extents[0] and extents[1]. Returns its index or PROP_WORLD_NONE if the world
+ * is full.
+ */
+uint32_t
+prop_world_add(
+  prop_world_t *world,
+  const prop_shape_t shape,
+  const point3f *position,
+  const vector3f *extents,
+  const float mass);
+
+void
+prop_world_wake(
+  prop_world_t *world,
+  const uint32_t index);
+
+void
+prop_world_step(
+  prop_world_t *world,
+  const float delta_time);
+
+/**
+ * Drops 'count' props of mixed shapes in layers above 'center', spaced for
+ * props of 'size' half extents.
+ */
+uint32_t
+prop_world_drop(
+  prop_world_t *world,
+  const point3f *center,
+  const uint32_t count,
+  const float size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,80 @@
+/**
+ * @file ray_query.h
+ * @author khalilhenoud@gmail.com
+ * @brief batched ray queries against the level bvh, traversed in packets.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef RAY_QUERY_H
+#define RAY_QUERY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <math/vector3f.h>
+
+#define RAY_PACKET_WIDTH          4
+#define RAY_QUERY_BATCH_SIZE      64
+#define RAY_HIT_NONE              ((uint32_t)-1)
+
+
+typedef struct collision_mesh_t collision_mesh_t;
+
+typedef
+enum {
+  RAY_QUERY_ANY_HIT,
+  RAY_QUERY_CLOSEST_HIT
+} ray_query_mode_t;
+
+// NOTE: the ray covers 'origin + direction * t' for t in [0, length], the
+// direction need not be normalized, 't' is in units of its length.
+typedef
+struct ray_t {
+  point3f origin;
+  vector3f direction;
+  float length;
+} ray_t;
+
+// 'face_index' is the bvh face hit or RAY_HIT_NONE, 't' is the ray parameter
+// of the hit, or the ray length if nothing was hit. In any hit mode the face
+// is whichever was found first, not necessarily the closest.
+typedef
+struct ray_hit_t {
+  float t;
+  uint32_t face_index;
+} ray_hit_t;
+
+/**
+ * Casts 'count' rays on the calling thread, the rays are traversed in packets
+ * of RAY_PACKET_WIDTH. The faces are double sided.
+ */
+void
+ray_query(
+  const collision_mesh_t *mesh,
+  const ray_t *rays,
+  ray_hit_t *hits,
+  const uint32_t count,
+  const ray_query_mode_t mode);
+
+/**
+ * Same as 'ray_query' but splits the rays in batches of RAY_QUERY_BATCH_SIZE
+ * across the job system workers. Returns when all the rays are done.
+ */
+void
+ray_query_batch(
+  const collision_mesh_t *mesh,
+  const ray_t *rays,
+  ray_hit_t *hits,
+  const uint32_t count,
+  const ray_query_mode_t mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,58 @@
+/**
+ * @file sweep_validation.h
+ * @author khalilhenoud@gmail.com
+ * @brief compares the iterative and the closed form time of impact solvers.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef SWEEP_VALIDATION_H
+#define SWEEP_VALIDATION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+
+typedef struct capsule_t capsule_t;
+typedef struct face_t face_t;
+typedef struct vector3f vector3f;
+
+// errors are in world units, measured along the displacement.
+typedef
+struct sweep_validation_stats_t {
+  uint32_t sweeps;
+  uint32_t mismatches;
+  float max_error;
+  float mean_error;
+} sweep_validation_stats_t;
+
+/**
+ * Records a capsule face sweep, the oldest sweeps are overwritten once the
+ * recording buffer is full.
+ */
+void
+sweep_validation_record(
+  const capsule_t *capsule,
+  const face_t *face,
+  const vector3f *normal,
+  const vector3f *displacement,
+  const uint32_t iterations,
+  const float limit_distance);
+
+/**
+ * Runs both solvers on the recorded sweeps, accumulates the results in
+ * 'stats' and clears the recording.
+ */
+void
+sweep_validation_run(sweep_validation_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,161 @@
+/**
+ * @file trigger_set.h
+ * @author khalilhenoud@gmail.com
+ * @brief static trigger volumes binned in a grid, with overlap events.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef TRIGGER_SET_H
+#define TRIGGER_SET_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <math/vector3f.h>
+
+#define TRIGGER_SET_MAX_CELLS       (1u << 18)
+#define TRIGGER_SET_MAX_QUERY_CELLS 64
+#define TRIGGER_SET_NONE            ((uint32_t)-1)
+
+
+typedef struct allocator_t allocator_t;
+typedef struct capsule_t capsule_t;
+
+typedef
+enum {
+  TRIGGER_SHAPE_BOX,
+  TRIGGER_SHAPE_SPHERE,
+  TRIGGER_SHAPE_CAPSULE
+} trigger_shape_t;
+
+typedef
+enum {
+  TRIGGER_EVENT_ENTER,
+  TRIGGER_EVENT_STAY,
+  TRIGGER_EVENT_EXIT
+} trigger_event_type_t;
+
+// NOTE: boxes are axis aligned with 'extents' their half sizes. A sphere has
+// its radius in extents[0], a capsule is upright with its radius in extents[0]
+// and its half height in extents[1], like capsule_t. 'id' is left to the
+// caller, the scene node of the volume for the loaded ones.
+typedef
+struct trigger_volume_t {
+  uint32_t shape;
+  uint32_t id;
+  point3f center;
+  vector3f extents;
+} trigger_volume_t;
+
+// 'actor' is the index of the capsule in the update.
+typedef
+struct trigger_event_t {
+  uint32_t type;
+  uint32_t volume;
+  uint32_t actor;
+} trigger_event_t;
+
+// the work of the last update.
+typedef
+struct trigger_set_stats_t {
+  uint32_t actors;
+  uint32_t cells;
+  uint32_t tested;
+  uint32_t pairs;
+  uint32_t events[3];
+  float update_us;
+} trigger_set_stats_t;
+
+// NOTE: the volumes do not move once set up. 'bounds' holds the min and max
+// corners of every volume, 6 floats each, binned in an xz grid like the faces.
+// Cell (x, z) holds [starts[i], starts[i + 1]) of 'cells' with
+// i = x + z * cell_count[0]. An actor covering more than
+// TRIGGER_SET_MAX_QUERY_CELLS cells tests every volume instead. 'pairs' are
+// the overlaps of the last update as (volume << 32 | actor), sorted, the
+// events are the difference with the previous ones. 'stamps' keeps a volume
+// found in several cells from being tested twice by the same actor.
+typedef
+struct trigger_set_t {
+  trigger_volume_t *volumes;
+  float *bounds;
+  uint32_t volume_count;
+  uint32_t *starts;
+  uint32_t *cells;
+  uint32_t cell_count[2];
+  float origin[2];
+  float cell_size;
+  float inverse_cell_size;
+  uint32_t *stamps;
+  uint32_t stamp;
+  uint64_t *pairs;
+  uint64_t *previous;
+  uint32_t pair_count;
+  uint32_t previous_count;
+  uint32_t pair_capacity;
+  trigger_event_t *events;
+  uint32_t event_count;
+  uint32_t event_capacity;
+  trigger_set_stats_t stats;
+  const allocator_t *allocator;
+} trigger_set_t;
+
+// update cost of the grid and of testing every volume, at growing volume
+// counts spread over a growing area so the density stays the same.
+typedef
+struct trigger_set_bench_t {
+  uint32_t counts[3];
+  float grid_us[3];
+  float brute_us[3];
+  uint32_t mismatches;
+} trigger_set_bench_t;
+
+void
+trigger_set_setup(
+  trigger_set_t *set,
+  const trigger_volume_t *volumes,
+  const uint32_t count,
+  const allocator_t *allocator);
+
+void
+trigger_set_cleanup(trigger_set_t *set);
+
+/**
+ * Finds the volumes overlapping each of the upright 'actors' and writes the
+ * enter, stay and exit events to 'events', sorted by volume then actor. The
+ * actor indices must keep their meaning from one update to the next.
+ */
+void
+trigger_set_update(
+  trigger_set_t *set,
+  const capsule_t *actors,
+  const uint32_t actor_count);
+
+/**
+ * Returns 1 if the upright 'capsule' overlaps 'volume', 0 otherwise.
+ */
+int32_t
+trigger_volume_overlaps(
+  const trigger_volume_t *volume,
+  const capsule_t *capsule);
+
+/**
+ * Times the updates of 'actor_count' random actors against random volumes,
+ * the grid results are checked against the brute force ones.
+ */
+void
+trigger_set_benchmark(
+  const uint32_t actor_count,
+  const float actor_radius,
+  const allocator_t *allocator,
+  trigger_set_bench_t *bench);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,128 @@
+/**
+ * @file wide_bvh.h
+ * @author khalilhenoud@gmail.com
+ * @brief 4 wide bvh with quantized child bounds, one node per cache line.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef WIDE_BVH_H
+#define WIDE_BVH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <game/logic/bvh_query.h>
+#include <spatial/bvh/bvh.h>
+
+#define WIDE_BVH_WIDTH            4
+#define WIDE_BVH_EMPTY            ((uint32_t)-1)
+#define WIDE_BVH_LEAF_BIT         0x80000000u
+#define WIDE_BVH_LEAF_COUNT_BITS  5
+#define WIDE_BVH_MAX_LEAF_SIZE    (1u << WIDE_BVH_LEAF_COUNT_BITS)
+
+
+typedef struct allocator_t allocator_t;
+typedef struct capsule_t capsule_t;
+typedef struct collision_mesh_t collision_mesh_t;
+
+// NOTE: the child bounds are quantized to 16 bits relative to the bounds of
+// the node itself, which are decoded from its parent (the root bounds are kept
+// as floats). The quantization rounds outwards, the decoded bounds contain the
+// exact ones. A child is WIDE_BVH_EMPTY, a node index, or WIDE_BVH_LEAF_BIT |
+// first face << 5 | (face count - 1).
+typedef
+struct wide_bvh_node_t {
+  uint16_t min[3][WIDE_BVH_WIDTH];
+  uint16_t max[3][WIDE_BVH_WIDTH];
+  uint32_t children[WIDE_BVH_WIDTH];
+} wide_bvh_node_t;
+
+// NOTE: 'revision' is the mesh revision the tree was built from, the tree is
+// not refit when the dynamic faces move.
+typedef
+struct wide_bvh_t {
+  wide_bvh_node_t *nodes;
+  void *allocation;
+  uint32_t count;
+  uint32_t revision;
+  bvh_aabb_t bounds;
+} wide_bvh_t;
+
+// the average nodes visited and 64 bytes lines touched per query, for the
+// binary and the wide layouts over the same queries.
+typedef
+struct wide_bvh_stats_t {
+  uint32_t binary_nodes;
+  uint32_t wide_nodes;
+  uint32_t binary_bytes;
+  uint32_t wide_bytes;
+  uint32_t queries;
+  float binary_visits;
+  float wide_visits;
+  float binary_lines;
+  float wide_lines;
+} wide_bvh_stats_t;
+
+/**
+ * Collapses the binary bvh into a 4 wide one, the leaves keep their faces.
+ */
+void
+wide_bvh_setup(
+  wide_bvh_t *wide,
+  const bvh_t *bvh,
+  const uint32_t revision,
+  const allocator_t *allocator);
+
+void
+wide_bvh_cleanup(
+  wide_bvh_t *wide,
+  const allocator_t *allocator);
+
+/**
+ * Same contract as 'bvh_query_faces', the children are tested 4 at a time.
+ * The number of nodes visited is added to 'visited' if not NULL.
+ */
+int32_t
+wide_bvh_query_faces(
+  const collision_mesh_t *mesh,
+  const wide_bvh_t *wide,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data,
+  uint32_t *visited);
+
+/**
+ * Returns the mask of the children of 'node' overlapping 'bounds', the node
+ * bounds are 'node_bounds'. The decoded child bounds are written to 'out'.
+ */
+uint32_t
+wide_bvh_node_mask(
+  const wide_bvh_node_t *node,
+  const bvh_aabb_t *node_bounds,
+  const bvh_aabb_t *bounds,
+  bvh_aabb_t out[WIDE_BVH_WIDTH]);
+
+/**
+ * Runs the bounds of 'capsule' centered on every 'stride'th face through both
+ * layouts and averages the nodes visited and the cache lines touched. A
+ * 'stride' of 0 only fills the node counts and sizes.
+ */
+void
+wide_bvh_compare(
+  const collision_mesh_t *mesh,
+  const capsule_t *capsule,
+  const uint32_t stride,
+  wide_bvh_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
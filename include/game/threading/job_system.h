@@ -0,0 +1,65 @@
+/**
+ * @file job_system.h
+ * @author khalilhenoud@gmail.com
+ * @brief fixed pool of worker threads running data parallel loops.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+// the calling thread always takes part, it is slot 0.
+#define JOB_SYSTEM_MAX_THREADS    8
+
+
+/**
+ * Processes the items [first, last), called from any of the threads.
+ */
+typedef void (*job_range_t)(uint32_t first, uint32_t last, void *user_data);
+
+/**
+ * Starts 'worker_count' workers, 0 picks the hardware concurrency minus the
+ * calling thread. Capped to JOB_SYSTEM_MAX_THREADS - 1.
+ */
+void
+job_system_init(uint32_t worker_count);
+
+void
+job_system_shutdown(void);
+
+uint32_t
+job_system_thread_count(void);
+
+/**
+ * Returns the slot of the calling thread in [0, JOB_SYSTEM_MAX_THREADS), 0 for
+ * any thread that is not a worker. Used to index per thread buffers.
+ */
+uint32_t
+job_system_thread_slot(void);
+
+/**
+ * Splits [0, count) in ranges of 'batch_size' items and runs 'job' on them
+ * across the workers and the calling thread. Returns when all are done. Runs
+ * inline if there are no workers or a single batch.
+ */
+void
+parallel_for(
+  const uint32_t count,
+  const uint32_t batch_size,
+  job_range_t job,
+  void *user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -11,6 +11,7 @@
 #include <assert.h>
 #include <string.h>
 #include <game/debug/face.h>
+#include <game/threading/job_system.h>
 #include <math/face.h>
 #include <renderer/pipeline.h>
 #include <renderer/renderer_opengl.h>
@@ -33,7 +34,8 @@ struct {
 } debug_face_frame_t;
 
 ////////////////////////////////////////////////////////////////////////////////
-static debug_face_frame_t debug_frame;
+// one frame per thread, the agents push their debug faces from the workers.
+static debug_face_frame_t debug_frames[JOB_SYSTEM_MAX_THREADS];
 
 void
 add_debug_face_to_frame(
@@ -42,13 +44,15 @@ add_debug_face_to_frame(
   debug_color_t color,
   int32_t thickness)
 {
+  debug_face_frame_t *debug_frame = debug_frames + job_system_thread_slot();
   assert(face && normal && "face or normal is null!");
-  assert(
-    debug_frame.used < DEBUG_FACES_MAX_COUNT &&
-    "reached the limit of debug faces!");
+
+  // with many agents drawing their queries the frame fills up, drop the rest.
+  if (debug_frame->used == DEBUG_FACES_MAX_COUNT)
+    return;
 
   {
-    debug_face_t *debug_face = debug_frame.faces + debug_frame.used++;
+    debug_face_t *debug_face = debug_frame->faces + debug_frame->used++;
     debug_face->face = *face;
     debug_face->normal = *normal;
     debug_face->color = color;
@@ -97,15 +101,19 @@ draw_debug_face_frame(
   pipeline_t *pipeline,
   const int32_t disable_depth)
 {
-  for (uint32_t i = 0; i < debug_frame.used; ++i) {
-    draw_debug_face(
-      &debug_frame.faces[i].face,
-      &debug_frame.faces[i].normal,
-      &debug_frame.faces[i].color,
-      debug_frame.faces[i].thickness,
-      pipeline,
-      disable_depth);
-  }
+  for (uint32_t slot = 0; slot < JOB_SYSTEM_MAX_THREADS; ++slot) {
+    debug_face_frame_t *debug_frame = debug_frames + slot;
 
-  debug_frame.used = 0;
+    for (uint32_t i = 0; i < debug_frame->used; ++i) {
+      draw_debug_face(
+        &debug_frame->faces[i].face,
+        &debug_frame->faces[i].normal,
+        &debug_frame->faces[i].color,
+        debug_frame->faces[i].thickness,
+        pipeline,
+        disable_depth);
+    }
+
+    debug_frame->used = 0;
+  }
 }
\ No newline at end of file
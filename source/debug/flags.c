@@ -19,6 +19,20 @@
 #define KEY_DISABLE_DEPTH         '7'
 #define KEY_MOVEMENT_LOCK         '8'
 #define KEY_DRAW_STEP_UP_FACE     'P'
+#define KEY_SCALAR_COLLISION      'O'
+#define KEY_ANALYTIC_TOI          'I'
+#define KEY_VALIDATE_TOI          'U'
+#define KEY_CANDIDATE_CACHE       'Y'
+#define KEY_LEGACY_BUCKETS        'T'
+#define KEY_DIFF_BUCKETS          'R'
+#define KEY_RECORD_COLLISION      'L'
+#define KEY_REBUILD_BVH           'B'
+#define KEY_WIDE_BVH              'G'
+#define KEY_COUNT_COLLISION       'V'
+#define KEY_FUSED_QUERIES         'F'
+#define KEY_INTERNAL_CONTACTS     'X'
+#define KEY_GROUND_GRID           'Z'
+#define KEY_MERGED_SWEEP_BOUNDS   'K'
 
 
 debug_flags_t g_debug_flags;
@@ -49,6 +63,48 @@ push_debug_flags_to_text_frame(void)
   add_debug_text_to_frame(
     "[P] DRAW STEP UP FACE",
     g_debug_flags.draw_step_up ? red : white, 0.f, (y+=20.f));
+  add_debug_text_to_frame(
+    "[O] USE SCALAR COLLISION PATH",
+    g_debug_flags.use_scalar_collision ? red : white, 0.f, (y+=20.f));
+  add_debug_text_to_frame(
+    "[I] USE ANALYTIC TIME OF IMPACT",
+    g_debug_flags.use_analytic_toi ? red : white, 0.f, (y+=20.f));
+  add_debug_text_to_frame(
+    "[U] VALIDATE TIME OF IMPACT",
+    g_debug_flags.validate_toi ? red : white, 0.f, (y+=20.f));
+  add_debug_text_to_frame(
+    "[Y] DISABLE CANDIDATE CACHE",
+    g_debug_flags.disable_candidate_cache ? red : white, 0.f, (y+=20.f));
+  add_debug_text_to_frame(
+    "[T] USE PAIRWISE BUCKETS",
+    g_debug_flags.use_legacy_buckets ? red : white, 0.f, (y+=20.f));
+  add_debug_text_to_frame(
+    "[R] DIFF BUCKET PROCESSING",
+    g_debug_flags.diff_buckets ? red : white, 0.f, (y+=20.f));
+  add_debug_text_to_frame(
+    "[L] RECORD COLLISION QUERIES",
+    g_debug_flags.record_collision ? red : white, 0.f, (y+=20.f));
+  add_debug_text_to_frame(
+    "[B] REBUILD BVH ON LOAD",
+    g_debug_flags.rebuild_bvh ? red : white, 0.f, (y+=20.f));
+  add_debug_text_to_frame(
+    "[G] USE WIDE BVH",
+    g_debug_flags.use_wide_bvh ? red : white, 0.f, (y+=20.f));
+  add_debug_text_to_frame(
+    "[V] COUNT COLLISION WORK",
+    g_debug_flags.count_collision_work ? red : white, 0.f, (y+=20.f));
+  add_debug_text_to_frame(
+    "[F] DISABLE FUSED QUERIES",
+    g_debug_flags.disable_fused_queries ? red : white, 0.f, (y+=20.f));
+  add_debug_text_to_frame(
+    "[X] KEEP INTERNAL EDGE CONTACTS",
+    g_debug_flags.keep_internal_contacts ? red : white, 0.f, (y+=20.f));
+  add_debug_text_to_frame(
+    "[Z] DISABLE GROUND GRID",
+    g_debug_flags.disable_ground_grid ? red : white, 0.f, (y+=20.f));
+  add_debug_text_to_frame(
+    "[K] USE MERGED SWEEP BOUNDS",
+    g_debug_flags.use_merged_sweep_bounds ? red : white, 0.f, (y+=20.f));
 }
 
 void
@@ -75,5 +131,50 @@ update_debug_flags(void)
   if (is_key_triggered(KEY_DRAW_STEP_UP_FACE))
     g_debug_flags.draw_step_up = !g_debug_flags.draw_step_up;
 
+  if (is_key_triggered(KEY_SCALAR_COLLISION))
+    g_debug_flags.use_scalar_collision = !g_debug_flags.use_scalar_collision;
+
+  if (is_key_triggered(KEY_ANALYTIC_TOI))
+    g_debug_flags.use_analytic_toi = !g_debug_flags.use_analytic_toi;
+
+  if (is_key_triggered(KEY_VALIDATE_TOI))
+    g_debug_flags.validate_toi = !g_debug_flags.validate_toi;
+
+  if (is_key_triggered(KEY_CANDIDATE_CACHE))
+    g_debug_flags.disable_candidate_cache =
+      !g_debug_flags.disable_candidate_cache;
+
+  if (is_key_triggered(KEY_LEGACY_BUCKETS))
+    g_debug_flags.use_legacy_buckets = !g_debug_flags.use_legacy_buckets;
+
+  if (is_key_triggered(KEY_DIFF_BUCKETS))
+    g_debug_flags.diff_buckets = !g_debug_flags.diff_buckets;
+
+  if (is_key_triggered(KEY_RECORD_COLLISION))
+    g_debug_flags.record_collision = !g_debug_flags.record_collision;
+
+  if (is_key_triggered(KEY_REBUILD_BVH))
+    g_debug_flags.rebuild_bvh = !g_debug_flags.rebuild_bvh;
+
+  if (is_key_triggered(KEY_WIDE_BVH))
+    g_debug_flags.use_wide_bvh = !g_debug_flags.use_wide_bvh;
+
+  if (is_key_triggered(KEY_COUNT_COLLISION))
+    g_debug_flags.count_collision_work = !g_debug_flags.count_collision_work;
+
+  if (is_key_triggered(KEY_FUSED_QUERIES))
+    g_debug_flags.disable_fused_queries = !g_debug_flags.disable_fused_queries;
+
+  if (is_key_triggered(KEY_INTERNAL_CONTACTS))
+    g_debug_flags.keep_internal_contacts =
+      !g_debug_flags.keep_internal_contacts;
+
+  if (is_key_triggered(KEY_GROUND_GRID))
+    g_debug_flags.disable_ground_grid = !g_debug_flags.disable_ground_grid;
+
+  if (is_key_triggered(KEY_MERGED_SWEEP_BOUNDS))
+    g_debug_flags.use_merged_sweep_bounds =
+      !g_debug_flags.use_merged_sweep_bounds;
+
   push_debug_flags_to_text_frame();
 }
\ No newline at end of file
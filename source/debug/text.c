@@ -11,6 +11,7 @@
 #include <assert.h>
 #include <string.h>
 #include <game/debug/text.h>
+#include <game/threading/job_system.h>
 #include <entity/runtime/font.h>
 #include <renderer/pipeline.h>
 #include <renderer/renderer_opengl.h>
@@ -33,7 +34,8 @@ struct {
 } debug_text_frame_t;
 
 ////////////////////////////////////////////////////////////////////////////////
-static debug_text_frame_t debug_frame;
+// one frame per thread, the agents push their debug text from the workers.
+static debug_text_frame_t debug_frames[JOB_SYSTEM_MAX_THREADS];
 
 void
 add_debug_text_to_frame(
@@ -42,15 +44,17 @@ add_debug_text_to_frame(
   float x,
   float y)
 {
+  debug_text_frame_t *debug_frame = debug_frames + job_system_thread_slot();
   assert(
     strlen(text) < DEBUG_TEXT_MAX_SIZE &&
     "'text' is too long, keep it less than 256!");
-  assert(
-    debug_frame.used < DEBUG_TEXT_MAX_ALLOWED &&
-    "exceeded max allowed debug text entries per frame!");
+
+  // with many agents reporting their state the frame fills up, drop the rest.
+  if (debug_frame->used == DEBUG_TEXT_MAX_ALLOWED)
+    return;
 
   {
-    debug_text_t *dst = debug_frame.text + debug_frame.used++;
+    debug_text_t *dst = debug_frame->text + debug_frame->used++;
     memset(dst->text, 0, sizeof(dst->text));
     memcpy(dst->text, text, strlen(text));
 
@@ -68,20 +72,24 @@ draw_debug_text_frame(
   const uint32_t font_image_id)
 {
   const char *text;
-  for (uint32_t i = 0; i < debug_frame.used; ++i) {
-    text = debug_frame.text[i].text;
-    render_text_to_screen(
-      font,
-      font_image_id,
-      pipeline,
-      &text,
-      1,
-      debug_frame.text[i].color,
-      debug_frame.text[i].x,
-      debug_frame.text[i].y);
-  }
+  for (uint32_t slot = 0; slot < JOB_SYSTEM_MAX_THREADS; ++slot) {
+    debug_text_frame_t *debug_frame = debug_frames + slot;
+
+    for (uint32_t i = 0; i < debug_frame->used; ++i) {
+      text = debug_frame->text[i].text;
+      render_text_to_screen(
+        font,
+        font_image_id,
+        pipeline,
+        &text,
+        1,
+        debug_frame->text[i].color,
+        debug_frame->text[i].x,
+        debug_frame->text[i].y);
+    }
 
-  debug_frame.used = 0;
+    debug_frame->used = 0;
+  }
 }
 
 void
@@ -14,6 +14,7 @@
 #include <game/levels/generic_level.h>
 #include <game/levels/room_select.h>
 #include <game/memory_tracking/memory_tracking.h>
+#include <game/threading/job_system.h>
 #include <entity/level/level.h>
 #include <library/allocator/allocator.h>
 #include <library/os/os.h>
@@ -123,6 +124,7 @@ game_init(
 
   set_periodic_timers_resolution(1);
   track_allocator_memory(&allocator);
+  job_system_init(0);
 
   input_set_client(window_data.handle);
 
@@ -136,6 +138,7 @@ void
 game_cleanup()
 {
   level_cleanup();
+  job_system_shutdown();
 
   opengl_cleanup();
   destroy_window(&window_data);
@@ -9,24 +9,69 @@
  *
  */
 #include <assert.h>
+#include <math.h>
+#include <string.h>
 #include <game/debug/flags.h>
 #include <game/debug/text.h>
 #include <game/input/input.h>
 #include <game/levels/utils.h>
+#include <game/logic/agent.h>
+#include <game/logic/agent_pool.h>
+#include <game/logic/bvh_build.h>
+#include <game/logic/bvh_query.h>
+#include <game/logic/bvh_refit.h>
+#include <game/logic/collision_context.h>
+#include <game/logic/collision_counters.h>
+#include <game/logic/collision_mesh.h>
+#include <game/logic/collision_recorder.h>
+#include <game/logic/collision_utils.h>
+#include <game/logic/collision_variant.h>
+#include <game/logic/face_grid.h>
+#include <game/logic/ground_grid.h>
+#include <game/logic/fixed_step.h>
+#include <game/logic/navmesh.h>
+#include <game/logic/path_scheduler.h>
 #include <game/logic/player.h>
+#include <game/logic/prop_world.h>
+#include <game/logic/ray_query.h>
+#include <game/logic/trigger_set.h>
+#include <game/logic/wide_bvh.h>
 #include <game/rendering/render_data.h>
+#include <game/threading/job_system.h>
 #include <entity/level/level.h>
 #include <entity/runtime/font.h>
 #include <entity/runtime/font_utils.h>
 #include <entity/scene/camera.h>
 #include <entity/scene/scene.h>
 #include <library/framerate_controller/framerate_controller.h>
+#include <math/matrix4f.h>
 #include <renderer/pipeline.h>
 #include <renderer/renderer_opengl.h>
 #include <spatial/bvh/bvh.h>
 
 #define TILDE   0xC0
 #define KEY_EXIT_LEVEL           '0'
+#define KEY_SPAWN_AGENTS         'N'
+#define AGENT_POOL_CAPACITY      256
+#define AGENT_SPAWN_COUNT        16
+#define KEY_TICK_RATE            'M'
+#define DEFAULT_TICK_RATE        60
+#define KEY_MOVING_PLATFORM      'H'
+#define PLATFORM_EXTENT          96.f
+#define PLATFORM_SPIN            0.5f
+#define PLATFORM_BOB             32.f
+#define WIDE_BVH_COMPARE_STRIDE  8
+#define KEY_BROADPHASE           'J'
+#define BROADPHASE_BENCH_STRIDE  4
+#define NAVMESH_BENCH_PATHS      1000
+#define PATH_BUDGET_MS           1.f
+#define PATH_CACHE_SETS          64
+#define TRIGGER_BENCH_ACTORS     64
+#define KEY_RUN_BENCHMARKS       0xBD
+#define KEY_DROP_PROPS           0xBB
+#define PROP_WORLD_CAPACITY      4096
+#define PROP_DROP_COUNT          1024
+#define PROP_SIZE                8.f
 
 
 static framerate_controller_t *controller;
@@ -39,6 +84,29 @@ static packaged_scene_render_data_t* render_data;
 static font_runtime_t* font;
 static uint32_t font_image_id;
 static bvh_t* bvh;
+static collision_mesh_t* collision_mesh;
+static agent_pool_t agent_pool;
+static fixed_step_t fixed_step;
+static char level_name[256];
+static bvh_refit_t bvh_refit;
+static bvh_build_stats_t bvh_stats[2];
+static uint32_t bvh_rebuilt;
+static wide_bvh_stats_t wide_stats;
+static face_grid_stats_t grid_stats;
+static uint64_t counters_frame;
+static uint32_t platform;
+static uint32_t platform_moving;
+static point3f platform_center;
+static float platform_time;
+static navmesh_t navmesh;
+static navmesh_query_t nav_query;
+static navmesh_stats_t nav_stats;
+static path_scheduler_t path_scheduler;
+static uint32_t agent_paths[AGENT_POOL_CAPACITY];
+static trigger_set_t triggers;
+static trigger_set_bench_t trigger_bench;
+static uint32_t player_triggers;
+static prop_world_t props;
 
 static
 void
@@ -48,6 +116,8 @@ load_level(
 {
   char room[256] = {0};
   sprintf(room, "rooms\\%s", context.level);
+  snprintf(level_name, sizeof(level_name), "%s", context.level);
+  collision_variant_select();
   scene = load_scene(context.data_set, room, context.level, allocator);
   create_default_camera(scene, camera);
   create_default_light(scene, allocator);
@@ -59,6 +129,63 @@ load_level(
   font = cvector_as(&render_data->font_data.fonts, 0, font_runtime_t);
   font_image_id = *cvector_as(&render_data->font_data.texture_ids, 0, uint32_t);
   bvh = (scene->bvh_repo.size) ? cvector_as(&scene->bvh_repo, 0, bvh_t) : NULL;
+  bvh_rebuilt = 0;
+  if (bvh) {
+    bvh_build_metrics(bvh, bvh_stats + 0, allocator);
+    if (g_debug_flags.rebuild_bvh) {
+      bvh_build_sah(bvh, bvh_stats + 1, allocator);
+      bvh_rebuilt = 1;
+    }
+  }
+  // the snapping probes extend the floor faces by the player's diameter.
+  collision_mesh = bvh ?
+    load_collision_mesh(bvh, PLAYER_CAPSULE_RADIUS * 2.f, allocator) : NULL;
+  if (collision_mesh) {
+    capsule_t capsule;
+    capsule.radius = PLAYER_CAPSULE_RADIUS;
+    capsule.half_height = PLAYER_CAPSULE_HALF_HEIGHT;
+
+    // only the sizes at load, the queries are timed on demand.
+    wide_bvh_compare(collision_mesh, &capsule, 0, &wide_stats);
+    face_grid_setup(
+      &collision_mesh->grid, bvh,
+      PLAYER_CAPSULE_RADIUS, collision_mesh->revision, allocator);
+    face_grid_benchmark(collision_mesh, &capsule, 0, &grid_stats);
+    collision_mesh->broadphase = COLLISION_BROADPHASE_BVH;
+
+    // the snap probes of every agent go through the floor faces only.
+    ground_grid_setup(
+      &collision_mesh->ground, collision_mesh,
+      PLAYER_CAPSULE_RADIUS, allocator);
+
+    // the snap probe lifts the player over anything up to a radius high.
+    navmesh_setup(
+      &navmesh, collision_mesh,
+      PLAYER_CAPSULE_RADIUS, PLAYER_CAPSULE_RADIUS, allocator);
+    navmesh_query_setup(&nav_query, &navmesh, allocator);
+    navmesh_benchmark(&navmesh, &nav_query, 0, &nav_stats);
+    path_scheduler_setup(
+      &path_scheduler, &navmesh,
+      AGENT_POOL_CAPACITY, PATH_CACHE_SETS, allocator);
+  }
+
+  for (uint32_t i = 0; i < AGENT_POOL_CAPACITY; ++i)
+    agent_paths[i] = PATH_SCHEDULER_NONE;
+
+  {
+    uint32_t count = load_trigger_volumes(scene, NULL, 0);
+    trigger_volume_t *volumes =
+      allocator->mem_alloc(sizeof(trigger_volume_t) * (count + 1));
+    load_trigger_volumes(scene, volumes, count);
+    trigger_set_setup(&triggers, volumes, count, allocator);
+    allocator->mem_free(volumes);
+    memset(&trigger_bench, 0, sizeof(trigger_bench));
+    player_triggers = 0;
+  }
+
+  // the capsules of the dropped shapes reach 1.5 times their size.
+  prop_world_setup(
+    &props, collision_mesh, PROP_WORLD_CAPACITY, PROP_SIZE * 1.5f, allocator);
 
   setup_view_projection_pipeline(&context, &pipeline);
   show_mouse_cursor(0);
@@ -67,11 +194,504 @@ load_level(
     scene->metadata.player_start,
     scene->metadata.player_angle,
     camera,
-    bvh);
+    collision_mesh,
+    allocator);
+  agent_pool_setup(
+    &agent_pool, AGENT_POOL_CAPACITY, collision_mesh, allocator);
+  if (collision_mesh)
+    bvh_refit_setup(&bvh_refit, collision_mesh, allocator);
+  platform = BVH_REFIT_NONE;
+  platform_moving = 0;
+  platform_time = 0.f;
 
   controller = controller_allocate(allocator, 60, 1u);
   exit_level = 0;
   disable_input = 0;
+  fixed_step_setup(&fixed_step, DEFAULT_TICK_RATE);
+}
+
+// line of sight from the player to every agent, an agent is visible when the
+// segment between them hits nothing.
+static
+uint32_t
+count_visible_agents(void)
+{
+  static ray_t rays[AGENT_POOL_CAPACITY];
+  static ray_hit_t hits[AGENT_POOL_CAPACITY];
+  point3f eye = player_get_position();
+  uint32_t visible = 0;
+
+  if (!collision_mesh)
+    return agent_pool.count;
+
+  for (uint32_t i = 0; i < agent_pool.count; ++i) {
+    rays[i].origin = eye;
+    rays[i].direction =
+      diff_v3f(&agent_pool.agents[i].capsule.center, &eye);
+    rays[i].length = 1.f;
+  }
+
+  ray_query_batch(
+    collision_mesh, rays, hits, agent_pool.count, RAY_QUERY_ANY_HIT);
+
+  for (uint32_t i = 0; i < agent_pool.count; ++i)
+    visible += hits[i].face_index == RAY_HIT_NONE;
+
+  return visible;
+}
+
+static
+void
+update_agents(void)
+{
+  char text[256];
+
+  // the npcs spawn on the player and wander off in random directions.
+  if (collision_mesh && is_key_triggered(KEY_SPAWN_AGENTS)) {
+    for (uint32_t i = 0; i < AGENT_SPAWN_COUNT; ++i)
+      agent_pool_spawn(&agent_pool, player_get_position());
+  }
+
+  snprintf(
+    text, sizeof(text),
+    "[N] SPAWN AGENTS: %u/%u     VISIBLE: %u     THREADS: %u",
+    agent_pool.count, agent_pool.capacity, count_visible_agents(),
+    job_system_thread_count());
+  add_debug_text_to_frame(text, white, 400.f, 380.f);
+}
+
+// every agent keeps a path to the player in flight, a new one is requested as
+// soon as the last completes.
+static
+void
+update_paths(void)
+{
+  char text[256];
+  const path_scheduler_stats_t *stats = &path_scheduler.stats;
+  point3f goal = player_get_position();
+
+  if (!collision_mesh)
+    return;
+
+  for (uint32_t i = 0; i < agent_pool.count; ++i) {
+    uint32_t status = agent_paths[i] == PATH_SCHEDULER_NONE ?
+      PATH_REQUEST_FREE :
+      path_scheduler_status(&path_scheduler, agent_paths[i]);
+
+    if (status == PATH_REQUEST_QUEUED || status == PATH_REQUEST_RUNNING)
+      continue;
+
+    if (agent_paths[i] != PATH_SCHEDULER_NONE)
+      path_scheduler_release(&path_scheduler, agent_paths[i]);
+    agent_paths[i] = path_scheduler_request(
+      &path_scheduler, &agent_pool.agents[i].capsule.center, &goal);
+  }
+
+  path_scheduler_update(&path_scheduler, PATH_BUDGET_MS);
+
+  snprintf(
+    text, sizeof(text),
+    "PATHS: %.2f/%.2fMS     STARTED: %u     FOUND: %u     FAILED: %u     "
+    "CACHED: %u     RUNNING: %u     WAITING: %u     EXPANDED: %u",
+    stats->update_ms, stats->budget_ms, stats->started, stats->found,
+    stats->failed, stats->cache_hits, stats->running, stats->waiting,
+    stats->expanded);
+  add_debug_text_to_frame(
+    text, stats->update_ms > stats->budget_ms ? red : white, 400.f, 640.f);
+}
+
+// the player is actor 0, the agents follow in pool order.
+static
+void
+update_triggers(void)
+{
+  static capsule_t actors[AGENT_POOL_CAPACITY + 1];
+  const trigger_set_stats_t *stats = &triggers.stats;
+  char text[256];
+
+  actors[0].center = player_get_position();
+  actors[0].radius = PLAYER_CAPSULE_RADIUS;
+  actors[0].half_height = PLAYER_CAPSULE_HALF_HEIGHT;
+  for (uint32_t i = 0; i < agent_pool.count; ++i)
+    actors[i + 1] = agent_pool.agents[i].capsule;
+
+  trigger_set_update(&triggers, actors, agent_pool.count + 1);
+
+  for (uint32_t i = 0; i < triggers.event_count; ++i) {
+    const trigger_event_t *event = triggers.events + i;
+    if (event->actor == 0 && event->type == TRIGGER_EVENT_ENTER)
+      player_triggers++;
+    else if (event->actor == 0 && event->type == TRIGGER_EVENT_EXIT)
+      player_triggers--;
+  }
+
+  snprintf(
+    text, sizeof(text),
+    "TRIGGERS: %u     PLAYER IN: %u     ENTER: %u     STAY: %u     EXIT: %u"
+    "     TESTED: %u     US: %.1f",
+    triggers.volume_count, player_triggers,
+    stats->events[TRIGGER_EVENT_ENTER], stats->events[TRIGGER_EVENT_STAY],
+    stats->events[TRIGGER_EVENT_EXIT], stats->tested, stats->update_us);
+  add_debug_text_to_frame(
+    text, player_triggers ? green : white, 400.f, 660.f);
+
+  if (!trigger_bench.counts[0])
+    return;
+
+  snprintf(
+    text, sizeof(text),
+    "TRIGGER BENCH (GRID/ALL US): %u: %.1f/%.1f     %u: %.1f/%.1f     "
+    "%u: %.1f/%.1f     MISMATCHES: %u",
+    trigger_bench.counts[0], trigger_bench.grid_us[0],
+    trigger_bench.brute_us[0],
+    trigger_bench.counts[1], trigger_bench.grid_us[1],
+    trigger_bench.brute_us[1],
+    trigger_bench.counts[2], trigger_bench.grid_us[2],
+    trigger_bench.brute_us[2],
+    trigger_bench.mismatches);
+  add_debug_text_to_frame(text, white, 400.f, 680.f);
+}
+
+// the synthetic benchmarks are too slow to run on every load, they run on
+// demand and their results stay on the HUD until the next run.
+static
+void
+run_benchmarks(const allocator_t *allocator)
+{
+  trigger_set_benchmark(
+    TRIGGER_BENCH_ACTORS, PLAYER_CAPSULE_RADIUS, allocator, &trigger_bench);
+
+  if (collision_mesh) {
+    capsule_t capsule;
+    capsule.radius = PLAYER_CAPSULE_RADIUS;
+    capsule.half_height = PLAYER_CAPSULE_HALF_HEIGHT;
+    wide_bvh_compare(
+      collision_mesh, &capsule, WIDE_BVH_COMPARE_STRIDE, &wide_stats);
+
+    // the room keeps whichever broadphase answered the benchmark faster.
+    face_grid_benchmark(
+      collision_mesh, &capsule, BROADPHASE_BENCH_STRIDE, &grid_stats);
+    collision_mesh->broadphase =
+      (grid_stats.grid_us < grid_stats.bvh_us && !grid_stats.mismatches) ?
+      COLLISION_BROADPHASE_GRID : COLLISION_BROADPHASE_BVH;
+
+    navmesh_benchmark(&navmesh, &nav_query, NAVMESH_BENCH_PATHS, &nav_stats);
+  }
+}
+
+// the props drop in layers above the player, the step time shows what the
+// awake ones cost once the rest went to sleep.
+static
+void
+update_props(void)
+{
+  char text[256];
+  const prop_world_stats_t *stats = &props.stats;
+
+  if (is_key_triggered(KEY_DROP_PROPS)) {
+    point3f center = player_get_position();
+    prop_world_drop(&props, &center, PROP_DROP_COUNT, PROP_SIZE);
+  }
+
+  snprintf(
+    text, sizeof(text),
+    "[=] DROP PROPS: %u/%u     AWAKE: %u     ISLANDS: %u     CONTACTS: %u     "
+    "WORLD: %u     WARM: %u     STEP: %.2fMS",
+    props.count, props.capacity, stats->awake, stats->islands,
+    stats->contacts, stats->face_contacts, stats->warm_started,
+    stats->step_ms);
+  add_debug_text_to_frame(
+    text, stats->awake ? green : white, 400.f, 700.f);
+}
+
+static
+void
+draw_bvh_stats(void)
+{
+  char text[256];
+  const bvh_build_stats_t *stats = bvh_stats + (bvh_rebuilt ? 1 : 0);
+  int32_t used;
+
+  if (!bvh)
+    return;
+
+  snprintf(
+    text, sizeof(text),
+    "BVH SAH: %.2f     DEPTH: %u     NODES: %u     LEAVES: %u",
+    stats->sah_cost, stats->max_depth, stats->node_count, stats->leaf_count);
+  add_debug_text_to_frame(text, white, 400.f, 440.f);
+
+  if (bvh_rebuilt) {
+    snprintf(
+      text, sizeof(text),
+      "REBUILT IN %.2fMS FROM SAH: %.2f     DEPTH: %u     NODES: %u",
+      stats->build_ms,
+      bvh_stats[0].sah_cost, bvh_stats[0].max_depth, bvh_stats[0].node_count);
+    add_debug_text_to_frame(text, green, 400.f, 460.f);
+  }
+
+  used = snprintf(text, sizeof(text), "LEAF SIZES:");
+  for (uint32_t i = 0; i < BVH_BUILD_HISTOGRAM_SIZE; ++i)
+    used += snprintf(
+      text + used, sizeof(text) - used, "     %u%s: %u",
+      i + 1, i + 1 == BVH_BUILD_HISTOGRAM_SIZE ? "+" : "",
+      stats->leaf_histogram[i]);
+  add_debug_text_to_frame(text, white, 400.f, 480.f);
+
+  // the timings are filled once the benchmarks ran.
+  used = snprintf(
+    text, sizeof(text),
+    "WIDE BVH NODES: %u/%u     KB: %.1f/%.1f%s",
+    wide_stats.wide_nodes, wide_stats.binary_nodes,
+    wide_stats.wide_bytes / 1024.f, wide_stats.binary_bytes / 1024.f,
+    collision_mesh->wide.revision == collision_mesh->revision ? "" : " STALE");
+  if (wide_stats.queries)
+    snprintf(
+      text + used, sizeof(text) - used,
+      "     VISITS: %.1f/%.1f     LINES: %.1f/%.1f",
+      wide_stats.wide_visits, wide_stats.binary_visits,
+      wide_stats.wide_lines, wide_stats.binary_lines);
+  add_debug_text_to_frame(
+    text, g_debug_flags.use_wide_bvh ? green : white, 400.f, 500.f);
+
+  used = snprintf(
+    text, sizeof(text),
+    "[J] BROADPHASE: %s%s     GRID KB: %.1f",
+    collision_mesh->broadphase == COLLISION_BROADPHASE_GRID ? "GRID" : "BVH",
+    collision_mesh->grid.revision == collision_mesh->revision ? "" : " STALE",
+    grid_stats.bytes / 1024.f);
+  if (grid_stats.queries)
+    snprintf(
+      text + used, sizeof(text) - used,
+      "     BVH: %.3fUS     GRID: %.3fUS     MISMATCHES: %u",
+      grid_stats.bvh_us, grid_stats.grid_us, grid_stats.mismatches);
+  add_debug_text_to_frame(text, white, 400.f, 520.f);
+
+  {
+    const ground_grid_t *ground = &collision_mesh->ground;
+    uint32_t cells = ground->cells[0] * ground->cells[1];
+    snprintf(
+      text, sizeof(text),
+      "GROUND GRID: %ux%u     FLOORS: %u     ENTRIES: %u     KB: %.1f%s",
+      ground->cells[0], ground->cells[1], ground->floor_count,
+      ground->entry_count,
+      (sizeof(uint32_t) * (cells + 1 + ground->entry_count) +
+      sizeof(float) * cells * 2) / 1024.f,
+      ground->revision == collision_mesh->revision ? "" : " STALE");
+    add_debug_text_to_frame(
+      text, g_debug_flags.disable_ground_grid ? white : green, 400.f, 600.f);
+  }
+
+  used = snprintf(
+    text, sizeof(text),
+    "NAVMESH: %u POLYS     %u LINKS     %u STEPS     BUILD: %.2fMS     "
+    "KB: %.1f",
+    nav_stats.polygons, nav_stats.links, nav_stats.step_links,
+    nav_stats.build_ms, nav_stats.bytes / 1024.f);
+  if (nav_stats.paths)
+    snprintf(
+      text + used, sizeof(text) - used,
+      "     PATHS/S: %.0f     FOUND: %u/%u",
+      nav_stats.paths_per_second, nav_stats.found, nav_stats.paths);
+  add_debug_text_to_frame(text, white, 400.f, 620.f);
+}
+
+// the queries are written to the working directory for the 'collision_replay'
+// tool, a new recording overwrites the previous one of the same room.
+static
+void
+update_recording(void)
+{
+  char text[256];
+
+  if (g_debug_flags.record_collision && !collision_recorder_is_open()) {
+    uint32_t settings = bvh_rebuilt ? COLLISION_RECORD_REBUILT_BVH : 0;
+    if (
+      collision_mesh &&
+      collision_mesh->broadphase == COLLISION_BROADPHASE_GRID)
+      settings |= COLLISION_RECORD_GRID;
+    if (platform != BVH_REFIT_NONE && platform_time > 0.f)
+      settings |= COLLISION_RECORD_MOVED_FACES;
+
+    snprintf(text, sizeof(text), "%s.collision", level_name);
+    if (!collision_recorder_open(text, level_name, settings))
+      g_debug_flags.record_collision = 0;
+  } else if (!g_debug_flags.record_collision && collision_recorder_is_open())
+    collision_recorder_close();
+}
+
+// the work of the player and the agents is summed and reset every frame, the
+// rows are streamed to the working directory while the counting is toggled.
+static
+void
+update_counters(const float dt)
+{
+  collision_counters_t total;
+  collision_context_t *context = player_get_context();
+  point3f position = player_get_position();
+  char text[256];
+
+  if (g_debug_flags.count_collision_work && !collision_counters_is_open()) {
+    snprintf(text, sizeof(text), "%s.counters.csv", level_name);
+    if (!collision_counters_open(text))
+      g_debug_flags.count_collision_work = 0;
+    counters_frame = 0;
+  } else if (
+    !g_debug_flags.count_collision_work && collision_counters_is_open())
+    collision_counters_close();
+
+  collision_counters_reset(&total);
+  collision_counters_add(&total, &context->counters);
+  collision_counters_reset(&context->counters);
+  for (uint32_t i = 0; i < agent_pool.count; ++i) {
+    context = &agent_pool.agents[i].context;
+    collision_counters_add(&total, &context->counters);
+    collision_counters_reset(&context->counters);
+  }
+
+  if (!g_debug_flags.count_collision_work)
+    return;
+
+  collision_counters_write(
+    counters_frame++, dt * 1000.f, agent_pool.count, &position, &total);
+  collision_counters_draw(&total, 400.f, 560.f);
+}
+
+// the floor faces under the player become a platform spinning and bobbing in
+// place, exercises the bvh refit.
+static
+void
+create_platform(const allocator_t *allocator)
+{
+  face_list_t list;
+  bvh_aabb_t bounds;
+  point3f position = player_get_position();
+  uint32_t count = 0;
+
+  vector3f_set_3f(
+    bounds.min_max + 0,
+    position.data[0] - PLATFORM_EXTENT,
+    position.data[1] - PLAYER_CAPSULE_HALF_HEIGHT - PLAYER_CAPSULE_RADIUS * 2.f,
+    position.data[2] - PLATFORM_EXTENT);
+  vector3f_set_3f(
+    bounds.min_max + 1,
+    position.data[0] + PLATFORM_EXTENT,
+    position.data[1] - PLAYER_CAPSULE_HALF_HEIGHT,
+    position.data[2] + PLATFORM_EXTENT);
+
+  face_list_setup(&list, 64, allocator);
+  bvh_gather_faces(collision_mesh, &bounds, NULL, &list);
+
+  vector3f_set_1f(&platform_center, 0.f);
+  for (uint32_t i = 0; i < list.count; ++i) {
+    uint32_t index = list.indices[i];
+    face_t *face = cvector_as(&bvh->faces, index, face_t);
+
+    if (!is_floor(collision_mesh, index))
+      continue;
+
+    list.indices[count++] = index;
+    for (uint32_t k = 0; k < 3; ++k)
+      add_set_v3f(&platform_center, face->points + k);
+  }
+
+  if (count) {
+    mult_set_v3f(&platform_center, 1.f / (3.f * count));
+    platform = bvh_refit_add_group(&bvh_refit, list.indices, count);
+  }
+
+  face_list_cleanup(&list);
+}
+
+static
+void
+update_platform(float step)
+{
+  matrix4f rotation;
+  vector3f rotated, translation;
+
+  if (platform == BVH_REFIT_NONE || !platform_moving)
+    return;
+
+  platform_time += step;
+  matrix4f_rotation_y(&rotation, platform_time * PLATFORM_SPIN);
+  rotated = mult_m4f_v3f(&rotation, &platform_center);
+  translation = diff_v3f(&platform_center, &rotated);
+  translation.data[1] += PLATFORM_BOB * sinf(platform_time);
+
+  bvh_refit_move_group(&bvh_refit, platform, &rotation, &translation);
+  bvh_refit_update(&bvh_refit);
+  collision_recorder_add_settings(COLLISION_RECORD_MOVED_FACES);
+}
+
+// the simulation runs at a fixed rate whatever the framerate, the render lerps
+// between the last two ticks.
+static
+void
+update_simulation(
+  float dt,
+  const allocator_t *allocator)
+{
+  static const uint32_t rates[] = { 30, 60, 120 };
+  char text[256];
+  uint32_t ticks;
+
+  if (is_key_triggered(KEY_TICK_RATE)) {
+    uint32_t i = 0;
+    while (i < 3 && rates[i] != fixed_step.rate)
+      ++i;
+    fixed_step_setup(&fixed_step, rates[(i + 1) % 3]);
+  }
+
+  ticks = fixed_step_advance(&fixed_step, dt);
+  player_input(dt);
+  update_agents();
+  update_paths();
+
+  if (collision_mesh && is_key_triggered(KEY_BROADPHASE))
+    collision_mesh->broadphase =
+      (collision_mesh->broadphase + 1) % COLLISION_BROADPHASE_COUNT;
+
+  if (is_key_triggered(KEY_RUN_BENCHMARKS))
+    run_benchmarks(allocator);
+
+  if (collision_mesh && is_key_triggered(KEY_MOVING_PLATFORM)) {
+    if (platform == BVH_REFIT_NONE)
+      create_platform(allocator);
+    platform_moving = platform != BVH_REFIT_NONE && !platform_moving;
+  }
+
+  // the faces move before anything queries them during the tick.
+  for (uint32_t i = 0; i < ticks; ++i) {
+    update_platform(fixed_step.step);
+    player_tick(fixed_step.step);
+    agent_pool_update(&agent_pool, fixed_step.step);
+    prop_world_step(&props, fixed_step.step);
+  }
+
+  // the overlaps are taken once the tick moved everything.
+  update_triggers();
+  update_props();
+
+  player_render(fixed_step_alpha(&fixed_step));
+
+  snprintf(
+    text, sizeof(text),
+    "[M] TICK RATE: %uHZ     TICKS: %u     [-] RUN BENCHMARKS",
+    fixed_step.rate, ticks);
+  add_debug_text_to_frame(text, white, 400.f, 400.f);
+  add_debug_text_to_frame(
+    g_collision_variant == COLLISION_VARIANT_RELEASE ?
+    "COLLISION PATH: RELEASE" : "COLLISION PATH: DEBUG",
+    white, 400.f, 540.f);
+
+  snprintf(
+    text, sizeof(text),
+    "[H] MOVING PLATFORM: %u FACES     COST: %.2f/%.2f     REBUILDS: %u",
+    platform == BVH_REFIT_NONE ? 0 : bvh_refit.groups[platform].count,
+    bvh_refit.cost, bvh_refit.built_cost, bvh_refit.rebuilds);
+  add_debug_text_to_frame(
+    text, platform_moving ? red : white, 400.f, 420.f);
 }
 
 static
@@ -92,7 +712,11 @@ update_level(const allocator_t* allocator)
 
   if (!disable_input) {
     update_debug_flags();
-    player_update(dt);
+    collision_variant_select();
+    update_recording();
+    update_simulation(dt, allocator);
+    update_counters(dt);
+    draw_bvh_stats();
     draw_debug_text_frame(&pipeline, font, font_image_id);
     draw_debug_face_frame(&pipeline, g_debug_flags.disable_depth_debug);
   } else if (is_key_triggered(KEY_EXIT_LEVEL))
@@ -107,6 +731,19 @@ void
 unload_level(const allocator_t* allocator)
 {
   controller_free(controller, allocator);
+  collision_recorder_close();
+  collision_counters_close();
+  agent_pool_cleanup(&agent_pool);
+  trigger_set_cleanup(&triggers);
+  prop_world_cleanup(&props);
+  player_cleanup();
+  if (collision_mesh) {
+    bvh_refit_cleanup(&bvh_refit);
+    path_scheduler_cleanup(&path_scheduler);
+    navmesh_query_cleanup(&nav_query, allocator);
+    navmesh_cleanup(&navmesh, allocator);
+    free_collision_mesh(collision_mesh, allocator);
+  }
   scene_free(scene, allocator);
   cleanup_packaged_render_data(render_data, allocator);
 }
@@ -14,6 +14,7 @@
 #include <string.h>
 #include <game/debug/color.h>
 #include <game/levels/utils.h>
+#include <game/logic/trigger_set.h>
 #include <entity/level/level.h>
 #include <entity/misc/font.h>
 #include <entity/scene/camera.h>
@@ -131,6 +132,92 @@ create_default_light(
   }
 }
 
+// NOTE: the node is a unit box, a sphere or a capsule fills the box. The world
+// bounds of the transformed box give the extents, a rotated node is made axis
+// aligned.
+static
+uint32_t
+collect_trigger_volumes(
+  scene_t *scene,
+  node_t *node,
+  const uint32_t node_index,
+  const matrix4f *parent,
+  trigger_volume_t *volumes,
+  const uint32_t capacity,
+  uint32_t count)
+{
+  const char *prefixes[] = {
+    "trigger_box", "trigger_sphere", "trigger_capsule" };
+  const char *name = node->name.str ? node->name.str : "";
+  matrix4f transform =
+    parent ? mult_m4f(parent, &node->transform) : node->transform;
+
+  for (uint32_t shape = 0; shape < 3; ++shape) {
+    trigger_volume_t *volume;
+    float half[3] = { 0.f, 0.f, 0.f };
+
+    if (strncmp(name, prefixes[shape], strlen(prefixes[shape])))
+      continue;
+
+    if (!volumes || count >= capacity) {
+      ++count;
+      break;
+    }
+
+    volume = volumes + count++;
+    volume->shape = shape;
+    volume->id = node_index;
+    memset(&volume->center, 0, sizeof(point3f));
+    mult_set_m4f_p3f(&transform, &volume->center);
+
+    for (uint32_t k = 0; k < 3; ++k) {
+      point3f axis;
+      vector3f_set_1f(&axis, 0.f);
+      axis.data[k] = 1.f;
+      mult_set_m4f_p3f(&transform, &axis);
+      for (uint32_t i = 0; i < 3; ++i)
+        half[i] += fabsf(axis.data[i] - volume->center.data[i]);
+    }
+
+    if (shape == TRIGGER_SHAPE_BOX)
+      vector3f_set_3f(&volume->extents, half[0], half[1], half[2]);
+    else if (shape == TRIGGER_SHAPE_SPHERE)
+      vector3f_set_3f(
+        &volume->extents, fmaxf(half[0], fmaxf(half[1], half[2])), 0.f, 0.f);
+    else {
+      float radius = fmaxf(half[0], half[2]);
+      vector3f_set_3f(
+        &volume->extents, radius, fmaxf(half[1] - radius, 0.f), 0.f);
+    }
+    break;
+  }
+
+  for (uint32_t i = 0; i < node->nodes.size; ++i) {
+    uint32_t index = *cvector_as(&node->nodes, i, uint32_t);
+    count = collect_trigger_volumes(
+      scene, cvector_as(&scene->node_repo, index, node_t), index,
+      &transform, volumes, capacity, count);
+  }
+
+  return count;
+}
+
+uint32_t
+load_trigger_volumes(
+  scene_t *scene,
+  trigger_volume_t *volumes,
+  const uint32_t capacity)
+{
+  assert(scene);
+
+  if (!scene->node_repo.size)
+    return 0;
+
+  return collect_trigger_volumes(
+    scene, cvector_as(&scene->node_repo, 0, node_t), 0,
+    NULL, volumes, capacity, 0);
+}
+
 // "http://stackoverflow.com/questions/12943164/replacement-for-gluperspective-with-glfrustrum"
 void
 setup_view_projection_pipeline(
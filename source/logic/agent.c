@@ -0,0 +1,653 @@
+/**
+ * @file agent.c
+ * @author khalilhenoud@gmail.com
+ * @brief capsule character controller, the player and the npcs share it.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <game/debug/face.h>
+#include <game/debug/flags.h>
+#include <game/debug/text.h>
+#include <game/logic/agent.h>
+#include <game/logic/bucket_processing.h>
+#include <game/logic/collision_context.h>
+#include <game/logic/collision_mesh.h>
+#include <game/logic/collision_utils.h>
+#include <game/logic/collision_variant.h>
+#include <game/logic/player.h>
+#include <collision/face.h>
+#include <math/capsule.h>
+#include <math/vector3f.h>
+#include <spatial/bvh/bvh.h>
+
+#define ITERATIONS                16
+#define LIMIT_DISTANCE            EPSILON_FLOAT_MIN_PRECISION
+
+
+inline
+void
+clamp(float *f, float min, float max)
+{
+  *f = (*f < min) ? min : *f;
+  *f = (*f > max) ? max : *f;
+}
+
+static
+void
+update_velocity(
+  agent_t *agent,
+  const agent_input_t *input,
+  float delta_time)
+{
+  float multiplier = delta_time / AGENT_REFERENCE_FRAME_TIME;
+  float friction = agent->friction * multiplier;
+
+  if (COLLISION_DEBUG_FLAG(use_locked_motion))
+    return;
+
+  agent->velocity.data[0] +=
+    input->strafe * agent->acceleration.data[0] * multiplier;
+  agent->velocity.data[2] +=
+    input->forward * agent->acceleration.data[2] * multiplier;
+
+  if (agent->is_flying)
+    agent->velocity.data[1] +=
+      input->vertical * agent->acceleration.data[1] * multiplier;
+
+  {
+    // apply friction.
+    vector3f mul;
+    vector3f_set_1f(&mul, 1.f);
+    mul.data[0] = agent->velocity.data[0] > 0.f ? -1.f : 1.f;
+    mul.data[1] = agent->velocity.data[1] > 0.f ? -1.f : 1.f;
+    mul.data[2] = agent->velocity.data[2] > 0.f ? -1.f : 1.f;
+
+    agent->velocity.data[0] += mul.data[0] * friction;
+    agent->velocity.data[0] = (mul.data[0] == -1.f) ?
+    fmax(agent->velocity.data[0], 0.f) : fmin(agent->velocity.data[0], 0.f);
+
+    agent->velocity.data[2] += mul.data[2] * friction;
+    agent->velocity.data[2] = (mul.data[2] == -1.f) ?
+    fmax(agent->velocity.data[2], 0.f) : fmin(agent->velocity.data[2], 0.f);
+
+    if (agent->is_flying) {
+      agent->velocity.data[1] += mul.data[1] * friction;
+      agent->velocity.data[1] = (mul.data[1] == -1.f) ?
+        fmax(agent->velocity.data[1], 0.f) :
+        fmin(agent->velocity.data[1], 0.f);
+    }
+  }
+
+  {
+    // clamp the velocity.
+    vector3f limit = agent->velocity_limit;
+    clamp(agent->velocity.data + 0, -limit.data[0], limit.data[0]);
+    clamp(agent->velocity.data + 2, -limit.data[2], limit.data[2]);
+    if (agent->is_flying)
+      clamp(agent->velocity.data + 1, -limit.data[1], limit.data[1]);
+  }
+}
+
+static
+vector3f
+get_world_relative_velocity(agent_t *agent, float delta_time)
+{
+  float multiplier = delta_time / AGENT_REFERENCE_FRAME_TIME;
+  vector3f relative = { 0.f, 0.f, 0.f };
+  float strafe = agent->velocity.data[0] * multiplier;
+  float forward = agent->velocity.data[2] * multiplier;
+
+  relative.data[0] += agent->right.data[0] * strafe;
+  relative.data[2] += agent->right.data[2] * strafe;
+  relative.data[1] += agent->velocity.data[1] * multiplier;
+  relative.data[0] += agent->forward.data[0] * forward;
+  relative.data[2] += agent->forward.data[2] * forward;
+
+  return relative;
+}
+
+// the probe sweeps the capsule raised by its radius down to -(diameter +
+// (diameter/iterations)), from [+radius, -(diameter + (diameter/iterations))]
+// relative to 'capsule'. The error term is necessary due to the collision term
+// imprecision. 'capsule' is raised in place.
+static
+void
+setup_snap_probe(
+  fused_query_t *probe,
+  capsule_t *capsule,
+  intersection_info_t hits[256])
+{
+  const float diameter = capsule->radius * 2;
+  capsule->center.data[1] += capsule->radius;
+  probe->type = FUSED_QUERY_PROBE;
+  probe->capsule = capsule;
+  probe->hits = hits;
+  vector3f_set_3f(
+    &probe->displacement, 0.f, -(diameter + diameter / ITERATIONS), 0.f);
+}
+
+// determines if we can snap on the floor found by the probe.
+static
+int32_t
+snap_on_probe(
+  agent_t *agent,
+  const fused_query_t *probe,
+  intersection_info_t *info,
+  float *out_y)
+{
+  collision_context_t *context = &agent->context;
+  collision_mesh_t *mesh = context->mesh;
+  bvh_t *bvh = mesh->bvh;
+  capsule_t capsule = *probe->capsule;
+  const float diameter = capsule.radius * 2;
+
+  info->time = 1.f;
+  info->flags = COLLIDED_NONE;
+  info->bvh_face_index = (uint32_t)-1;
+
+  if (probe->floor_index != -1)
+    *info = probe->hits[probe->floor_index];
+
+  // after the sweep if we collided with any floor face.
+  if (info->flags == COLLIDED_FLOOR_FLAG) {
+    float t;
+    vector3f *normal = cvector_as(
+      &bvh->normals, info->bvh_face_index, vector3f);
+    face_t face = mesh->extended[info->bvh_face_index];
+
+    // the extended faces are prebuilt for the player's capsule.
+    if (!IS_SAME_LP(mesh->extension, diameter)) {
+      face = *cvector_as(&bvh->faces, info->bvh_face_index, face_t);
+      face = get_extended_face(&face, diameter);
+    }
+
+    {
+       // the capsule must have cleared the extended face. since we are
+       // dealing with a capsule face, there might be no collision even if we
+       // haven't cleared the floor face.
+       vector3f penetration;
+       point3f sphere_center;
+       capsule_face_classification_t classify =
+         classify_capsule_face(
+           &capsule, &face, normal, 0, &penetration, &sphere_center);
+
+       if (classify != CAPSULE_FACE_NO_COLLISION)
+         return 0;
+     }
+
+    t = get_face_time_of_impact(
+      capsule,
+      &face,
+      normal,
+      probe->displacement,
+      ITERATIONS,
+      LIMIT_DISTANCE);
+
+    // the capsule has to end in valid space, why does this do that.
+    capsule.center.data[1] += probe->displacement.data[1] * t;
+    if (!is_in_valid_space(context, &capsule))
+      return 0;
+
+    info->time = t;
+    *out_y = capsule.center.data[1];
+    return 1;
+  }
+
+  return 0;
+}
+
+// does a vertical sweep to determine if we can snap the provided capsule.
+static
+int32_t
+can_snap_vertically(
+  agent_t *agent,
+  capsule_t capsule,
+  intersection_info_t *info,
+  float *out_y)
+{
+  intersection_info_t hits[256];
+  fused_query_t probe;
+
+  setup_snap_probe(&probe, &capsule, hits);
+  get_fused_queries(&agent->context, &probe, 1, ITERATIONS, LIMIT_DISTANCE);
+  return snap_on_probe(agent, &probe, info, out_y);
+}
+
+static
+void
+update_vertical_velocity(agent_t *agent, float delta_time)
+{
+  collision_mesh_t *mesh = agent->context.mesh;
+  bvh_t *bvh = mesh->bvh;
+  intersection_data_t collisions;
+  int32_t floor_index;
+  intersection_info_t info = { 1.f, COLLIDED_NONE, (uint32_t)-1 };
+  float out_y;
+
+  if (
+    can_snap_vertically(agent, agent->capsule, &info, &out_y) &&
+    agent->velocity.data[1] <= agent->snap_velocity) {
+    float copy_y = agent->capsule.center.data[1];
+    agent->on_solid_floor = 1;
+    agent->velocity.data[1] = 0.f;
+    agent->capsule.center.data[1] = out_y;
+
+    if (COLLISION_DEBUG_FLAG(draw_status) && agent->draw_debug) {
+      uint32_t i = info.bvh_face_index;
+      debug_color_t color = get_debug_color(mesh, i);
+      float distance = copy_y - out_y;
+      char text[512];
+      memset(text, 0, sizeof(text));
+      sprintf(text, "SNAPPING %f", distance);
+      add_debug_text_to_frame(text, green, 400.f, 300.f);
+      add_debug_face_to_frame(
+        cvector_as(&bvh->faces, i, face_t),
+        cvector_as(&bvh->normals, i, vector3f),
+        color, 1);
+    }
+  } else
+    agent->on_solid_floor = 0;
+}
+
+static
+void
+step_up_debug_data(
+  agent_t *agent,
+  float delta,
+  const intersection_info_t *info)
+{
+  collision_mesh_t *mesh = agent->context.mesh;
+  bvh_t *bvh = mesh->bvh;
+
+  if (!COLLISION_DEBUG_ENABLED || !agent->draw_debug)
+    return;
+
+  if (COLLISION_DEBUG_FLAG(draw_status)) {
+    char text[512];
+    memset(text, 0, sizeof(text));
+    sprintf(text, "STEPUP %f", delta);
+    add_debug_text_to_frame(text, red, 400.f, 320.f);
+  }
+
+  if (COLLISION_DEBUG_FLAG(draw_step_up)) {
+    uint32_t i = info->bvh_face_index;
+    face_t *face = cvector_as(&bvh->faces, i, face_t);
+    vector3f *normal = cvector_as(&bvh->normals, i, vector3f);
+    debug_color_t color = get_debug_color(mesh, i);
+    int32_t width = is_floor(mesh, i) ? 3 : 2;
+    add_debug_face_to_frame(face, normal, color, width);
+  }
+}
+
+static
+uint32_t
+has_any_walls(
+  collision_mesh_t *const mesh,
+  const intersection_info_t collision_info[256],
+  const uint32_t info_used)
+{
+  uint32_t index;
+  for (uint32_t i = 0; i < info_used; ++i) {
+    index = collision_info[i].bvh_face_index;
+    if (get_collision_flag(mesh, index) == COLLIDED_WALLS_FLAG)
+      return 1;
+  }
+
+  return 0;
+}
+
+static
+void
+display_debug_normal(
+  const vector3f *normal,
+  debug_color_t color,
+  float x,
+  float y)
+{
+  char text[512];
+  memset(text, 0, sizeof(text));
+  sprintf(text, "NORMAL %.3f %.3f %.3f",
+  normal->data[0], normal->data[1], normal->data[2]);
+  add_debug_text_to_frame(text, color, x, y);
+}
+
+static
+uint32_t
+can_step_up(
+  agent_t *agent,
+  const intersection_data_t *collisions,
+  capsule_t copy,
+  vector3f unit,
+  intersection_info_t *info,
+  float *out_y)
+{
+  collision_context_t *const context = &agent->context;
+  capsule_t original = copy;
+  capsule_t probed;
+  intersection_info_t hits[256];
+  fused_query_t queries[2];
+
+  if (!has_any_walls(context->mesh, collisions->hits, collisions->count))
+    return 0;
+
+  mult_set_v3f(&unit, agent->snap_shift);
+  add_set_v3f(&copy.center, &unit);
+  probed = copy;
+
+  // the shifted capsule is blocked more often than not once a wall is hit, the
+  // probe is issued along with the overlap to share its traversal.
+  queries[0].type = FUSED_QUERY_OVERLAP;
+  queries[0].capsule = &copy;
+  setup_snap_probe(queries + 1, &probed, hits);
+  get_fused_queries(context, queries, 2, ITERATIONS, LIMIT_DISTANCE);
+
+  if (queries[0].valid || !snap_on_probe(agent, queries + 1, info, out_y))
+    return 0;
+
+  original.center.data[1] = *out_y;
+  return is_in_valid_space(context, &original);
+}
+
+// returns the remaining energy after the projection
+static
+float
+project_velocity(
+  const vector3f *orientation,
+  const vector3f *normal,
+  const float energy,
+  vector3f *velocity)
+{
+  vector3f subtract;
+  float dot;
+  float applied = energy;
+
+  assert(!IS_ZERO_LP(length_squared_v3f(velocity)));
+  normalize_set_v3f(velocity);
+  dot = dot_product_v3f(velocity, normal);
+  subtract = mult_v3f(normal, dot);
+  diff_set_v3f(velocity, &subtract);
+  if (IS_ZERO_LP(length_squared_v3f(velocity)))
+    return 0.f;
+  normalize_set_v3f(velocity);
+
+#if 0
+  applied *= fmax(sin(acos(dot_product_v3f(&normal, &velocity))), 0.f);
+  mult_set_v3f(&velocity, applied);
+#else
+  // loss is proportional to the deviation from the initial direction
+  applied *= fmax(dot_product_v3f(orientation, velocity), 0.f);
+  mult_set_v3f(velocity, applied);
+#endif
+  return applied;
+}
+
+static
+collision_flags_t
+handle_collision_detection(agent_t *agent, const vector3f displacement)
+{
+  collision_context_t *context = &agent->context;
+  collision_mesh_t *mesh = context->mesh;
+  bvh_t *bvh = mesh->bvh;
+  capsule_t *capsule = &agent->capsule;
+  collision_flags_t flags = (collision_flags_t)0;
+  intersection_data_t collisions;
+  vector3f orientation = normalize_v3f(&displacement);
+  vector3f velocity = displacement;
+  float energy = length_v3f(&velocity);
+  const uint32_t base_steps = 5;
+  uint32_t steps = base_steps;
+
+#if 0
+  uint32_t face_indices[] = {6536};
+  uint32_t face_indices_count = sizeof(face_indices)/sizeof(face_indices[0]);
+  for (uint32_t i = 0; i < face_indices_count; ++i) {
+    add_debug_face_to_frame(
+    bvh->faces + face_indices[i],
+    bvh->normals + face_indices[i],
+    yellow, 2);
+  }
+#endif
+
+  while (steps-- && !IS_ZERO_LP(length_squared_v3f(&velocity))) {
+    capsule_t destination = *capsule;
+    fused_query_t queries[2];
+
+    if (COLLISION_DEBUG_FLAG(count_collision_work))
+      context->counters.sweep_steps++;
+
+    // the destination is checked along with the sweep, it is only needed if
+    // nothing is hit but that is the common case.
+    add_set_v3f(&destination.center, &velocity);
+    queries[0].type = FUSED_QUERY_SWEEP;
+    queries[0].capsule = capsule;
+    queries[0].displacement = velocity;
+    queries[0].hits = collisions.hits;
+    queries[1].type = FUSED_QUERY_OVERLAP;
+    queries[1].capsule = &destination;
+    get_fused_queries(context, queries, 2, ITERATIONS, LIMIT_DISTANCE);
+    collisions.count = queries[0].hit_count;
+
+    collisions.count = process_collision_info(
+      mesh, &velocity, collisions.hits, collisions.count, &context->counters);
+
+    if (!collisions.count) {
+      if (queries[1].valid)
+        capsule->center = destination.center;
+      else
+      {
+        // this is occuring because we are removing the back face, we should
+        // replace removing the backface with using the tangent plane for
+        // collision reaction.
+        // for now we are simply keeping the position.
+#if 0
+        collisions.count = get_time_of_impact(
+          context,
+          capsule,
+          velocity,
+          collisions.hits,
+          ITERATIONS,
+          LIMIT_DISTANCE);
+
+        collisions.count = process_collision_info(
+          mesh, &velocity, collisions.hits, collisions.count,
+          &context->counters);
+
+        add_set_v3f(&capsule->center, &velocity);
+#endif
+
+        if (COLLISION_DEBUG_ENABLED && agent->draw_debug)
+          add_debug_text_to_frame("NOT IN VALID SPACE", red, 200.f, 20.f);
+      }
+
+      return flags;
+    }
+
+    {
+      float length = length_v3f(&velocity);
+      vector3f unit = mult_v3f(&velocity, 1.f/length);
+      vector3f unit_copy = unit;
+      float toi = collisions.hits[0].time;
+      float toi_mul = fmax(toi * length - agent->energy_cutoff, 0.f);
+      vector3f to_apply = mult_v3f(&unit, toi_mul);
+
+      add_set_v3f(&capsule->center, &to_apply);
+      energy *= (1.f - toi);
+
+      {
+        float out_y;
+        intersection_info_t info;
+        if (can_step_up(agent, &collisions, *capsule, unit, &info, &out_y)) {
+          step_up_debug_data(agent, capsule->center.data[1] - out_y, &info);
+          capsule->center.data[1] = out_y;
+          continue;
+        }
+      }
+
+      {
+        vector3f normal;
+        collision_flags_t l_flags = COLLIDED_NONE;
+        collision_flags_t flags_array[] = {
+          COLLIDED_FLOOR_FLAG, COLLIDED_WALLS_FLAG | COLLIDED_CEILING_FLAG };
+        uint32_t cflags_array[] = { 0, 1 };
+        debug_color_t color_array[] = { green, red };
+        const float base = 330.f + (base_steps - steps) * 20.f;
+
+        for (uint32_t i = 0; i < 2; ++i) {
+          l_flags = get_averaged_normal_filtered(
+            &unit_copy,
+            mesh,
+            &normal,
+            collisions.hits,
+            collisions.count,
+            agent->on_solid_floor, flags_array[i], cflags_array[i]);
+
+          if (l_flags != COLLIDED_NONE) {
+            flags |= l_flags;
+            energy = project_velocity(&orientation, &normal, energy, &velocity);
+            if (energy < agent->energy_cutoff)
+              return flags;
+
+            if (COLLISION_DEBUG_ENABLED && agent->draw_debug)
+              display_debug_normal(
+                &normal, color_array[i], 0.f, base + i * 20.f);
+          }
+        }
+      }
+    }
+  }
+
+  if (
+    COLLISION_DEBUG_ENABLED &&
+    agent->draw_debug &&
+    !is_in_valid_space(context, &agent->capsule))
+    add_debug_text_to_frame("NOT IN VALID SPACE", red, 200.f, 20.f);
+
+  return flags;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#if !defined(COLLISION_RELEASE)
+void
+agent_setup(
+  agent_t *agent,
+  point3f position,
+  collision_mesh_t *mesh,
+  const allocator_t *allocator)
+{
+  assert(agent && allocator);
+
+  agent->acceleration.data[0] = agent->acceleration.data[1] =
+  agent->acceleration.data[2] = 5.f;
+  agent->velocity.data[0] = agent->velocity.data[1] =
+  agent->velocity.data[2] = 0.f;
+  agent->velocity_limit.data[0] = agent->velocity_limit.data[1] =
+  agent->velocity_limit.data[2] = 10.f;
+  vector3f_set_3f(&agent->right, 1.f, 0.f, 0.f);
+  vector3f_set_3f(&agent->forward, 0.f, 0.f, -1.f);
+  agent->gravity = 1.f;
+  agent->friction = 2.f;
+  agent->jump_velocity = 10.f;
+  agent->capsule.center = position;
+  agent->capsule.half_height = PLAYER_CAPSULE_HALF_HEIGHT;
+  agent->capsule.radius = PLAYER_CAPSULE_RADIUS;
+  agent->snap_velocity = 0.f;
+  agent->snap_shift = agent->capsule.radius / 2.f;
+  agent->is_flying = mesh ? 0 : 1;
+  agent->on_solid_floor = 0;
+  agent->draw_debug = 0;
+  collision_context_setup(&agent->context, mesh, allocator);
+  agent->energy_cutoff = 0.25f;
+
+  if (mesh && !is_in_valid_space(&agent->context, &agent->capsule))
+    ensure_in_valid_space(&agent->context, &agent->capsule);
+}
+
+void
+agent_cleanup(agent_t *agent)
+{
+  assert(agent);
+  collision_context_cleanup(&agent->context);
+}
+#endif
+
+collision_flags_t
+COLLISION_VARIANT(agent_update)(
+  agent_t *agent,
+  const agent_input_t *input,
+  float delta_time)
+{
+  vector3f displacement;
+  collision_flags_t flags = COLLIDED_NONE;
+
+  assert(agent && input);
+
+  update_velocity(agent, input, delta_time);
+  if (!agent->is_flying)
+    update_vertical_velocity(agent, delta_time);
+
+  displacement = get_world_relative_velocity(agent, delta_time);
+  if (agent->context.mesh) {
+    COLLISION_VARIANT(collision_context_prefetch)(
+      &agent->context, &agent->capsule, &displacement);
+    flags = handle_collision_detection(agent, displacement);
+
+    if (
+      COLLISION_DEBUG_ENABLED &&
+      agent->draw_debug &&
+      !is_in_valid_space(&agent->context, &agent->capsule))
+      add_debug_text_to_frame("NOT IN VALID SPACE", red, 200.f, 20.f);
+  } else
+    add_set_v3f(&agent->capsule.center, &displacement);
+
+  // apply gravity
+  if (!agent->on_solid_floor) {
+    float multiplier = delta_time / AGENT_REFERENCE_FRAME_TIME;
+    agent->velocity.data[1] -= agent->gravity * multiplier;
+    agent->velocity.data[1] =
+      fmax(agent->velocity.data[1], -agent->velocity_limit.data[1]);
+  }
+
+  // jump
+  if (input->jump && agent->on_solid_floor) {
+    agent->on_solid_floor = 0;
+    agent->velocity.data[1] = agent->jump_velocity;
+  }
+
+  // reset the vertical velocity if we collide with a ceiling
+  if (
+    agent->context.mesh &&
+    !agent->is_flying &&
+    (flags & COLLIDED_CEILING_FLAG) == COLLIDED_CEILING_FLAG &&
+    agent->velocity.data[1] > 0.f)
+    agent->velocity.data[1] = 0.f;
+
+  return flags;
+}
+
+#if !defined(COLLISION_RELEASE)
+collision_flags_t
+agent_update_release(
+  agent_t *agent,
+  const agent_input_t *input,
+  float delta_time);
+
+collision_flags_t
+agent_update(
+  agent_t *agent,
+  const agent_input_t *input,
+  float delta_time)
+{
+  if (g_collision_variant == COLLISION_VARIANT_RELEASE)
+    return agent_update_release(agent, input, delta_time);
+
+  return agent_update_debug(agent, input, delta_time);
+}
+#endif
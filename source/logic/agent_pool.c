@@ -0,0 +1,155 @@
+/**
+ * @file agent_pool.c
+ * @author khalilhenoud@gmail.com
+ * @brief fixed capacity pool of npc agents updated in parallel batches.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <assert.h>
+#include <math.h>
+#include <stddef.h>
+#include <game/debug/flags.h>
+#include <game/logic/agent.h>
+#include <game/logic/agent_pool.h>
+#include <game/threading/job_system.h>
+#include <library/allocator/allocator.h>
+
+#define WANDER_TURN_DEGREES       135.f
+
+
+typedef
+struct {
+  agent_pool_t *pool;
+  float delta_time;
+} agent_batch_t;
+
+static
+uint32_t
+next_random(uint32_t *seed)
+{
+  // xorshift32, the seed must not be 0.
+  *seed ^= *seed << 13;
+  *seed ^= *seed >> 17;
+  *seed ^= *seed << 5;
+  return *seed;
+}
+
+// returns a value in [-1, 1].
+static
+float
+next_unit(uint32_t *seed)
+{
+  return (float)(next_random(seed) & 0xffff) / 32767.5f - 1.f;
+}
+
+static
+void
+update_wander(
+  agent_t *agent,
+  agent_wander_t *wander,
+  agent_input_t *input)
+{
+  if (wander->flags & COLLIDED_WALLS_FLAG)
+    wander->heading +=
+      TO_RADIANS(WANDER_TURN_DEGREES) * next_unit(&wander->seed);
+
+  vector3f_set_3f(
+    &agent->forward, sinf(wander->heading), 0.f, -cosf(wander->heading));
+  vector3f_set_3f(
+    &agent->right, -agent->forward.data[2], 0.f, agent->forward.data[0]);
+
+  input->strafe = input->vertical = 0.f;
+  input->forward = 1.f;
+  input->jump = 0;
+}
+
+static
+void
+update_batch(uint32_t first, uint32_t last, void *user_data)
+{
+  agent_batch_t *batch = (agent_batch_t *)user_data;
+  agent_pool_t *pool = batch->pool;
+
+  for (uint32_t i = first; i < last; ++i) {
+    agent_input_t input;
+    update_wander(pool->agents + i, pool->wander + i, &input);
+    pool->wander[i].flags =
+      agent_update(pool->agents + i, &input, batch->delta_time);
+  }
+}
+
+void
+agent_pool_setup(
+  agent_pool_t *pool,
+  const uint32_t capacity,
+  collision_mesh_t *mesh,
+  const allocator_t *allocator)
+{
+  assert(pool && capacity && allocator);
+
+  pool->agents = allocator->mem_alloc(sizeof(agent_t) * capacity);
+  pool->wander = allocator->mem_alloc(sizeof(agent_wander_t) * capacity);
+  pool->count = 0;
+  pool->capacity = capacity;
+  pool->mesh = mesh;
+  pool->allocator = allocator;
+}
+
+void
+agent_pool_cleanup(agent_pool_t *pool)
+{
+  assert(pool);
+
+  for (uint32_t i = 0; i < pool->count; ++i)
+    agent_cleanup(pool->agents + i);
+
+  pool->allocator->mem_free(pool->agents);
+  pool->allocator->mem_free(pool->wander);
+  pool->agents = NULL;
+  pool->wander = NULL;
+  pool->count = pool->capacity = 0;
+}
+
+uint32_t
+agent_pool_spawn(
+  agent_pool_t *pool,
+  point3f position)
+{
+  uint32_t index;
+  assert(pool);
+
+  if (pool->count == pool->capacity)
+    return AGENT_POOL_NONE;
+
+  index = pool->count++;
+  agent_setup(pool->agents + index, position, pool->mesh, pool->allocator);
+  pool->wander[index].seed = 0x9e3779b9u * (index + 1);
+  pool->wander[index].heading =
+    TO_RADIANS(180.f) * next_unit(&pool->wander[index].seed);
+  pool->wander[index].flags = COLLIDED_NONE;
+  return index;
+}
+
+void
+agent_pool_update(
+  agent_pool_t *pool,
+  float delta_time)
+{
+  agent_batch_t batch;
+  assert(pool);
+
+  batch.pool = pool;
+  batch.delta_time = delta_time;
+
+  // the validations and the query recorder write into shared buffers.
+  if (
+    g_debug_flags.validate_toi ||
+    g_debug_flags.diff_buckets ||
+    g_debug_flags.record_collision)
+    update_batch(0, pool->count, &batch);
+  else
+    parallel_for(pool->count, AGENT_POOL_BATCH_SIZE, update_batch, &batch);
+}
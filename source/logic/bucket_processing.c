@@ -9,15 +9,26 @@
  *
  */
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 #include <game/debug/color.h>
 #include <game/debug/face.h>
 #include <game/debug/flags.h>
 #include <game/logic/bucket_processing.h>
+#include <game/logic/collision_counters.h>
+#include <game/logic/collision_mesh.h>
 #include <game/logic/collision_utils.h>
+#include <game/logic/collision_variant.h>
+#include <game/logic/logic_utils.h>
+#include <game/logic/plane_buckets.h>
 #include <collision/face.h>
 #include <math/capsule.h>
 #include <spatial/bvh/bvh.h>
 
+#define TRIVIAL_BUCKETS_MAX_HITS    8
+
+
+static bucket_diff_stats_t s_diff_stats;
 
 /**
  * To remove a bucket (that is a part of a pair), all of the faces that belong
@@ -140,7 +151,7 @@ remove_bucket(
 
   for (uint32_t i = 0, index = 0; i < info_used; ++i) {
     if (i >= start_index && i < end_index) {
-      if (g_debug_flags.draw_ignored_faces)
+      if (COLLISION_DEBUG_FLAG(draw_ignored_faces))
         add_debug_face_to_frame(
           cvector_as(&bvh->faces, collision_info[i].bvh_face_index, face_t),
           cvector_as(&bvh->normals, collision_info[i].bvh_face_index, vector3f),
@@ -356,9 +367,9 @@ sort_in_buckets(
  * returns the aggregate flags of the faces we processed, else COLLIDED_NONE
  */
 collision_flags_t
-get_averaged_normal_filtered(
+COLLISION_VARIANT(get_averaged_normal_filtered)(
   const vector3f *orientation,
-  bvh_t *const bvh,
+  collision_mesh_t *const mesh,
   vector3f *averaged,
   intersection_info_t collision_info[256],
   const uint32_t info_used,
@@ -366,15 +377,25 @@ get_averaged_normal_filtered(
   const collision_flags_t flags,
   const uint32_t adjust_non_walkable)
 {
+  bvh_t *const bvh = mesh->bvh;
   collision_flags_t return_flags = COLLIDED_NONE;
-  uint32_t buckets[256];
+  uint32_t legacy_buckets[256];
+  plane_buckets_t plane_buckets;
+  uint32_t *buckets = legacy_buckets;
   uint32_t bucket_count = 0;
 
   assert(flags != 0 && flags != COLLIDED_NONE);
   vector3f_set_1f(averaged, 0.f);
 
   // we sort the faces to avoid considering colinear faces more than once
-  bucket_count = sort_in_buckets(bvh, collision_info, info_used, buckets);
+  if (COLLISION_DEBUG_FLAG(use_legacy_buckets))
+    bucket_count =
+      sort_in_buckets(bvh, collision_info, info_used, legacy_buckets);
+  else {
+    bucket_count = sort_in_plane_buckets(
+      mesh, collision_info, info_used, &plane_buckets);
+    buckets = plane_buckets.counts;
+  }
 
   for (uint32_t i = 0, index = 0; i < bucket_count; index += buckets[i], ++i) {
     if ((collision_info[index].flags & flags) == 0)
@@ -384,12 +405,12 @@ get_averaged_normal_filtered(
       &bvh->normals, collision_info[index].bvh_face_index, vector3f));
     return_flags |= collision_info[index].flags;
 
-     if (g_debug_flags.draw_collided_face) {
+     if (COLLISION_DEBUG_FLAG(draw_collided_face)) {
        for (uint32_t k = index; k < (index + buckets[i]); ++k) {
          add_debug_face_to_frame(
           cvector_as(&bvh->faces, collision_info[k].bvh_face_index, face_t),
           cvector_as(&bvh->normals, collision_info[k].bvh_face_index, vector3f),
-          get_debug_color(bvh, collision_info[k].bvh_face_index),
+          get_debug_color(mesh, collision_info[k].bvh_face_index),
           2);
        }
      }
@@ -455,27 +476,231 @@ trim_backfacing(
   return count;
 }
 
+/**
+ * Writes a canonical form of the bucket partition to 'out', one entry per face
+ * made of the face index and the smallest face index in its bucket. Two
+ * partitions of the same faces are identical if their canonical forms are.
+ */
+static
+void
+canonical_partition(
+  const intersection_info_t collision_info[256],
+  const uint32_t buckets[256],
+  const uint32_t bucket_count,
+  uint64_t out[256])
+{
+  for (uint32_t i = 0, index = 0; i < bucket_count; index += buckets[i], ++i) {
+    uint32_t label = (uint32_t)-1;
+    for (uint32_t k = index; k < index + buckets[i]; ++k)
+      label = collision_info[k].bvh_face_index < label ?
+        collision_info[k].bvh_face_index : label;
+
+    for (uint32_t k = index; k < index + buckets[i]; ++k)
+      out[k] = ((uint64_t)collision_info[k].bvh_face_index << 32) | label;
+  }
+}
+
+/**
+ * Runs the pairwise and the plane key bucketing on copies of 'collision_info'
+ * and records whether the buckets and the surviving faces match.
+ */
+static
+void
+diff_bucket_processing(
+  collision_mesh_t *const mesh,
+  const intersection_info_t collision_info[256],
+  const uint32_t info_used)
+{
+  bvh_t *const bvh = mesh->bvh;
+  intersection_info_t info[2][256];
+  uint64_t canonical[2][256];
+  uint32_t legacy_buckets[256];
+  uint32_t legacy_count, plane_count;
+  plane_buckets_t plane_buckets;
+  uint32_t used[2];
+
+  memcpy(info[0], collision_info, sizeof(intersection_info_t) * info_used);
+  memcpy(info[1], collision_info, sizeof(intersection_info_t) * info_used);
+
+  legacy_count = sort_in_buckets(bvh, info[0], info_used, legacy_buckets);
+  plane_count =
+    sort_in_plane_buckets(mesh, info[1], info_used, &plane_buckets);
+
+  s_diff_stats.runs++;
+
+  canonical_partition(info[0], legacy_buckets, legacy_count, canonical[0]);
+  canonical_partition(
+    info[1], plane_buckets.counts, plane_count, canonical[1]);
+  qsort(canonical[0], info_used, sizeof(uint64_t), compare_uint64);
+  qsort(canonical[1], info_used, sizeof(uint64_t), compare_uint64);
+  if (
+    legacy_count != plane_count ||
+    memcmp(canonical[0], canonical[1], sizeof(uint64_t) * info_used)) {
+    s_diff_stats.bucket_mismatches++;
+    return;
+  }
+
+  used[0] =
+    process_buckets(bvh, info[0], info_used, legacy_buckets, legacy_count);
+  used[1] = process_plane_buckets(mesh, info[1], info_used, &plane_buckets);
+  for (uint32_t k = 0; k < 2; ++k) {
+    for (uint32_t i = 0; i < used[k]; ++i)
+      canonical[k][i] = info[k][i].bvh_face_index;
+    qsort(canonical[k], used[k], sizeof(uint64_t), compare_uint64);
+  }
+
+  if (
+    used[0] != used[1] ||
+    memcmp(canonical[0], canonical[1], sizeof(uint64_t) * used[0]))
+    s_diff_stats.result_mismatches++;
+}
+
+#if !defined(COLLISION_RELEASE)
+const bucket_diff_stats_t *
+get_bucket_diff_stats(void)
+{
+  return &s_diff_stats;
+}
+#endif
+
+// the hits are on distinct planes none of which faces another, the plane
+// buckets would hold one hit each in reverse order and none would be removed.
+// The common case once the internal edge contacts are dropped.
+static
+uint32_t
+is_trivially_bucketed(
+  const collision_mesh_t *mesh,
+  const intersection_info_t collision_info[256],
+  const uint32_t info_used)
+{
+  if (info_used > TRIVIAL_BUCKETS_MAX_HITS)
+    return 0;
+
+  for (uint32_t i = 0; i < info_used; ++i) {
+    uint32_t cluster = mesh->clusters[collision_info[i].bvh_face_index];
+    uint32_t opposite = mesh->opposites[cluster];
+
+    for (uint32_t j = i + 1; j < info_used; ++j) {
+      uint32_t other = mesh->clusters[collision_info[j].bvh_face_index];
+      if (other == cluster || other == opposite)
+        return 0;
+    }
+  }
+
+  return 1;
+}
+
 /**
  * Sorts the collision information into buckets where each buckets corresponds
  * to a number of colinear faces. Then we remove redundant buckets, redundant
  * buckets are those that have a negating pair (colinear but normals oppose) and
  * could be subject to removal under certain conditions.
- * returns the number of faces left, sorted consecutively.
+ * returns the number of faces left, sorted consecutively. The buckets are
+ * counted in 'counters' if not NULL.
  */
 uint32_t
-process_collision_info(
-  bvh_t *const bvh,
+COLLISION_VARIANT(process_collision_info)(
+  collision_mesh_t *const mesh,
   const vector3f *velocity,
   intersection_info_t collision_info[256],
-  uint32_t info_used)
+  uint32_t info_used,
+  collision_counters_t *counters)
 {
-  if (info_used) {
+  bvh_t *const bvh = mesh->bvh;
+
+  if (info_used && COLLISION_DEBUG_FLAG(diff_buckets))
+    diff_bucket_processing(mesh, collision_info, info_used);
+
+  if (info_used && COLLISION_DEBUG_FLAG(use_legacy_buckets)) {
     uint32_t buckets[256];
     uint32_t bucket_count =
       sort_in_buckets(bvh, collision_info, info_used, buckets);
     info_used =
       process_buckets(bvh, collision_info, info_used, buckets, bucket_count);
+
+    // the legacy path does not report the surviving buckets.
+    if (counters && COLLISION_DEBUG_FLAG(count_collision_work))
+      counters->buckets_formed += bucket_count;
+  } else if (info_used && is_trivially_bucketed(
+    mesh, collision_info, info_used)) {
+    for (uint32_t i = 0, j = info_used - 1; i < j; ++i, --j) {
+      intersection_info_t swap = collision_info[i];
+      collision_info[i] = collision_info[j];
+      collision_info[j] = swap;
+    }
+
+    if (counters && COLLISION_DEBUG_FLAG(count_collision_work))
+      counters->buckets_formed += info_used;
+  } else if (info_used) {
+    plane_buckets_t buckets;
+    uint32_t formed =
+      sort_in_plane_buckets(mesh, collision_info, info_used, &buckets);
+    info_used =
+      process_plane_buckets(mesh, collision_info, info_used, &buckets);
+
+    if (counters && COLLISION_DEBUG_FLAG(count_collision_work)) {
+      counters->buckets_formed += formed;
+      counters->buckets_removed += formed - buckets.count;
+    }
   }
 
   return trim_backfacing(bvh, velocity, collision_info, info_used);
-}
\ No newline at end of file
+}
+
+#if !defined(COLLISION_RELEASE)
+collision_flags_t
+get_averaged_normal_filtered_release(
+  const vector3f *orientation,
+  collision_mesh_t *const mesh,
+  vector3f *averaged,
+  intersection_info_t collision_info[256],
+  const uint32_t info_used,
+  const uint32_t on_solid_floor,
+  const collision_flags_t flags,
+  const uint32_t adjust_non_walkable);
+
+uint32_t
+process_collision_info_release(
+  collision_mesh_t *const mesh,
+  const vector3f *velocity,
+  intersection_info_t collision_info[256],
+  uint32_t info_used,
+  collision_counters_t *counters);
+
+collision_flags_t
+get_averaged_normal_filtered(
+  const vector3f *orientation,
+  collision_mesh_t *const mesh,
+  vector3f *averaged,
+  intersection_info_t collision_info[256],
+  const uint32_t info_used,
+  const uint32_t on_solid_floor,
+  const collision_flags_t flags,
+  const uint32_t adjust_non_walkable)
+{
+  if (g_collision_variant == COLLISION_VARIANT_RELEASE)
+    return get_averaged_normal_filtered_release(
+      orientation, mesh, averaged, collision_info, info_used,
+      on_solid_floor, flags, adjust_non_walkable);
+
+  return get_averaged_normal_filtered_debug(
+    orientation, mesh, averaged, collision_info, info_used,
+    on_solid_floor, flags, adjust_non_walkable);
+}
+
+uint32_t
+process_collision_info(
+  collision_mesh_t *const mesh,
+  const vector3f *velocity,
+  intersection_info_t collision_info[256],
+  uint32_t info_used,
+  collision_counters_t *counters)
+{
+  if (g_collision_variant == COLLISION_VARIANT_RELEASE)
+    return process_collision_info_release(
+      mesh, velocity, collision_info, info_used, counters);
+
+  return process_collision_info_debug(
+    mesh, velocity, collision_info, info_used, counters);
+}
+#endif
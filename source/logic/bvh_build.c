@@ -0,0 +1,514 @@
+/**
+ * @file bvh_build.c
+ * @author khalilhenoud@gmail.com
+ * @brief binned surface area heuristic bvh builder and quality metrics.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <game/logic/bvh_build.h>
+#include <game/logic/bvh_query.h>
+#include <game/logic/face_packets.h>
+#include <game/logic/logic_utils.h>
+#include <game/threading/job_system.h>
+#include <library/allocator/allocator.h>
+#include <math/face.h>
+#include <spatial/bvh/bvh.h>
+
+// deep enough for any sane level, keeps the traversal stacks from overflowing.
+#define MAX_DEPTH                 (BVH_QUERY_STACK_SIZE - 16)
+// the subtrees below this many faces are built by a single thread.
+#define PARALLEL_FACE_COUNT       2048
+#define TRAVERSAL_COST            1.f
+// the leaf faces are culled a packet at a time.
+#define FACE_COST                 (1.f / FACE_PACKET_WIDTH)
+
+
+typedef
+struct {
+  const bvh_aabb_t *bounds;
+  vector3f *centers;
+  uint32_t *indices;
+  bvh_node_t *nodes;
+} build_t;
+
+// 'base' is the first node of the block reserved for the subtree pairs.
+typedef
+struct {
+  uint32_t node;
+  uint32_t first;
+  uint32_t count;
+  uint32_t depth;
+  uint32_t base;
+} subtree_t;
+
+typedef
+struct {
+  build_t *build;
+  subtree_t *subtrees;
+} subtree_job_t;
+
+typedef
+struct {
+  bvh_aabb_t bounds;
+  uint32_t count;
+} bin_t;
+
+static
+float
+get_area(const bvh_aabb_t *bounds)
+{
+  vector3f size = diff_v3f(bounds->min_max + 1, bounds->min_max + 0);
+  if (size.data[0] < 0.f)
+    return 0.f;
+
+  return 2.f * (
+    size.data[0] * size.data[1] +
+    size.data[1] * size.data[2] +
+    size.data[2] * size.data[0]);
+}
+
+static
+void
+empty_bounds(bvh_aabb_t *bounds)
+{
+  vector3f_set_1f(bounds->min_max + 0, FLT_MAX);
+  vector3f_set_1f(bounds->min_max + 1, -FLT_MAX);
+}
+
+static
+void
+grow_bounds(bvh_aabb_t *bounds, const bvh_aabb_t *other)
+{
+  for (uint32_t axis = 0; axis < 3; ++axis) {
+    bounds->min_max[0].data[axis] =
+      fminf(bounds->min_max[0].data[axis], other->min_max[0].data[axis]);
+    bounds->min_max[1].data[axis] =
+      fmaxf(bounds->min_max[1].data[axis], other->min_max[1].data[axis]);
+  }
+}
+
+/**
+ * Finds the cheapest binned split of [first, first + count), writes the axis
+ * and the bin the right side starts at. Returns the split cost, FLT_MAX if the
+ * centers cannot be split.
+ */
+static
+float
+find_split(
+  const build_t *build,
+  const uint32_t first,
+  const uint32_t count,
+  const bvh_aabb_t *centers,
+  uint32_t *split_axis,
+  uint32_t *split_bin)
+{
+  float best = FLT_MAX;
+
+  for (uint32_t axis = 0; axis < 3; ++axis) {
+    bin_t bins[BVH_BUILD_BINS];
+    float left_area[BVH_BUILD_BINS];
+    uint32_t left_count[BVH_BUILD_BINS];
+    float min = centers->min_max[0].data[axis];
+    float extent = centers->min_max[1].data[axis] - min;
+    float scale;
+    bvh_aabb_t running;
+    uint32_t running_count = 0;
+
+    if (extent <= 0.f)
+      continue;
+
+    scale = BVH_BUILD_BINS / extent;
+    for (uint32_t i = 0; i < BVH_BUILD_BINS; ++i) {
+      empty_bounds(&bins[i].bounds);
+      bins[i].count = 0;
+    }
+
+    for (uint32_t i = first; i < first + count; ++i) {
+      uint32_t index = build->indices[i];
+      uint32_t bin =
+        (uint32_t)((build->centers[index].data[axis] - min) * scale);
+      bin = bin >= BVH_BUILD_BINS ? BVH_BUILD_BINS - 1 : bin;
+      bins[bin].count++;
+      grow_bounds(&bins[bin].bounds, build->bounds + index);
+    }
+
+    empty_bounds(&running);
+    for (uint32_t i = 0; i < BVH_BUILD_BINS - 1; ++i) {
+      grow_bounds(&running, &bins[i].bounds);
+      running_count += bins[i].count;
+      left_area[i] = get_area(&running);
+      left_count[i] = running_count;
+    }
+
+    // sweep from the right, the plane 'i' splits bins [0, i) and [i, bins).
+    empty_bounds(&running);
+    running_count = 0;
+    for (uint32_t i = BVH_BUILD_BINS - 1; i > 0; --i) {
+      float cost;
+      grow_bounds(&running, &bins[i].bounds);
+      running_count += bins[i].count;
+
+      if (!left_count[i - 1] || !running_count)
+        continue;
+
+      cost =
+        left_area[i - 1] * left_count[i - 1] +
+        get_area(&running) * running_count;
+      if (cost < best) {
+        best = cost;
+        *split_axis = axis;
+        *split_bin = i;
+      }
+    }
+  }
+
+  return best;
+}
+
+/**
+ * Turns the node into a leaf or splits it, the children pair is allocated at
+ * '*cursor'. Returns the number of faces of the left child, 0 for a leaf.
+ */
+static
+uint32_t
+split_node(
+  build_t *build,
+  const uint32_t node_index,
+  const uint32_t first,
+  const uint32_t count,
+  const uint32_t depth,
+  uint32_t *cursor)
+{
+  bvh_node_t *node = build->nodes + node_index;
+  bvh_aabb_t centers;
+  uint32_t axis = 0, bin = 0, left_count;
+  float cost;
+
+  empty_bounds(&node->bounds);
+  empty_bounds(&centers);
+  for (uint32_t i = first; i < first + count; ++i) {
+    uint32_t index = build->indices[i];
+    bvh_aabb_t center;
+    center.min_max[0] = center.min_max[1] = build->centers[index];
+    grow_bounds(&node->bounds, build->bounds + index);
+    grow_bounds(&centers, &center);
+  }
+
+  node->left_first = first;
+  node->tri_count = count;
+
+  if (count == 1 || depth >= MAX_DEPTH)
+    return 0;
+
+  cost = find_split(build, first, count, &centers, &axis, &bin);
+  cost = cost == FLT_MAX ?
+    FLT_MAX : TRAVERSAL_COST + FACE_COST * cost / get_area(&node->bounds);
+
+  if (cost >= FACE_COST * count && count <= BVH_BUILD_MAX_LEAF_SIZE)
+    return 0;
+
+  if (cost == FLT_MAX)
+    // the centers are all the same, any partition is as good as another.
+    left_count = count / 2;
+  else {
+    float min = centers.min_max[0].data[axis];
+    float scale =
+      BVH_BUILD_BINS / (centers.min_max[1].data[axis] - min);
+    uint32_t i = first, j = first + count;
+
+    while (i < j) {
+      uint32_t index = build->indices[i];
+      uint32_t b =
+        (uint32_t)((build->centers[index].data[axis] - min) * scale);
+      b = b >= BVH_BUILD_BINS ? BVH_BUILD_BINS - 1 : b;
+
+      if (b < bin)
+        ++i;
+      else {
+        build->indices[i] = build->indices[--j];
+        build->indices[j] = index;
+      }
+    }
+
+    left_count = i - first;
+  }
+
+  assert(left_count && left_count < count);
+  node->left_first = *cursor;
+  node->tri_count = 0;
+  *cursor += 2;
+  return left_count;
+}
+
+static
+void
+build_subtree(
+  build_t *build,
+  const uint32_t node_index,
+  const uint32_t first,
+  const uint32_t count,
+  const uint32_t depth,
+  uint32_t *cursor)
+{
+  uint32_t left_count, left;
+
+  left_count = split_node(build, node_index, first, count, depth, cursor);
+  if (!left_count)
+    return;
+
+  left = build->nodes[node_index].left_first;
+  build_subtree(build, left, first, left_count, depth + 1, cursor);
+  build_subtree(
+    build, left + 1, first + left_count, count - left_count, depth + 1,
+    cursor);
+}
+
+static
+void
+build_subtrees(uint32_t first, uint32_t last, void *user_data)
+{
+  subtree_job_t *job = (subtree_job_t *)user_data;
+
+  for (uint32_t i = first; i < last; ++i) {
+    subtree_t *subtree = job->subtrees + i;
+    uint32_t cursor = subtree->base;
+    build_subtree(
+      job->build,
+      subtree->node,
+      subtree->first,
+      subtree->count,
+      subtree->depth,
+      &cursor);
+    assert(cursor <= subtree->base + 2 * subtree->count - 2);
+  }
+}
+
+/**
+ * Copies the reachable nodes depth first into 'out', the pairs stay adjacent.
+ * Returns the number of nodes written.
+ */
+static
+uint32_t
+compact_nodes(
+  const bvh_node_t *nodes,
+  bvh_node_t *out,
+  const allocator_t *allocator,
+  const uint32_t capacity)
+{
+  // pairs of (source node, destination node).
+  uint32_t *stack = allocator->mem_alloc(sizeof(uint32_t) * 2 * capacity);
+  uint32_t used = 0, count = 1;
+
+  out[0] = nodes[0];
+  stack[used++] = 0;
+  stack[used++] = 0;
+
+  while (used) {
+    uint32_t target = stack[--used];
+    uint32_t source = stack[--used];
+    uint32_t left = nodes[source].left_first;
+
+    if (nodes[source].tri_count)
+      continue;
+
+    out[target].left_first = count;
+    out[count] = nodes[left];
+    out[count + 1] = nodes[left + 1];
+    stack[used++] = left;
+    stack[used++] = count;
+    stack[used++] = left + 1;
+    stack[used++] = count + 1;
+    count += 2;
+  }
+
+  allocator->mem_free(stack);
+  return count;
+}
+
+static
+void
+permute(
+  cvector_t *vector,
+  const uint32_t *indices,
+  const uint32_t count,
+  const size_t size,
+  const allocator_t *allocator)
+{
+  uint8_t *copy = allocator->mem_alloc(size * count);
+  uint8_t *data = (uint8_t *)vector->data;
+  memcpy(copy, data, size * count);
+  for (uint32_t i = 0; i < count; ++i)
+    memcpy(data + i * size, copy + indices[i] * size, size);
+  allocator->mem_free(copy);
+}
+
+void
+bvh_build_sah(
+  bvh_t *bvh,
+  bvh_build_stats_t *stats,
+  const allocator_t *allocator)
+{
+  const uint32_t face_count = (uint32_t)bvh->faces.size;
+  const uint32_t capacity = face_count * 2;
+  double start = get_microseconds();
+  build_t build;
+  subtree_t *subtrees;
+  uint32_t subtree_count = 0, pending_count = 0, cursor = 1;
+  subtree_t *pending;
+
+  assert(bvh && stats && allocator);
+
+  if (!face_count)
+    return;
+
+  build.bounds = (const bvh_aabb_t *)bvh->bounds.data;
+  build.centers = allocator->mem_alloc(sizeof(vector3f) * face_count);
+  build.indices = allocator->mem_alloc(sizeof(uint32_t) * face_count);
+  build.nodes = allocator->mem_alloc(sizeof(bvh_node_t) * capacity);
+  subtrees = allocator->mem_alloc(sizeof(subtree_t) * face_count);
+  pending = allocator->mem_alloc(sizeof(subtree_t) * face_count);
+
+  for (uint32_t i = 0; i < face_count; ++i) {
+    build.centers[i] = add_v3f(
+      build.bounds[i].min_max + 0, build.bounds[i].min_max + 1);
+    mult_set_v3f(build.centers + i, 0.5f);
+    build.indices[i] = i;
+  }
+
+  // split the top of the tree on the calling thread until the subtrees are
+  // small enough, each subtree then gets its own block of nodes.
+  pending[pending_count].node = 0;
+  pending[pending_count].first = 0;
+  pending[pending_count].count = face_count;
+  pending[pending_count++].depth = 0;
+
+  while (pending_count) {
+    subtree_t top = pending[--pending_count];
+    uint32_t left_count, left;
+
+    if (top.count <= PARALLEL_FACE_COUNT) {
+      subtrees[subtree_count++] = top;
+      continue;
+    }
+
+    left_count = split_node(
+      &build, top.node, top.first, top.count, top.depth, &cursor);
+    if (!left_count)
+      continue;
+
+    left = build.nodes[top.node].left_first;
+    pending[pending_count].node = left;
+    pending[pending_count].first = top.first;
+    pending[pending_count].count = left_count;
+    pending[pending_count++].depth = top.depth + 1;
+    pending[pending_count].node = left + 1;
+    pending[pending_count].first = top.first + left_count;
+    pending[pending_count].count = top.count - left_count;
+    pending[pending_count++].depth = top.depth + 1;
+  }
+
+  for (uint32_t i = 0; i < subtree_count; ++i) {
+    subtrees[i].base = cursor;
+    cursor += 2 * subtrees[i].count - 2;
+  }
+  assert(cursor <= capacity);
+
+  {
+    subtree_job_t job;
+    job.build = &build;
+    job.subtrees = subtrees;
+    parallel_for(subtree_count, 1, build_subtrees, &job);
+  }
+
+  {
+    bvh_node_t *compacted =
+      allocator->mem_alloc(sizeof(bvh_node_t) * capacity);
+    uint32_t count =
+      compact_nodes(build.nodes, compacted, allocator, capacity);
+
+    cvector_resize(&bvh->nodes, count);
+    memcpy(bvh->nodes.data, compacted, sizeof(bvh_node_t) * count);
+    allocator->mem_free(compacted);
+  }
+
+  permute(&bvh->faces, build.indices, face_count, sizeof(face_t), allocator);
+  permute(
+    &bvh->normals, build.indices, face_count, sizeof(vector3f), allocator);
+  permute(
+    &bvh->bounds, build.indices, face_count, sizeof(bvh_aabb_t), allocator);
+
+  allocator->mem_free(pending);
+  allocator->mem_free(subtrees);
+  allocator->mem_free(build.nodes);
+  allocator->mem_free(build.indices);
+  allocator->mem_free(build.centers);
+
+  bvh_build_metrics(bvh, stats, allocator);
+  stats->build_ms = (float)((get_microseconds() - start) / 1000.0);
+}
+
+void
+bvh_build_metrics(
+  const bvh_t *bvh,
+  bvh_build_stats_t *stats,
+  const allocator_t *allocator)
+{
+  // every node is pushed once, the stack never holds more than the nodes.
+  const uint32_t capacity = (uint32_t)bvh->nodes.size + 1;
+  uint32_t *stack, *depths;
+  uint32_t used = 0;
+  float area_sum = 0.f, root_area;
+
+  assert(bvh && stats && allocator);
+
+  memset(stats, 0, sizeof(bvh_build_stats_t));
+  if (!bvh->nodes.size)
+    return;
+
+  stack = allocator->mem_alloc(sizeof(uint32_t) * capacity);
+  depths = allocator->mem_alloc(sizeof(uint32_t) * capacity);
+  root_area = get_area(&cvector_as(&bvh->nodes, 0, bvh_node_t)->bounds);
+  stack[used] = 0;
+  depths[used++] = 0;
+
+  while (used) {
+    uint32_t depth = depths[--used];
+    const bvh_node_t *node =
+      cvector_as(&bvh->nodes, stack[used], bvh_node_t);
+    float area = get_area(&node->bounds);
+
+    stats->node_count++;
+    stats->max_depth = depth > stats->max_depth ? depth : stats->max_depth;
+
+    if (node->tri_count) {
+      uint32_t bucket = node->tri_count > BVH_BUILD_MAX_LEAF_SIZE ?
+        BVH_BUILD_MAX_LEAF_SIZE : node->tri_count - 1;
+      stats->leaf_count++;
+      stats->leaf_histogram[bucket]++;
+      area_sum += area * node->tri_count * FACE_COST;
+      continue;
+    }
+
+    area_sum += area * TRAVERSAL_COST;
+
+    // only a malformed tree sharing its nodes gets here, the walk stops.
+    if (used + 2 > capacity)
+      break;
+
+    stack[used] = node->left_first + 1;
+    depths[used++] = depth + 1;
+    stack[used] = node->left_first;
+    depths[used++] = depth + 1;
+  }
+
+  allocator->mem_free(depths);
+  allocator->mem_free(stack);
+  stats->sah_cost = root_area > 0.f ? area_sum / root_area : 0.f;
+}
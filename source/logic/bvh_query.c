@@ -0,0 +1,498 @@
+/**
+ * @file bvh_query.c
+ * @author khalilhenoud@gmail.com
+ * @brief stack based bvh traversal that streams the candidate faces.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <assert.h>
+#include <string.h>
+#include <game/debug/flags.h>
+#include <game/logic/bvh_query.h>
+#include <game/logic/collision_mesh.h>
+#include <game/logic/collision_variant.h>
+#include <game/logic/face_grid.h>
+#include <game/logic/wide_bvh.h>
+#include <library/allocator/allocator.h>
+#include <math/capsule.h>
+#include <math/vector3f.h>
+#include <spatial/bvh/bvh.h>
+
+#define BOUNDS_MULTIPLIER   1.025f
+
+
+#if !defined(COLLISION_RELEASE)
+void
+face_list_setup(
+  face_list_t *list,
+  const uint32_t capacity,
+  const allocator_t *allocator)
+{
+  assert(list && capacity && allocator);
+
+  list->indices = allocator->mem_alloc(sizeof(uint32_t) * capacity);
+  list->count = 0;
+  list->capacity = capacity;
+  list->allocator = allocator;
+}
+
+void
+face_list_cleanup(face_list_t *list)
+{
+  assert(list);
+
+  if (list->indices)
+    list->allocator->mem_free(list->indices);
+  list->indices = NULL;
+  list->count = list->capacity = 0;
+}
+
+void
+face_list_push(face_list_t *list, const uint32_t index)
+{
+  if (list->count == list->capacity) {
+    list->capacity *= 2;
+    list->indices = list->allocator->mem_realloc(
+      list->indices, sizeof(uint32_t) * list->capacity);
+  }
+
+  list->indices[list->count++] = index;
+}
+
+void *
+bvh_stack_grow(
+  void *entries,
+  const void *local,
+  uint32_t *capacity,
+  const uint32_t size,
+  const allocator_t *allocator)
+{
+  size_t bytes = (size_t)*capacity * size;
+  assert(entries && capacity && allocator);
+
+  *capacity *= 2;
+  if (entries != local)
+    return allocator->mem_realloc(entries, bytes * 2);
+
+  entries = allocator->mem_alloc(bytes * 2);
+  memcpy(entries, local, bytes);
+  return entries;
+}
+
+void
+bvh_sweep_setup(
+  bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  const vector3f *displacement,
+  const float multiplier)
+{
+  assert(sweep && capsule && displacement);
+
+  for (uint32_t axis = 0; axis < 3; ++axis) {
+    sweep->origin[axis] = capsule->center.data[axis];
+    sweep->delta[axis] = displacement->data[axis];
+    sweep->extents[axis] = capsule->radius * multiplier;
+  }
+  sweep->extents[1] = (capsule->half_height + capsule->radius) * multiplier;
+}
+
+int32_t
+bvh_sweep_intersects(
+  const bvh_sweep_t *sweep,
+  const bvh_aabb_t *bounds)
+{
+  float enter = 0.f, leave = 1.f;
+
+  for (uint32_t axis = 0; axis < 3; ++axis) {
+    float low = bounds->min_max[0].data[axis] - sweep->extents[axis];
+    float high = bounds->min_max[1].data[axis] + sweep->extents[axis];
+    float origin = sweep->origin[axis];
+    float delta = sweep->delta[axis];
+
+    // a segment parallel to the slab is either always in it or never.
+    if (delta == 0.f) {
+      if (origin < low || origin > high)
+        return 0;
+      continue;
+    }
+
+    {
+      float inverse = 1.f / delta;
+      float t0 = (low - origin) * inverse;
+      float t1 = (high - origin) * inverse;
+      if (t0 > t1) {
+        float swap = t0;
+        t0 = t1;
+        t1 = swap;
+      }
+
+      enter = t0 > enter ? t0 : enter;
+      leave = t1 < leave ? t1 : leave;
+      if (enter > leave)
+        return 0;
+    }
+  }
+
+  return 1;
+}
+#endif
+
+int32_t
+COLLISION_VARIANT(bvh_query_leaf)(
+  const collision_mesh_t *mesh,
+  const uint32_t first,
+  const uint32_t count,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data)
+{
+  bvh_t *bvh = mesh->bvh;
+  uint32_t culled[FACE_PACKET_WIDTH];
+  uint32_t i = first;
+  uint32_t last = first + count;
+
+  if (COLLISION_DEBUG_FLAG(use_scalar_collision)) {
+    for (; i < last; ++i) {
+      bvh_aabb_t *face_bounds = cvector_as(&bvh->bounds, i, bvh_aabb_t);
+      if (!bounds_intersect(bounds, face_bounds))
+        continue;
+
+      if (sweep && !bvh_sweep_intersects(sweep, face_bounds))
+        continue;
+
+      if (!callback(i, user_data))
+        return 0;
+    }
+
+    return 1;
+  }
+
+  while (i < last) {
+    uint32_t packet_last = (i / FACE_PACKET_WIDTH + 1) * FACE_PACKET_WIDTH;
+    uint32_t culled_count;
+    packet_last = packet_last > last ? last : packet_last;
+    culled_count = face_packets_cull(
+      &mesh->packets,
+      i, packet_last,
+      bounds, capsule, BOUNDS_MULTIPLIER, culled);
+    i = packet_last;
+
+    for (uint32_t k = 0; k < culled_count; ++k) {
+      if (
+        sweep &&
+        !bvh_sweep_intersects(
+          sweep, cvector_as(&bvh->bounds, culled[k], bvh_aabb_t)))
+        continue;
+
+      if (!callback(culled[k], user_data))
+        return 0;
+    }
+  }
+
+  return 1;
+}
+
+int32_t
+COLLISION_VARIANT(bvh_query_faces_swept)(
+  const collision_mesh_t *mesh,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data,
+  uint32_t *visited)
+{
+  bvh_t *bvh = mesh->bvh;
+  uint32_t local[BVH_QUERY_STACK_SIZE];
+  uint32_t *stack = local;
+  uint32_t capacity = BVH_QUERY_STACK_SIZE;
+  uint32_t used = 0;
+  uint32_t nodes = 0;
+  int32_t result = 1;
+
+  assert(mesh && bounds && callback);
+
+  if (
+    mesh->broadphase == COLLISION_BROADPHASE_GRID &&
+    mesh->grid.starts &&
+    mesh->grid.revision == mesh->revision) {
+    uint32_t indices[FACE_GRID_QUERY_CAPACITY];
+    face_list_t list;
+    list.count = face_grid_gather(
+      &mesh->grid, bvh, bounds, indices, FACE_GRID_QUERY_CAPACITY);
+
+    if (list.count != FACE_GRID_OVERFLOW) {
+      if (visited)
+        *visited += face_grid_query_cells(&mesh->grid, bounds);
+      list.indices = indices;
+      list.capacity = FACE_GRID_QUERY_CAPACITY;
+      list.allocator = NULL;
+      return COLLISION_VARIANT(face_list_query)(
+        mesh, &list, bounds, sweep, capsule, callback, user_data);
+    }
+  }
+
+  if (
+    COLLISION_DEBUG_FLAG(use_wide_bvh) &&
+    mesh->wide.nodes &&
+    mesh->wide.revision == mesh->revision)
+    return wide_bvh_query_faces(
+      mesh, &mesh->wide, bounds, sweep, capsule, callback, user_data, visited);
+
+  if (!bvh->nodes.size)
+    return 1;
+
+  stack[used++] = 0;
+
+  while (used) {
+    bvh_node_t *node = cvector_as(&bvh->nodes, stack[--used], bvh_node_t);
+    ++nodes;
+
+    if (!bounds_intersect(bounds, &node->bounds))
+      continue;
+
+    if (sweep && !bvh_sweep_intersects(sweep, &node->bounds))
+      continue;
+
+    if (!node->tri_count) {
+      // the children are allocated in pairs, the right follows the left.
+      if (used + 2 > capacity)
+        stack = bvh_stack_grow(
+          stack, local, &capacity, sizeof(uint32_t), mesh->allocator);
+      stack[used++] = node->left_first + 1;
+      stack[used++] = node->left_first;
+      continue;
+    }
+
+    if (!COLLISION_VARIANT(bvh_query_leaf)(
+      mesh, node->left_first, node->tri_count,
+      bounds, sweep, capsule, callback, user_data)) {
+      result = 0;
+      break;
+    }
+  }
+
+  if (stack != local)
+    mesh->allocator->mem_free(stack);
+  if (visited)
+    *visited += nodes;
+  return result;
+}
+
+int32_t
+COLLISION_VARIANT(face_list_query)(
+  const collision_mesh_t *mesh,
+  const face_list_t *list,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data)
+{
+  assert(mesh && list && bounds && callback);
+
+  for (uint32_t index = 0; index < list->count; ++index) {
+    uint32_t i = list->indices[index];
+
+    if (!COLLISION_VARIANT(bvh_query_accepts_face)(
+      mesh, i, bounds, sweep, capsule))
+      continue;
+
+    if (!callback(i, user_data))
+      return 0;
+  }
+
+  return 1;
+}
+
+int32_t
+COLLISION_VARIANT(bvh_query_accepts_face)(
+  const collision_mesh_t *mesh,
+  const uint32_t i,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule)
+{
+  bvh_aabb_t *face_bounds = cvector_as(&mesh->bvh->bounds, i, bvh_aabb_t);
+  const face_packet_t *packet;
+  uint32_t lane;
+
+  if (COLLISION_DEBUG_FLAG(use_scalar_collision))
+    return
+      bounds_intersect(bounds, face_bounds) &&
+      (!sweep || bvh_sweep_intersects(sweep, face_bounds));
+
+  packet = mesh->packets.packets + i / FACE_PACKET_WIDTH;
+  lane = 1u << (i % FACE_PACKET_WIDTH);
+
+  if (!(face_packet_bounds_mask(packet, bounds) & lane))
+    return 0;
+
+  if (
+    capsule &&
+    !(face_packet_plane_mask(packet, capsule, BOUNDS_MULTIPLIER) & lane))
+    return 0;
+
+  return !sweep || bvh_sweep_intersects(sweep, face_bounds);
+}
+
+#if !defined(COLLISION_RELEASE)
+int32_t
+bvh_query_leaf_release(
+  const collision_mesh_t *mesh,
+  const uint32_t first,
+  const uint32_t count,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data);
+
+int32_t
+bvh_query_faces_swept_release(
+  const collision_mesh_t *mesh,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data,
+  uint32_t *visited);
+
+int32_t
+face_list_query_release(
+  const collision_mesh_t *mesh,
+  const face_list_t *list,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data);
+
+int32_t
+bvh_query_accepts_face_release(
+  const collision_mesh_t *mesh,
+  const uint32_t i,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule);
+
+int32_t
+bvh_query_leaf(
+  const collision_mesh_t *mesh,
+  const uint32_t first,
+  const uint32_t count,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data)
+{
+  if (g_collision_variant == COLLISION_VARIANT_RELEASE)
+    return bvh_query_leaf_release(
+      mesh, first, count, bounds, sweep, capsule, callback, user_data);
+
+  return bvh_query_leaf_debug(
+    mesh, first, count, bounds, sweep, capsule, callback, user_data);
+}
+
+int32_t
+bvh_query_faces(
+  const collision_mesh_t *mesh,
+  bvh_aabb_t *bounds,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data)
+{
+  return bvh_query_faces_counted(
+    mesh, bounds, capsule, callback, user_data, NULL);
+}
+
+int32_t
+bvh_query_faces_counted(
+  const collision_mesh_t *mesh,
+  bvh_aabb_t *bounds,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data,
+  uint32_t *visited)
+{
+  return bvh_query_faces_swept(
+    mesh, bounds, NULL, capsule, callback, user_data, visited);
+}
+
+int32_t
+bvh_query_faces_swept(
+  const collision_mesh_t *mesh,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data,
+  uint32_t *visited)
+{
+  if (g_collision_variant == COLLISION_VARIANT_RELEASE)
+    return bvh_query_faces_swept_release(
+      mesh, bounds, sweep, capsule, callback, user_data, visited);
+
+  return bvh_query_faces_swept_debug(
+    mesh, bounds, sweep, capsule, callback, user_data, visited);
+}
+
+static
+int32_t
+push_face(uint32_t face_index, void *user_data)
+{
+  face_list_push((face_list_t *)user_data, face_index);
+  return 1;
+}
+
+uint32_t
+bvh_gather_faces(
+  const collision_mesh_t *mesh,
+  bvh_aabb_t *bounds,
+  const capsule_t *capsule,
+  face_list_t *out)
+{
+  uint32_t count = out->count;
+  bvh_query_faces(mesh, bounds, capsule, push_face, out);
+  return out->count - count;
+}
+
+int32_t
+face_list_query(
+  const collision_mesh_t *mesh,
+  const face_list_t *list,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data)
+{
+  if (g_collision_variant == COLLISION_VARIANT_RELEASE)
+    return face_list_query_release(
+      mesh, list, bounds, sweep, capsule, callback, user_data);
+
+  return face_list_query_debug(
+    mesh, list, bounds, sweep, capsule, callback, user_data);
+}
+
+int32_t
+bvh_query_accepts_face(
+  const collision_mesh_t *mesh,
+  const uint32_t i,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule)
+{
+  if (g_collision_variant == COLLISION_VARIANT_RELEASE)
+    return bvh_query_accepts_face_release(
+      mesh, i, bounds, sweep, capsule);
+
+  return bvh_query_accepts_face_debug(mesh, i, bounds, sweep, capsule);
+}
+#endif
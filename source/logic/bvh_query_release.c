@@ -0,0 +1,12 @@
+/**
+ * @file bvh_query_release.c
+ * @author khalilhenoud@gmail.com
+ * @brief release variant of bvh_query.c, see collision_variant.h.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#define COLLISION_RELEASE
+#include "bvh_query.c"
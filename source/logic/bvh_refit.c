@@ -0,0 +1,398 @@
+/**
+ * @file bvh_refit.c
+ * @author khalilhenoud@gmail.com
+ * @brief moves groups of level faces and refits the bvh bottom up.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <game/logic/bvh_query.h>
+#include <game/logic/bvh_refit.h>
+#include <game/logic/collision_mesh.h>
+#include <library/allocator/allocator.h>
+#include <math/face.h>
+#include <math/matrix4f.h>
+#include <spatial/bvh/bvh.h>
+
+
+static
+float
+get_area(const bvh_aabb_t *bounds)
+{
+  vector3f size = diff_v3f(bounds->min_max + 1, bounds->min_max + 0);
+  return 2.f * (
+    size.data[0] * size.data[1] +
+    size.data[1] * size.data[2] +
+    size.data[2] * size.data[0]);
+}
+
+static
+float
+get_node_weight(const bvh_node_t *node)
+{
+  return node->tri_count ? (float)node->tri_count : 1.f;
+}
+
+static
+void
+update_cost(bvh_refit_t *refit)
+{
+  bvh_node_t *root = cvector_as(&refit->mesh->bvh->nodes, 0, bvh_node_t);
+  float area = get_area(&root->bounds);
+  refit->cost = area > 0.f ? refit->area_sum / area : 0.f;
+}
+
+/**
+ * Links every reachable node to its parent and every face to its leaf, and sums
+ * the weighted node areas.
+ */
+static
+void
+link_nodes(bvh_refit_t *refit)
+{
+  bvh_t *bvh = refit->mesh->bvh;
+  uint32_t local[BVH_QUERY_STACK_SIZE];
+  uint32_t *stack = local;
+  uint32_t capacity = BVH_QUERY_STACK_SIZE;
+  uint32_t used = 0;
+
+  for (uint32_t i = 0; i < bvh->nodes.size; ++i)
+    refit->parents[i] = BVH_REFIT_NONE;
+  refit->area_sum = 0.f;
+
+  stack[used++] = 0;
+
+  while (used) {
+    uint32_t index = stack[--used];
+    bvh_node_t *node = cvector_as(&bvh->nodes, index, bvh_node_t);
+    refit->area_sum += get_area(&node->bounds) * get_node_weight(node);
+
+    if (node->tri_count) {
+      for (uint32_t i = 0; i < node->tri_count; ++i)
+        refit->leaves[node->left_first + i] = index;
+      continue;
+    }
+
+    if (used + 2 > capacity)
+      stack = bvh_stack_grow(
+        stack, local, &capacity, sizeof(uint32_t), refit->allocator);
+    refit->parents[node->left_first] = index;
+    refit->parents[node->left_first + 1] = index;
+    stack[used++] = node->left_first + 1;
+    stack[used++] = node->left_first;
+  }
+
+  if (stack != local)
+    refit->allocator->mem_free(stack);
+  update_cost(refit);
+}
+
+void
+bvh_refit_setup(
+  bvh_refit_t *refit,
+  collision_mesh_t *mesh,
+  const allocator_t *allocator)
+{
+  bvh_t *bvh;
+
+  assert(refit && mesh && allocator);
+
+  memset(refit, 0, sizeof(bvh_refit_t));
+  bvh = mesh->bvh;
+  refit->mesh = mesh;
+  refit->allocator = allocator;
+
+  if (!bvh->nodes.size)
+    return;
+
+  refit->parents = allocator->mem_alloc(sizeof(uint32_t) * bvh->nodes.size);
+  refit->dirty = allocator->mem_alloc(sizeof(uint32_t) * bvh->nodes.size);
+  refit->is_dirty = allocator->mem_alloc(sizeof(uint8_t) * bvh->nodes.size);
+  memset(refit->is_dirty, 0, sizeof(uint8_t) * bvh->nodes.size);
+  refit->leaves = mesh->face_count ?
+    allocator->mem_alloc(sizeof(uint32_t) * mesh->face_count) : NULL;
+
+  link_nodes(refit);
+  refit->built_cost = refit->cost;
+}
+
+void
+bvh_refit_cleanup(bvh_refit_t *refit)
+{
+  const allocator_t *allocator;
+
+  assert(refit);
+
+  allocator = refit->allocator;
+  for (uint32_t i = 0; i < refit->group_count; ++i) {
+    allocator->mem_free(refit->groups[i].faces);
+    allocator->mem_free(refit->groups[i].rest);
+    allocator->mem_free(refit->groups[i].rest_normals);
+  }
+
+  if (refit->parents)
+    allocator->mem_free(refit->parents);
+  if (refit->dirty)
+    allocator->mem_free(refit->dirty);
+  if (refit->is_dirty)
+    allocator->mem_free(refit->is_dirty);
+  if (refit->leaves)
+    allocator->mem_free(refit->leaves);
+  memset(refit, 0, sizeof(bvh_refit_t));
+}
+
+uint32_t
+bvh_refit_add_group(
+  bvh_refit_t *refit,
+  const uint32_t *faces,
+  const uint32_t count)
+{
+  const allocator_t *allocator = refit->allocator;
+  bvh_t *bvh = refit->mesh->bvh;
+  bvh_refit_group_t *group;
+
+  assert(refit && faces && count);
+
+  if (refit->group_count == BVH_REFIT_MAX_GROUPS || !refit->parents)
+    return BVH_REFIT_NONE;
+
+  group = refit->groups + refit->group_count;
+  group->count = count;
+  group->faces = allocator->mem_alloc(sizeof(uint32_t) * count);
+  group->rest = allocator->mem_alloc(sizeof(face_t) * count);
+  group->rest_normals = allocator->mem_alloc(sizeof(vector3f) * count);
+
+  for (uint32_t i = 0; i < count; ++i) {
+    assert(faces[i] < refit->mesh->face_count);
+    group->faces[i] = faces[i];
+    group->rest[i] = *cvector_as(&bvh->faces, faces[i], face_t);
+    group->rest_normals[i] = *cvector_as(&bvh->normals, faces[i], vector3f);
+  }
+
+  collision_mesh_split_clusters(refit->mesh, faces, count, allocator);
+  return refit->group_count++;
+}
+
+void
+bvh_refit_move_group(
+  bvh_refit_t *refit,
+  const uint32_t group,
+  const matrix4f *rotation,
+  const vector3f *translation)
+{
+  bvh_t *bvh = refit->mesh->bvh;
+  bvh_refit_group_t *moved;
+
+  assert(refit && rotation && translation && group < refit->group_count);
+
+  moved = refit->groups + group;
+  for (uint32_t i = 0; i < moved->count; ++i) {
+    uint32_t index = moved->faces[i];
+    uint32_t leaf = refit->leaves[index];
+    face_t *face = cvector_as(&bvh->faces, index, face_t);
+    bvh_aabb_t *bounds = cvector_as(&bvh->bounds, index, bvh_aabb_t);
+
+    for (uint32_t k = 0; k < 3; ++k) {
+      face->points[k] = mult_m4f_v3f(rotation, moved->rest[i].points + k);
+      add_set_v3f(face->points + k, translation);
+    }
+    *cvector_as(&bvh->normals, index, vector3f) =
+      mult_m4f_v3f(rotation, moved->rest_normals + i);
+
+    bounds->min_max[0] = bounds->min_max[1] = face->points[0];
+    for (uint32_t k = 1; k < 3; ++k) {
+      for (uint32_t axis = 0; axis < 3; ++axis) {
+        float value = face->points[k].data[axis];
+        bounds->min_max[0].data[axis] =
+          fminf(bounds->min_max[0].data[axis], value);
+        bounds->min_max[1].data[axis] =
+          fmaxf(bounds->min_max[1].data[axis], value);
+      }
+    }
+
+    collision_mesh_update_face(refit->mesh, index);
+
+    if (!refit->is_dirty[leaf]) {
+      refit->is_dirty[leaf] = 1;
+      refit->dirty[refit->dirty_count++] = leaf;
+    }
+  }
+}
+
+static
+int32_t
+is_same_bounds(const bvh_aabb_t *a, const bvh_aabb_t *b)
+{
+  return !memcmp(a, b, sizeof(bvh_aabb_t));
+}
+
+// recomputes the bounds of 'index', returns 0 if they did not change.
+static
+int32_t
+refit_node(
+  bvh_refit_t *refit,
+  const uint32_t index)
+{
+  bvh_t *bvh = refit->mesh->bvh;
+  bvh_node_t *node = cvector_as(&bvh->nodes, index, bvh_node_t);
+  bvh_aabb_t bounds;
+
+  if (node->tri_count) {
+    bounds = *cvector_as(&bvh->bounds, node->left_first, bvh_aabb_t);
+    for (uint32_t i = 1; i < node->tri_count; ++i) {
+      bvh_aabb_t merged;
+      merge_aabb(
+        &merged,
+        &bounds,
+        cvector_as(&bvh->bounds, node->left_first + i, bvh_aabb_t));
+      bounds = merged;
+    }
+  } else
+    merge_aabb(
+      &bounds,
+      &cvector_as(&bvh->nodes, node->left_first, bvh_node_t)->bounds,
+      &cvector_as(&bvh->nodes, node->left_first + 1, bvh_node_t)->bounds);
+
+  if (is_same_bounds(&bounds, &node->bounds))
+    return 0;
+
+  refit->area_sum +=
+    (get_area(&bounds) - get_area(&node->bounds)) * get_node_weight(node);
+  node->bounds = bounds;
+  return 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// the rebuild keeps the faces where they are, the face indices are referenced
+// everywhere. The leaves are kept as they are and the tree above them is built
+// again with median splits.
+static
+uint32_t sort_axis;
+
+static
+int
+compare_leaves(const void *lhs, const void *rhs)
+{
+  const bvh_node_t *a = (const bvh_node_t *)lhs;
+  const bvh_node_t *b = (const bvh_node_t *)rhs;
+  float ca =
+    a->bounds.min_max[0].data[sort_axis] + a->bounds.min_max[1].data[sort_axis];
+  float cb =
+    b->bounds.min_max[0].data[sort_axis] + b->bounds.min_max[1].data[sort_axis];
+  return ca < cb ? -1 : (ca > cb ? 1 : 0);
+}
+
+static
+void
+build_node(
+  bvh_t *bvh,
+  bvh_node_t *leaves,
+  const uint32_t count,
+  const uint32_t index,
+  uint32_t *next)
+{
+  bvh_node_t *node = cvector_as(&bvh->nodes, index, bvh_node_t);
+  vector3f min, max;
+  uint32_t left, half;
+
+  if (count == 1) {
+    *node = leaves[0];
+    return;
+  }
+
+  // split on the longest axis of the leaf centers.
+  vector3f_set_1f(&min, FLT_MAX);
+  vector3f_set_1f(&max, -FLT_MAX);
+  for (uint32_t i = 0; i < count; ++i) {
+    for (uint32_t axis = 0; axis < 3; ++axis) {
+      float center =
+        leaves[i].bounds.min_max[0].data[axis] +
+        leaves[i].bounds.min_max[1].data[axis];
+      min.data[axis] = fminf(min.data[axis], center);
+      max.data[axis] = fmaxf(max.data[axis], center);
+    }
+  }
+
+  sort_axis = 0;
+  for (uint32_t axis = 1; axis < 3; ++axis)
+    if (
+      max.data[axis] - min.data[axis] >
+      max.data[sort_axis] - min.data[sort_axis])
+      sort_axis = axis;
+  qsort(leaves, count, sizeof(bvh_node_t), compare_leaves);
+
+  half = count / 2;
+  left = *next;
+  *next += 2;
+  build_node(bvh, leaves, half, left, next);
+  build_node(bvh, leaves + half, count - half, left + 1, next);
+
+  node = cvector_as(&bvh->nodes, index, bvh_node_t);
+  node->left_first = left;
+  node->tri_count = 0;
+  merge_aabb(
+    &node->bounds,
+    &cvector_as(&bvh->nodes, left, bvh_node_t)->bounds,
+    &cvector_as(&bvh->nodes, left + 1, bvh_node_t)->bounds);
+}
+
+static
+void
+rebuild(bvh_refit_t *refit)
+{
+  const allocator_t *allocator = refit->allocator;
+  bvh_t *bvh = refit->mesh->bvh;
+  bvh_node_t *leaves;
+  uint32_t count = 0, next = 1;
+
+  leaves = allocator->mem_alloc(sizeof(bvh_node_t) * bvh->nodes.size);
+  for (uint32_t i = 0; i < bvh->nodes.size; ++i) {
+    // the unreachable nodes have no parent, the root included.
+    bvh_node_t *node = cvector_as(&bvh->nodes, i, bvh_node_t);
+    if (node->tri_count && (i == 0 || refit->parents[i] != BVH_REFIT_NONE))
+      leaves[count++] = *node;
+  }
+
+  // a binary tree over 'count' leaves takes 2 * count - 1 nodes, no more than
+  // the tree it replaces.
+  assert(count && 2 * count - 1 <= bvh->nodes.size);
+  build_node(bvh, leaves, count, 0, &next);
+  allocator->mem_free(leaves);
+
+  link_nodes(refit);
+  refit->built_cost = refit->cost;
+  refit->rebuilds++;
+}
+
+void
+bvh_refit_update(bvh_refit_t *refit)
+{
+  assert(refit);
+
+  if (!refit->dirty_count)
+    return;
+
+  // walk up from every moved leaf, stop as soon as the bounds are unchanged.
+  for (uint32_t i = 0; i < refit->dirty_count; ++i) {
+    uint32_t index = refit->dirty[i];
+    refit->is_dirty[index] = 0;
+
+    while (index != BVH_REFIT_NONE && refit_node(refit, index))
+      index = refit->parents[index];
+  }
+
+  refit->dirty_count = 0;
+  refit->refits++;
+  refit->mesh->revision++;
+  update_cost(refit);
+
+  if (refit->cost > refit->built_cost * BVH_REFIT_REBUILD_RATIO)
+    rebuild(refit);
+}
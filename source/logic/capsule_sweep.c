@@ -0,0 +1,403 @@
+/**
+ * @file capsule_sweep.c
+ * @author khalilhenoud@gmail.com
+ * @brief closed form swept capsule against face time of impact.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <assert.h>
+#include <math.h>
+#include <game/logic/capsule_sweep.h>
+#include <collision/face.h>
+#include <math/capsule.h>
+#include <math/face.h>
+
+#define SWEEP_EPSILON       1e-6f
+
+
+// NOTE: the capsule axis is the world y axis, its segment goes from
+// 'center - half_height' to 'center + half_height'. All the tests below are
+// first root problems of the form |p + t * v|^2 = r^2 with 'p' outside.
+
+static
+void
+keep_earliest(
+  sweep_result_t *result,
+  const float time,
+  const vector3f *normal,
+  const sweep_feature_t feature,
+  const uint32_t feature_index)
+{
+  if (time >= result->time)
+    return;
+
+  result->time = time;
+  result->normal = *normal;
+  normalize_set_v3f(&result->normal);
+  result->feature = feature;
+  result->feature_index = feature_index;
+}
+
+// returns the first root in [0, 1] of a * t^2 + b * t + c = 0, or -1.
+static
+float
+first_root(const float a, const float b, const float c)
+{
+  float discriminant, t;
+
+  // starting inside or not moving relative to the shape.
+  if (c <= 0.f || a <= SWEEP_EPSILON)
+    return -1.f;
+
+  discriminant = b * b - 4.f * a * c;
+  if (discriminant < 0.f)
+    return -1.f;
+
+  t = (-b - sqrtf(discriminant)) / (2.f * a);
+  return (t >= 0.f && t <= 1.f) ? t : -1.f;
+}
+
+static
+int32_t
+is_in_face(
+  const face_t *face,
+  const vector3f *normal,
+  const point3f *point)
+{
+  float side[3];
+
+  for (uint32_t i = 0; i < 3; ++i) {
+    vector3f edge = diff_v3f(face->points + (i + 1) % 3, face->points + i);
+    vector3f to_point = diff_v3f(point, face->points + i);
+    vector3f cross = cross_product_v3f(&edge, &to_point);
+    side[i] = dot_product_v3f(&cross, normal);
+  }
+
+  // winding agnostic, the point is inside if it is on the same side of all.
+  return
+    (side[0] >= -SWEEP_EPSILON &&
+     side[1] >= -SWEEP_EPSILON &&
+     side[2] >= -SWEEP_EPSILON) ||
+    (side[0] <= SWEEP_EPSILON &&
+     side[1] <= SWEEP_EPSILON &&
+     side[2] <= SWEEP_EPSILON);
+}
+
+// a capsule sphere moving towards the face plane, from either side.
+static
+void
+sweep_sphere_plane(
+  const point3f *center,
+  const float radius,
+  const face_t *face,
+  const vector3f *normal,
+  const vector3f *displacement,
+  sweep_result_t *result)
+{
+  float distance = dot_product_v3f(normal, face->points + 0);
+  float s0 = dot_product_v3f(normal, center) - distance;
+  float speed = dot_product_v3f(normal, displacement);
+  float side = s0 > 0.f ? 1.f : -1.f;
+  float t;
+
+  // already within reach of the plane, or moving away from it.
+  if (fabsf(s0) <= radius || side * speed >= -SWEEP_EPSILON)
+    return;
+
+  t = (s0 - side * radius) / -speed;
+  if (t < 0.f || t > 1.f || t >= result->time)
+    return;
+
+  {
+    vector3f offset = mult_v3f(displacement, t);
+    vector3f to_plane = mult_v3f(normal, -side * radius);
+    point3f contact = add_v3f(center, &offset);
+    add_set_v3f(&contact, &to_plane);
+
+    if (is_in_face(face, normal, &contact)) {
+      vector3f facing = mult_v3f(normal, side);
+      keep_earliest(result, t, &facing, SWEEP_FEATURE_FACE, 0);
+    }
+  }
+}
+
+// a capsule sphere against the infinite cylinder around the edge, clamped to
+// the edge extent.
+static
+void
+sweep_sphere_edge(
+  const point3f *center,
+  const float radius,
+  const point3f *e0,
+  const point3f *e1,
+  const vector3f *displacement,
+  const uint32_t edge_index,
+  sweep_result_t *result)
+{
+  vector3f edge = diff_v3f(e1, e0);
+  float length_sqrd = length_squared_v3f(&edge);
+  vector3f w = diff_v3f(center, e0);
+  vector3f w_perp, d_perp, along;
+  float t, s;
+
+  if (length_sqrd <= SWEEP_EPSILON)
+    return;
+
+  along = mult_v3f(&edge, dot_product_v3f(&w, &edge) / length_sqrd);
+  w_perp = diff_v3f(&w, &along);
+  along = mult_v3f(&edge, dot_product_v3f(displacement, &edge) / length_sqrd);
+  d_perp = diff_v3f(displacement, &along);
+
+  t = first_root(
+    dot_product_v3f(&d_perp, &d_perp),
+    2.f * dot_product_v3f(&w_perp, &d_perp),
+    dot_product_v3f(&w_perp, &w_perp) - radius * radius);
+  if (t < 0.f || t >= result->time)
+    return;
+
+  {
+    vector3f offset = mult_v3f(displacement, t);
+    vector3f moved = add_v3f(&w, &offset);
+    s = dot_product_v3f(&moved, &edge) / length_sqrd;
+    if (s < 0.f || s > 1.f)
+      return;
+
+    along = mult_v3f(&edge, s);
+    moved = diff_v3f(&moved, &along);
+    keep_earliest(result, t, &moved, SWEEP_FEATURE_EDGE, edge_index);
+  }
+}
+
+// a capsule sphere against a face vertex.
+static
+void
+sweep_sphere_vertex(
+  const point3f *center,
+  const float radius,
+  const point3f *vertex,
+  const vector3f *displacement,
+  const uint32_t vertex_index,
+  sweep_result_t *result)
+{
+  vector3f w = diff_v3f(center, vertex);
+  float t = first_root(
+    dot_product_v3f(displacement, displacement),
+    2.f * dot_product_v3f(&w, displacement),
+    dot_product_v3f(&w, &w) - radius * radius);
+
+  if (t < 0.f || t >= result->time)
+    return;
+
+  {
+    vector3f offset = mult_v3f(displacement, t);
+    add_set_v3f(&w, &offset);
+    keep_earliest(result, t, &w, SWEEP_FEATURE_VERTEX, vertex_index);
+  }
+}
+
+// the capsule cylinder against a face vertex, the vertex is moved by the
+// opposite of the displacement against the static capsule axis.
+static
+void
+sweep_cylinder_vertex(
+  const capsule_t *capsule,
+  const point3f *vertex,
+  const vector3f *displacement,
+  const uint32_t vertex_index,
+  sweep_result_t *result)
+{
+  float wx = capsule->center.data[0] - vertex->data[0];
+  float wz = capsule->center.data[2] - vertex->data[2];
+  float dx = displacement->data[0];
+  float dz = displacement->data[2];
+  float t = first_root(
+    dx * dx + dz * dz,
+    2.f * (wx * dx + wz * dz),
+    wx * wx + wz * wz - capsule->radius * capsule->radius);
+  float y;
+
+  if (t < 0.f || t >= result->time)
+    return;
+
+  y = vertex->data[1] - (capsule->center.data[1] + displacement->data[1] * t);
+  if (fabsf(y) > capsule->half_height)
+    return;
+
+  {
+    vector3f normal;
+    vector3f_set_3f(&normal, wx + dx * t, 0.f, wz + dz * t);
+    keep_earliest(result, t, &normal, SWEEP_FEATURE_VERTEX, vertex_index);
+  }
+}
+
+// the capsule cylinder against an edge interior, the distance between the two
+// supporting lines is linear in time.
+static
+void
+sweep_cylinder_edge(
+  const capsule_t *capsule,
+  const point3f *e0,
+  const point3f *e1,
+  const vector3f *displacement,
+  const uint32_t edge_index,
+  sweep_result_t *result)
+{
+  const float radius = capsule->radius;
+  const float half_height = capsule->half_height;
+  vector3f edge = diff_v3f(e1, e0);
+  vector3f w = diff_v3f(&capsule->center, e0);
+  vector3f m;
+  float m_length;
+
+  // y cross edge.
+  vector3f_set_3f(&m, edge.data[2], 0.f, -edge.data[0]);
+  m_length = length_v3f(&m);
+
+  if (m_length <= SWEEP_EPSILON) {
+    // vertical edge, a circle in the xz plane with an overlap check along y.
+    float dx = displacement->data[0];
+    float dz = displacement->data[2];
+    float t = first_root(
+      dx * dx + dz * dz,
+      2.f * (w.data[0] * dx + w.data[2] * dz),
+      w.data[0] * w.data[0] + w.data[2] * w.data[2] - radius * radius);
+    float y, e_min, e_max;
+
+    if (t < 0.f || t >= result->time)
+      return;
+
+    y = capsule->center.data[1] + displacement->data[1] * t;
+    e_min = fminf(e0->data[1], e1->data[1]);
+    e_max = fmaxf(e0->data[1], e1->data[1]);
+    if (y + half_height < e_min || y - half_height > e_max)
+      return;
+
+    vector3f_set_3f(&m, w.data[0] + dx * t, 0.f, w.data[2] + dz * t);
+    keep_earliest(result, t, &m, SWEEP_FEATURE_EDGE, edge_index);
+    return;
+  }
+
+  mult_set_v3f(&m, 1.f / m_length);
+
+  {
+    float d0 = dot_product_v3f(&w, &m);
+    float speed = dot_product_v3f(displacement, &m);
+    float side = d0 > 0.f ? 1.f : -1.f;
+    float t, u, s, denominator;
+    vector3f offset;
+
+    if (fabsf(d0) <= radius || side * speed >= -SWEEP_EPSILON)
+      return;
+
+    t = (side * radius - d0) / speed;
+    if (t < 0.f || t > 1.f || t >= result->time)
+      return;
+
+    // closest points between the lines 'center(t) + u * y' and 'e0 + s * e'.
+    offset = mult_v3f(displacement, t);
+    add_set_v3f(&w, &offset);
+    denominator = edge.data[0] * edge.data[0] + edge.data[2] * edge.data[2];
+    u =
+      (edge.data[1] * dot_product_v3f(&edge, &w) -
+      length_squared_v3f(&edge) * w.data[1]) / denominator;
+    s = (dot_product_v3f(&edge, &w) - edge.data[1] * w.data[1]) / denominator;
+
+    if (u < -half_height || u > half_height || s < 0.f || s > 1.f)
+      return;
+
+    mult_set_v3f(&m, side);
+    keep_earliest(result, t, &m, SWEEP_FEATURE_EDGE, edge_index);
+  }
+}
+
+int32_t
+sweep_capsule_face(
+  const capsule_t *capsule,
+  const face_t *face,
+  const vector3f *normal,
+  const vector3f *displacement,
+  sweep_result_t *result)
+{
+  point3f spheres[2];
+
+  assert(capsule && face && normal && displacement && result);
+
+  result->time = 1.f;
+  vector3f_set_1f(&result->normal, 0.f);
+  result->feature = SWEEP_FEATURE_NONE;
+  result->feature_index = 0;
+
+  {
+    // an overlapping capsule is at time 0, the classification is shared with
+    // the iterative solver.
+    vector3f penetration;
+    point3f sphere_center;
+    capsule_face_classification_t classification =
+      classify_capsule_face(
+        capsule, face, normal, 0, &penetration, &sphere_center);
+
+    if (classification != CAPSULE_FACE_NO_COLLISION) {
+      result->time = 0.f;
+      result->normal = *normal;
+      result->feature = SWEEP_FEATURE_FACE;
+      return 1;
+    }
+  }
+
+  if (IS_ZERO_LP(length_squared_v3f(displacement)))
+    return 0;
+
+  spheres[0] = spheres[1] = capsule->center;
+  spheres[0].data[1] -= capsule->half_height;
+  spheres[1].data[1] += capsule->half_height;
+
+  // face interior, only reachable through the spheres.
+  for (uint32_t i = 0; i < 2; ++i)
+    sweep_sphere_plane(
+      spheres + i, capsule->radius, face, normal, displacement, result);
+
+  // edges, against the spheres and the cylinder.
+  for (uint32_t e = 0; e < 3; ++e) {
+    const point3f *e0 = face->points + e;
+    const point3f *e1 = face->points + (e + 1) % 3;
+
+    for (uint32_t i = 0; i < 2; ++i)
+      sweep_sphere_edge(
+        spheres + i, capsule->radius, e0, e1, displacement, e, result);
+    sweep_cylinder_edge(capsule, e0, e1, displacement, e, result);
+  }
+
+  // vertices, against the spheres and the cylinder.
+  for (uint32_t v = 0; v < 3; ++v) {
+    for (uint32_t i = 0; i < 2; ++i)
+      sweep_sphere_vertex(
+        spheres + i, capsule->radius, face->points + v, displacement, v,
+        result);
+    sweep_cylinder_vertex(capsule, face->points + v, displacement, v, result);
+  }
+
+  return result->feature != SWEEP_FEATURE_NONE;
+}
+
+float
+sweep_capsule_face_time(
+  const capsule_t *capsule,
+  const face_t *face,
+  const vector3f *normal,
+  const vector3f *displacement,
+  const float limit_distance)
+{
+  sweep_result_t result;
+
+  if (!sweep_capsule_face(capsule, face, normal, displacement, &result))
+    return 1.f;
+
+  if (result.time == 0.f)
+    return 0.f;
+
+  return fmaxf(
+    result.time - limit_distance / length_v3f(displacement), 0.f);
+}
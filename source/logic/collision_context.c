@@ -0,0 +1,251 @@
+/**
+ * @file collision_context.c
+ * @author khalilhenoud@gmail.com
+ * @brief per agent state used by the capsule collision queries.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <assert.h>
+#include <math.h>
+#include <stddef.h>
+#include <game/debug/flags.h>
+#include <game/logic/collision_context.h>
+#include <game/logic/collision_mesh.h>
+#include <game/logic/collision_recorder.h>
+#include <game/logic/collision_utils.h>
+#include <game/logic/collision_variant.h>
+#include <math/capsule.h>
+#include <math/vector3f.h>
+
+#define CANDIDATES_INITIAL_CAPACITY   256
+#define CACHE_INITIAL_CAPACITY        1024
+#define CACHE_RADIUS_MULTIPLIER       2.f
+
+
+#if !defined(COLLISION_RELEASE)
+void
+collision_context_setup(
+  collision_context_t *context,
+  collision_mesh_t *mesh,
+  const allocator_t *allocator)
+{
+  assert(context && allocator);
+
+  context->mesh = mesh;
+  face_list_setup(
+    &context->candidates, CANDIDATES_INITIAL_CAPACITY, allocator);
+  face_list_setup(&context->cache, CACHE_INITIAL_CAPACITY, allocator);
+  context->cache_valid = 0;
+  context->cache_revision = 0;
+  collision_counters_reset(&context->counters);
+}
+
+void
+collision_context_cleanup(collision_context_t *context)
+{
+  assert(context);
+
+  face_list_cleanup(&context->candidates);
+  face_list_cleanup(&context->cache);
+  context->cache_valid = 0;
+  context->mesh = NULL;
+}
+#endif
+
+// NULL unless the work is being counted.
+static
+uint32_t *
+get_visited_counter(collision_context_t *context)
+{
+  if (!COLLISION_DEBUG_FLAG(count_collision_work))
+    return NULL;
+
+  context->counters.queries++;
+  return &context->counters.nodes_visited;
+}
+
+static
+int32_t
+push_face(uint32_t face_index, void *user_data)
+{
+  face_list_push((face_list_t *)user_data, face_index);
+  return 1;
+}
+
+static
+int32_t
+is_contained(const bvh_aabb_t *outer, const bvh_aabb_t *inner)
+{
+  for (uint32_t axis = 0; axis < 3; ++axis) {
+    if (
+      inner->min_max[0].data[axis] < outer->min_max[0].data[axis] ||
+      inner->min_max[1].data[axis] > outer->min_max[1].data[axis])
+      return 0;
+  }
+
+  return 1;
+}
+
+static
+int32_t
+is_cache_usable(collision_context_t *context, const bvh_aabb_t *bounds)
+{
+  return
+    context->cache_valid &&
+    context->cache_revision == context->mesh->revision &&
+    !COLLISION_DEBUG_FLAG(disable_candidate_cache) &&
+    is_contained(&context->cache_bounds, bounds);
+}
+
+void
+COLLISION_VARIANT(collision_context_prefetch)(
+  collision_context_t *context,
+  const capsule_t *capsule,
+  const vector3f *displacement)
+{
+  bvh_aabb_t swept;
+
+  assert(context && capsule && displacement);
+
+  if (COLLISION_DEBUG_ENABLED)
+    collision_recorder_prefetch(context, capsule, displacement);
+
+  if (!context->mesh || COLLISION_DEBUG_FLAG(disable_candidate_cache)) {
+    context->cache_valid = 0;
+    return;
+  }
+
+  populate_moving_capsule_aabb(&swept, capsule, displacement, 1.f);
+  if (
+    context->cache_valid &&
+    context->cache_revision == context->mesh->revision &&
+    is_contained(&context->cache_bounds, &swept))
+    return;
+
+  // the slack covers the step up and snap probes and a few frames of motion.
+  {
+    float slack = capsule->radius * CACHE_RADIUS_MULTIPLIER;
+    vector3f offset;
+    vector3f_set_3f(
+      &offset,
+      slack + fabsf(displacement->data[0]),
+      slack + fabsf(displacement->data[1]),
+      slack + fabsf(displacement->data[2]));
+    context->cache_bounds = swept;
+    diff_set_v3f(context->cache_bounds.min_max + 0, &offset);
+    add_set_v3f(context->cache_bounds.min_max + 1, &offset);
+  }
+
+  context->cache.count = 0;
+  COLLISION_VARIANT(bvh_query_faces_swept)(
+    context->mesh, &context->cache_bounds, NULL, NULL,
+    push_face, &context->cache, get_visited_counter(context));
+  context->cache_valid = 1;
+  context->cache_revision = context->mesh->revision;
+}
+
+int32_t
+COLLISION_VARIANT(collision_context_query_faces)(
+  collision_context_t *context,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data)
+{
+  if (is_cache_usable(context, bounds))
+    return COLLISION_VARIANT(face_list_query)(
+      context->mesh, &context->cache,
+      bounds, sweep, capsule, callback, user_data);
+
+  return COLLISION_VARIANT(bvh_query_faces_swept)(
+    context->mesh, bounds, sweep, capsule,
+    callback, user_data, get_visited_counter(context));
+}
+
+uint32_t
+COLLISION_VARIANT(collision_context_gather_faces)(
+  collision_context_t *context,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  face_list_t *out)
+{
+  uint32_t count = out->count;
+  COLLISION_VARIANT(collision_context_query_faces)(
+    context, bounds, sweep, capsule, push_face, out);
+  return out->count - count;
+}
+
+#if !defined(COLLISION_RELEASE)
+void
+collision_context_prefetch_release(
+  collision_context_t *context,
+  const capsule_t *capsule,
+  const vector3f *displacement);
+
+int32_t
+collision_context_query_faces_release(
+  collision_context_t *context,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data);
+
+uint32_t
+collision_context_gather_faces_release(
+  collision_context_t *context,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  face_list_t *out);
+
+void
+collision_context_prefetch(
+  collision_context_t *context,
+  const capsule_t *capsule,
+  const vector3f *displacement)
+{
+  if (g_collision_variant == COLLISION_VARIANT_RELEASE)
+    collision_context_prefetch_release(context, capsule, displacement);
+  else
+    collision_context_prefetch_debug(context, capsule, displacement);
+}
+
+int32_t
+collision_context_query_faces(
+  collision_context_t *context,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data)
+{
+  if (g_collision_variant == COLLISION_VARIANT_RELEASE)
+    return collision_context_query_faces_release(
+      context, bounds, sweep, capsule, callback, user_data);
+
+  return collision_context_query_faces_debug(
+    context, bounds, sweep, capsule, callback, user_data);
+}
+
+uint32_t
+collision_context_gather_faces(
+  collision_context_t *context,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  face_list_t *out)
+{
+  if (g_collision_variant == COLLISION_VARIANT_RELEASE)
+    return collision_context_gather_faces_release(
+      context, bounds, sweep, capsule, out);
+
+  return collision_context_gather_faces_debug(
+    context, bounds, sweep, capsule, out);
+}
+#endif
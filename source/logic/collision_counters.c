@@ -0,0 +1,127 @@
+/**
+ * @file collision_counters.c
+ * @author khalilhenoud@gmail.com
+ * @brief per frame collision work counters, streamed to a csv file.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <game/debug/color.h>
+#include <game/debug/text.h>
+#include <game/logic/collision_counters.h>
+
+
+static FILE *csv;
+
+void
+collision_counters_reset(collision_counters_t *counters)
+{
+  assert(counters);
+  memset(counters, 0, sizeof(collision_counters_t));
+}
+
+void
+collision_counters_add(
+  collision_counters_t *total,
+  const collision_counters_t *counters)
+{
+  assert(total && counters);
+
+  total->queries += counters->queries;
+  total->nodes_visited += counters->nodes_visited;
+  total->faces_tested += counters->faces_tested;
+  total->post_displacement_rejects += counters->post_displacement_rejects;
+  total->toi_solves += counters->toi_solves;
+  total->toi_iterations += counters->toi_iterations;
+  total->buckets_formed += counters->buckets_formed;
+  total->buckets_removed += counters->buckets_removed;
+  total->sweep_steps += counters->sweep_steps;
+}
+
+void
+collision_counters_draw(
+  const collision_counters_t *counters,
+  const float x,
+  const float y)
+{
+  char text[256];
+
+  assert(counters);
+
+  snprintf(
+    text, sizeof(text),
+    "QUERIES: %u     NODES: %u     FACES: %u     REJECTS: %u",
+    counters->queries, counters->nodes_visited,
+    counters->faces_tested, counters->post_displacement_rejects);
+  add_debug_text_to_frame(text, white, x, y);
+
+  snprintf(
+    text, sizeof(text),
+    "TOI SOLVES: %u     ITERATIONS: %u     BUCKETS: %u/%u     STEPS: %u",
+    counters->toi_solves, counters->toi_iterations,
+    counters->buckets_removed, counters->buckets_formed,
+    counters->sweep_steps);
+  add_debug_text_to_frame(text, white, x, y + 20.f);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint32_t
+collision_counters_open(const char *path)
+{
+  assert(path);
+
+  collision_counters_close();
+  csv = fopen(path, "w");
+  if (!csv)
+    return 0;
+
+  fprintf(
+    csv,
+    "frame,frame_ms,agents,x,y,z,queries,nodes_visited,faces_tested,"
+    "post_displacement_rejects,toi_solves,toi_iterations,buckets_formed,"
+    "buckets_removed,sweep_steps\n");
+  return 1;
+}
+
+void
+collision_counters_close(void)
+{
+  if (csv)
+    fclose(csv);
+  csv = NULL;
+}
+
+uint32_t
+collision_counters_is_open(void)
+{
+  return csv != NULL;
+}
+
+void
+collision_counters_write(
+  const uint64_t frame,
+  const float frame_ms,
+  const uint32_t agents,
+  const point3f *position,
+  const collision_counters_t *counters)
+{
+  assert(position && counters);
+
+  if (!csv)
+    return;
+
+  fprintf(
+    csv,
+    "%llu,%.3f,%u,%.2f,%.2f,%.2f,%u,%u,%u,%u,%u,%u,%u,%u,%u\n",
+    (unsigned long long)frame, frame_ms, agents,
+    position->data[0], position->data[1], position->data[2],
+    counters->queries, counters->nodes_visited, counters->faces_tested,
+    counters->post_displacement_rejects, counters->toi_solves,
+    counters->toi_iterations, counters->buckets_formed,
+    counters->buckets_removed, counters->sweep_steps);
+}
@@ -0,0 +1,400 @@
+/**
+ * @file collision_mesh.c
+ * @author khalilhenoud@gmail.com
+ * @brief per level collision data, the bvh and the structures derived from it.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <game/logic/collision_data.h>
+#include <game/logic/collision_mesh.h>
+#include <collision/face.h>
+#include <library/allocator/allocator.h>
+#include <math/face.h>
+#include <spatial/bvh/bvh.h>
+
+#define FLOOR_ANGLE_DEGREES 60
+#define NORMAL_KEY_SCALE    512.f
+#define DISTANCE_KEY_SCALE  4.f
+#define NORMAL_EPSILON      0.001f
+#define DISTANCE_EPSILON    0.01f
+
+
+// NOTE: the rounding is symmetric around 0, negating the key of a plane gives
+// the key of the opposite facing plane.
+typedef
+struct {
+  int32_t key[4];
+  uint32_t index;
+} plane_key_t;
+
+static
+void
+set_face_metadata(
+  collision_mesh_t *mesh,
+  const uint32_t i)
+{
+  bvh_t *bvh = mesh->bvh;
+  const float cosine_target = cosf(TO_RADIANS(FLOOR_ANGLE_DEGREES));
+  face_metadata_t *metadata = mesh->metadata + i;
+  face_t *face = cvector_as(&bvh->faces, i, face_t);
+  vector3f *normal = cvector_as(&bvh->normals, i, vector3f);
+  float normal_dot = normal->data[1];
+
+  if (normal_dot > cosine_target) {
+    metadata->flag = COLLIDED_FLOOR_FLAG;
+    metadata->color = FACE_COLOR_FLOOR;
+  } else if (normal_dot < -cosine_target) {
+    metadata->flag = COLLIDED_CEILING_FLAG;
+    metadata->color = FACE_COLOR_CEILING;
+  } else {
+    metadata->flag = COLLIDED_WALLS_FLAG;
+    metadata->color = FACE_COLOR_WALL;
+  }
+
+  metadata->distance = dot_product_v3f(normal, face->points + 0);
+  metadata->reserved = 0;
+  mesh->extended[i] = get_extended_face(face, mesh->extension);
+}
+
+static
+void
+build_face_metadata(
+  collision_mesh_t *mesh,
+  const allocator_t *allocator)
+{
+  mesh->metadata = NULL;
+  mesh->extended = NULL;
+  if (!mesh->face_count)
+    return;
+
+  mesh->metadata =
+    allocator->mem_alloc(sizeof(face_metadata_t) * mesh->face_count);
+  mesh->extended = allocator->mem_alloc(sizeof(face_t) * mesh->face_count);
+
+  for (uint32_t i = 0; i < mesh->face_count; ++i)
+    set_face_metadata(mesh, i);
+}
+
+static
+int32_t
+compare_keys(const int32_t a[4], const int32_t b[4])
+{
+  for (uint32_t i = 0; i < 4; ++i) {
+    if (a[i] != b[i])
+      return a[i] < b[i] ? -1 : 1;
+  }
+
+  return 0;
+}
+
+static
+int
+compare_plane_keys(const void *lhs, const void *rhs)
+{
+  const plane_key_t *a = (const plane_key_t *)lhs;
+  const plane_key_t *b = (const plane_key_t *)rhs;
+  int32_t result = compare_keys(a->key, b->key);
+  if (result)
+    return result;
+  return a->index < b->index ? -1 : (a->index > b->index ? 1 : 0);
+}
+
+// returns the position of the first entry matching 'key', or count.
+static
+uint32_t
+find_plane_key(
+  const plane_key_t *sorted,
+  const uint32_t count,
+  const int32_t key[4])
+{
+  uint32_t low = 0, high = count;
+
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    if (compare_keys(sorted[middle].key, key) < 0)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  return (low < count && !compare_keys(sorted[low].key, key)) ? low : count;
+}
+
+// true if the plane of 'face' is within the epsilons of 'normal'/'distance'.
+static
+int32_t
+is_close_plane(
+  const collision_mesh_t *mesh,
+  const uint32_t face,
+  const vector3f *normal,
+  const float distance)
+{
+  const vector3f *other = cvector_as(&mesh->bvh->normals, face, vector3f);
+
+  for (uint32_t i = 0; i < 3; ++i) {
+    if (fabsf(other->data[i] - normal->data[i]) > NORMAL_EPSILON)
+      return 0;
+  }
+
+  return fabsf(mesh->metadata[face].distance - distance) <= DISTANCE_EPSILON;
+}
+
+/**
+ * Returns the cluster of the cell 'key' or of one of its 80 neighbouring
+ * cells, or PLANE_CLUSTER_NONE. The cell 'key' is accepted as is, neighbours
+ * only if their representative plane is within the epsilons of the given one,
+ * this keeps planes sitting on a rounding boundary in one cluster. Faces not
+ * yet assigned a cluster are skipped.
+ */
+static
+uint32_t
+find_close_cluster(
+  const collision_mesh_t *mesh,
+  const plane_key_t *sorted,
+  const uint32_t *representatives,
+  const int32_t key[4],
+  const vector3f *normal,
+  const float distance)
+{
+  for (uint32_t cell = 0; cell < 81; ++cell) {
+    // cell 0 is the key itself, the base 3 digits give an offset of 0, 1, -1.
+    static const int32_t offsets[3] = { 0, 1, -1 };
+    int32_t neighbour[4];
+    uint32_t found, cluster;
+
+    for (uint32_t i = 0, digits = cell; i < 4; ++i, digits /= 3)
+      neighbour[i] = key[i] + offsets[digits % 3];
+
+    found = find_plane_key(sorted, mesh->face_count, neighbour);
+    if (found == mesh->face_count)
+      continue;
+
+    cluster = mesh->clusters[sorted[found].index];
+    if (cluster == PLANE_CLUSTER_NONE)
+      continue;
+
+    if (
+      !cell ||
+      is_close_plane(
+        mesh, sorted[representatives[cluster]].index, normal, distance))
+      return cluster;
+  }
+
+  return PLANE_CLUSTER_NONE;
+}
+
+/**
+ * Quantizes every face plane (normal and distance) into an integer key, faces
+ * with the same key share a cluster. A face whose key differs is still merged
+ * into a neighbouring cluster when its plane is within the epsilons of that
+ * cluster's representative (first) face. The opposite facing cluster is found
+ * the same way from the negated plane. Requires the metadata.
+ */
+static
+void
+build_plane_clusters(
+  collision_mesh_t *mesh,
+  const allocator_t *allocator)
+{
+  bvh_t *bvh = mesh->bvh;
+  plane_key_t *sorted;
+  uint32_t *representatives;
+
+  mesh->clusters = NULL;
+  mesh->opposites = NULL;
+  mesh->cluster_count = 0;
+  if (!mesh->face_count)
+    return;
+
+  sorted = allocator->mem_alloc(sizeof(plane_key_t) * mesh->face_count);
+  for (uint32_t i = 0; i < mesh->face_count; ++i) {
+    vector3f *normal = cvector_as(&bvh->normals, i, vector3f);
+    sorted[i].key[0] = (int32_t)lroundf(normal->data[0] * NORMAL_KEY_SCALE);
+    sorted[i].key[1] = (int32_t)lroundf(normal->data[1] * NORMAL_KEY_SCALE);
+    sorted[i].key[2] = (int32_t)lroundf(normal->data[2] * NORMAL_KEY_SCALE);
+    sorted[i].key[3] =
+      (int32_t)lroundf(mesh->metadata[i].distance * DISTANCE_KEY_SCALE);
+    sorted[i].index = i;
+  }
+
+  qsort(sorted, mesh->face_count, sizeof(plane_key_t), compare_plane_keys);
+
+  // 'representatives' holds the sorted position of the first face of every
+  // cluster.
+  mesh->clusters = allocator->mem_alloc(sizeof(uint32_t) * mesh->face_count);
+  representatives =
+    allocator->mem_alloc(sizeof(uint32_t) * mesh->face_count);
+  for (uint32_t i = 0; i < mesh->face_count; ++i)
+    mesh->clusters[i] = PLANE_CLUSTER_NONE;
+
+  for (uint32_t i = 0; i < mesh->face_count; ++i) {
+    uint32_t face = sorted[i].index;
+    uint32_t cluster = find_close_cluster(
+      mesh, sorted, representatives, sorted[i].key,
+      cvector_as(&bvh->normals, face, vector3f),
+      mesh->metadata[face].distance);
+
+    if (cluster == PLANE_CLUSTER_NONE) {
+      cluster = mesh->cluster_count++;
+      representatives[cluster] = i;
+    }
+
+    mesh->clusters[face] = cluster;
+  }
+
+  mesh->opposites =
+    allocator->mem_alloc(sizeof(uint32_t) * mesh->cluster_count);
+  for (uint32_t i = 0; i < mesh->cluster_count; ++i) {
+    const plane_key_t *representative = sorted + representatives[i];
+    const int32_t *key = representative->key;
+    uint32_t face = representative->index;
+    vector3f negated_normal;
+    int32_t negated[4];
+
+    negated[0] = -key[0];
+    negated[1] = -key[1];
+    negated[2] = -key[2];
+    negated[3] = -key[3];
+    negated_normal = mult_v3f(cvector_as(&bvh->normals, face, vector3f), -1.f);
+    mesh->opposites[i] = find_close_cluster(
+      mesh, sorted, representatives, negated, &negated_normal,
+      -mesh->metadata[face].distance);
+  }
+
+  // the tolerance can match one way only (the negated plane of a lands in b
+  // but the one of b lands in a cluster next to a), the buckets expect mutual
+  // pairs. a one-way link is completed when its target has none, the links
+  // still one-way after that are dropped.
+  for (uint32_t i = 0; i < mesh->cluster_count; ++i) {
+    uint32_t opposite = mesh->opposites[i];
+    if (
+      opposite != PLANE_CLUSTER_NONE &&
+      mesh->opposites[opposite] == PLANE_CLUSTER_NONE)
+      mesh->opposites[opposite] = i;
+  }
+
+  for (uint32_t i = 0; i < mesh->cluster_count; ++i) {
+    uint32_t opposite = mesh->opposites[i];
+    if (opposite != PLANE_CLUSTER_NONE && mesh->opposites[opposite] != i)
+      mesh->opposites[i] = PLANE_CLUSTER_NONE;
+  }
+
+  allocator->mem_free(representatives);
+  allocator->mem_free(sorted);
+}
+
+collision_mesh_t *
+load_collision_mesh(
+  bvh_t *bvh,
+  const float extension,
+  const allocator_t *allocator)
+{
+  collision_mesh_t *mesh;
+  assert(bvh && allocator);
+
+  mesh = allocator->mem_alloc(sizeof(collision_mesh_t));
+  mesh->bvh = bvh;
+  mesh->extension = extension;
+  mesh->face_count = (uint32_t)bvh->faces.size;
+  mesh->revision = 0;
+  mesh->allocator = allocator;
+  face_packets_setup(&mesh->packets, bvh, allocator);
+  wide_bvh_setup(&mesh->wide, bvh, mesh->revision, allocator);
+  memset(&mesh->grid, 0, sizeof(face_grid_t));
+  memset(&mesh->ground, 0, sizeof(ground_grid_t));
+  mesh->broadphase = COLLISION_BROADPHASE_BVH;
+  build_face_metadata(mesh, allocator);
+  build_plane_clusters(mesh, allocator);
+  face_adjacency_setup(&mesh->adjacency, bvh, mesh->clusters, allocator);
+  return mesh;
+}
+
+void
+collision_mesh_update_face(
+  collision_mesh_t *mesh,
+  const uint32_t index)
+{
+  assert(mesh && index < mesh->face_count);
+
+  set_face_metadata(mesh, index);
+  face_packets_update(&mesh->packets, mesh->bvh, index);
+}
+
+void
+collision_mesh_split_clusters(
+  collision_mesh_t *mesh,
+  const uint32_t *faces,
+  const uint32_t count,
+  const allocator_t *allocator)
+{
+  uint32_t *remap;
+  uint32_t *opposites;
+  uint32_t cluster_count = mesh->cluster_count;
+
+  assert(mesh && allocator && (faces || !count));
+
+  if (!count)
+    return;
+
+  // 'remap' maps an old cluster to its new one, only the clusters of 'faces'
+  // are remapped, at most one new cluster per face.
+  remap = allocator->mem_alloc(sizeof(uint32_t) * mesh->cluster_count);
+  for (uint32_t i = 0; i < mesh->cluster_count; ++i)
+    remap[i] = PLANE_CLUSTER_NONE;
+
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t cluster = mesh->clusters[faces[i]];
+    if (remap[cluster] == PLANE_CLUSTER_NONE)
+      remap[cluster] = cluster_count++;
+  }
+
+  opposites = allocator->mem_alloc(sizeof(uint32_t) * cluster_count);
+  for (uint32_t i = 0; i < mesh->cluster_count; ++i) {
+    uint32_t opposite = mesh->opposites[i];
+    opposites[i] = opposite;
+
+    // a plane moving with its opposite stays opposite to it.
+    if (remap[i] != PLANE_CLUSTER_NONE)
+      opposites[remap[i]] = opposite == PLANE_CLUSTER_NONE ?
+        PLANE_CLUSTER_NONE : remap[opposite];
+  }
+
+  for (uint32_t i = 0; i < count; ++i)
+    mesh->clusters[faces[i]] = remap[mesh->clusters[faces[i]]];
+
+  allocator->mem_free(mesh->opposites);
+  allocator->mem_free(remap);
+  mesh->opposites = opposites;
+  mesh->cluster_count = cluster_count;
+  face_adjacency_update(&mesh->adjacency, mesh->clusters, faces, count);
+}
+
+void
+free_collision_mesh(
+  collision_mesh_t *mesh,
+  const allocator_t *allocator)
+{
+  assert(mesh && allocator);
+
+  face_packets_cleanup(&mesh->packets, allocator);
+  wide_bvh_cleanup(&mesh->wide, allocator);
+  face_grid_cleanup(&mesh->grid, allocator);
+  ground_grid_cleanup(&mesh->ground, allocator);
+  face_adjacency_cleanup(&mesh->adjacency, allocator);
+  if (mesh->metadata)
+    allocator->mem_free(mesh->metadata);
+  if (mesh->extended)
+    allocator->mem_free(mesh->extended);
+  if (mesh->clusters)
+    allocator->mem_free(mesh->clusters);
+  if (mesh->opposites)
+    allocator->mem_free(mesh->opposites);
+  allocator->mem_free(mesh);
+}
@@ -0,0 +1,323 @@
+/**
+ * @file collision_recorder.c
+ * @author khalilhenoud@gmail.com
+ * @brief serializes the collision queries to a file to replay them offline.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <assert.h>
+#include <string.h>
+#include <game/debug/flags.h>
+#include <game/logic/collision_recorder.h>
+
+#define COLLISION_RECORD_MAGIC      0x59525143    // 'CQRY'
+#define COLLISION_RECORD_VERSION    4
+
+
+// the file is a header followed by the records, every field is written as a
+// 32 bits value in the native byte order:
+//  header: magic, version, room[256], settings
+//  record: type, context, center[3], half_height, radius, displacement[3]
+//  time of impact and probe only: iterations, limit_distance, analytic,
+//  hit_count, hit_count * (time, flags, bvh_face_index)
+typedef
+struct {
+  FILE *file;
+  uint32_t settings;
+  const collision_context_t *contexts[COLLISION_RECORD_MAX_CONTEXTS];
+  uint32_t context_count;
+} collision_recorder_t;
+
+////////////////////////////////////////////////////////////////////////////////
+static collision_recorder_t recorder;
+
+static
+void
+write_u32(const uint32_t value)
+{
+  fwrite(&value, sizeof(uint32_t), 1, recorder.file);
+}
+
+static
+void
+write_f32(const float value)
+{
+  fwrite(&value, sizeof(float), 1, recorder.file);
+}
+
+#define SETTINGS_OFFSET \
+  (2 * sizeof(uint32_t) + COLLISION_RECORD_ROOM_LENGTH)
+
+// the contexts are identified by the order they are first seen in, the replay
+// only needs to tell them apart.
+static
+uint32_t
+get_context_id(const collision_context_t *context)
+{
+  for (uint32_t i = 0; i < recorder.context_count; ++i)
+    if (recorder.contexts[i] == context)
+      return i;
+
+  assert(recorder.context_count < COLLISION_RECORD_MAX_CONTEXTS);
+  if (recorder.context_count == COLLISION_RECORD_MAX_CONTEXTS)
+    return COLLISION_RECORD_MAX_CONTEXTS - 1;
+
+  recorder.contexts[recorder.context_count] = context;
+  return recorder.context_count++;
+}
+
+static
+uint32_t
+get_settings(const uint32_t level_settings)
+{
+  uint32_t settings = level_settings;
+  settings |= g_debug_flags.use_scalar_collision ? COLLISION_RECORD_SCALAR : 0;
+  settings |=
+    g_debug_flags.disable_candidate_cache ? COLLISION_RECORD_NO_CACHE : 0;
+  settings |=
+    g_debug_flags.use_legacy_buckets ? COLLISION_RECORD_LEGACY_BUCKETS : 0;
+  settings |= g_debug_flags.use_wide_bvh ? COLLISION_RECORD_WIDE_BVH : 0;
+  settings |=
+    g_debug_flags.disable_fused_queries ? COLLISION_RECORD_NO_FUSION : 0;
+  settings |= g_debug_flags.keep_internal_contacts ?
+    COLLISION_RECORD_INTERNAL_CONTACTS : 0;
+  settings |=
+    g_debug_flags.disable_ground_grid ? COLLISION_RECORD_NO_GROUND_GRID : 0;
+  settings |= g_debug_flags.use_merged_sweep_bounds ?
+    COLLISION_RECORD_MERGED_SWEEP_BOUNDS : 0;
+  return settings;
+}
+
+static
+void
+write_query(
+  const collision_record_type_t type,
+  const collision_context_t *context,
+  const capsule_t *capsule,
+  const vector3f *displacement)
+{
+  write_u32((uint32_t)type);
+  write_u32(get_context_id(context));
+  for (uint32_t i = 0; i < 3; ++i)
+    write_f32(capsule->center.data[i]);
+  write_f32(capsule->half_height);
+  write_f32(capsule->radius);
+  for (uint32_t i = 0; i < 3; ++i)
+    write_f32(displacement->data[i]);
+}
+
+uint32_t
+collision_recorder_open(
+  const char *path,
+  const char *room,
+  const uint32_t settings)
+{
+  char name[COLLISION_RECORD_ROOM_LENGTH] = { 0 };
+
+  assert(path && room);
+
+  collision_recorder_close();
+  recorder.file = fopen(path, "wb");
+  if (!recorder.file)
+    return 0;
+
+  strncpy(name, room, COLLISION_RECORD_ROOM_LENGTH - 1);
+  write_u32(COLLISION_RECORD_MAGIC);
+  write_u32(COLLISION_RECORD_VERSION);
+  fwrite(name, 1, COLLISION_RECORD_ROOM_LENGTH, recorder.file);
+  recorder.settings = get_settings(settings);
+  write_u32(recorder.settings);
+  return 1;
+}
+
+void
+collision_recorder_close(void)
+{
+  if (recorder.file)
+    fclose(recorder.file);
+  recorder.file = NULL;
+  recorder.context_count = 0;
+}
+
+uint32_t
+collision_recorder_is_open(void)
+{
+  return recorder.file != NULL;
+}
+
+void
+collision_recorder_add_settings(const uint32_t settings)
+{
+  long position;
+
+  if (!recorder.file || (recorder.settings | settings) == recorder.settings)
+    return;
+
+  recorder.settings |= settings;
+  position = ftell(recorder.file);
+  fseek(recorder.file, (long)SETTINGS_OFFSET, SEEK_SET);
+  write_u32(recorder.settings);
+  fseek(recorder.file, position, SEEK_SET);
+}
+
+void
+collision_recorder_prefetch(
+  const collision_context_t *context,
+  const capsule_t *capsule,
+  const vector3f *displacement)
+{
+  if (!recorder.file)
+    return;
+
+  write_query(COLLISION_RECORD_PREFETCH, context, capsule, displacement);
+}
+
+static
+void
+write_hits(
+  const collision_record_type_t type,
+  const collision_context_t *context,
+  const capsule_t *capsule,
+  const vector3f *displacement,
+  const uint32_t iterations,
+  const float limit_distance,
+  const intersection_info_t *hits,
+  const uint32_t hit_count)
+{
+  write_query(type, context, capsule, displacement);
+  write_u32(iterations);
+  write_f32(limit_distance);
+  write_u32(g_debug_flags.use_analytic_toi);
+  write_u32(hit_count);
+  for (uint32_t i = 0; i < hit_count; ++i) {
+    write_f32(hits[i].time);
+    write_u32((uint32_t)hits[i].flags);
+    write_u32(hits[i].bvh_face_index);
+  }
+}
+
+void
+collision_recorder_time_of_impact(
+  const collision_context_t *context,
+  const capsule_t *capsule,
+  const vector3f *displacement,
+  const uint32_t iterations,
+  const float limit_distance,
+  const intersection_info_t *hits,
+  const uint32_t hit_count)
+{
+  if (!recorder.file)
+    return;
+
+  write_hits(
+    COLLISION_RECORD_TIME_OF_IMPACT, context, capsule, displacement,
+    iterations, limit_distance, hits, hit_count);
+}
+
+void
+collision_recorder_probe(
+  const collision_context_t *context,
+  const capsule_t *capsule,
+  const vector3f *displacement,
+  const uint32_t iterations,
+  const float limit_distance,
+  const intersection_info_t *hits,
+  const uint32_t hit_count)
+{
+  if (!recorder.file)
+    return;
+
+  write_hits(
+    COLLISION_RECORD_PROBE, context, capsule, displacement,
+    iterations, limit_distance, hits, hit_count);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static
+uint32_t
+read_u32(FILE *file, uint32_t *value)
+{
+  return fread(value, sizeof(uint32_t), 1, file) == 1;
+}
+
+static
+uint32_t
+read_f32(FILE *file, float *value)
+{
+  return fread(value, sizeof(float), 1, file) == 1;
+}
+
+uint32_t
+collision_record_read_header(
+  FILE *file,
+  char room[COLLISION_RECORD_ROOM_LENGTH],
+  uint32_t *settings)
+{
+  uint32_t magic = 0, version = 0;
+
+  assert(file && room && settings);
+
+  if (
+    !read_u32(file, &magic) ||
+    !read_u32(file, &version) ||
+    magic != COLLISION_RECORD_MAGIC ||
+    version != COLLISION_RECORD_VERSION)
+    return 0;
+
+  if (fread(room, 1, COLLISION_RECORD_ROOM_LENGTH, file) !=
+    COLLISION_RECORD_ROOM_LENGTH)
+    return 0;
+
+  room[COLLISION_RECORD_ROOM_LENGTH - 1] = 0;
+  return read_u32(file, settings);
+}
+
+uint32_t
+collision_record_read(
+  FILE *file,
+  collision_record_t *record)
+{
+  uint32_t type, read = 1;
+
+  assert(file && record);
+
+  if (!read_u32(file, &type) || type >= COLLISION_RECORD_COUNT)
+    return 0;
+
+  record->type = (collision_record_type_t)type;
+  read &= read_u32(file, &record->context);
+  for (uint32_t i = 0; i < 3; ++i)
+    read &= read_f32(file, record->capsule.center.data + i);
+  read &= read_f32(file, &record->capsule.half_height);
+  read &= read_f32(file, &record->capsule.radius);
+  for (uint32_t i = 0; i < 3; ++i)
+    read &= read_f32(file, record->displacement.data + i);
+
+  record->iterations = 0;
+  record->limit_distance = 0.f;
+  record->analytic = 0;
+  record->hit_count = 0;
+
+  if (record->type == COLLISION_RECORD_PREFETCH)
+    return read;
+
+  read &= read_u32(file, &record->iterations);
+  read &= read_f32(file, &record->limit_distance);
+  read &= read_u32(file, &record->analytic);
+  read &= read_u32(file, &record->hit_count);
+  if (!read || record->hit_count > 256)
+    return 0;
+
+  for (uint32_t i = 0; i < record->hit_count; ++i) {
+    uint32_t flags;
+    read &= read_f32(file, &record->hits[i].time);
+    read &= read_u32(file, &flags);
+    read &= read_u32(file, &record->hits[i].bvh_face_index);
+    record->hits[i].flags = (collision_flags_t)flags;
+  }
+
+  return read;
+}
@@ -9,46 +9,50 @@
  *
  */
 #include <assert.h>
+#include <math.h>
 #include <game/debug/face.h>
 #include <game/debug/flags.h>
+#include <game/logic/bvh_query.h>
+#include <game/logic/capsule_sweep.h>
+#include <game/logic/collision_context.h>
+#include <game/logic/collision_mesh.h>
+#include <game/logic/collision_recorder.h>
 #include <game/logic/collision_utils.h>
+#include <game/logic/collision_variant.h>
+#include <game/logic/face_adjacency.h>
+#include <game/logic/ground_grid.h>
+#include <game/logic/sweep_validation.h>
 #include <collision/face.h>
 #include <math/capsule.h>
 #include <spatial/bvh/bvh.h>
 
-#define FLOOR_ANGLE_DEGREES 60
+#define BOUNDS_MULTIPLIER   1.025f
 
 
+#if !defined(COLLISION_RELEASE)
 uint32_t
-is_floor(bvh_t *bvh, uint32_t index)
+is_floor(const collision_mesh_t *mesh, uint32_t index)
 {
-  float cosine_target = cosf(TO_RADIANS(FLOOR_ANGLE_DEGREES));
-  float normal_dot = (cvector_as(&bvh->normals, index, vector3f))->data[1];
-  return normal_dot > cosine_target;
+  return mesh->metadata[index].flag == COLLIDED_FLOOR_FLAG;
 }
 
 uint32_t
-is_ceiling(bvh_t *bvh, uint32_t index)
+is_ceiling(const collision_mesh_t *mesh, uint32_t index)
 {
-  float cosine_target = cosf(TO_RADIANS(FLOOR_ANGLE_DEGREES));
-  float normal_dot = (cvector_as(&bvh->normals, index, vector3f))->data[1];
-  return normal_dot < -cosine_target;
+  return mesh->metadata[index].flag == COLLIDED_CEILING_FLAG;
 }
 
 debug_color_t
-get_debug_color(bvh_t *bvh, uint32_t index)
+get_debug_color(const collision_mesh_t *mesh, uint32_t index)
 {
-  return is_floor(bvh, index) ? green : (is_ceiling(bvh, index) ? white : blue);
+  const debug_color_t *palette[FACE_COLOR_COUNT] = { &green, &white, &blue };
+  return *palette[mesh->metadata[index].color];
 }
 
 collision_flags_t
-get_collision_flag(bvh_t *bvh, uint32_t index)
+get_collision_flag(const collision_mesh_t *mesh, uint32_t index)
 {
-  collision_flags_t flag = COLLIDED_NONE;
-  flag = is_floor(bvh, index) ? COLLIDED_FLOOR_FLAG : flag;
-  flag = is_ceiling(bvh, index) ? COLLIDED_CEILING_FLAG : flag;
-  flag = (flag == COLLIDED_NONE) ? COLLIDED_WALLS_FLAG : flag;
-  return flag;
+  return (collision_flags_t)mesh->metadata[index].flag;
 }
 
 void
@@ -88,89 +92,112 @@ populate_moving_capsule_aabb(
   merge_aabb(aabb, start_end + 0, start_end + 1);
 }
 
+#endif
+
+static
+int32_t
+is_penetrating(
+  capsule_t *capsule,
+  face_t *face,
+  vector3f *normal)
+{
+  vector3f penetration;
+  point3f sphere_center;
+  capsule_face_classification_t classification =
+    classify_capsule_face(
+      capsule, face, normal, 0, &penetration, &sphere_center);
+
+  return
+    classification != CAPSULE_FACE_NO_COLLISION &&
+    !IS_ZERO_LP(length_squared_v3f(&penetration));
+}
+
+#if !defined(COLLISION_RELEASE)
+typedef
+struct {
+  bvh_t *bvh;
+  capsule_t *capsule;
+} capsule_query_t;
+
+static
+int32_t
+stop_on_penetration(uint32_t face_index, void *user_data)
+{
+  capsule_query_t *query = (capsule_query_t *)user_data;
+  return !is_penetrating(
+    query->capsule,
+    cvector_as(&query->bvh->faces, face_index, face_t),
+    cvector_as(&query->bvh->normals, face_index, vector3f));
+}
+
 int32_t
 is_in_valid_space(
-  bvh_t *bvh,
+  collision_context_t *context,
   capsule_t *capsule)
 {
+  bvh_aabb_t bounds;
+  capsule_query_t query;
+  query.bvh = context->mesh->bvh;
+  query.capsule = capsule;
+
+  populate_capsule_aabb(&bounds, capsule, BOUNDS_MULTIPLIER);
+  return collision_context_query_faces(
+    context, &bounds, NULL, capsule, stop_on_penetration, &query);
+}
+
+static
+int32_t
+push_out_of_face(uint32_t face_index, void *user_data)
+{
+  capsule_query_t *query = (capsule_query_t *)user_data;
   vector3f penetration;
   point3f sphere_center;
-  uint32_t query[256];
-  uint32_t used = 0;
-  bvh_aabb_t bounds;
-  capsule_face_classification_t classification;
-  float length_sqrd;
-
-  populate_capsule_aabb(&bounds, capsule, 1.025f);
-  query_intersection_fixed_256(bvh, &bounds, query, &used);
-
-  for (uint32_t used_index = 0; used_index < used; ++used_index) {
-    bvh_node_t *node = cvector_as(&bvh->nodes, query[used_index], bvh_node_t);
-    for (
-      uint32_t i = node->left_first, last = node->left_first + node->tri_count;
-      i < last; ++i) {
-      if (!bounds_intersect(&bounds, cvector_as(&bvh->bounds, i, bvh_aabb_t)))
-        continue;
-
-      classification =
-        classify_capsule_face(
-          capsule,
-          cvector_as(&bvh->faces, i, face_t),
-          cvector_as(&bvh->normals, i, vector3f),
-          0,
-          &penetration,
-          &sphere_center);
-
-      length_sqrd = length_squared_v3f(&penetration);
-
-      if (
-        classification != CAPSULE_FACE_NO_COLLISION &&
-        !IS_ZERO_LP(length_sqrd))
-        return 0;
-    }
-  }
+  capsule_face_classification_t classification =
+    classify_capsule_face(
+      query->capsule,
+      cvector_as(&query->bvh->faces, face_index, face_t),
+      cvector_as(&query->bvh->normals, face_index, vector3f),
+      0,
+      &penetration,
+      &sphere_center);
+
+  if (classification != CAPSULE_FACE_NO_COLLISION)
+    add_set_v3f(&query->capsule->center, &penetration);
 
   return 1;
 }
 
+// NOTE: the capsule moves as it is pushed out, no plane culling is done since
+// it is evaluated ahead of the faces it culls.
 void
 ensure_in_valid_space(
-  bvh_t *bvh,
+  collision_context_t *context,
   capsule_t *capsule)
 {
-  vector3f penetration;
-  point3f sphere_center;
-  uint32_t query[256];
-  uint32_t used = 0;
   bvh_aabb_t bounds;
-  capsule_face_classification_t classification;
-  float length_sqrd;
-
-  populate_capsule_aabb(&bounds, capsule, 1.025f);
-  query_intersection_fixed_256(bvh, &bounds, query, &used);
-
-  for (uint32_t used_index = 0; used_index < used; ++used_index) {
-    bvh_node_t *node = cvector_as(&bvh->nodes, query[used_index], bvh_node_t);
-    for (
-      uint32_t i = node->left_first, last = node->left_first + node->tri_count;
-      i < last; ++i) {
-
-      if (!bounds_intersect(&bounds, cvector_as(&bvh->bounds, i, bvh_aabb_t)))
-        continue;
-
-      classification =
-        classify_capsule_face(
-          capsule,
-          cvector_as(&bvh->faces, i, face_t),
-          cvector_as(&bvh->normals, i, vector3f),
-          0,
-          &penetration,
-          &sphere_center);
-
-      if (classification != CAPSULE_FACE_NO_COLLISION)
-        add_set_v3f(&capsule->center, &penetration);
-    }
-  }
+  capsule_query_t query;
+  query.bvh = context->mesh->bvh;
+  query.capsule = capsule;
+
+  populate_capsule_aabb(&bounds, capsule, BOUNDS_MULTIPLIER);
+  collision_context_query_faces(
+    context, &bounds, NULL, NULL, push_out_of_face, &query);
+}
+#endif
+
+// NULL when toggled off, the queries are then culled by the merged bounds only.
+static
+const bvh_sweep_t *
+setup_sweep(
+  bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  const vector3f *displacement)
+{
+  if (COLLISION_DEBUG_FLAG(use_merged_sweep_bounds))
+    return NULL;
+
+  bvh_sweep_setup(sweep, capsule, displacement, BOUNDS_MULTIPLIER);
+  return sweep;
 }
 
 inline
@@ -191,20 +218,167 @@ intersects_post_displacement(
   return classification != CAPSULE_FACE_NO_COLLISION;
 }
 
+float
+COLLISION_VARIANT(get_face_time_of_impact)(
+  capsule_t capsule,
+  face_t *face,
+  vector3f *normal,
+  vector3f displacement,
+  const uint32_t iterations,
+  const float limit_distance)
+{
+  if (COLLISION_DEBUG_FLAG(validate_toi))
+    sweep_validation_record(
+      &capsule, face, normal, &displacement, iterations, limit_distance);
+
+  if (COLLISION_DEBUG_FLAG(use_analytic_toi))
+    return sweep_capsule_face_time(
+      &capsule, face, normal, &displacement, limit_distance);
+
+  return find_capsule_face_intersection_time(
+    capsule,
+    face,
+    normal,
+    displacement,
+    iterations,
+    limit_distance);
+}
+
+static
+void
+accumulate_time_of_impact(
+  collision_mesh_t *mesh,
+  capsule_t *capsule,
+  vector3f displacement,
+  intersection_info_t collision_info[256],
+  uint32_t *hits,
+  const uint32_t i,
+  const uint32_t iterations,
+  const float limit_distance)
+{
+  float time;
+  intersection_info_t *first = collision_info;
+  bvh_t *bvh = mesh->bvh;
+  face_t *face = cvector_as(&bvh->faces, i, face_t);
+  vector3f *normal = cvector_as(&bvh->normals, i, vector3f);
+
+  // NOTE: we do not ignore faces that we are to the back of, the bucket
+  // processing handles that.
+  time = COLLISION_VARIANT(get_face_time_of_impact)(
+    *capsule,
+    face,
+    normal,
+    displacement,
+    iterations,
+    limit_distance);
+
+  if (time < first->time || IS_SAME_MP(time, first->time)) {
+    *hits = time < first->time ? 0 : *hits;
+    collision_info[*hits].time = time;
+    collision_info[*hits].flags = get_collision_flag(mesh, i);
+    collision_info[*hits].bvh_face_index = i;
+    (*hits)++;
+    assert(*hits < 256);
+  }
+}
+
+// NOTE: coplanar faces hit at the same time report the same contact through
+// the edges and vertices they share. The hits touching an internal feature are
+// dropped when another hit of their plane cluster is kept, the hits on the
+// face interior or on an open feature are kept, the lowest face index is kept
+// if none is. The contact is approximated by the point of the capsule segment
+// nearest to the face plane.
+static
 uint32_t
-get_time_of_impact(
-  bvh_t *bvh,
+drop_internal_contacts(
+  collision_mesh_t *mesh,
+  const capsule_t *capsule,
+  const vector3f *displacement,
+  intersection_info_t collision_info[256],
+  const uint32_t info_used)
+{
+  bvh_t *bvh = mesh->bvh;
+  uint8_t internal[256];
+  uint32_t used = 0;
+
+  if (
+    info_used < 2 ||
+    !mesh->adjacency.internal ||
+    COLLISION_DEBUG_FLAG(keep_internal_contacts))
+    return info_used;
+
+  for (uint32_t i = 0; i < info_used; ++i) {
+    uint32_t face_index = collision_info[i].bvh_face_index;
+    uint32_t cluster = mesh->clusters[face_index];
+    uint32_t shared = 0;
+
+    internal[i] = 0;
+    for (uint32_t j = 0; j < info_used && !shared; ++j)
+      shared =
+        j != i && mesh->clusters[collision_info[j].bvh_face_index] == cluster;
+
+    if (!shared || !mesh->adjacency.internal[face_index])
+      continue;
+
+    {
+      vector3f *normal = cvector_as(&bvh->normals, face_index, vector3f);
+      float distance = mesh->metadata[face_index].distance;
+      vector3f moved = mult_v3f(displacement, collision_info[i].time);
+      point3f point = add_v3f(&capsule->center, &moved);
+      float center = dot_product_v3f(normal, &point) - distance;
+      float reach = normal->data[1] * capsule->half_height;
+      uint32_t feature;
+
+      // the segment endpoint nearest to the plane, the center for the walls.
+      if (!IS_ZERO_LP(reach))
+        point.data[1] += fabsf(center - reach) < fabsf(center + reach) ?
+          -capsule->half_height : capsule->half_height;
+
+      feature = face_contact_feature(
+        cvector_as(&bvh->faces, face_index, face_t), &point);
+      internal[i] =
+        feature != FACE_FEATURE_INTERIOR &&
+        (mesh->adjacency.internal[face_index] >> (feature - 1)) & 1;
+    }
+  }
+
+  for (uint32_t i = 0; i < info_used; ++i) {
+    uint32_t face_index = collision_info[i].bvh_face_index;
+    uint32_t cluster = mesh->clusters[face_index];
+    uint32_t dropped = 0;
+
+    for (uint32_t j = 0; j < info_used && internal[i] && !dropped; ++j) {
+      uint32_t other = collision_info[j].bvh_face_index;
+      dropped =
+        j != i &&
+        mesh->clusters[other] == cluster &&
+        (!internal[j] || other < face_index);
+    }
+
+    if (!dropped)
+      collision_info[used++] = collision_info[i];
+  }
+
+  return used;
+}
+
+uint32_t
+COLLISION_VARIANT(get_time_of_impact)(
+  collision_context_t *context,
   capsule_t *capsule,
   vector3f displacement,
   intersection_info_t collision_info[256],
   const uint32_t iterations,
   const float limit_distance)
 {
-  uint32_t query[256];
-  uint32_t query_hits = 0;
+  collision_mesh_t *mesh = context->mesh;
+  bvh_t *bvh = mesh->bvh;
+  face_list_t *candidates = &context->candidates;
   uint32_t hits = 0;
+  uint32_t rejects = 0;
   bvh_aabb_t bounds;
-  vector3f unit = normalize_v3f(&displacement);
+  bvh_sweep_t sweep;
+  capsule_t moved = *capsule;
   intersection_info_t *first = collision_info;
 
   // initialize the first element, this represents the minimum toi if any.
@@ -212,69 +386,422 @@ get_time_of_impact(
   first->flags = COLLIDED_NONE;
   first->bvh_face_index = (uint32_t)-1;
 
-  populate_moving_capsule_aabb(&bounds, capsule, &displacement, 1.025f);
-  query_intersection_fixed_256(bvh, &bounds, query, &query_hits);
-
-  if (query_hits && g_debug_flags.draw_collision_query) {
-    uint32_t index = 0;
-
-    for (; index < query_hits; ++index) {
-      bvh_node_t *node = cvector_as(&bvh->nodes, query[index], bvh_node_t);
-      uint32_t i = node->left_first;
-      uint32_t last = node->left_first + node->tri_count;
-      for (; i < last; ++i) {
-        debug_color_t color = get_debug_color(bvh, i);
-        int32_t width = is_floor(bvh, i) ? 3 : 2;
-        add_debug_face_to_frame(
-          cvector_as(&bvh->faces, i, face_t),
-          cvector_as(&bvh->normals, i, vector3f),
-          color, width);
+  // faces out of reach of the displaced capsule are culled by the traversal.
+  add_set_v3f(&moved.center, &displacement);
+  populate_moving_capsule_aabb(
+    &bounds, capsule, &displacement, BOUNDS_MULTIPLIER);
+  candidates->count = 0;
+  COLLISION_VARIANT(collision_context_gather_faces)(
+    context, &bounds,
+    setup_sweep(&sweep, capsule, &displacement), &moved, candidates);
+
+  if (COLLISION_DEBUG_FLAG(draw_collision_query)) {
+    for (uint32_t index = 0; index < candidates->count; ++index) {
+      uint32_t i = candidates->indices[index];
+      debug_color_t color = get_debug_color(mesh, i);
+      int32_t width = is_floor(mesh, i) ? 3 : 2;
+      add_debug_face_to_frame(
+        cvector_as(&bvh->faces, i, face_t),
+        cvector_as(&bvh->normals, i, vector3f),
+        color, width);
+    }
+  }
+
+  for (uint32_t index = 0; index < candidates->count; ++index) {
+    uint32_t i = candidates->indices[index];
+
+    // ignore any face that does not intersect post displacement, that is a
+    // problem for continuous collision detection (tunneling).
+    if (!intersects_post_displacement(
+      *capsule,
+      displacement,
+      cvector_as(&bvh->faces, i, face_t),
+      cvector_as(&bvh->normals, i, vector3f))) {
+      ++rejects;
+      continue;
+    }
+
+    accumulate_time_of_impact(
+      mesh, capsule, displacement, collision_info, &hits, i,
+      iterations, limit_distance);
+  }
+
+  hits = drop_internal_contacts(
+    mesh, capsule, &displacement, collision_info, hits);
+
+  // the iterative solver does not report its iteration count, the budget is
+  // counted instead.
+  if (COLLISION_DEBUG_FLAG(count_collision_work)) {
+    collision_counters_t *counters = &context->counters;
+    uint32_t solves = candidates->count - rejects;
+    counters->faces_tested += candidates->count;
+    counters->post_displacement_rejects += rejects;
+    counters->toi_solves += solves;
+    counters->toi_iterations +=
+      solves * (COLLISION_DEBUG_FLAG(use_analytic_toi) ? 1 : iterations);
+  }
+
+  if (COLLISION_DEBUG_ENABLED)
+    collision_recorder_time_of_impact(
+      context, capsule, &displacement, iterations, limit_distance,
+      collision_info, hits);
+  return hits;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+typedef
+struct {
+  collision_mesh_t *mesh;
+  fused_query_t *queries;
+  uint32_t count;
+  bvh_aabb_t bounds[FUSED_QUERY_MAX];
+  bvh_sweep_t sweeps[FUSED_QUERY_MAX];
+  const bvh_sweep_t *swept[FUSED_QUERY_MAX];
+  capsule_t culled[FUSED_QUERY_MAX];
+  uint32_t pending;
+  uint32_t iterations;
+  float limit_distance;
+  uint32_t tested;
+  uint32_t rejects;
+} fused_state_t;
+
+// the sweep work of a single face, shared by the traversal and the ground grid.
+static
+void
+run_sweep_face(
+  fused_state_t *state,
+  fused_query_t *query,
+  const uint32_t face_index)
+{
+  collision_mesh_t *mesh = state->mesh;
+  bvh_t *bvh = mesh->bvh;
+  face_t *face = cvector_as(&bvh->faces, face_index, face_t);
+  vector3f *normal = cvector_as(&bvh->normals, face_index, vector3f);
+
+  if (COLLISION_DEBUG_FLAG(draw_collision_query))
+    add_debug_face_to_frame(
+      face, normal,
+      get_debug_color(mesh, face_index),
+      is_floor(mesh, face_index) ? 3 : 2);
+
+  state->tested++;
+  if (!intersects_post_displacement(
+    *query->capsule, query->displacement, face, normal)) {
+    state->rejects++;
+    return;
+  }
+
+  accumulate_time_of_impact(
+    mesh, query->capsule, query->displacement,
+    query->hits, &query->hit_count, face_index,
+    state->iterations, state->limit_distance);
+}
+
+// mirrors the per face work of the individual queries, 'culled' is the capsule
+// they cull the face planes with.
+static
+int32_t
+run_fused_face(uint32_t face_index, void *user_data)
+{
+  fused_state_t *state = (fused_state_t *)user_data;
+  collision_mesh_t *mesh = state->mesh;
+  bvh_t *bvh = mesh->bvh;
+
+  for (uint32_t i = 0; i < state->count; ++i) {
+    fused_query_t *query = state->queries + i;
+
+    if (!(state->pending & (1u << i)))
+      continue;
+
+    // same as the ground grid, the probes only see the floors.
+    if (query->type == FUSED_QUERY_PROBE && !is_floor(mesh, face_index))
+      continue;
+
+    if (!COLLISION_VARIANT(bvh_query_accepts_face)(
+      mesh, face_index,
+      state->bounds + i, state->swept[i], state->culled + i))
+      continue;
+
+    if (query->type == FUSED_QUERY_OVERLAP) {
+      if (is_penetrating(
+        query->capsule,
+        cvector_as(&bvh->faces, face_index, face_t),
+        cvector_as(&bvh->normals, face_index, vector3f))) {
+        query->valid = 0;
+        state->pending &= ~(1u << i);
       }
+      continue;
     }
+
+    run_sweep_face(state, query, face_index);
   }
 
-  if (query_hits) {
-    float time;
-    uint32_t index = 0;
-
-    for (; index < query_hits; ++index) {
-      bvh_node_t *node = cvector_as(&bvh->nodes, query[index], bvh_node_t);
-      uint32_t i = node->left_first;
-      uint32_t last = node->left_first + node->tri_count;
-
-      for (; i < last; ++i) {
-        face_t *face = cvector_as(&bvh->faces, i, face_t);
-        vector3f *normal = cvector_as(&bvh->normals, i, vector3f);
-
-        if (!bounds_intersect(&bounds, cvector_as(&bvh->bounds, i, bvh_aabb_t)))
-          continue;
-
-        // ignore any face that does not intersect post displacement, that is a
-        // problem for continuous collision detection (tunneling).
-        if (!intersects_post_displacement(*capsule, displacement, face, normal))
-          continue;
-
-        // NOTE: we do not ignore faces that we are to the back of, the bucket
-        // processing handles that.
-        time = find_capsule_face_intersection_time(
-          *capsule,
-          face,
-          normal,
-          displacement,
-          iterations,
-          limit_distance);
-
-        if (time < first->time || IS_SAME_MP(time, first->time)) {
-          hits = time < first->time ? 0 : hits;
-          collision_info[hits].time = time;
-          collision_info[hits].flags = get_collision_flag(bvh, i);
-          collision_info[hits].bvh_face_index = i;
-          hits++;
-          assert(hits < 256);
+  // the traversal is over once every query has its answer.
+  return state->pending != 0;
+}
+
+// answers the probe from the floor faces of the ground grid, returns 0 if the
+// grid is stale or cannot hold the query, the probe goes through the traversal.
+static
+uint32_t
+run_ground_probe(
+  collision_context_t *context,
+  fused_state_t *state,
+  const uint32_t i)
+{
+  collision_mesh_t *mesh = state->mesh;
+  fused_query_t *query = state->queries + i;
+  uint32_t faces[GROUND_GRID_QUERY_CAPACITY];
+  uint32_t count;
+
+  if (
+    COLLISION_DEBUG_FLAG(disable_ground_grid) ||
+    !mesh->ground.starts ||
+    mesh->ground.revision != mesh->revision)
+    return 0;
+
+  count = ground_grid_gather(
+    &mesh->ground, mesh, state->bounds + i,
+    faces, GROUND_GRID_QUERY_CAPACITY);
+  if (count == GROUND_GRID_OVERFLOW)
+    return 0;
+
+  if (COLLISION_DEBUG_FLAG(count_collision_work))
+    context->counters.queries++;
+
+  for (uint32_t k = 0; k < count; ++k)
+    if (COLLISION_VARIANT(bvh_query_accepts_face)(
+      mesh, faces[k], state->bounds + i, state->swept[i], state->culled + i))
+      run_sweep_face(state, query, faces[k]);
+
+  return 1;
+}
+
+// answers 'queries' in a single traversal, the probes answered by the ground
+// grid are left out of it.
+static
+void
+run_fused_traversal(
+  collision_context_t *context,
+  fused_query_t *queries,
+  const uint32_t count,
+  const uint32_t iterations,
+  const float limit_distance)
+{
+  fused_state_t state;
+  bvh_aabb_t bounds;
+  uint32_t merged = 0;
+
+  state.mesh = context->mesh;
+  state.queries = queries;
+  state.count = count;
+  state.pending = (1u << count) - 1;
+  state.iterations = iterations;
+  state.limit_distance = limit_distance;
+  state.tested = state.rejects = 0;
+
+  for (uint32_t i = 0; i < count; ++i) {
+    fused_query_t *query = queries + i;
+    state.culled[i] = *query->capsule;
+
+    state.swept[i] = NULL;
+
+    if (query->type == FUSED_QUERY_OVERLAP) {
+      query->valid = 1;
+      populate_capsule_aabb(
+        state.bounds + i, query->capsule, BOUNDS_MULTIPLIER);
+    } else {
+      query->hit_count = 0;
+      query->hits[0].time = 1.f;
+      query->hits[0].flags = COLLIDED_NONE;
+      query->hits[0].bvh_face_index = (uint32_t)-1;
+      add_set_v3f(&state.culled[i].center, &query->displacement);
+      populate_moving_capsule_aabb(
+        state.bounds + i, query->capsule, &query->displacement,
+        BOUNDS_MULTIPLIER);
+      state.swept[i] = setup_sweep(
+        state.sweeps + i, query->capsule, &query->displacement);
+    }
+
+    // the probes only look for floors, the ground grid holds them all.
+    if (
+      query->type == FUSED_QUERY_PROBE &&
+      run_ground_probe(context, &state, i)) {
+      state.pending &= ~(1u << i);
+      continue;
+    }
+
+    if (merged++)
+      merge_aabb(&bounds, &bounds, state.bounds + i);
+    else
+      bounds = state.bounds[i];
+  }
+
+  // no plane culling, the planes are culled per query in the callback.
+  if (state.pending)
+    COLLISION_VARIANT(collision_context_query_faces)(
+      context, &bounds, NULL, NULL, run_fused_face, &state);
+
+  if (COLLISION_DEBUG_FLAG(count_collision_work)) {
+    uint32_t solves = state.tested - state.rejects;
+    context->counters.faces_tested += state.tested;
+    context->counters.post_displacement_rejects += state.rejects;
+    context->counters.toi_solves += solves;
+    context->counters.toi_iterations +=
+      solves * (COLLISION_DEBUG_FLAG(use_analytic_toi) ? 1 : iterations);
+  }
+}
+
+// the probes are traversed on their own, the time of impact would let walls
+// and ceilings hide the floors.
+static
+void
+run_separate_queries(
+  collision_context_t *context,
+  fused_query_t *queries,
+  const uint32_t count,
+  const uint32_t iterations,
+  const float limit_distance)
+{
+  for (uint32_t i = 0; i < count; ++i) {
+    fused_query_t *query = queries + i;
+    if (query->type == FUSED_QUERY_OVERLAP)
+      query->valid = is_in_valid_space(context, query->capsule);
+    else if (query->type == FUSED_QUERY_PROBE)
+      run_fused_traversal(context, query, 1, iterations, limit_distance);
+    else
+      query->hit_count = COLLISION_VARIANT(get_time_of_impact)(
+        context, query->capsule, query->displacement, query->hits,
+        iterations, limit_distance);
+  }
+}
+
+void
+COLLISION_VARIANT(get_fused_queries)(
+  collision_context_t *context,
+  fused_query_t *queries,
+  const uint32_t count,
+  const uint32_t iterations,
+  const float limit_distance)
+{
+  assert(context && queries && count && count <= FUSED_QUERY_MAX);
+
+  if (COLLISION_DEBUG_FLAG(disable_fused_queries))
+    run_separate_queries(context, queries, count, iterations, limit_distance);
+  else
+    run_fused_traversal(context, queries, count, iterations, limit_distance);
+
+  for (uint32_t i = 0; i < count; ++i) {
+    fused_query_t *query = queries + i;
+
+    if (query->type == FUSED_QUERY_OVERLAP)
+      continue;
+
+    query->hit_count = drop_internal_contacts(
+      context->mesh, query->capsule, &query->displacement,
+      query->hits, query->hit_count);
+
+    query->floor_index = -1;
+    if (query->type == FUSED_QUERY_PROBE) {
+      for (uint32_t j = 0; j < query->hit_count; ++j) {
+        if (query->hits[j].flags == COLLIDED_FLOOR_FLAG) {
+          query->floor_index = (int32_t)j;
+          break;
         }
       }
     }
+
+    // the separate sweeps were recorded by the time of impact.
+    if (!COLLISION_DEBUG_ENABLED)
+      continue;
+
+    if (query->type == FUSED_QUERY_PROBE)
+      collision_recorder_probe(
+        context, query->capsule, &query->displacement,
+        iterations, limit_distance, query->hits, query->hit_count);
+    else if (!COLLISION_DEBUG_FLAG(disable_fused_queries))
+      collision_recorder_time_of_impact(
+        context, query->capsule, &query->displacement,
+        iterations, limit_distance, query->hits, query->hit_count);
   }
+}
 
-  return hits;
-}
\ No newline at end of file
+#if !defined(COLLISION_RELEASE)
+float
+get_face_time_of_impact_release(
+  capsule_t capsule,
+  face_t *face,
+  vector3f *normal,
+  vector3f displacement,
+  const uint32_t iterations,
+  const float limit_distance);
+
+uint32_t
+get_time_of_impact_release(
+  collision_context_t *context,
+  capsule_t *capsule,
+  vector3f displacement,
+  intersection_info_t collision_info[256],
+  const uint32_t iterations,
+  const float limit_distance);
+
+void
+get_fused_queries_release(
+  collision_context_t *context,
+  fused_query_t *queries,
+  const uint32_t count,
+  const uint32_t iterations,
+  const float limit_distance);
+
+float
+get_face_time_of_impact(
+  capsule_t capsule,
+  face_t *face,
+  vector3f *normal,
+  vector3f displacement,
+  const uint32_t iterations,
+  const float limit_distance)
+{
+  if (g_collision_variant == COLLISION_VARIANT_RELEASE)
+    return get_face_time_of_impact_release(
+      capsule, face, normal, displacement, iterations, limit_distance);
+
+  return get_face_time_of_impact_debug(
+    capsule, face, normal, displacement, iterations, limit_distance);
+}
+
+uint32_t
+get_time_of_impact(
+  collision_context_t *context,
+  capsule_t *capsule,
+  vector3f displacement,
+  intersection_info_t collision_info[256],
+  const uint32_t iterations,
+  const float limit_distance)
+{
+  if (g_collision_variant == COLLISION_VARIANT_RELEASE)
+    return get_time_of_impact_release(
+      context, capsule, displacement, collision_info,
+      iterations, limit_distance);
+
+  return get_time_of_impact_debug(
+    context, capsule, displacement, collision_info,
+    iterations, limit_distance);
+}
+
+void
+get_fused_queries(
+  collision_context_t *context,
+  fused_query_t *queries,
+  const uint32_t count,
+  const uint32_t iterations,
+  const float limit_distance)
+{
+  if (g_collision_variant == COLLISION_VARIANT_RELEASE)
+    get_fused_queries_release(
+      context, queries, count, iterations, limit_distance);
+  else
+    get_fused_queries_debug(
+      context, queries, count, iterations, limit_distance);
+}
+#endif
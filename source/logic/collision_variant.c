@@ -0,0 +1,43 @@
+/**
+ * @file collision_variant.c
+ * @author khalilhenoud@gmail.com
+ * @brief debug and release variants of the collision hot path.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <game/debug/flags.h>
+#include <game/logic/collision_variant.h>
+
+
+collision_variant_t g_collision_variant = COLLISION_VARIANT_DEBUG;
+
+void
+collision_variant_select(void)
+{
+  uint32_t debug =
+    g_debug_flags.draw_ignored_faces ||
+    g_debug_flags.use_locked_motion ||
+    g_debug_flags.draw_collision_query ||
+    g_debug_flags.draw_collided_face ||
+    g_debug_flags.draw_status ||
+    g_debug_flags.draw_step_up ||
+    g_debug_flags.use_scalar_collision ||
+    g_debug_flags.disable_candidate_cache ||
+    g_debug_flags.use_wide_bvh ||
+    g_debug_flags.use_analytic_toi ||
+    g_debug_flags.validate_toi ||
+    g_debug_flags.use_legacy_buckets ||
+    g_debug_flags.diff_buckets ||
+    g_debug_flags.record_collision ||
+    g_debug_flags.count_collision_work ||
+    g_debug_flags.disable_fused_queries ||
+    g_debug_flags.keep_internal_contacts ||
+    g_debug_flags.disable_ground_grid ||
+    g_debug_flags.use_merged_sweep_bounds;
+
+  g_collision_variant =
+    debug ? COLLISION_VARIANT_DEBUG : COLLISION_VARIANT_RELEASE;
+}
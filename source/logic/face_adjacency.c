@@ -0,0 +1,267 @@
+/**
+ * @file face_adjacency.c
+ * @author khalilhenoud@gmail.com
+ * @brief edge adjacency of the bvh faces and their internal features.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <game/logic/face_adjacency.h>
+#include <library/allocator/allocator.h>
+#include <math/face.h>
+#include <spatial/bvh/bvh.h>
+
+#define POINT_KEY_SCALE     16.f
+
+
+// NOTE: the points are ordered so both faces sharing an edge produce the same
+// key whatever their winding.
+typedef
+struct {
+  int32_t key[6];
+  uint32_t face;
+  uint32_t edge;
+} edge_key_t;
+
+static
+int32_t
+compare_points(const int32_t a[3], const int32_t b[3])
+{
+  for (uint32_t i = 0; i < 3; ++i) {
+    if (a[i] != b[i])
+      return a[i] < b[i] ? -1 : 1;
+  }
+
+  return 0;
+}
+
+static
+int
+compare_edge_keys(const void *lhs, const void *rhs)
+{
+  const edge_key_t *a = (const edge_key_t *)lhs;
+  const edge_key_t *b = (const edge_key_t *)rhs;
+  int32_t result = compare_points(a->key, b->key);
+  if (!result)
+    result = compare_points(a->key + 3, b->key + 3);
+  if (result)
+    return result;
+  return a->face < b->face ? -1 : (a->face > b->face ? 1 : 0);
+}
+
+static
+void
+set_edge_key(
+  edge_key_t *edge,
+  const face_t *face,
+  const uint32_t face_index,
+  const uint32_t i)
+{
+  int32_t points[2][3];
+
+  for (uint32_t k = 0; k < 2; ++k)
+    for (uint32_t axis = 0; axis < 3; ++axis)
+      points[k][axis] = (int32_t)lroundf(
+        face->points[(i + k) % 3].data[axis] * POINT_KEY_SCALE);
+
+  {
+    uint32_t first = compare_points(points[0], points[1]) > 0 ? 1 : 0;
+    memcpy(edge->key + 0, points[first], sizeof(points[0]));
+    memcpy(edge->key + 3, points[1 - first], sizeof(points[0]));
+  }
+
+  edge->face = face_index;
+  edge->edge = i;
+}
+
+static
+void
+set_internal_features(
+  face_adjacency_t *adjacency,
+  const uint32_t *clusters,
+  const uint32_t face)
+{
+  const uint32_t *neighbors = adjacency->neighbors + face * 3;
+  uint8_t internal = 0;
+
+  for (uint32_t i = 0; i < 3; ++i) {
+    if (
+      neighbors[i] != FACE_ADJACENCY_NONE &&
+      clusters[neighbors[i]] == clusters[face])
+      internal |= 1u << (FACE_FEATURE_EDGE(i) - 1);
+  }
+
+  // vertex 'i' is where the edges 'i - 1' and 'i' meet.
+  for (uint32_t i = 0; i < 3; ++i) {
+    uint32_t previous = 1u << (FACE_FEATURE_EDGE((i + 2) % 3) - 1);
+    uint32_t next = 1u << (FACE_FEATURE_EDGE(i) - 1);
+    if ((internal & previous) && (internal & next))
+      internal |= 1u << (FACE_FEATURE_VERTEX(i) - 1);
+  }
+
+  adjacency->internal[face] = internal;
+}
+
+static
+void
+count_internal_edges(face_adjacency_t *adjacency)
+{
+  adjacency->internal_edges = 0;
+  for (uint32_t i = 0; i < adjacency->face_count; ++i)
+    for (uint32_t k = 0; k < 3; ++k)
+      adjacency->internal_edges +=
+        (adjacency->internal[i] >> (FACE_FEATURE_EDGE(k) - 1)) & 1;
+
+  // every internal edge is seen from both its faces.
+  adjacency->internal_edges /= 2;
+}
+
+void
+face_adjacency_setup(
+  face_adjacency_t *adjacency,
+  bvh_t *bvh,
+  const uint32_t *clusters,
+  const allocator_t *allocator)
+{
+  edge_key_t *edges;
+  uint32_t edge_count;
+
+  assert(adjacency && bvh && allocator);
+
+  memset(adjacency, 0, sizeof(face_adjacency_t));
+  adjacency->face_count = (uint32_t)bvh->faces.size;
+  if (!adjacency->face_count)
+    return;
+
+  assert(clusters);
+
+  edge_count = adjacency->face_count * 3;
+  edges = allocator->mem_alloc(sizeof(edge_key_t) * edge_count);
+  for (uint32_t i = 0; i < adjacency->face_count; ++i) {
+    face_t *face = cvector_as(&bvh->faces, i, face_t);
+    for (uint32_t k = 0; k < 3; ++k)
+      set_edge_key(edges + i * 3 + k, face, i, k);
+  }
+
+  qsort(edges, edge_count, sizeof(edge_key_t), compare_edge_keys);
+
+  adjacency->neighbors =
+    allocator->mem_alloc(sizeof(uint32_t) * edge_count);
+  adjacency->internal =
+    allocator->mem_alloc(sizeof(uint8_t) * adjacency->face_count);
+  for (uint32_t i = 0; i < edge_count; ++i)
+    adjacency->neighbors[i] = FACE_ADJACENCY_NONE;
+
+  // only the edges shared by exactly 2 faces are paired.
+  for (uint32_t i = 0, last; i < edge_count; i = last) {
+    last = i + 1;
+    while (
+      last < edge_count &&
+      !compare_points(edges[i].key, edges[last].key) &&
+      !compare_points(edges[i].key + 3, edges[last].key + 3))
+      ++last;
+
+    if (last - i == 2 && edges[i].face != edges[i + 1].face) {
+      adjacency->neighbors[edges[i].face * 3 + edges[i].edge] =
+        edges[i + 1].face;
+      adjacency->neighbors[edges[i + 1].face * 3 + edges[i + 1].edge] =
+        edges[i].face;
+    }
+  }
+
+  allocator->mem_free(edges);
+
+  for (uint32_t i = 0; i < adjacency->face_count; ++i)
+    set_internal_features(adjacency, clusters, i);
+  count_internal_edges(adjacency);
+}
+
+void
+face_adjacency_cleanup(
+  face_adjacency_t *adjacency,
+  const allocator_t *allocator)
+{
+  assert(adjacency && allocator);
+
+  if (adjacency->neighbors)
+    allocator->mem_free(adjacency->neighbors);
+  if (adjacency->internal)
+    allocator->mem_free(adjacency->internal);
+  memset(adjacency, 0, sizeof(face_adjacency_t));
+}
+
+void
+face_adjacency_update(
+  face_adjacency_t *adjacency,
+  const uint32_t *clusters,
+  const uint32_t *faces,
+  const uint32_t count)
+{
+  assert(adjacency && clusters && (faces || !count));
+
+  if (!adjacency->internal)
+    return;
+
+  for (uint32_t i = 0; i < count; ++i) {
+    const uint32_t *neighbors = adjacency->neighbors + faces[i] * 3;
+    set_internal_features(adjacency, clusters, faces[i]);
+    for (uint32_t k = 0; k < 3; ++k)
+      if (neighbors[k] != FACE_ADJACENCY_NONE)
+        set_internal_features(adjacency, clusters, neighbors[k]);
+  }
+
+  count_internal_edges(adjacency);
+}
+
+// the voronoi regions of the triangle, see 'closest point on triangle to
+// point' in real time collision detection (Ericson).
+uint32_t
+face_contact_feature(
+  const face_t *face,
+  const point3f *point)
+{
+  const point3f *a = face->points + 0;
+  const point3f *b = face->points + 1;
+  const point3f *c = face->points + 2;
+  vector3f ab = diff_v3f(b, a);
+  vector3f ac = diff_v3f(c, a);
+  vector3f ap = diff_v3f(point, a);
+  vector3f bp = diff_v3f(point, b);
+  vector3f cp = diff_v3f(point, c);
+  float d1 = dot_product_v3f(&ab, &ap);
+  float d2 = dot_product_v3f(&ac, &ap);
+  float d3 = dot_product_v3f(&ab, &bp);
+  float d4 = dot_product_v3f(&ac, &bp);
+  float d5 = dot_product_v3f(&ab, &cp);
+  float d6 = dot_product_v3f(&ac, &cp);
+  float va, vb, vc;
+
+  if (d1 <= 0.f && d2 <= 0.f)
+    return FACE_FEATURE_VERTEX(0);
+
+  if (d3 >= 0.f && d4 <= d3)
+    return FACE_FEATURE_VERTEX(1);
+
+  vc = d1 * d4 - d3 * d2;
+  if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f)
+    return FACE_FEATURE_EDGE(0);
+
+  if (d6 >= 0.f && d5 <= d6)
+    return FACE_FEATURE_VERTEX(2);
+
+  vb = d5 * d2 - d1 * d6;
+  if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f)
+    return FACE_FEATURE_EDGE(2);
+
+  va = d3 * d6 - d5 * d4;
+  if (va <= 0.f && (d4 - d3) >= 0.f && (d5 - d6) >= 0.f)
+    return FACE_FEATURE_EDGE(1);
+
+  return FACE_FEATURE_INTERIOR;
+}
@@ -0,0 +1,361 @@
+/**
+ * @file face_grid.c
+ * @author khalilhenoud@gmail.com
+ * @brief uniform spatial hash over the level faces, an alternative broadphase.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <game/logic/bvh_query.h>
+#include <game/logic/collision_mesh.h>
+#include <game/logic/collision_utils.h>
+#include <game/logic/face_grid.h>
+#include <game/logic/logic_utils.h>
+#include <library/allocator/allocator.h>
+#include <math/capsule.h>
+#include <math/face.h>
+#include <spatial/bvh/bvh.h>
+
+#define MIN_TABLE_SIZE            64
+
+
+typedef
+struct {
+  int32_t min[3];
+  int32_t max[3];
+} cell_range_t;
+
+typedef
+struct {
+  uint32_t count;
+  uint64_t sum;
+} checksum_t;
+
+static
+uint32_t
+hash_cell(const int32_t x, const int32_t y, const int32_t z)
+{
+  return
+    ((uint32_t)x * 73856093u) ^
+    ((uint32_t)y * 19349663u) ^
+    ((uint32_t)z * 83492791u);
+}
+
+static
+void
+get_cell_range(
+  const face_grid_t *grid,
+  const bvh_aabb_t *bounds,
+  cell_range_t *range)
+{
+  for (uint32_t axis = 0; axis < 3; ++axis) {
+    range->min[axis] = (int32_t)floorf(
+      bounds->min_max[0].data[axis] * grid->inverse_cell_size);
+    range->max[axis] = (int32_t)floorf(
+      bounds->min_max[1].data[axis] * grid->inverse_cell_size);
+  }
+}
+
+static
+uint64_t
+get_cell_count(const cell_range_t *range)
+{
+  return
+    (uint64_t)(range->max[0] - range->min[0] + 1) *
+    (uint64_t)(range->max[1] - range->min[1] + 1) *
+    (uint64_t)(range->max[2] - range->min[2] + 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+face_grid_setup(
+  face_grid_t *grid,
+  const bvh_t *bvh,
+  const float capsule_radius,
+  const uint32_t revision,
+  const allocator_t *allocator)
+{
+  const uint32_t face_count = (uint32_t)bvh->faces.size;
+  uint32_t *cursors;
+
+  assert(grid && bvh && allocator && capsule_radius > 0.f);
+
+  memset(grid, 0, sizeof(face_grid_t));
+  grid->revision = revision;
+  grid->cell_size = capsule_radius * FACE_GRID_CELL_SCALE;
+  grid->inverse_cell_size = 1.f / grid->cell_size;
+  if (!face_count)
+    return;
+
+  for (uint32_t i = 0; i < face_count; ++i) {
+    cell_range_t range;
+    uint64_t cells;
+    get_cell_range(grid, cvector_as(&bvh->bounds, i, bvh_aabb_t), &range);
+    cells = get_cell_count(&range);
+    if (cells > FACE_GRID_MAX_FACE_CELLS)
+      grid->large_count++;
+    else
+      grid->entry_count += (uint32_t)cells;
+  }
+
+  grid->table_size = MIN_TABLE_SIZE;
+  while (grid->table_size < grid->entry_count)
+    grid->table_size *= 2;
+
+  grid->starts =
+    allocator->mem_alloc(sizeof(uint32_t) * (grid->table_size + 1));
+  grid->faces =
+    allocator->mem_alloc(sizeof(uint32_t) * (grid->entry_count + 1));
+  grid->large =
+    allocator->mem_alloc(sizeof(uint32_t) * (grid->large_count + 1));
+  cursors = allocator->mem_alloc(sizeof(uint32_t) * grid->table_size);
+  memset(grid->starts, 0, sizeof(uint32_t) * (grid->table_size + 1));
+
+  // count the entries per bucket, then fill in face order so that every
+  // bucket ends up sorted.
+  for (uint32_t pass = 0; pass < 2; ++pass) {
+    uint32_t large_count = 0;
+
+    for (uint32_t i = 0; i < face_count; ++i) {
+      cell_range_t range;
+      get_cell_range(grid, cvector_as(&bvh->bounds, i, bvh_aabb_t), &range);
+
+      if (get_cell_count(&range) > FACE_GRID_MAX_FACE_CELLS) {
+        if (pass)
+          grid->large[large_count++] = i;
+        continue;
+      }
+
+      for (int32_t z = range.min[2]; z <= range.max[2]; ++z) {
+        for (int32_t y = range.min[1]; y <= range.max[1]; ++y) {
+          for (int32_t x = range.min[0]; x <= range.max[0]; ++x) {
+            uint32_t bucket = hash_cell(x, y, z) & (grid->table_size - 1);
+            if (pass)
+              grid->faces[cursors[bucket]++] = i;
+            else
+              grid->starts[bucket + 1]++;
+          }
+        }
+      }
+    }
+
+    if (pass)
+      break;
+
+    for (uint32_t i = 0; i < grid->table_size; ++i) {
+      grid->starts[i + 1] += grid->starts[i];
+      cursors[i] = grid->starts[i];
+    }
+  }
+
+  allocator->mem_free(cursors);
+}
+
+void
+face_grid_cleanup(
+  face_grid_t *grid,
+  const allocator_t *allocator)
+{
+  assert(grid && allocator);
+
+  if (grid->starts)
+    allocator->mem_free(grid->starts);
+  if (grid->faces)
+    allocator->mem_free(grid->faces);
+  if (grid->large)
+    allocator->mem_free(grid->large);
+  memset(grid, 0, sizeof(face_grid_t));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NOTE: a face spanning several cells of the query is only reported from the
+// first of them, the cell whose coordinates are the max of the face and the
+// query min cells. The same test rejects the faces of other cells sharing the
+// bucket through a hash collision, given the face overlaps the query bounds.
+uint32_t
+face_grid_gather(
+  const face_grid_t *grid,
+  const bvh_t *bvh,
+  const bvh_aabb_t *bounds,
+  uint32_t *out,
+  const uint32_t capacity)
+{
+  cell_range_t query;
+  uint32_t count = 0;
+
+  assert(grid && bvh && bounds && out);
+
+  if (!grid->starts)
+    return 0;
+
+  get_cell_range(grid, bounds, &query);
+  if (get_cell_count(&query) > FACE_GRID_MAX_QUERY_CELLS)
+    return FACE_GRID_OVERFLOW;
+
+  for (int32_t z = query.min[2]; z <= query.max[2]; ++z) {
+    for (int32_t y = query.min[1]; y <= query.max[1]; ++y) {
+      for (int32_t x = query.min[0]; x <= query.max[0]; ++x) {
+        int32_t cell[3] = { x, y, z };
+        uint32_t bucket = hash_cell(x, y, z) & (grid->table_size - 1);
+
+        for (
+          uint32_t i = grid->starts[bucket], last = grid->starts[bucket + 1];
+          i < last; ++i) {
+          uint32_t face = grid->faces[i];
+          bvh_aabb_t *face_bounds = cvector_as(&bvh->bounds, face, bvh_aabb_t);
+          uint32_t axis = 0;
+
+          if (!bounds_intersect(bounds, face_bounds))
+            continue;
+
+          for (; axis < 3; ++axis) {
+            int32_t first = (int32_t)floorf(
+              face_bounds->min_max[0].data[axis] * grid->inverse_cell_size);
+            first = first > query.min[axis] ? first : query.min[axis];
+            if (cell[axis] != first)
+              break;
+          }
+
+          if (axis != 3)
+            continue;
+
+          if (count == capacity)
+            return FACE_GRID_OVERFLOW;
+          out[count++] = face;
+        }
+      }
+    }
+  }
+
+  for (uint32_t i = 0; i < grid->large_count; ++i) {
+    uint32_t face = grid->large[i];
+    if (!bounds_intersect(bounds, cvector_as(&bvh->bounds, face, bvh_aabb_t)))
+      continue;
+
+    if (count == capacity)
+      return FACE_GRID_OVERFLOW;
+    out[count++] = face;
+  }
+
+  // the bvh streams its faces in ascending order, so does the grid. A face is
+  // repeated when several of its cells collide in the same bucket.
+  return sort_unique_uint32(out, count);
+}
+
+uint32_t
+face_grid_query_cells(
+  const face_grid_t *grid,
+  const bvh_aabb_t *bounds)
+{
+  cell_range_t query;
+  uint64_t count;
+
+  assert(grid && bounds);
+
+  if (!grid->starts)
+    return 0;
+
+  get_cell_range(grid, bounds, &query);
+  count = get_cell_count(&query);
+  return count > FACE_GRID_MAX_QUERY_CELLS ? 0 : (uint32_t)count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static
+int32_t
+add_to_checksum(uint32_t face_index, void *user_data)
+{
+  checksum_t *checksum = (checksum_t *)user_data;
+  checksum->count++;
+  checksum->sum += face_index;
+  return 1;
+}
+
+static
+void
+get_query_bounds(
+  const collision_mesh_t *mesh,
+  const capsule_t *capsule,
+  const uint32_t i,
+  capsule_t *query,
+  bvh_aabb_t *bounds)
+{
+  const face_t *face = cvector_as(&mesh->bvh->faces, i, face_t);
+
+  *query = *capsule;
+  query->center = add_v3f(face->points + 0, face->points + 1);
+  add_set_v3f(&query->center, face->points + 2);
+  mult_set_v3f(&query->center, 1.f / 3.f);
+  populate_capsule_aabb(bounds, query, 1.f);
+}
+
+static
+double
+time_broadphase(
+  collision_mesh_t *mesh,
+  const capsule_t *capsule,
+  const uint32_t stride,
+  const uint32_t broadphase)
+{
+  checksum_t checksum = { 0, 0 };
+  double start = get_microseconds();
+
+  mesh->broadphase = broadphase;
+  for (uint32_t i = 0; i < mesh->face_count; i += stride) {
+    capsule_t query;
+    bvh_aabb_t bounds;
+    get_query_bounds(mesh, capsule, i, &query, &bounds);
+    bvh_query_faces(mesh, &bounds, &query, add_to_checksum, &checksum);
+  }
+
+  return get_microseconds() - start;
+}
+
+void
+face_grid_benchmark(
+  collision_mesh_t *mesh,
+  const capsule_t *capsule,
+  const uint32_t stride,
+  face_grid_stats_t *stats)
+{
+  const uint32_t broadphase = mesh->broadphase;
+  const face_grid_t *grid = &mesh->grid;
+
+  assert(mesh && capsule && stats);
+
+  memset(stats, 0, sizeof(face_grid_stats_t));
+  stats->bytes = (uint32_t)sizeof(uint32_t) *
+    (grid->table_size + 1 + grid->entry_count + grid->large_count);
+
+  if (!stride || !grid->starts || !mesh->face_count)
+    return;
+
+  for (uint32_t i = 0; i < mesh->face_count; i += stride) {
+    checksum_t checksums[2] = { { 0, 0 }, { 0, 0 } };
+    capsule_t query;
+    bvh_aabb_t bounds;
+    get_query_bounds(mesh, capsule, i, &query, &bounds);
+
+    for (uint32_t j = 0; j < 2; ++j) {
+      mesh->broadphase =
+        j ? COLLISION_BROADPHASE_GRID : COLLISION_BROADPHASE_BVH;
+      bvh_query_faces(mesh, &bounds, &query, add_to_checksum, checksums + j);
+    }
+
+    stats->queries++;
+    stats->mismatches +=
+      checksums[0].count != checksums[1].count ||
+      checksums[0].sum != checksums[1].sum;
+  }
+
+  stats->bvh_us = time_broadphase(
+    mesh, capsule, stride, COLLISION_BROADPHASE_BVH) / stats->queries;
+  stats->grid_us = time_broadphase(
+    mesh, capsule, stride, COLLISION_BROADPHASE_GRID) / stats->queries;
+  mesh->broadphase = broadphase;
+}
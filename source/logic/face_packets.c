@@ -0,0 +1,237 @@
+/**
+ * @file face_packets.c
+ * @author khalilhenoud@gmail.com
+ * @brief structure of arrays repacking of the bvh faces for batched rejection.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <game/logic/face_packets.h>
+#include <library/allocator/allocator.h>
+#include <math/capsule.h>
+#include <math/face.h>
+#include <spatial/bvh/bvh.h>
+
+#if \
+  defined(__SSE__) || \
+  defined(_M_X64) || \
+  defined(_M_AMD64) || \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FACE_PACKETS_SSE
+#include <xmmintrin.h>
+#endif
+
+
+static
+void
+set_lane(
+  face_packets_t *packets,
+  bvh_t *bvh,
+  const uint32_t i)
+{
+  face_packet_t *packet = packets->packets + i / FACE_PACKET_WIDTH;
+  uint32_t lane = i % FACE_PACKET_WIDTH;
+
+  // padding lanes can never overlap anything.
+  if (i >= packets->face_count) {
+    for (uint32_t axis = 0; axis < 3; ++axis) {
+      packet->min[axis][lane] = FLT_MAX;
+      packet->max[axis][lane] = -FLT_MAX;
+      packet->normal[axis][lane] = 0.f;
+    }
+    packet->distance[lane] = FLT_MAX;
+    return;
+  }
+
+  {
+    bvh_aabb_t *aabb = cvector_as(&bvh->bounds, i, bvh_aabb_t);
+    face_t *face = cvector_as(&bvh->faces, i, face_t);
+    vector3f *normal = cvector_as(&bvh->normals, i, vector3f);
+
+    for (uint32_t axis = 0; axis < 3; ++axis) {
+      packet->min[axis][lane] = aabb->min_max[0].data[axis];
+      packet->max[axis][lane] = aabb->min_max[1].data[axis];
+      packet->normal[axis][lane] = normal->data[axis];
+    }
+    packet->distance[lane] = dot_product_v3f(normal, face->points + 0);
+  }
+}
+
+void
+face_packets_setup(
+  face_packets_t *packets,
+  bvh_t *bvh,
+  const allocator_t *allocator)
+{
+  assert(packets && bvh && allocator);
+
+  packets->face_count = (uint32_t)bvh->faces.size;
+  packets->count =
+    (packets->face_count + FACE_PACKET_WIDTH - 1) / FACE_PACKET_WIDTH;
+  packets->packets = NULL;
+
+  if (!packets->count)
+    return;
+
+  packets->packets =
+    allocator->mem_alloc(sizeof(face_packet_t) * packets->count);
+
+  for (uint32_t i = 0, last = packets->count * FACE_PACKET_WIDTH; i < last; ++i)
+    set_lane(packets, bvh, i);
+}
+
+void
+face_packets_update(
+  face_packets_t *packets,
+  bvh_t *bvh,
+  const uint32_t index)
+{
+  assert(packets && bvh && index < packets->face_count);
+  set_lane(packets, bvh, index);
+}
+
+void
+face_packets_cleanup(
+  face_packets_t *packets,
+  const allocator_t *allocator)
+{
+  assert(packets && allocator);
+
+  if (packets->packets)
+    allocator->mem_free(packets->packets);
+  packets->packets = NULL;
+  packets->count = packets->face_count = 0;
+}
+
+uint32_t
+face_packet_bounds_mask(
+  const face_packet_t *packet,
+  const bvh_aabb_t *bounds)
+{
+#if defined(FACE_PACKETS_SSE)
+  __m128 result = _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps());
+
+  for (uint32_t axis = 0; axis < 3; ++axis) {
+    __m128 q_min = _mm_set1_ps(bounds->min_max[0].data[axis]);
+    __m128 q_max = _mm_set1_ps(bounds->min_max[1].data[axis]);
+    __m128 f_min = _mm_loadu_ps(packet->min[axis]);
+    __m128 f_max = _mm_loadu_ps(packet->max[axis]);
+    result = _mm_and_ps(result, _mm_cmple_ps(f_min, q_max));
+    result = _mm_and_ps(result, _mm_cmpge_ps(f_max, q_min));
+  }
+
+  return (uint32_t)_mm_movemask_ps(result);
+#else
+  uint32_t mask = 0;
+
+  for (uint32_t lane = 0; lane < FACE_PACKET_WIDTH; ++lane) {
+    uint32_t inside = 1;
+    for (uint32_t axis = 0; axis < 3; ++axis) {
+      inside &= packet->min[axis][lane] <= bounds->min_max[1].data[axis];
+      inside &= packet->max[axis][lane] >= bounds->min_max[0].data[axis];
+    }
+    mask |= inside << lane;
+  }
+
+  return mask;
+#endif
+}
+
+// the capsule segment is vertical, the segment endpoints signed distances to
+// the plane are 's +/- ny * half_height' with 's' the center distance. The face
+// is out of reach when both are beyond the radius on the same side, in other
+// words when |s| > radius + |ny| * half_height.
+uint32_t
+face_packet_plane_mask(
+  const face_packet_t *packet,
+  const capsule_t *capsule,
+  const float multiplier)
+{
+  const float radius = capsule->radius * multiplier;
+  const float half_height = capsule->half_height;
+
+#if defined(FACE_PACKETS_SSE)
+  const __m128 sign = _mm_set1_ps(-0.f);
+  __m128 cx = _mm_set1_ps(capsule->center.data[0]);
+  __m128 cy = _mm_set1_ps(capsule->center.data[1]);
+  __m128 cz = _mm_set1_ps(capsule->center.data[2]);
+  __m128 nx = _mm_loadu_ps(packet->normal[0]);
+  __m128 ny = _mm_loadu_ps(packet->normal[1]);
+  __m128 nz = _mm_loadu_ps(packet->normal[2]);
+  __m128 s = _mm_add_ps(
+    _mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)), _mm_mul_ps(nz, cz));
+  __m128 reach = _mm_add_ps(
+    _mm_set1_ps(radius),
+    _mm_mul_ps(_mm_andnot_ps(sign, ny), _mm_set1_ps(half_height)));
+  s = _mm_sub_ps(s, _mm_loadu_ps(packet->distance));
+  s = _mm_andnot_ps(sign, s);
+  return (uint32_t)_mm_movemask_ps(_mm_cmple_ps(s, reach));
+#else
+  uint32_t mask = 0;
+
+  for (uint32_t lane = 0; lane < FACE_PACKET_WIDTH; ++lane) {
+    float s =
+      packet->normal[0][lane] * capsule->center.data[0] +
+      packet->normal[1][lane] * capsule->center.data[1] +
+      packet->normal[2][lane] * capsule->center.data[2] -
+      packet->distance[lane];
+    float reach = radius + fabsf(packet->normal[1][lane]) * half_height;
+    mask |= (uint32_t)(fabsf(s) <= reach) << lane;
+  }
+
+  return mask;
+#endif
+}
+
+uint32_t
+face_packets_cull(
+  const face_packets_t *packets,
+  const uint32_t first,
+  const uint32_t last,
+  const bvh_aabb_t *bounds,
+  const capsule_t *capsule,
+  const float multiplier,
+  uint32_t *out)
+{
+  uint32_t used = 0;
+
+  assert(packets && bounds && out);
+  assert(last <= packets->face_count);
+
+  if (first >= last)
+    return 0;
+
+  for (
+    uint32_t p = first / FACE_PACKET_WIDTH,
+    p_last = (last - 1) / FACE_PACKET_WIDTH;
+    p <= p_last; ++p) {
+    const face_packet_t *packet = packets->packets + p;
+    uint32_t base = p * FACE_PACKET_WIDTH;
+    uint32_t mask = (1u << FACE_PACKET_WIDTH) - 1;
+
+    // trim the lanes that fall outside the [first, last) range.
+    if (base < first)
+      mask &= ~((1u << (first - base)) - 1);
+    if (base + FACE_PACKET_WIDTH > last)
+      mask &= (1u << (last - base)) - 1;
+
+    mask &= face_packet_bounds_mask(packet, bounds);
+    if (!mask)
+      continue;
+
+    if (capsule)
+      mask &= face_packet_plane_mask(packet, capsule, multiplier);
+
+    for (uint32_t lane = 0; mask; ++lane, mask >>= 1)
+      if (mask & 1)
+        out[used++] = base + lane;
+  }
+
+  return used;
+}
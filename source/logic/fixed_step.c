@@ -0,0 +1,52 @@
+/**
+ * @file fixed_step.c
+ * @author khalilhenoud@gmail.com
+ * @brief accumulator splitting the frame time into fixed simulation ticks.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <assert.h>
+#include <game/logic/fixed_step.h>
+
+
+void
+fixed_step_setup(
+  fixed_step_t *fixed_step,
+  const uint32_t rate)
+{
+  assert(fixed_step && rate);
+
+  fixed_step->rate = rate;
+  fixed_step->step = 1.f / (float)rate;
+  fixed_step->accumulator = 0.f;
+}
+
+uint32_t
+fixed_step_advance(
+  fixed_step_t *fixed_step,
+  const float delta_time)
+{
+  uint32_t ticks = 0;
+  assert(fixed_step);
+
+  fixed_step->accumulator += delta_time;
+  while (fixed_step->accumulator >= fixed_step->step) {
+    fixed_step->accumulator -= fixed_step->step;
+    ++ticks;
+  }
+
+  if (ticks > FIXED_STEP_MAX_TICKS)
+    ticks = FIXED_STEP_MAX_TICKS;
+
+  return ticks;
+}
+
+float
+fixed_step_alpha(const fixed_step_t *fixed_step)
+{
+  assert(fixed_step);
+  return fixed_step->accumulator / fixed_step->step;
+}
@@ -0,0 +1,232 @@
+/**
+ * @file ground_grid.c
+ * @author khalilhenoud@gmail.com
+ * @brief 2d grid of the floor faces, answers the vertical snap probes.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <game/logic/collision_mesh.h>
+#include <game/logic/collision_utils.h>
+#include <game/logic/ground_grid.h>
+#include <game/logic/logic_utils.h>
+#include <library/allocator/allocator.h>
+#include <spatial/bvh/bvh.h>
+
+
+typedef
+struct {
+  int32_t min[2];
+  int32_t max[2];
+} cell_range_t;
+
+// returns 0 if 'bounds' is entirely out of the grid, the range is clamped.
+static
+uint32_t
+get_cell_range(
+  const ground_grid_t *grid,
+  const bvh_aabb_t *bounds,
+  cell_range_t *range)
+{
+  for (uint32_t i = 0; i < 2; ++i) {
+    uint32_t axis = i * 2;
+    int32_t last = (int32_t)grid->cells[i] - 1;
+    range->min[i] = (int32_t)floorf(
+      (bounds->min_max[0].data[axis] - grid->origin[i]) *
+      grid->inverse_cell_size);
+    range->max[i] = (int32_t)floorf(
+      (bounds->min_max[1].data[axis] - grid->origin[i]) *
+      grid->inverse_cell_size);
+
+    if (range->max[i] < 0 || range->min[i] > last)
+      return 0;
+
+    range->min[i] = range->min[i] < 0 ? 0 : range->min[i];
+    range->max[i] = range->max[i] > last ? last : range->max[i];
+  }
+
+  return 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+ground_grid_setup(
+  ground_grid_t *grid,
+  const collision_mesh_t *mesh,
+  const float capsule_radius,
+  const allocator_t *allocator)
+{
+  bvh_t *bvh;
+  float min[2] = { FLT_MAX, FLT_MAX };
+  float max[2] = { -FLT_MAX, -FLT_MAX };
+  uint32_t cell_count;
+  uint32_t *cursors;
+
+  assert(grid && mesh && allocator && capsule_radius > 0.f);
+
+  bvh = mesh->bvh;
+  memset(grid, 0, sizeof(ground_grid_t));
+  grid->revision = mesh->revision;
+  grid->cell_size = capsule_radius * GROUND_GRID_CELL_SCALE;
+
+  for (uint32_t i = 0; i < mesh->face_count; ++i) {
+    bvh_aabb_t *bounds = cvector_as(&bvh->bounds, i, bvh_aabb_t);
+
+    if (!is_floor(mesh, i))
+      continue;
+
+    grid->floor_count++;
+    for (uint32_t k = 0; k < 2; ++k) {
+      min[k] = fminf(min[k], bounds->min_max[0].data[k * 2]);
+      max[k] = fmaxf(max[k], bounds->min_max[1].data[k * 2]);
+    }
+  }
+
+  if (!grid->floor_count) {
+    grid->inverse_cell_size = 1.f / grid->cell_size;
+    return;
+  }
+
+  for (;;) {
+    uint64_t total = 1;
+    for (uint32_t k = 0; k < 2; ++k) {
+      grid->cells[k] = (uint32_t)((max[k] - min[k]) / grid->cell_size) + 1;
+      total *= grid->cells[k];
+    }
+
+    if (total <= GROUND_GRID_MAX_CELLS)
+      break;
+    grid->cell_size *= 2.f;
+  }
+
+  grid->origin[0] = min[0];
+  grid->origin[1] = min[1];
+  grid->inverse_cell_size = 1.f / grid->cell_size;
+  cell_count = grid->cells[0] * grid->cells[1];
+
+  grid->starts = allocator->mem_alloc(sizeof(uint32_t) * (cell_count + 1));
+  grid->heights = allocator->mem_alloc(sizeof(float) * cell_count * 2);
+  cursors = allocator->mem_alloc(sizeof(uint32_t) * cell_count);
+  memset(grid->starts, 0, sizeof(uint32_t) * (cell_count + 1));
+  for (uint32_t i = 0; i < cell_count; ++i) {
+    grid->heights[i * 2 + 0] = FLT_MAX;
+    grid->heights[i * 2 + 1] = -FLT_MAX;
+  }
+
+  // count the entries per cell, then fill in face order so that every cell
+  // ends up sorted.
+  for (uint32_t pass = 0; pass < 2; ++pass) {
+    for (uint32_t i = 0; i < mesh->face_count; ++i) {
+      bvh_aabb_t *bounds = cvector_as(&bvh->bounds, i, bvh_aabb_t);
+      cell_range_t range;
+
+      if (!is_floor(mesh, i))
+        continue;
+
+      get_cell_range(grid, bounds, &range);
+      for (int32_t z = range.min[1]; z <= range.max[1]; ++z) {
+        for (int32_t x = range.min[0]; x <= range.max[0]; ++x) {
+          uint32_t cell = (uint32_t)x + (uint32_t)z * grid->cells[0];
+          float *heights = grid->heights + cell * 2;
+
+          if (pass) {
+            grid->faces[cursors[cell]++] = i;
+            continue;
+          }
+
+          grid->starts[cell + 1]++;
+          heights[0] = fminf(heights[0], bounds->min_max[0].data[1]);
+          heights[1] = fmaxf(heights[1], bounds->min_max[1].data[1]);
+        }
+      }
+    }
+
+    if (pass)
+      break;
+
+    for (uint32_t i = 0; i < cell_count; ++i) {
+      grid->starts[i + 1] += grid->starts[i];
+      cursors[i] = grid->starts[i];
+    }
+
+    grid->entry_count = grid->starts[cell_count];
+    grid->faces =
+      allocator->mem_alloc(sizeof(uint32_t) * (grid->entry_count + 1));
+  }
+
+  allocator->mem_free(cursors);
+}
+
+void
+ground_grid_cleanup(
+  ground_grid_t *grid,
+  const allocator_t *allocator)
+{
+  assert(grid && allocator);
+
+  if (grid->starts)
+    allocator->mem_free(grid->starts);
+  if (grid->faces)
+    allocator->mem_free(grid->faces);
+  if (grid->heights)
+    allocator->mem_free(grid->heights);
+  memset(grid, 0, sizeof(ground_grid_t));
+}
+
+uint32_t
+ground_grid_gather(
+  const ground_grid_t *grid,
+  const collision_mesh_t *mesh,
+  bvh_aabb_t *bounds,
+  uint32_t *out,
+  const uint32_t capacity)
+{
+  bvh_t *bvh = mesh->bvh;
+  cell_range_t range;
+  uint32_t count = 0;
+
+  assert(grid && mesh && bounds && out);
+
+  if (!grid->starts || !get_cell_range(grid, bounds, &range))
+    return 0;
+
+  if (
+    (uint64_t)(range.max[0] - range.min[0] + 1) *
+    (uint64_t)(range.max[1] - range.min[1] + 1) >
+    GROUND_GRID_MAX_QUERY_CELLS)
+    return GROUND_GRID_OVERFLOW;
+
+  for (int32_t z = range.min[1]; z <= range.max[1]; ++z) {
+    for (int32_t x = range.min[0]; x <= range.max[0]; ++x) {
+      uint32_t cell = (uint32_t)x + (uint32_t)z * grid->cells[0];
+      const float *heights = grid->heights + cell * 2;
+
+      if (
+        heights[0] > bounds->min_max[1].data[1] ||
+        heights[1] < bounds->min_max[0].data[1])
+        continue;
+
+      for (
+        uint32_t i = grid->starts[cell], last = grid->starts[cell + 1];
+        i < last; ++i) {
+        uint32_t face = grid->faces[i];
+        bvh_aabb_t *face_bounds = cvector_as(&bvh->bounds, face, bvh_aabb_t);
+        if (!bounds_intersect(bounds, face_bounds))
+          continue;
+
+        if (count == capacity)
+          return GROUND_GRID_OVERFLOW;
+        out[count++] = face;
+      }
+    }
+  }
+
+  // a face overlapping several cells is gathered once per cell.
+  return sort_unique_uint32(out, count);
+}
@@ -0,0 +1,51 @@
+/**
+ * @file logic_utils.c
+ * @author khalilhenoud@gmail.com
+ * @brief small helpers shared by the logic modules.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <stdlib.h>
+#include <time.h>
+#include <game/logic/logic_utils.h>
+
+
+double
+get_microseconds(void)
+{
+  struct timespec now;
+  timespec_get(&now, TIME_UTC);
+  return (double)now.tv_sec * 1000000.0 + (double)now.tv_nsec / 1000.0;
+}
+
+int
+compare_uint64(const void *lhs, const void *rhs)
+{
+  uint64_t a = *(const uint64_t *)lhs;
+  uint64_t b = *(const uint64_t *)rhs;
+  return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+static
+int
+compare_uint32(const void *lhs, const void *rhs)
+{
+  uint32_t a = *(const uint32_t *)lhs;
+  uint32_t b = *(const uint32_t *)rhs;
+  return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+uint32_t
+sort_unique_uint32(uint32_t *values, const uint32_t count)
+{
+  uint32_t unique = count ? 1 : 0;
+
+  qsort(values, count, sizeof(uint32_t), compare_uint32);
+  for (uint32_t i = 1; i < count; ++i)
+    if (values[i] != values[unique - 1])
+      values[unique++] = values[i];
+  return unique;
+}
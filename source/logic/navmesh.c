@@ -0,0 +1,1240 @@
+/**
+ * @file navmesh.c
+ * @author khalilhenoud@gmail.com
+ * @brief convex polygons merged from the floor faces, with an a* path query.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <game/logic/collision_mesh.h>
+#include <game/logic/collision_utils.h>
+#include <game/logic/logic_utils.h>
+#include <game/logic/navmesh.h>
+#include <library/allocator/allocator.h>
+#include <math/face.h>
+#include <spatial/bvh/bvh.h>
+
+#define WELD_DISTANCE             0.1f
+#define CONVEX_EPSILON            0.001f
+#define STEP_GAP_SCALE            0.25f
+#define INITIAL_CAPACITY          256
+#define BENCH_PATH_CAPACITY       64
+
+
+typedef
+struct {
+  uint32_t from;
+  navmesh_link_t link;
+} link_entry_t;
+
+typedef
+struct {
+  uint32_t polygon;
+  point3f points[2];
+  float min_x;
+  float max_x;
+} boundary_edge_t;
+
+typedef
+struct {
+  link_entry_t *links;
+  uint32_t link_count;
+  uint32_t link_capacity;
+  boundary_edge_t *edges;
+  uint32_t edge_count;
+  uint32_t edge_capacity;
+} build_state_t;
+
+// twice the signed area of the xz triangle, positive when 'c' is to the right
+// of 'a' to 'b'.
+static
+float
+triarea2(const point3f *a, const point3f *b, const point3f *c)
+{
+  float ax = b->data[0] - a->data[0];
+  float az = b->data[2] - a->data[2];
+  float bx = c->data[0] - a->data[0];
+  float bz = c->data[2] - a->data[2];
+  return bx * az - ax * bz;
+}
+
+static
+int32_t
+is_same_point(const point3f *a, const point3f *b)
+{
+  vector3f delta = diff_v3f(a, b);
+  return length_squared_v3f(&delta) <= WELD_DISTANCE * WELD_DISTANCE;
+}
+
+static
+int32_t
+is_same_point_xz(const point3f *a, const point3f *b)
+{
+  float dx = a->data[0] - b->data[0];
+  float dz = a->data[2] - b->data[2];
+  return dx * dx + dz * dz <= WELD_DISTANCE * WELD_DISTANCE;
+}
+
+static
+float
+get_distance(const point3f *a, const point3f *b)
+{
+  vector3f delta = diff_v3f(a, b);
+  return sqrtf(length_squared_v3f(&delta));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static
+int32_t
+is_convex(
+  const point3f *outline,
+  const uint32_t count,
+  const float sign)
+{
+  for (uint32_t i = 0; i < count; ++i) {
+    const point3f *previous = outline + (i + count - 1) % count;
+    const point3f *next = outline + (i + 1) % count;
+    if (triarea2(previous, outline + i, next) * sign < -CONVEX_EPSILON)
+      return 0;
+  }
+
+  return 1;
+}
+
+// grows the outline by the triangle 'face' across its edge 'a' 'b', the
+// outline is left untouched if it would stop being convex.
+static
+int32_t
+merge_face(
+  point3f outline[NAVMESH_MAX_VERTICES],
+  uint32_t *count,
+  const float sign,
+  const point3f *a,
+  const point3f *b,
+  const face_t *face)
+{
+  point3f merged[NAVMESH_MAX_VERTICES];
+  uint32_t third = 3;
+
+  if (*count == NAVMESH_MAX_VERTICES)
+    return 0;
+
+  for (uint32_t k = 0; k < 3; ++k)
+    if (
+      !is_same_point(face->points + k, a) &&
+      !is_same_point(face->points + k, b))
+      third = k;
+
+  if (third == 3)
+    return 0;
+
+  for (uint32_t i = 0; i < *count; ++i) {
+    const point3f *first = outline + i;
+    const point3f *second = outline + (i + 1) % *count;
+
+    if (
+      !(is_same_point(first, a) && is_same_point(second, b)) &&
+      !(is_same_point(first, b) && is_same_point(second, a)))
+      continue;
+
+    memcpy(merged, outline, sizeof(point3f) * (i + 1));
+    merged[i + 1] = face->points[third];
+    memcpy(
+      merged + i + 2, outline + i + 1, sizeof(point3f) * (*count - i - 1));
+
+    if (!is_convex(merged, *count + 1, sign))
+      return 0;
+
+    memcpy(outline, merged, sizeof(point3f) * (*count + 1));
+    (*count)++;
+    return 1;
+  }
+
+  return 0;
+}
+
+static
+void
+push_link(
+  build_state_t *state,
+  const uint32_t from,
+  const uint32_t to,
+  const uint32_t is_step,
+  const point3f *a,
+  const point3f *b,
+  const allocator_t *allocator)
+{
+  link_entry_t *entry;
+
+  if (state->link_count == state->link_capacity) {
+    state->link_capacity *= 2;
+    state->links = allocator->mem_realloc(
+      state->links, sizeof(link_entry_t) * state->link_capacity);
+  }
+
+  entry = state->links + state->link_count++;
+  entry->from = from;
+  entry->link.polygon = to;
+  entry->link.is_step = is_step;
+  entry->link.corners = is_step ? 3 : 0;
+  entry->link.portal[0] = *a;
+  entry->link.portal[1] = *b;
+}
+
+static
+void
+push_edge(
+  build_state_t *state,
+  const uint32_t polygon,
+  const point3f *a,
+  const point3f *b,
+  const allocator_t *allocator)
+{
+  boundary_edge_t *edge;
+
+  if (state->edge_count == state->edge_capacity) {
+    state->edge_capacity *= 2;
+    state->edges = allocator->mem_realloc(
+      state->edges, sizeof(boundary_edge_t) * state->edge_capacity);
+  }
+
+  edge = state->edges + state->edge_count++;
+  edge->polygon = polygon;
+  edge->points[0] = *a;
+  edge->points[1] = *b;
+  edge->min_x = fminf(a->data[0], b->data[0]);
+  edge->max_x = fmaxf(a->data[0], b->data[0]);
+}
+
+static
+int
+compare_edges(const void *lhs, const void *rhs)
+{
+  float a = ((const boundary_edge_t *)lhs)->min_x;
+  float b = ((const boundary_edge_t *)rhs)->min_x;
+  return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+static
+int
+compare_points(const void *lhs, const void *rhs)
+{
+  float a = ((const point3f *)lhs)->data[0];
+  float b = ((const point3f *)rhs)->data[0];
+  return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+// 'points' is sorted along x.
+static
+int32_t
+is_boundary_point(
+  const point3f *points,
+  const uint32_t count,
+  const point3f *point)
+{
+  uint32_t low = 0, high = count;
+
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    if (points[middle].data[0] < point->data[0] - WELD_DISTANCE)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  for (
+    ;
+    low < count && points[low].data[0] <= point->data[0] + WELD_DISTANCE;
+    ++low)
+    if (is_same_point(points + low, point))
+      return 1;
+
+  return 0;
+}
+
+static
+int
+compare_links(const void *lhs, const void *rhs)
+{
+  const link_entry_t *a = (const link_entry_t *)lhs;
+  const link_entry_t *b = (const link_entry_t *)rhs;
+
+  if (a->from != b->from)
+    return a->from < b->from ? -1 : 1;
+  if (a->link.polygon != b->link.polygon)
+    return a->link.polygon < b->link.polygon ? -1 : 1;
+  if (a->link.is_step != b->link.is_step)
+    return a->link.is_step < b->link.is_step ? -1 : 1;
+  return 0;
+}
+
+// links two facing boundary edges of different polygons if the capsule can
+// step from one to the other, the edges must be collinear in xz within 'gap'.
+static
+void
+try_step_link(
+  navmesh_t *navmesh,
+  build_state_t *state,
+  const boundary_edge_t *lower,
+  const boundary_edge_t *upper,
+  const float gap,
+  const allocator_t *allocator)
+{
+  const point3f *origin = lower->points + 0;
+  const point3f *end = lower->points + 1;
+  float ux = end->data[0] - origin->data[0];
+  float uz = end->data[2] - origin->data[2];
+  float length = sqrtf(ux * ux + uz * uz);
+  float t[2], s[2];
+  point3f other[2], portal[2];
+
+  if (length <= WELD_DISTANCE)
+    return;
+
+  ux /= length;
+  uz /= length;
+
+  for (uint32_t i = 0; i < 2; ++i) {
+    float dx = upper->points[i].data[0] - origin->data[0];
+    float dz = upper->points[i].data[2] - origin->data[2];
+    if (fabsf(dx * uz - dz * ux) > gap)
+      return;
+    t[i] = dx * ux + dz * uz;
+    other[i] = upper->points[i];
+  }
+
+  if (t[0] > t[1]) {
+    float swap = t[0];
+    point3f point = other[0];
+    t[0] = t[1];
+    t[1] = swap;
+    other[0] = other[1];
+    other[1] = point;
+  }
+
+  s[0] = fmaxf(0.f, t[0]);
+  s[1] = fminf(length, t[1]);
+  if (s[1] - s[0] < navmesh->radius * 2.f)
+    return;
+
+  for (uint32_t i = 0; i < 2; ++i) {
+    float y0 =
+      origin->data[1] + (end->data[1] - origin->data[1]) * s[i] / length;
+    float y1 =
+      other[0].data[1] +
+      (other[1].data[1] - other[0].data[1]) * (s[i] - t[0]) / (t[1] - t[0]);
+
+    if (fabsf(y1 - y0) > navmesh->step_height)
+      return;
+
+    vector3f_set_3f(
+      portal + i,
+      origin->data[0] + ux * s[i],
+      fmaxf(y0, y1),
+      origin->data[2] + uz * s[i]);
+  }
+
+  push_link(
+    state, lower->polygon, upper->polygon, 1,
+    portal + 0, portal + 1, allocator);
+  push_link(
+    state, upper->polygon, lower->polygon, 1,
+    portal + 0, portal + 1, allocator);
+}
+
+// merges 'link' into 'kept' if their portals are collinear and touch, the
+// portal becomes the span of both.
+static
+int32_t
+merge_portals(navmesh_link_t *kept, const navmesh_link_t *link)
+{
+  const point3f *origin = kept->portal + 0;
+  float ux = kept->portal[1].data[0] - origin->data[0];
+  float uz = kept->portal[1].data[2] - origin->data[2];
+  float length = sqrtf(ux * ux + uz * uz);
+  const point3f *points[4] = {
+    kept->portal + 0, kept->portal + 1, link->portal + 0, link->portal + 1 };
+  float t[4] = { 0.f, length, 0.f, 0.f };
+  uint32_t low = 0, high = 1;
+  point3f span[2];
+
+  if (length <= WELD_DISTANCE)
+    return 0;
+
+  ux /= length;
+  uz /= length;
+
+  for (uint32_t i = 2; i < 4; ++i) {
+    float dx = points[i]->data[0] - origin->data[0];
+    float dz = points[i]->data[2] - origin->data[2];
+    if (fabsf(dx * uz - dz * ux) > WELD_DISTANCE)
+      return 0;
+    t[i] = dx * ux + dz * uz;
+  }
+
+  if (
+    fminf(t[2], t[3]) > length + WELD_DISTANCE ||
+    fmaxf(t[2], t[3]) < -WELD_DISTANCE)
+    return 0;
+
+  for (uint32_t i = 2; i < 4; ++i) {
+    low = t[i] < t[low] ? i : low;
+    high = t[i] > t[high] ? i : high;
+  }
+
+  span[0] = *points[low];
+  span[1] = *points[high];
+  kept->portal[0] = span[0];
+  kept->portal[1] = span[1];
+  return 1;
+}
+
+static
+void
+build_polygons(
+  navmesh_t *navmesh,
+  const collision_mesh_t *mesh,
+  uint32_t *face_polygons,
+  const allocator_t *allocator)
+{
+  bvh_t *bvh = mesh->bvh;
+  const uint32_t *neighbors = mesh->adjacency.neighbors;
+  uint32_t *stack = allocator->mem_alloc(sizeof(uint32_t) * mesh->face_count);
+  uint32_t floors = 0;
+
+  for (uint32_t i = 0; i < mesh->face_count; ++i)
+    floors += is_floor(mesh, i);
+
+  navmesh->polygons =
+    allocator->mem_alloc(sizeof(navmesh_polygon_t) * (floors + 1));
+  navmesh->vertices = allocator->mem_alloc(
+    sizeof(point3f) * (floors * NAVMESH_MAX_VERTICES + 1));
+
+  for (uint32_t f = 0; f < mesh->face_count; ++f) {
+    point3f outline[NAVMESH_MAX_VERTICES];
+    face_t *face = cvector_as(&bvh->faces, f, face_t);
+    navmesh_polygon_t *polygon;
+    uint32_t count = 3, used = 0;
+    uint32_t index = navmesh->polygon_count;
+    float sign;
+
+    if (!is_floor(mesh, f) || face_polygons[f] != NAVMESH_NONE)
+      continue;
+
+    memcpy(outline, face->points, sizeof(point3f) * 3);
+    sign = triarea2(outline + 0, outline + 1, outline + 2) > 0.f ? 1.f : -1.f;
+    face_polygons[f] = index;
+    stack[used++] = f;
+
+    // flood the coplanar floor faces, each is kept if the outline stays convex.
+    while (used) {
+      uint32_t g = stack[--used];
+      face_t *current = cvector_as(&bvh->faces, g, face_t);
+
+      for (uint32_t e = 0; e < 3; ++e) {
+        uint32_t n = neighbors ? neighbors[g * 3 + e] : FACE_ADJACENCY_NONE;
+
+        if (
+          n == FACE_ADJACENCY_NONE ||
+          face_polygons[n] != NAVMESH_NONE ||
+          !is_floor(mesh, n) ||
+          mesh->clusters[n] != mesh->clusters[f])
+          continue;
+
+        if (!merge_face(
+          outline, &count, sign,
+          current->points + e, current->points + (e + 1) % 3,
+          cvector_as(&bvh->faces, n, face_t)))
+          continue;
+
+        face_polygons[n] = index;
+        stack[used++] = n;
+      }
+    }
+
+    polygon = navmesh->polygons + navmesh->polygon_count++;
+    polygon->first_vertex = navmesh->vertex_count;
+    polygon->vertex_count = count;
+    polygon->normal = *cvector_as(&bvh->normals, f, vector3f);
+    polygon->distance = dot_product_v3f(&polygon->normal, outline + 0);
+    polygon->min[0] = polygon->min[1] = FLT_MAX;
+    polygon->max[0] = polygon->max[1] = -FLT_MAX;
+    vector3f_set_1f(&polygon->center, 0.f);
+
+    for (uint32_t i = 0; i < count; ++i) {
+      navmesh->vertices[navmesh->vertex_count++] = outline[i];
+      add_set_v3f(&polygon->center, outline + i);
+      for (uint32_t k = 0; k < 2; ++k) {
+        polygon->min[k] = fminf(polygon->min[k], outline[i].data[k * 2]);
+        polygon->max[k] = fmaxf(polygon->max[k], outline[i].data[k * 2]);
+      }
+    }
+    mult_set_v3f(&polygon->center, 1.f / count);
+  }
+
+  allocator->mem_free(stack);
+}
+
+static
+void
+build_links(
+  navmesh_t *navmesh,
+  const collision_mesh_t *mesh,
+  const uint32_t *face_polygons,
+  const allocator_t *allocator)
+{
+  bvh_t *bvh = mesh->bvh;
+  const uint32_t *neighbors = mesh->adjacency.neighbors;
+  const float gap = navmesh->radius * STEP_GAP_SCALE;
+  build_state_t state;
+  uint32_t used = 0;
+
+  state.link_count = state.edge_count = 0;
+  state.link_capacity = state.edge_capacity = INITIAL_CAPACITY;
+  state.links =
+    allocator->mem_alloc(sizeof(link_entry_t) * state.link_capacity);
+  state.edges =
+    allocator->mem_alloc(sizeof(boundary_edge_t) * state.edge_capacity);
+
+  // the shared edges are met from both faces, one link per direction.
+  for (uint32_t f = 0; f < mesh->face_count; ++f) {
+    face_t *face = cvector_as(&bvh->faces, f, face_t);
+    uint32_t polygon = face_polygons[f];
+
+    if (polygon == NAVMESH_NONE)
+      continue;
+
+    for (uint32_t e = 0; e < 3; ++e) {
+      uint32_t n = neighbors ? neighbors[f * 3 + e] : FACE_ADJACENCY_NONE;
+      const point3f *a = face->points + e;
+      const point3f *b = face->points + (e + 1) % 3;
+
+      if (n != FACE_ADJACENCY_NONE && face_polygons[n] != NAVMESH_NONE) {
+        if (face_polygons[n] != polygon)
+          push_link(&state, polygon, face_polygons[n], 0, a, b, allocator);
+        continue;
+      }
+
+      push_edge(&state, polygon, a, b, allocator);
+    }
+  }
+
+  // sweep and prune the open edges along x for the step pairs.
+  qsort(state.edges, state.edge_count, sizeof(boundary_edge_t), compare_edges);
+  for (uint32_t i = 0; i < state.edge_count; ++i) {
+    for (
+      uint32_t j = i + 1;
+      j < state.edge_count &&
+      state.edges[j].min_x <= state.edges[i].max_x + gap;
+      ++j) {
+      if (state.edges[i].polygon != state.edges[j].polygon)
+        try_step_link(
+          navmesh, &state, state.edges + i, state.edges + j, gap, allocator);
+    }
+  }
+
+  // a polygon pair can share several collinear edges, their portals are joined.
+  qsort(state.links, state.link_count, sizeof(link_entry_t), compare_links);
+  for (uint32_t i = 0; i < state.link_count; ++i) {
+    link_entry_t *kept = used ? state.links + used - 1 : NULL;
+
+    if (
+      kept &&
+      compare_links(kept, state.links + i) == 0 &&
+      merge_portals(&kept->link, &state.links[i].link))
+      continue;
+
+    state.links[used++] = state.links[i];
+  }
+
+  // a shared portal end is a corner if an open edge ends there.
+  {
+    uint32_t count = state.edge_count * 2;
+    point3f *points = allocator->mem_alloc(sizeof(point3f) * (count + 1));
+    for (uint32_t i = 0; i < state.edge_count; ++i) {
+      points[i * 2 + 0] = state.edges[i].points[0];
+      points[i * 2 + 1] = state.edges[i].points[1];
+    }
+    qsort(points, count, sizeof(point3f), compare_points);
+
+    for (uint32_t i = 0; i < used; ++i) {
+      navmesh_link_t *link = &state.links[i].link;
+      for (uint32_t k = 0; k < 2 && !link->is_step; ++k)
+        link->corners |=
+          is_boundary_point(points, count, link->portal + k) << k;
+    }
+
+    allocator->mem_free(points);
+  }
+
+  navmesh->link_count = used;
+  navmesh->links = allocator->mem_alloc(sizeof(navmesh_link_t) * (used + 1));
+  for (uint32_t i = 0; i < navmesh->polygon_count; ++i)
+    navmesh->polygons[i].link_count = 0;
+
+  for (uint32_t i = 0; i < used; ++i) {
+    navmesh->links[i] = state.links[i].link;
+    navmesh->polygons[state.links[i].from].link_count++;
+    navmesh->step_links += state.links[i].link.is_step;
+  }
+
+  for (uint32_t i = 0, first = 0; i < navmesh->polygon_count; ++i) {
+    navmesh->polygons[i].first_link = first;
+    first += navmesh->polygons[i].link_count;
+  }
+
+  allocator->mem_free(state.links);
+  allocator->mem_free(state.edges);
+}
+
+static
+void
+get_cell(
+  const navmesh_t *navmesh,
+  const float x,
+  const float z,
+  int32_t cell[2])
+{
+  const float inverse = navmesh->inverse_cell_size;
+  cell[0] = (int32_t)floorf((x - navmesh->origin[0]) * inverse);
+  cell[1] = (int32_t)floorf((z - navmesh->origin[1]) * inverse);
+}
+
+static
+void
+build_grid(navmesh_t *navmesh, const allocator_t *allocator)
+{
+  float min[2] = { FLT_MAX, FLT_MAX };
+  float max[2] = { -FLT_MAX, -FLT_MAX };
+  uint32_t cell_count;
+  uint32_t *cursors;
+
+  for (uint32_t i = 0; i < navmesh->polygon_count; ++i) {
+    for (uint32_t k = 0; k < 2; ++k) {
+      min[k] = fminf(min[k], navmesh->polygons[i].min[k]);
+      max[k] = fmaxf(max[k], navmesh->polygons[i].max[k]);
+    }
+  }
+
+  navmesh->cell_size = navmesh->radius * NAVMESH_CELL_SCALE;
+  for (;;) {
+    uint64_t total = 1;
+    for (uint32_t k = 0; k < 2; ++k) {
+      navmesh->cell_count[k] =
+        (uint32_t)((max[k] - min[k]) / navmesh->cell_size) + 1;
+      total *= navmesh->cell_count[k];
+    }
+
+    if (total <= NAVMESH_MAX_CELLS)
+      break;
+    navmesh->cell_size *= 2.f;
+  }
+
+  navmesh->origin[0] = min[0];
+  navmesh->origin[1] = min[1];
+  navmesh->inverse_cell_size = 1.f / navmesh->cell_size;
+  cell_count = navmesh->cell_count[0] * navmesh->cell_count[1];
+  navmesh->starts = allocator->mem_alloc(sizeof(uint32_t) * (cell_count + 1));
+  cursors = allocator->mem_alloc(sizeof(uint32_t) * cell_count);
+  memset(navmesh->starts, 0, sizeof(uint32_t) * (cell_count + 1));
+
+  for (uint32_t pass = 0; pass < 2; ++pass) {
+    for (uint32_t i = 0; i < navmesh->polygon_count; ++i) {
+      const navmesh_polygon_t *polygon = navmesh->polygons + i;
+      int32_t first[2], last[2];
+      get_cell(navmesh, polygon->min[0], polygon->min[1], first);
+      get_cell(navmesh, polygon->max[0], polygon->max[1], last);
+
+      for (int32_t z = first[1]; z <= last[1]; ++z) {
+        for (int32_t x = first[0]; x <= last[0]; ++x) {
+          uint32_t cell = (uint32_t)x + (uint32_t)z * navmesh->cell_count[0];
+          if (pass)
+            navmesh->cells[cursors[cell]++] = i;
+          else
+            navmesh->starts[cell + 1]++;
+        }
+      }
+    }
+
+    if (pass)
+      break;
+
+    for (uint32_t i = 0; i < cell_count; ++i) {
+      navmesh->starts[i + 1] += navmesh->starts[i];
+      cursors[i] = navmesh->starts[i];
+    }
+
+    navmesh->cells = allocator->mem_alloc(
+      sizeof(uint32_t) * (navmesh->starts[cell_count] + 1));
+  }
+
+  allocator->mem_free(cursors);
+}
+
+void
+navmesh_setup(
+  navmesh_t *navmesh,
+  const collision_mesh_t *mesh,
+  const float radius,
+  const float step_height,
+  const allocator_t *allocator)
+{
+  double start = get_microseconds();
+  uint32_t *face_polygons;
+
+  assert(navmesh && mesh && allocator && radius > 0.f);
+
+  memset(navmesh, 0, sizeof(navmesh_t));
+  navmesh->radius = radius;
+  navmesh->step_height = step_height;
+
+  face_polygons =
+    allocator->mem_alloc(sizeof(uint32_t) * (mesh->face_count + 1));
+  for (uint32_t i = 0; i < mesh->face_count; ++i)
+    face_polygons[i] = NAVMESH_NONE;
+
+  build_polygons(navmesh, mesh, face_polygons, allocator);
+  if (navmesh->polygon_count) {
+    build_links(navmesh, mesh, face_polygons, allocator);
+    build_grid(navmesh, allocator);
+  }
+
+  allocator->mem_free(face_polygons);
+  navmesh->build_ms = (float)((get_microseconds() - start) / 1000.0);
+}
+
+void
+navmesh_cleanup(
+  navmesh_t *navmesh,
+  const allocator_t *allocator)
+{
+  assert(navmesh && allocator);
+
+  if (navmesh->polygons)
+    allocator->mem_free(navmesh->polygons);
+  if (navmesh->vertices)
+    allocator->mem_free(navmesh->vertices);
+  if (navmesh->links)
+    allocator->mem_free(navmesh->links);
+  if (navmesh->starts)
+    allocator->mem_free(navmesh->starts);
+  if (navmesh->cells)
+    allocator->mem_free(navmesh->cells);
+  memset(navmesh, 0, sizeof(navmesh_t));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static
+int32_t
+contains_xz(
+  const navmesh_t *navmesh,
+  const navmesh_polygon_t *polygon,
+  const point3f *point)
+{
+  const point3f *outline = navmesh->vertices + polygon->first_vertex;
+  uint32_t count = polygon->vertex_count;
+  uint32_t positive = 0, negative = 0;
+
+  for (uint32_t i = 0; i < count; ++i) {
+    float area = triarea2(outline + i, outline + (i + 1) % count, point);
+    positive |= area > CONVEX_EPSILON;
+    negative |= area < -CONVEX_EPSILON;
+  }
+
+  return !(positive && negative);
+}
+
+uint32_t
+navmesh_find_polygon(
+  const navmesh_t *navmesh,
+  const point3f *point,
+  point3f *out)
+{
+  uint32_t below = NAVMESH_NONE, closest = NAVMESH_NONE;
+  float below_y = -FLT_MAX, closest_y = 0.f, closest_distance = FLT_MAX;
+  int32_t cell[2];
+  uint32_t index, result;
+
+  assert(navmesh && point);
+
+  if (!navmesh->starts)
+    return NAVMESH_NONE;
+
+  get_cell(navmesh, point->data[0], point->data[2], cell);
+  if (
+    cell[0] < 0 || cell[0] >= (int32_t)navmesh->cell_count[0] ||
+    cell[1] < 0 || cell[1] >= (int32_t)navmesh->cell_count[1])
+    return NAVMESH_NONE;
+
+  index = (uint32_t)cell[0] + (uint32_t)cell[1] * navmesh->cell_count[0];
+  for (
+    uint32_t i = navmesh->starts[index], last = navmesh->starts[index + 1];
+    i < last; ++i) {
+    const navmesh_polygon_t *polygon = navmesh->polygons + navmesh->cells[i];
+    float y;
+
+    if (
+      polygon->normal.data[1] <= 0.f ||
+      !contains_xz(navmesh, polygon, point))
+      continue;
+
+    y = (polygon->distance -
+      polygon->normal.data[0] * point->data[0] -
+      polygon->normal.data[2] * point->data[2]) / polygon->normal.data[1];
+
+    if (y <= point->data[1] + navmesh->step_height && y > below_y) {
+      below = navmesh->cells[i];
+      below_y = y;
+    }
+
+    if (fabsf(y - point->data[1]) < closest_distance) {
+      closest = navmesh->cells[i];
+      closest_y = y;
+      closest_distance = fabsf(y - point->data[1]);
+    }
+  }
+
+  result = below != NAVMESH_NONE ? below : closest;
+  if (out && result != NAVMESH_NONE)
+    vector3f_set_3f(
+      out,
+      point->data[0],
+      below != NAVMESH_NONE ? below_y : closest_y,
+      point->data[2]);
+  return result;
+}
+
+void
+navmesh_query_setup(
+  navmesh_query_t *query,
+  const navmesh_t *navmesh,
+  const allocator_t *allocator)
+{
+  uint32_t count;
+
+  assert(query && navmesh && allocator);
+
+  memset(query, 0, sizeof(navmesh_query_t));
+  count = query->polygon_count = navmesh->polygon_count;
+  query->open_capacity = navmesh->link_count + 1;
+  query->costs = allocator->mem_alloc(sizeof(float) * (count + 1));
+  query->positions = allocator->mem_alloc(sizeof(point3f) * (count + 1));
+  query->parents = allocator->mem_alloc(sizeof(uint32_t) * (count + 1));
+  query->via = allocator->mem_alloc(sizeof(uint32_t) * (count + 1));
+  query->opened = allocator->mem_alloc(sizeof(uint32_t) * (count + 1));
+  query->closed = allocator->mem_alloc(sizeof(uint32_t) * (count + 1));
+  query->corridor = allocator->mem_alloc(sizeof(uint32_t) * (count + 1));
+  query->open =
+    allocator->mem_alloc(sizeof(navmesh_open_t) * query->open_capacity);
+  memset(query->opened, 0, sizeof(uint32_t) * (count + 1));
+  memset(query->closed, 0, sizeof(uint32_t) * (count + 1));
+  query->status = NAVMESH_SEARCH_FAILED;
+}
+
+void
+navmesh_query_cleanup(
+  navmesh_query_t *query,
+  const allocator_t *allocator)
+{
+  assert(query && allocator);
+
+  if (query->costs) {
+    allocator->mem_free(query->costs);
+    allocator->mem_free(query->positions);
+    allocator->mem_free(query->parents);
+    allocator->mem_free(query->via);
+    allocator->mem_free(query->opened);
+    allocator->mem_free(query->closed);
+    allocator->mem_free(query->corridor);
+    allocator->mem_free(query->open);
+  }
+  memset(query, 0, sizeof(navmesh_query_t));
+}
+
+static
+void
+push_open(
+  navmesh_query_t *query,
+  const uint32_t polygon,
+  const float cost)
+{
+  navmesh_open_t *open = query->open;
+  uint32_t i = query->open_count++;
+
+  assert(query->open_count <= query->open_capacity);
+
+  for (; i; ) {
+    uint32_t parent = (i - 1) / 2;
+    if (open[parent].cost <= cost)
+      break;
+    open[i] = open[parent];
+    i = parent;
+  }
+
+  open[i].cost = cost;
+  open[i].polygon = polygon;
+}
+
+static
+uint32_t
+pop_open(navmesh_query_t *query)
+{
+  navmesh_open_t *open = query->open;
+  uint32_t polygon = open[0].polygon;
+  navmesh_open_t last = open[--query->open_count];
+  uint32_t i = 0;
+
+  for (;;) {
+    uint32_t child = i * 2 + 1;
+    if (child >= query->open_count)
+      break;
+    if (
+      child + 1 < query->open_count &&
+      open[child + 1].cost < open[child].cost)
+      ++child;
+    if (last.cost <= open[child].cost)
+      break;
+    open[i] = open[child];
+    i = child;
+  }
+
+  open[i] = last;
+  return polygon;
+}
+
+static
+point3f
+get_portal_middle(const navmesh_link_t *link)
+{
+  point3f middle = add_v3f(link->portal + 0, link->portal + 1);
+  mult_set_v3f(&middle, 0.5f);
+  return middle;
+}
+
+uint32_t
+navmesh_query_begin(
+  navmesh_query_t *query,
+  const navmesh_t *navmesh,
+  const point3f *start,
+  const point3f *goal)
+{
+  uint32_t polygon;
+
+  assert(query && navmesh && start && goal);
+  assert(query->polygon_count == navmesh->polygon_count);
+
+  // the stamps wrapped around, the stale entries must go.
+  if (++query->stamp == 0) {
+    memset(query->opened, 0, sizeof(uint32_t) * query->polygon_count);
+    memset(query->closed, 0, sizeof(uint32_t) * query->polygon_count);
+    query->stamp = 1;
+  }
+
+  query->open_count = 0;
+  query->expanded = 0;
+  query->start_polygon =
+    navmesh_find_polygon(navmesh, start, &query->start);
+  query->goal_polygon =
+    navmesh_find_polygon(navmesh, goal, &query->goal);
+
+  if (
+    query->start_polygon == NAVMESH_NONE ||
+    query->goal_polygon == NAVMESH_NONE) {
+    query->status = NAVMESH_SEARCH_FAILED;
+    return query->status;
+  }
+
+  polygon = query->start_polygon;
+  query->costs[polygon] = 0.f;
+  query->positions[polygon] = query->start;
+  query->parents[polygon] = NAVMESH_NONE;
+  query->via[polygon] = NAVMESH_NONE;
+  query->opened[polygon] = query->stamp;
+  push_open(query, polygon, get_distance(&query->start, &query->goal));
+  query->status = NAVMESH_SEARCH_RUNNING;
+  return query->status;
+}
+
+// NOTE: a polygon is reached at the middle of the portal it is entered from,
+// the cost is the length of the polyline through those middles. The straight
+// distance to the goal never overestimates it.
+uint32_t
+navmesh_query_step(
+  navmesh_query_t *query,
+  const navmesh_t *navmesh,
+  const uint32_t max_expansions)
+{
+  const uint32_t stamp = query->stamp;
+  uint32_t expansions = 0;
+
+  assert(query && navmesh);
+
+  if (query->status != NAVMESH_SEARCH_RUNNING)
+    return query->status;
+
+  while (expansions < max_expansions && query->open_count) {
+    uint32_t polygon = pop_open(query);
+    const navmesh_polygon_t *current = navmesh->polygons + polygon;
+
+    if (query->closed[polygon] == stamp)
+      continue;
+
+    query->closed[polygon] = stamp;
+    query->expanded++;
+    expansions++;
+
+    if (polygon == query->goal_polygon) {
+      query->status = NAVMESH_SEARCH_FOUND;
+      return query->status;
+    }
+
+    for (uint32_t i = 0; i < current->link_count; ++i) {
+      uint32_t index = current->first_link + i;
+      const navmesh_link_t *link = navmesh->links + index;
+      uint32_t next = link->polygon;
+      point3f middle;
+      float cost, estimate;
+
+      if (query->closed[next] == stamp)
+        continue;
+
+      middle = get_portal_middle(link);
+      cost =
+        query->costs[polygon] +
+        get_distance(query->positions + polygon, &middle);
+      estimate = get_distance(&middle, &query->goal);
+
+      // the last leg to the goal is known, it is part of the cost.
+      if (next == query->goal_polygon) {
+        cost += estimate;
+        estimate = 0.f;
+      }
+
+      if (query->opened[next] == stamp && cost >= query->costs[next])
+        continue;
+
+      query->opened[next] = stamp;
+      query->costs[next] = cost;
+      query->positions[next] = middle;
+      query->parents[next] = polygon;
+      query->via[next] = index;
+      push_open(query, next, cost + estimate);
+    }
+  }
+
+  if (!query->open_count)
+    query->status = NAVMESH_SEARCH_FAILED;
+  return query->status;
+}
+
+// the left and right ends of portal 'i' of the corridor, the ends on the
+// boundary are narrowed by the radius. The first and last portals are the start
+// and the goal.
+static
+void
+get_portal(
+  const navmesh_query_t *query,
+  const navmesh_t *navmesh,
+  const uint32_t count,
+  const uint32_t i,
+  point3f *left,
+  point3f *right)
+{
+  const navmesh_link_t *link;
+  const navmesh_polygon_t *from;
+  vector3f direction, left_shift, right_shift;
+  uint32_t left_corner, right_corner;
+  float width, shrink;
+
+  if (i == 0 || i == count + 1) {
+    *left = *right = i ? query->goal : query->start;
+    return;
+  }
+
+  link = navmesh->links + query->corridor[i - 1];
+  from = navmesh->polygons +
+    (i == 1 ?
+      query->start_polygon : navmesh->links[query->corridor[i - 2]].polygon);
+
+  if (triarea2(link->portal + 0, link->portal + 1, &from->center) > 0.f) {
+    *left = link->portal[0];
+    *right = link->portal[1];
+    left_corner = link->corners & 1;
+    right_corner = link->corners & 2;
+  } else {
+    *left = link->portal[1];
+    *right = link->portal[0];
+    left_corner = link->corners & 2;
+    right_corner = link->corners & 1;
+  }
+
+  direction = diff_v3f(right, left);
+  width = sqrtf(length_squared_v3f(&direction));
+  if (width <= 0.f)
+    return;
+
+  // both ends move in by at most half the width, they never cross.
+  shrink = fminf(navmesh->radius, width / 2.f);
+  mult_set_v3f(&direction, shrink / width);
+  left_shift = right_shift = direction;
+  if (left_corner)
+    add_set_v3f(left, &left_shift);
+  if (right_corner)
+    diff_set_v3f(right, &right_shift);
+}
+
+// the simple stupid funnel algorithm, the corridor portals are string pulled
+// in xz and the corners keep the height of the portal they come from.
+uint32_t
+navmesh_query_path(
+  navmesh_query_t *query,
+  const navmesh_t *navmesh,
+  point3f *path,
+  const uint32_t capacity)
+{
+  uint32_t count = 0, used = 0, portals;
+  uint32_t apex_index = 0, left_index = 0, right_index = 0;
+  point3f apex, funnel_left, funnel_right;
+
+  assert(query && navmesh && path);
+
+  if (query->status != NAVMESH_SEARCH_FOUND || !capacity)
+    return 0;
+
+  for (
+    uint32_t polygon = query->goal_polygon;
+    polygon != query->start_polygon;
+    polygon = query->parents[polygon])
+    query->corridor[count++] = query->via[polygon];
+
+  for (uint32_t i = 0; i < count / 2; ++i) {
+    uint32_t swap = query->corridor[i];
+    query->corridor[i] = query->corridor[count - 1 - i];
+    query->corridor[count - 1 - i] = swap;
+  }
+
+  portals = count + 2;
+  get_portal(query, navmesh, count, 0, &funnel_left, &funnel_right);
+  apex = funnel_left;
+  path[used++] = apex;
+
+  for (uint32_t i = 1; i < portals && used < capacity; ++i) {
+    point3f left, right;
+    get_portal(query, navmesh, count, i, &left, &right);
+
+    if (triarea2(&apex, &funnel_right, &right) <= 0.f) {
+      if (
+        is_same_point_xz(&apex, &funnel_right) ||
+        triarea2(&apex, &funnel_left, &right) > 0.f) {
+        funnel_right = right;
+        right_index = i;
+      } else {
+        path[used++] = funnel_left;
+        apex = funnel_left;
+        apex_index = left_index;
+        funnel_right = apex;
+        right_index = apex_index;
+        i = apex_index;
+        continue;
+      }
+    }
+
+    if (triarea2(&apex, &funnel_left, &left) >= 0.f) {
+      if (
+        is_same_point_xz(&apex, &funnel_left) ||
+        triarea2(&apex, &funnel_right, &left) < 0.f) {
+        funnel_left = left;
+        left_index = i;
+      } else {
+        path[used++] = funnel_right;
+        apex = funnel_right;
+        apex_index = right_index;
+        funnel_left = apex;
+        left_index = apex_index;
+        i = apex_index;
+        continue;
+      }
+    }
+  }
+
+  if (used < capacity && !is_same_point(path + used - 1, &query->goal))
+    path[used++] = query->goal;
+  return used;
+}
+
+uint32_t
+navmesh_find_path(
+  navmesh_query_t *query,
+  const navmesh_t *navmesh,
+  const point3f *start,
+  const point3f *goal,
+  point3f *path,
+  const uint32_t capacity)
+{
+  if (
+    navmesh_query_begin(query, navmesh, start, goal) ==
+    NAVMESH_SEARCH_RUNNING)
+    navmesh_query_step(query, navmesh, UINT32_MAX);
+
+  return navmesh_query_path(query, navmesh, path, capacity);
+}
+
+void
+navmesh_benchmark(
+  const navmesh_t *navmesh,
+  navmesh_query_t *query,
+  const uint32_t paths,
+  navmesh_stats_t *stats)
+{
+  point3f path[BENCH_PATH_CAPACITY];
+  uint64_t points = 0, expanded = 0;
+  double start;
+
+  assert(navmesh && query && stats);
+
+  memset(stats, 0, sizeof(navmesh_stats_t));
+  stats->polygons = navmesh->polygon_count;
+  stats->links = navmesh->link_count;
+  stats->step_links = navmesh->step_links;
+  stats->build_ms = navmesh->build_ms;
+  stats->bytes = (uint32_t)(
+    sizeof(navmesh_polygon_t) * navmesh->polygon_count +
+    sizeof(point3f) * navmesh->vertex_count +
+    sizeof(navmesh_link_t) * navmesh->link_count +
+    sizeof(uint32_t) *
+    (navmesh->cell_count[0] * navmesh->cell_count[1] + 1 +
+    (navmesh->starts ?
+      navmesh->starts[navmesh->cell_count[0] * navmesh->cell_count[1]] : 0)));
+
+  if (!navmesh->polygon_count || !paths)
+    return;
+
+  start = get_microseconds();
+  for (uint32_t i = 0; i < paths; ++i) {
+    uint32_t from = (uint32_t)(((uint64_t)i * 7919u) % navmesh->polygon_count);
+    uint32_t to = (uint32_t)(
+      ((uint64_t)i * 104729u + navmesh->polygon_count / 2) %
+      navmesh->polygon_count);
+    uint32_t count = navmesh_find_path(
+      query, navmesh,
+      &navmesh->polygons[from].center, &navmesh->polygons[to].center,
+      path, BENCH_PATH_CAPACITY);
+
+    stats->found += count != 0;
+    points += count;
+    expanded += query->expanded;
+  }
+
+  stats->paths = paths;
+  stats->paths_per_second =
+    paths / fmax((get_microseconds() - start) / 1000000.0, 1e-9);
+  stats->average_points = stats->found ? (float)points / stats->found : 0.f;
+  stats->average_expanded = (float)expanded / paths;
+}
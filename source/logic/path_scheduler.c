@@ -0,0 +1,377 @@
+/**
+ * @file path_scheduler.c
+ * @author khalilhenoud@gmail.com
+ * @brief queued navmesh path requests solved under a per frame time budget.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <game/logic/logic_utils.h>
+#include <game/logic/navmesh.h>
+#include <game/logic/path_scheduler.h>
+#include <game/threading/job_system.h>
+#include <library/allocator/allocator.h>
+
+
+typedef
+struct {
+  path_scheduler_t *scheduler;
+  double deadline;
+} path_round_t;
+
+static
+void
+get_cell(
+  const path_scheduler_t *scheduler,
+  const point3f *point,
+  int32_t cell[3])
+{
+  for (uint32_t axis = 0; axis < 3; ++axis)
+    cell[axis] = (int32_t)floorf(point->data[axis] / scheduler->cell_size);
+}
+
+static
+path_cache_entry_t *
+get_cache_set(
+  const path_scheduler_t *scheduler,
+  const int32_t cells[2][3])
+{
+  uint32_t hash = 2166136261u;
+  for (uint32_t i = 0; i < 6; ++i)
+    hash = (hash ^ (uint32_t)cells[i / 3][i % 3]) * 16777619u;
+  return
+    scheduler->cache +
+    (hash & (scheduler->set_count - 1)) * PATH_CACHE_WAYS;
+}
+
+static
+int32_t
+find_in_cache(
+  path_scheduler_t *scheduler,
+  path_request_t *request)
+{
+  path_cache_entry_t *set = get_cache_set(scheduler, request->cells);
+
+  for (uint32_t i = 0; i < PATH_CACHE_WAYS; ++i) {
+    path_cache_entry_t *entry = set + i;
+
+    if (
+      !entry->frame ||
+      memcmp(entry->cells, request->cells, sizeof(entry->cells)))
+      continue;
+
+    entry->frame = scheduler->frame;
+    request->count = entry->count;
+    memcpy(request->points, entry->points, sizeof(point3f) * entry->count);
+    if (request->count) {
+      request->points[0] = request->start;
+      request->points[request->count - 1] = request->goal;
+    }
+    request->status =
+      request->count ? PATH_REQUEST_FOUND : PATH_REQUEST_FAILED;
+    return 1;
+  }
+
+  return 0;
+}
+
+static
+void
+add_to_cache(
+  path_scheduler_t *scheduler,
+  const path_request_t *request)
+{
+  path_cache_entry_t *set = get_cache_set(scheduler, request->cells);
+  path_cache_entry_t *entry = set;
+
+  for (uint32_t i = 1; i < PATH_CACHE_WAYS && entry->frame; ++i)
+    entry = set[i].frame < entry->frame ? set + i : entry;
+
+  memcpy(entry->cells, request->cells, sizeof(entry->cells));
+  entry->frame = scheduler->frame;
+  entry->count = request->count;
+  memcpy(entry->points, request->points, sizeof(point3f) * request->count);
+}
+
+void
+path_scheduler_setup(
+  path_scheduler_t *scheduler,
+  const navmesh_t *navmesh,
+  const uint32_t capacity,
+  const uint32_t cache_sets,
+  const allocator_t *allocator)
+{
+  assert(scheduler && navmesh && capacity && allocator);
+
+  memset(scheduler, 0, sizeof(path_scheduler_t));
+  scheduler->navmesh = navmesh;
+  scheduler->capacity = capacity;
+  scheduler->allocator = allocator;
+  scheduler->requests =
+    allocator->mem_alloc(sizeof(path_request_t) * capacity);
+  scheduler->queue = allocator->mem_alloc(sizeof(uint32_t) * capacity);
+  memset(scheduler->requests, 0, sizeof(path_request_t) * capacity);
+
+  for (uint32_t i = 0; i < PATH_SCHEDULER_MAX_ACTIVE; ++i)
+    navmesh_query_setup(scheduler->queries + i, navmesh, allocator);
+
+  scheduler->set_count = 1;
+  while (scheduler->set_count < cache_sets)
+    scheduler->set_count *= 2;
+  scheduler->cache = allocator->mem_alloc(
+    sizeof(path_cache_entry_t) * scheduler->set_count * PATH_CACHE_WAYS);
+  path_scheduler_clear_cache(scheduler);
+
+  // the cached corners hold for any start and goal in the same cells.
+  scheduler->cell_size = navmesh->radius;
+}
+
+void
+path_scheduler_cleanup(path_scheduler_t *scheduler)
+{
+  const allocator_t *allocator;
+  assert(scheduler);
+
+  allocator = scheduler->allocator;
+  for (uint32_t i = 0; i < PATH_SCHEDULER_MAX_ACTIVE; ++i)
+    navmesh_query_cleanup(scheduler->queries + i, allocator);
+
+  allocator->mem_free(scheduler->requests);
+  allocator->mem_free(scheduler->queue);
+  allocator->mem_free(scheduler->cache);
+  memset(scheduler, 0, sizeof(path_scheduler_t));
+}
+
+void
+path_scheduler_clear_cache(path_scheduler_t *scheduler)
+{
+  assert(scheduler);
+
+  memset(
+    scheduler->cache, 0,
+    sizeof(path_cache_entry_t) * scheduler->set_count * PATH_CACHE_WAYS);
+}
+
+uint32_t
+path_scheduler_request(
+  path_scheduler_t *scheduler,
+  const point3f *start,
+  const point3f *goal)
+{
+  path_request_t *request = NULL;
+  uint32_t handle;
+
+  assert(scheduler && start && goal);
+
+  for (handle = 0; handle < scheduler->capacity; ++handle) {
+    if (scheduler->requests[handle].status == PATH_REQUEST_FREE) {
+      request = scheduler->requests + handle;
+      break;
+    }
+  }
+
+  if (!request)
+    return PATH_SCHEDULER_NONE;
+
+  // a free request is never in the queue, the queue cannot be full.
+  assert(scheduler->queue_count < scheduler->capacity);
+
+  request->start = *start;
+  request->goal = *goal;
+  request->count = 0;
+  request->status = PATH_REQUEST_QUEUED;
+  get_cell(scheduler, start, request->cells[0]);
+  get_cell(scheduler, goal, request->cells[1]);
+  scheduler->queue[
+    (scheduler->queue_first + scheduler->queue_count++) %
+    scheduler->capacity] = handle;
+  return handle;
+}
+
+uint32_t
+path_scheduler_status(
+  const path_scheduler_t *scheduler,
+  const uint32_t handle)
+{
+  assert(scheduler && handle < scheduler->capacity);
+  return scheduler->requests[handle].status;
+}
+
+const path_request_t *
+path_scheduler_get(
+  const path_scheduler_t *scheduler,
+  const uint32_t handle)
+{
+  assert(scheduler && handle < scheduler->capacity);
+  return scheduler->requests + handle;
+}
+
+void
+path_scheduler_release(
+  path_scheduler_t *scheduler,
+  const uint32_t handle)
+{
+  path_request_t *request;
+  assert(scheduler && handle < scheduler->capacity);
+
+  request = scheduler->requests + handle;
+
+  // the queue is compacted, a running search is dropped on the next update.
+  if (request->status == PATH_REQUEST_QUEUED) {
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < scheduler->queue_count; ++i) {
+      uint32_t from = (scheduler->queue_first + i) % scheduler->capacity;
+      uint32_t to = (scheduler->queue_first + used) % scheduler->capacity;
+      if (scheduler->queue[from] == handle)
+        continue;
+      scheduler->queue[to] = scheduler->queue[from];
+      ++used;
+    }
+    scheduler->queue_count = used;
+  }
+
+  request->status = PATH_REQUEST_FREE;
+}
+
+static
+void
+remove_active(
+  path_scheduler_t *scheduler,
+  const uint32_t index)
+{
+  // the queries are swapped, each keeps its own buffers.
+  uint32_t last = --scheduler->active_count;
+  navmesh_query_t query = scheduler->queries[index];
+  scheduler->queries[index] = scheduler->queries[last];
+  scheduler->queries[last] = query;
+  scheduler->active[index] = scheduler->active[last];
+}
+
+// starts the queued requests on the free queries, the cached ones and the ones
+// off the navmesh complete right away.
+static
+void
+start_requests(path_scheduler_t *scheduler)
+{
+  path_scheduler_stats_t *stats = &scheduler->stats;
+
+  while (
+    scheduler->queue_count &&
+    scheduler->active_count < PATH_SCHEDULER_MAX_ACTIVE) {
+    uint32_t handle = scheduler->queue[scheduler->queue_first];
+    path_request_t *request = scheduler->requests + handle;
+    navmesh_query_t *query = scheduler->queries + scheduler->active_count;
+
+    scheduler->queue_first = (scheduler->queue_first + 1) % scheduler->capacity;
+    scheduler->queue_count--;
+
+    if (find_in_cache(scheduler, request)) {
+      stats->cache_hits++;
+      continue;
+    }
+
+    stats->started++;
+    if (
+      navmesh_query_begin(
+        query, scheduler->navmesh, &request->start, &request->goal) !=
+      NAVMESH_SEARCH_RUNNING) {
+      request->status = PATH_REQUEST_FAILED;
+      stats->failed++;
+      add_to_cache(scheduler, request);
+      continue;
+    }
+
+    request->status = PATH_REQUEST_RUNNING;
+    scheduler->active[scheduler->active_count++] = handle;
+  }
+}
+
+static
+void
+advance_searches(uint32_t first, uint32_t last, void *user_data)
+{
+  path_round_t *round = (path_round_t *)user_data;
+  path_scheduler_t *scheduler = round->scheduler;
+
+  for (uint32_t i = first; i < last; ++i) {
+    navmesh_query_t *query = scheduler->queries + i;
+    while (
+      get_microseconds() < round->deadline &&
+      navmesh_query_step(query, scheduler->navmesh, PATH_SCHEDULER_SLICE) ==
+      NAVMESH_SEARCH_RUNNING);
+  }
+}
+
+// writes the paths of the completed searches and frees their queries.
+static
+void
+complete_searches(path_scheduler_t *scheduler)
+{
+  path_scheduler_stats_t *stats = &scheduler->stats;
+
+  for (uint32_t i = scheduler->active_count; i--;) {
+    navmesh_query_t *query = scheduler->queries + i;
+    path_request_t *request = scheduler->requests + scheduler->active[i];
+
+    if (query->status == NAVMESH_SEARCH_RUNNING)
+      continue;
+
+    stats->expanded += query->expanded;
+    request->count = navmesh_query_path(
+      query, scheduler->navmesh, request->points, PATH_SCHEDULER_MAX_POINTS);
+    request->status =
+      request->count ? PATH_REQUEST_FOUND : PATH_REQUEST_FAILED;
+    stats->found += request->count != 0;
+    stats->failed += request->count == 0;
+    add_to_cache(scheduler, request);
+    remove_active(scheduler, i);
+  }
+}
+
+void
+path_scheduler_update(
+  path_scheduler_t *scheduler,
+  const float budget_ms)
+{
+  path_scheduler_stats_t *stats;
+  double start = get_microseconds();
+  double budget_us = budget_ms * 1000.0;
+  path_round_t round;
+
+  assert(scheduler);
+
+  stats = &scheduler->stats;
+  memset(stats, 0, sizeof(path_scheduler_stats_t));
+  stats->budget_ms = budget_ms;
+  scheduler->frame++;
+
+  // the released requests leave their searches behind.
+  for (uint32_t i = scheduler->active_count; i--;)
+    if (
+      scheduler->requests[scheduler->active[i]].status !=
+      PATH_REQUEST_RUNNING)
+      remove_active(scheduler, i);
+
+  round.scheduler = scheduler;
+  for (uint32_t r = 0; r < PATH_SCHEDULER_ROUNDS; ++r) {
+    start_requests(scheduler);
+    if (!scheduler->active_count)
+      break;
+
+    round.deadline = start + budget_us * (r + 1) / PATH_SCHEDULER_ROUNDS;
+    parallel_for(scheduler->active_count, 1, advance_searches, &round);
+    complete_searches(scheduler);
+    stats->slices++;
+  }
+
+  // the expansions of the searches carried to the next frame are counted when
+  // they complete.
+  stats->running = scheduler->active_count;
+  stats->waiting = scheduler->queue_count;
+  stats->update_ms = (float)((get_microseconds() - start) / 1000.0);
+}
@@ -0,0 +1,305 @@
+/**
+ * @file plane_buckets.c
+ * @author khalilhenoud@gmail.com
+ * @brief groups the collision hits per plane using the mesh plane clusters.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <game/debug/color.h>
+#include <game/debug/face.h>
+#include <game/debug/flags.h>
+#include <game/logic/collision_mesh.h>
+#include <game/logic/collision_variant.h>
+#include <game/logic/logic_utils.h>
+#include <game/logic/plane_buckets.h>
+#include <collision/face.h>
+#include <spatial/bvh/bvh.h>
+
+
+#if !defined(COLLISION_RELEASE)
+// returns the position of the first entry of 'cluster' in 'sorted', or count.
+static
+uint32_t
+find_cluster(
+  const uint64_t *sorted,
+  const uint32_t count,
+  const uint32_t cluster)
+{
+  uint32_t low = 0, high = count;
+
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    if ((uint32_t)(sorted[middle] >> 32) < cluster)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  return (low < count && (uint32_t)(sorted[low] >> 32) == cluster) ?
+    low : count;
+}
+
+uint32_t
+sort_in_plane_buckets(
+  const collision_mesh_t *mesh,
+  intersection_info_t collision_info[256],
+  const uint32_t info_used,
+  plane_buckets_t *buckets)
+{
+  // cluster in the high bits, the position in 'collision_info' in the low.
+  uint64_t sorted[256];
+  intersection_info_t scratch[256];
+  uint32_t bucket_of[256];
+  uint32_t bucket_of_hit[256];
+
+  assert(mesh && buckets && info_used <= 256);
+
+  buckets->count = 0;
+  if (!info_used)
+    return 0;
+
+  for (uint32_t i = 0; i < info_used; ++i) {
+    uint32_t cluster = mesh->clusters[collision_info[i].bvh_face_index];
+    sorted[i] = ((uint64_t)cluster << 32) | i;
+  }
+
+  qsort(sorted, info_used, sizeof(uint64_t), compare_uint64);
+
+  // back to front, mirrors the reference face selection of 'sort_in_buckets'.
+  // the bucket of a cluster is stored at the sorted position of its first hit.
+  for (uint32_t i = 0; i < info_used; ++i)
+    bucket_of[i] = PLANE_BUCKET_NONE;
+
+  for (uint32_t i = info_used; i--;) {
+    uint32_t cluster = mesh->clusters[collision_info[i].bvh_face_index];
+    uint32_t first = find_cluster(sorted, info_used, cluster);
+    if (bucket_of[first] == PLANE_BUCKET_NONE) {
+      bucket_of[first] = buckets->count;
+      buckets->counts[buckets->count++] = 0;
+    }
+    buckets->counts[bucket_of[first]]++;
+    bucket_of_hit[i] = bucket_of[first];
+  }
+
+  for (uint32_t i = 0; i < info_used; ++i) {
+    uint32_t opposite;
+    uint32_t found;
+
+    if (bucket_of[i] == PLANE_BUCKET_NONE)
+      continue;
+
+    opposite = mesh->opposites[(uint32_t)(sorted[i] >> 32)];
+    found = opposite == PLANE_CLUSTER_NONE ?
+      info_used : find_cluster(sorted, info_used, opposite);
+    buckets->partners[bucket_of[i]] =
+      found == info_used ? PLANE_BUCKET_NONE : bucket_of[found];
+  }
+
+  {
+    uint32_t positions[256];
+    for (uint32_t i = 0, index = 0; i < buckets->count; ++i) {
+      buckets->offsets[i] = positions[i] = index;
+      index += buckets->counts[i];
+    }
+
+    for (uint32_t i = info_used; i--;)
+      scratch[positions[bucket_of_hit[i]]++] = collision_info[i];
+  }
+
+  memcpy(collision_info, scratch, sizeof(intersection_info_t) * info_used);
+  return buckets->count;
+}
+#endif
+
+/**
+ * Same as 'classify_buckets', returns 1 if the faces of 'bucket_index' are not
+ * all on one side of every other bucket matching 'flag', else 0. The removed
+ * buckets and 'excluded_index' are not considered.
+ */
+static
+int32_t
+is_bucket_split(
+  bvh_t *const bvh,
+  intersection_info_t collision_info[256],
+  const plane_buckets_t *buckets,
+  const uint8_t removed[256],
+  const collision_flags_t flag,
+  const uint32_t bucket_index,
+  const uint32_t excluded_index)
+{
+  const uint32_t first = buckets->offsets[bucket_index];
+  const uint32_t last = first + buckets->counts[bucket_index];
+
+  for (uint32_t i = 0; i < buckets->count; ++i) {
+    uint32_t reference = collision_info[buckets->offsets[i]].bvh_face_index;
+    uint32_t faces_in_front = 0, faces_to_back = 0;
+    face_t *face;
+    vector3f *normal;
+
+    if (i == bucket_index || i == excluded_index || removed[i])
+      continue;
+
+    if ((collision_info[buckets->offsets[i]].flags & flag) == 0)
+      continue;
+
+    face = cvector_as(&bvh->faces, reference, face_t);
+    normal = cvector_as(&bvh->normals, reference, vector3f);
+
+    for (uint32_t j = first; j < last; ++j) {
+      uint32_t points_in_front = 0, points_to_back = 0;
+      face_t *target =
+        cvector_as(&bvh->faces, collision_info[j].bvh_face_index, face_t);
+
+      for (uint32_t k = 0; k < 3; ++k) {
+        point_halfspace_classification_t classify =
+          classify_point_halfspace(face, normal, target->points + k);
+        points_in_front += (classify == POINT_IN_POSITIVE_HALFSPACE) ? 1 : 0;
+        points_to_back += (classify == POINT_IN_NEGATIVE_HALFSPACE) ? 1 : 0;
+      }
+
+      if (points_in_front && points_to_back)
+        return 1;
+      else if (points_to_back)
+        faces_to_back++;
+      else
+        faces_in_front++;
+
+      if (faces_in_front && faces_to_back)
+        return 1;
+    }
+  }
+
+  return 0;
+}
+
+static
+void
+remove_plane_bucket(
+  bvh_t *const bvh,
+  intersection_info_t collision_info[256],
+  const plane_buckets_t *buckets,
+  uint8_t removed[256],
+  const uint32_t bucket_index)
+{
+  removed[bucket_index] = 1;
+
+  if (!COLLISION_DEBUG_FLAG(draw_ignored_faces))
+    return;
+
+  for (
+    uint32_t i = buckets->offsets[bucket_index],
+    last = i + buckets->counts[bucket_index];
+    i < last; ++i) {
+    add_debug_face_to_frame(
+      cvector_as(&bvh->faces, collision_info[i].bvh_face_index, face_t),
+      cvector_as(&bvh->normals, collision_info[i].bvh_face_index, vector3f),
+      yellow, 2);
+  }
+}
+
+uint32_t
+COLLISION_VARIANT(process_plane_buckets)(
+  const collision_mesh_t *mesh,
+  intersection_info_t collision_info[256],
+  const uint32_t info_used,
+  plane_buckets_t *buckets)
+{
+  bvh_t *const bvh = mesh->bvh;
+  collision_flags_t flags[] = {
+    COLLIDED_WALLS_FLAG,
+    COLLIDED_FLOOR_FLAG | COLLIDED_CEILING_FLAG};
+  uint8_t removed[256] = { 0 };
+  uint32_t remap[256];
+  uint32_t used = 0, count = 0;
+
+  assert(buckets->count);
+
+  // a bucket has at most one partner and removals never create new pairs, a
+  // single ascending pass per flag meets the pairs in the pairwise order.
+  for (uint32_t findex = 0; findex < 2; ++findex) {
+    collision_flags_t flag = flags[findex];
+
+    for (uint32_t i = 0; i < buckets->count; ++i) {
+      uint32_t j = buckets->partners[i];
+
+      if (removed[i] || j == PLANE_BUCKET_NONE || j < i || removed[j])
+        continue;
+
+      if (
+        (collision_info[buckets->offsets[i]].flags & flag) == 0 ||
+        (collision_info[buckets->offsets[j]].flags & flag) == 0)
+        continue;
+
+      if (is_bucket_split(bvh, collision_info, buckets, removed, flag, i, j))
+        remove_plane_bucket(bvh, collision_info, buckets, removed, j);
+      else if (
+        is_bucket_split(bvh, collision_info, buckets, removed, flag, j, i))
+        remove_plane_bucket(bvh, collision_info, buckets, removed, i);
+      else {
+        remove_plane_bucket(bvh, collision_info, buckets, removed, i);
+        remove_plane_bucket(bvh, collision_info, buckets, removed, j);
+      }
+    }
+  }
+
+  // compact the surviving buckets in place, the order is preserved.
+  for (uint32_t i = 0; i < buckets->count; ++i) {
+    uint32_t offset = buckets->offsets[i];
+    uint32_t size = buckets->counts[i];
+
+    remap[i] = removed[i] ? PLANE_BUCKET_NONE : count;
+    if (removed[i])
+      continue;
+
+    if (used != offset)
+      memmove(
+        collision_info + used,
+        collision_info + offset,
+        sizeof(intersection_info_t) * size);
+
+    buckets->offsets[count] = used;
+    buckets->counts[count] = size;
+    buckets->partners[count] = buckets->partners[i];
+    used += size;
+    ++count;
+  }
+
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t partner = buckets->partners[i];
+    buckets->partners[i] =
+      partner == PLANE_BUCKET_NONE ? PLANE_BUCKET_NONE : remap[partner];
+  }
+
+  assert(used <= info_used);
+  buckets->count = count;
+  return used;
+}
+
+#if !defined(COLLISION_RELEASE)
+uint32_t
+process_plane_buckets_release(
+  const collision_mesh_t *mesh,
+  intersection_info_t collision_info[256],
+  const uint32_t info_used,
+  plane_buckets_t *buckets);
+
+uint32_t
+process_plane_buckets(
+  const collision_mesh_t *mesh,
+  intersection_info_t collision_info[256],
+  const uint32_t info_used,
+  plane_buckets_t *buckets)
+{
+  if (g_collision_variant == COLLISION_VARIANT_RELEASE)
+    return process_plane_buckets_release(
+      mesh, collision_info, info_used, buckets);
+
+  return process_plane_buckets_debug(mesh, collision_info, info_used, buckets);
+}
+#endif
@@ -0,0 +1,12 @@
+/**
+ * @file plane_buckets_release.c
+ * @author khalilhenoud@gmail.com
+ * @brief release variant of plane_buckets.c, see collision_variant.h.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#define COLLISION_RELEASE
+#include "plane_buckets.c"
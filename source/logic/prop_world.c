@@ -0,0 +1,712 @@
+/**
+ * @file prop_world.c
+ * @author khalilhenoud@gmail.com
+ * @brief rigid props colliding with the level and with each other, the resting
+ * islands are put to sleep.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <game/logic/bvh_query.h>
+#include <game/logic/collision_mesh.h>
+#include <game/logic/collision_utils.h>
+#include <game/logic/logic_utils.h>
+#include <game/logic/prop_world.h>
+#include <game/threading/job_system.h>
+#include <library/allocator/allocator.h>
+#include <collision/face.h>
+#include <spatial/bvh/bvh.h>
+
+#define INITIAL_CAPACITY          256
+#define BOUNDS_MULTIPLIER         1.025f
+#define FRICTION                  0.5f
+#define BAUMGARTE                 0.2f
+#define PENETRATION_SLOP          0.5f
+#define FACE_BATCH_SIZE           16
+#define DROP_LAYER_SIDE           16
+#define DROP_SPACING              3.f
+
+
+typedef
+struct {
+  const collision_mesh_t *mesh;
+  const prop_body_t *body;
+  uint32_t index;
+  prop_contact_t *contacts;
+  uint32_t count;
+} face_query_t;
+
+static
+void
+get_cell(
+  const prop_world_t *world,
+  const point3f *point,
+  int32_t cell[3])
+{
+  for (uint32_t axis = 0; axis < 3; ++axis)
+    cell[axis] = (int32_t)floorf(point->data[axis] / world->cell_size);
+}
+
+static
+uint32_t
+hash_cell(const int32_t x, const int32_t y, const int32_t z)
+{
+  uint32_t hash =
+    ((uint32_t)x * 73856093u) ^
+    ((uint32_t)y * 19349663u) ^
+    ((uint32_t)z * 83492791u);
+  return hash & (PROP_WORLD_BUCKETS - 1);
+}
+
+static
+void
+unlink_body(
+  prop_world_t *world,
+  const uint32_t index)
+{
+  prop_body_t *body = world->bodies + index;
+
+  if (body->previous != PROP_WORLD_NONE)
+    world->bodies[body->previous].next = body->next;
+  else
+    world->buckets[body->bucket] = body->next;
+
+  if (body->next != PROP_WORLD_NONE)
+    world->bodies[body->next].previous = body->previous;
+}
+
+static
+void
+link_body(
+  prop_world_t *world,
+  const uint32_t index)
+{
+  prop_body_t *body = world->bodies + index;
+  int32_t cell[3];
+
+  get_cell(world, &body->capsule.center, cell);
+  body->bucket = hash_cell(cell[0], cell[1], cell[2]);
+  body->previous = PROP_WORLD_NONE;
+  body->next = world->buckets[body->bucket];
+  if (body->next != PROP_WORLD_NONE)
+    world->bodies[body->next].previous = index;
+  world->buckets[body->bucket] = index;
+}
+
+void
+prop_world_setup(
+  prop_world_t *world,
+  const collision_mesh_t *mesh,
+  const uint32_t capacity,
+  const float max_radius,
+  const allocator_t *allocator)
+{
+  assert(world && capacity && max_radius > 0.f && allocator);
+
+  memset(world, 0, sizeof(prop_world_t));
+  world->mesh = mesh;
+  world->capacity = capacity;
+  world->cell_size = max_radius * 2.f;
+  world->allocator = allocator;
+  world->bodies = allocator->mem_alloc(sizeof(prop_body_t) * capacity);
+  world->awake = allocator->mem_alloc(sizeof(uint32_t) * capacity);
+  world->buckets =
+    allocator->mem_alloc(sizeof(uint32_t) * PROP_WORLD_BUCKETS);
+  world->face_contacts = allocator->mem_alloc(
+    sizeof(prop_contact_t) * capacity * PROP_MAX_FACE_CONTACTS);
+  world->face_counts = allocator->mem_alloc(sizeof(uint32_t) * capacity);
+  world->contact_capacity = INITIAL_CAPACITY;
+  world->contacts =
+    allocator->mem_alloc(sizeof(prop_contact_t) * world->contact_capacity);
+  world->cached =
+    allocator->mem_alloc(sizeof(prop_contact_t) * world->contact_capacity);
+
+  for (uint32_t i = 0; i < PROP_WORLD_BUCKETS; ++i)
+    world->buckets[i] = PROP_WORLD_NONE;
+}
+
+void
+prop_world_cleanup(prop_world_t *world)
+{
+  const allocator_t *allocator;
+  assert(world);
+
+  allocator = world->allocator;
+  allocator->mem_free(world->bodies);
+  allocator->mem_free(world->awake);
+  allocator->mem_free(world->buckets);
+  allocator->mem_free(world->face_contacts);
+  allocator->mem_free(world->face_counts);
+  allocator->mem_free(world->contacts);
+  allocator->mem_free(world->cached);
+  memset(world, 0, sizeof(prop_world_t));
+}
+
+uint32_t
+prop_world_add(
+  prop_world_t *world,
+  const prop_shape_t shape,
+  const point3f *position,
+  const vector3f *extents,
+  const float mass)
+{
+  prop_body_t *body;
+  uint32_t index;
+
+  assert(world && position && extents && mass > 0.f);
+
+  if (world->count == world->capacity)
+    return PROP_WORLD_NONE;
+
+  index = world->count++;
+  body = world->bodies + index;
+  memset(body, 0, sizeof(prop_body_t));
+  body->shape = shape;
+  body->extents = *extents;
+  body->inverse_mass = 1.f / mass;
+  body->capsule.center = *position;
+
+  if (shape == PROP_SHAPE_BOX) {
+    body->capsule.radius = fmaxf(extents->data[0], extents->data[2]);
+    body->capsule.half_height =
+      fmaxf(extents->data[1] - body->capsule.radius, 0.f);
+  } else {
+    body->capsule.radius = extents->data[0];
+    body->capsule.half_height =
+      shape == PROP_SHAPE_CAPSULE ? extents->data[1] : 0.f;
+  }
+
+  assert(
+    (body->capsule.radius + body->capsule.half_height) * 2.f <=
+    world->cell_size && "the prop is larger than the setup max radius!");
+
+  body->awake_index = PROP_WORLD_NONE;
+  link_body(world, index);
+  prop_world_wake(world, index);
+  return index;
+}
+
+void
+prop_world_wake(
+  prop_world_t *world,
+  const uint32_t index)
+{
+  prop_body_t *body;
+  assert(world && index < world->count);
+
+  body = world->bodies + index;
+  if (body->awake_index != PROP_WORLD_NONE)
+    return;
+
+  body->awake_index = world->awake_count;
+  body->sleep_time = 0.f;
+  world->awake[world->awake_count++] = index;
+  world->stats.woken++;
+}
+
+static
+void
+put_to_sleep(
+  prop_world_t *world,
+  const uint32_t index)
+{
+  prop_body_t *body = world->bodies + index;
+  uint32_t last = world->awake[--world->awake_count];
+
+  world->awake[body->awake_index] = last;
+  world->bodies[last].awake_index = body->awake_index;
+  body->awake_index = PROP_WORLD_NONE;
+  vector3f_set_1f(&body->velocity, 0.f);
+  world->stats.slept++;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static
+prop_contact_t *
+push_contact(prop_world_t *world)
+{
+  // both buffers keep the same capacity, they are swapped every step.
+  if (world->contact_count == world->contact_capacity) {
+    const allocator_t *allocator = world->allocator;
+    world->contact_capacity *= 2;
+    world->contacts = allocator->mem_realloc(
+      world->contacts, sizeof(prop_contact_t) * world->contact_capacity);
+    world->cached = allocator->mem_realloc(
+      world->cached, sizeof(prop_contact_t) * world->contact_capacity);
+  }
+
+  return world->contacts + world->contact_count++;
+}
+
+// NOTE: both capsules are upright, the closest points of their segments are
+// level when the segments overlap vertically, else they are the nearest ends.
+static
+int32_t
+get_capsule_contact(
+  const capsule_t *a,
+  const capsule_t *b,
+  vector3f *normal,
+  float *depth)
+{
+  float dy = a->center.data[1] - b->center.data[1];
+  float reach = a->half_height + b->half_height;
+  float radius = a->radius + b->radius;
+  float length;
+
+  vector3f_set_3f(
+    normal,
+    a->center.data[0] - b->center.data[0],
+    dy > reach ? dy - reach : (dy < -reach ? dy + reach : 0.f),
+    a->center.data[2] - b->center.data[2]);
+
+  length = length_squared_v3f(normal);
+  if (length >= radius * radius)
+    return 0;
+
+  length = sqrtf(length);
+  if (length > 0.f)
+    mult_set_v3f(normal, 1.f / length);
+  else
+    vector3f_set_3f(normal, 0.f, 1.f, 0.f);
+
+  *depth = radius - length;
+  return 1;
+}
+
+// pairs every awake prop with the props of the cells around it, the sleeping
+// ones it touches are woken and walked in turn.
+static
+void
+find_body_contacts(prop_world_t *world)
+{
+  for (uint32_t k = 0; k < world->awake_count; ++k) {
+    uint32_t i = world->awake[k];
+    prop_body_t *body = world->bodies + i;
+    int32_t cell[3];
+
+    get_cell(world, &body->capsule.center, cell);
+    world->stamp++;
+
+    for (int32_t z = cell[2] - 1; z <= cell[2] + 1; ++z) {
+      for (int32_t y = cell[1] - 1; y <= cell[1] + 1; ++y) {
+        for (int32_t x = cell[0] - 1; x <= cell[0] + 1; ++x) {
+          uint32_t j = world->buckets[hash_cell(x, y, z)];
+
+          for (; j != PROP_WORLD_NONE; j = world->bodies[j].next) {
+            prop_body_t *other = world->bodies + j;
+            prop_contact_t *contact;
+            vector3f normal;
+            float depth;
+
+            // buckets are shared by the hashed cells, a prop can show twice.
+            if (j == i || other->stamp == world->stamp)
+              continue;
+            other->stamp = world->stamp;
+
+            // the pairs of two awake props are made by the first one listed.
+            if (
+              other->awake_index != PROP_WORLD_NONE &&
+              other->awake_index < k)
+              continue;
+
+            if (!get_capsule_contact(
+              &body->capsule, &other->capsule, &normal, &depth))
+              continue;
+
+            prop_world_wake(world, j);
+
+            contact = push_contact(world);
+            memset(contact, 0, sizeof(prop_contact_t));
+            contact->a = i < j ? i : j;
+            contact->b = i < j ? j : i;
+            contact->depth = depth;
+            contact->normal = normal;
+            if (i > j)
+              mult_set_v3f(&contact->normal, -1.f);
+          }
+        }
+      }
+    }
+  }
+}
+
+static
+int32_t
+add_face_contact(uint32_t face_index, void *user_data)
+{
+  face_query_t *query = (face_query_t *)user_data;
+  bvh_t *bvh = query->mesh->bvh;
+  prop_contact_t *contact;
+  vector3f penetration;
+  point3f sphere_center;
+  float depth;
+
+  if (
+    classify_capsule_face(
+      &query->body->capsule,
+      cvector_as(&bvh->faces, face_index, face_t),
+      cvector_as(&bvh->normals, face_index, vector3f),
+      0,
+      &penetration,
+      &sphere_center) == CAPSULE_FACE_NO_COLLISION)
+    return 1;
+
+  depth = sqrtf(length_squared_v3f(&penetration));
+  if (depth <= 0.f)
+    return 1;
+
+  // the shallowest contact makes room once the slots are full.
+  if (query->count == PROP_MAX_FACE_CONTACTS) {
+    uint32_t shallowest = 0;
+    for (uint32_t i = 1; i < PROP_MAX_FACE_CONTACTS; ++i)
+      if (query->contacts[i].depth < query->contacts[shallowest].depth)
+        shallowest = i;
+    if (query->contacts[shallowest].depth >= depth)
+      return 1;
+    contact = query->contacts + shallowest;
+  } else
+    contact = query->contacts + query->count++;
+
+  memset(contact, 0, sizeof(prop_contact_t));
+  contact->a = query->index;
+  contact->b = PROP_CONTACT_WORLD | face_index;
+  contact->depth = depth;
+  contact->normal = penetration;
+  mult_set_v3f(&contact->normal, 1.f / depth);
+  return 1;
+}
+
+static
+void
+find_face_batch(uint32_t first, uint32_t last, void *user_data)
+{
+  prop_world_t *world = (prop_world_t *)user_data;
+
+  for (uint32_t k = first; k < last; ++k) {
+    face_query_t query;
+    bvh_aabb_t bounds;
+
+    query.mesh = world->mesh;
+    query.index = world->awake[k];
+    query.body = world->bodies + query.index;
+    query.contacts = world->face_contacts + k * PROP_MAX_FACE_CONTACTS;
+    query.count = 0;
+
+    populate_capsule_aabb(&bounds, &query.body->capsule, BOUNDS_MULTIPLIER);
+    bvh_query_faces(
+      world->mesh, &bounds, &query.body->capsule, add_face_contact, &query);
+    world->face_counts[k] = query.count;
+  }
+}
+
+static
+void
+find_face_contacts(prop_world_t *world)
+{
+  if (!world->mesh || !world->awake_count)
+    return;
+
+  // the queries only read the mesh, every awake prop owns its contact slots.
+  parallel_for(world->awake_count, FACE_BATCH_SIZE, find_face_batch, world);
+
+  for (uint32_t k = 0; k < world->awake_count; ++k) {
+    for (uint32_t i = 0; i < world->face_counts[k]; ++i) {
+      *push_contact(world) =
+        world->face_contacts[k * PROP_MAX_FACE_CONTACTS + i];
+      world->stats.face_contacts++;
+    }
+  }
+}
+
+static
+int
+compare_contacts(const void *lhs, const void *rhs)
+{
+  const prop_contact_t *a = (const prop_contact_t *)lhs;
+  const prop_contact_t *b = (const prop_contact_t *)rhs;
+
+  if (a->a != b->a)
+    return a->a < b->a ? -1 : 1;
+  return a->b < b->b ? -1 : (a->b > b->b ? 1 : 0);
+}
+
+// both lists are sorted, the impulses of the pairs that persist carry over.
+static
+void
+warm_start(prop_world_t *world)
+{
+  uint32_t i = 0, j = 0;
+
+  while (i < world->contact_count && j < world->cached_count) {
+    prop_contact_t *contact = world->contacts + i;
+    const prop_contact_t *cached = world->cached + j;
+    int result = compare_contacts(contact, cached);
+
+    if (result < 0)
+      ++i;
+    else if (result > 0)
+      ++j;
+    else {
+      contact->normal_impulse = cached->normal_impulse;
+      contact->friction_impulse = cached->friction_impulse;
+      world->stats.warm_started++;
+      ++i;
+      ++j;
+    }
+  }
+}
+
+static
+void
+apply_impulse(
+  prop_world_t *world,
+  const prop_contact_t *contact,
+  const vector3f *impulse)
+{
+  prop_body_t *a = world->bodies + contact->a;
+  vector3f delta = *impulse;
+
+  mult_set_v3f(&delta, a->inverse_mass);
+  add_set_v3f(&a->velocity, &delta);
+
+  if (!(contact->b & PROP_CONTACT_WORLD)) {
+    prop_body_t *b = world->bodies + contact->b;
+    delta = *impulse;
+    mult_set_v3f(&delta, b->inverse_mass);
+    diff_set_v3f(&b->velocity, &delta);
+  }
+}
+
+// NOTE: sequential impulses on the linear velocities, the penetration beyond
+// the slop is fed back as a velocity bias.
+static
+void
+solve_contacts(
+  prop_world_t *world,
+  const float delta_time)
+{
+  for (uint32_t i = 0; i < world->contact_count; ++i) {
+    const prop_contact_t *contact = world->contacts + i;
+    vector3f impulse = contact->normal;
+    mult_set_v3f(&impulse, contact->normal_impulse);
+    add_set_v3f(&impulse, &contact->friction_impulse);
+    apply_impulse(world, contact, &impulse);
+  }
+
+  for (uint32_t pass = 0; pass < PROP_SOLVER_ITERATIONS; ++pass) {
+    for (uint32_t i = 0; i < world->contact_count; ++i) {
+      prop_contact_t *contact = world->contacts + i;
+      prop_body_t *a = world->bodies + contact->a;
+      uint32_t is_world = contact->b & PROP_CONTACT_WORLD;
+      float mass = a->inverse_mass +
+        (is_world ? 0.f : world->bodies[contact->b].inverse_mass);
+      float bias = BAUMGARTE / delta_time *
+        fmaxf(contact->depth - PENETRATION_SLOP, 0.f);
+      vector3f relative = a->velocity;
+      vector3f tangent, impulse, total;
+      float speed, previous, limit, length;
+
+      if (!is_world)
+        diff_set_v3f(&relative, &world->bodies[contact->b].velocity);
+
+      speed = dot_product_v3f(&relative, &contact->normal);
+      previous = contact->normal_impulse;
+      contact->normal_impulse =
+        fmaxf(previous + (bias - speed) / mass, 0.f);
+      impulse = contact->normal;
+      mult_set_v3f(&impulse, contact->normal_impulse - previous);
+      apply_impulse(world, contact, &impulse);
+
+      // the friction cancels the sliding, within the cone of the normal.
+      relative = a->velocity;
+      if (!is_world)
+        diff_set_v3f(&relative, &world->bodies[contact->b].velocity);
+      tangent = contact->normal;
+      mult_set_v3f(
+        &tangent, dot_product_v3f(&relative, &contact->normal));
+      tangent = diff_v3f(&relative, &tangent);
+      mult_set_v3f(&tangent, -1.f / mass);
+
+      total = add_v3f(&contact->friction_impulse, &tangent);
+      limit = FRICTION * contact->normal_impulse;
+      length = sqrtf(length_squared_v3f(&total));
+      if (length > limit)
+        mult_set_v3f(&total, length > 0.f ? limit / length : 0.f);
+
+      impulse = diff_v3f(&total, &contact->friction_impulse);
+      contact->friction_impulse = total;
+      apply_impulse(world, contact, &impulse);
+    }
+  }
+}
+
+static
+uint32_t
+find_island(
+  prop_world_t *world,
+  uint32_t index)
+{
+  while (world->bodies[index].island != index) {
+    uint32_t parent = world->bodies[index].island;
+    world->bodies[index].island = world->bodies[parent].island;
+    index = parent;
+  }
+
+  return index;
+}
+
+// NOTE: the props touching each other form an island, an island sleeps once
+// all its props have been slow for PROP_SLEEP_TIME. Every prop contact is
+// between awake props, the sleeping ones were woken when met. 'stamp' marks
+// the roots of the islands with a prop still moving.
+static
+void
+update_islands(
+  prop_world_t *world,
+  const float delta_time)
+{
+  const float limit = PROP_SLEEP_SPEED * PROP_SLEEP_SPEED;
+
+  for (uint32_t k = 0; k < world->awake_count; ++k) {
+    prop_body_t *body = world->bodies + world->awake[k];
+    body->island = world->awake[k];
+    body->sleep_time = length_squared_v3f(&body->velocity) < limit ?
+      body->sleep_time + delta_time : 0.f;
+  }
+
+  for (uint32_t i = 0; i < world->contact_count; ++i) {
+    const prop_contact_t *contact = world->contacts + i;
+    uint32_t a, b;
+
+    if (contact->b & PROP_CONTACT_WORLD)
+      continue;
+
+    a = find_island(world, contact->a);
+    b = find_island(world, contact->b);
+    if (a != b)
+      world->bodies[a < b ? b : a].island = a < b ? a : b;
+  }
+
+  world->stamp++;
+  for (uint32_t k = 0; k < world->awake_count; ++k) {
+    uint32_t index = world->awake[k];
+    uint32_t root = find_island(world, index);
+    world->stats.islands += root == index;
+    if (world->bodies[index].sleep_time < PROP_SLEEP_TIME)
+      world->bodies[root].stamp = world->stamp;
+  }
+
+  // back to front, a removal moves an already visited prop into the slot.
+  for (uint32_t k = world->awake_count; k--;) {
+    uint32_t index = world->awake[k];
+    if (world->bodies[find_island(world, index)].stamp != world->stamp)
+      put_to_sleep(world, index);
+  }
+}
+
+void
+prop_world_step(
+  prop_world_t *world,
+  const float delta_time)
+{
+  double start = get_microseconds();
+  prop_contact_t *swap;
+
+  assert(world);
+
+  memset(&world->stats, 0, sizeof(prop_world_stats_t));
+  if (delta_time <= 0.f)
+    return;
+
+  for (uint32_t k = 0; k < world->awake_count; ++k)
+    world->bodies[world->awake[k]].velocity.data[1] -=
+      PROP_GRAVITY * delta_time;
+
+  swap = world->cached;
+  world->cached = world->contacts;
+  world->contacts = swap;
+  world->cached_count = world->contact_count;
+  world->contact_count = 0;
+
+  find_body_contacts(world);
+  find_face_contacts(world);
+  qsort(
+    world->contacts, world->contact_count,
+    sizeof(prop_contact_t), compare_contacts);
+  warm_start(world);
+  solve_contacts(world, delta_time);
+
+  for (uint32_t k = 0; k < world->awake_count; ++k) {
+    uint32_t index = world->awake[k];
+    prop_body_t *body = world->bodies + index;
+    vector3f displacement = body->velocity;
+    int32_t cell[3];
+
+    mult_set_v3f(&displacement, delta_time);
+    add_set_v3f(&body->capsule.center, &displacement);
+
+    get_cell(world, &body->capsule.center, cell);
+    if (hash_cell(cell[0], cell[1], cell[2]) != body->bucket) {
+      unlink_body(world, index);
+      link_body(world, index);
+    }
+  }
+
+  update_islands(world, delta_time);
+
+  world->stats.bodies = world->count;
+  world->stats.awake = world->awake_count;
+  world->stats.contacts = world->contact_count;
+  world->stats.step_ms = (float)((get_microseconds() - start) / 1000.0);
+}
+
+uint32_t
+prop_world_drop(
+  prop_world_t *world,
+  const point3f *center,
+  const uint32_t count,
+  const float size)
+{
+  const float spacing = size * DROP_SPACING;
+  uint32_t added = 0;
+
+  assert(world && center && size > 0.f);
+
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t layer = i / (DROP_LAYER_SIDE * DROP_LAYER_SIDE);
+    uint32_t x = i % DROP_LAYER_SIDE;
+    uint32_t z = (i / DROP_LAYER_SIDE) % DROP_LAYER_SIDE;
+    uint32_t shape = i % 3;
+    point3f position;
+    vector3f extents;
+
+    // every other layer is offset so the props do not stack in columns.
+    vector3f_set_3f(
+      &position,
+      center->data[0] +
+      (x - DROP_LAYER_SIDE / 2.f + (layer & 1) * 0.5f) * spacing,
+      center->data[1] + (layer + 1) * spacing,
+      center->data[2] +
+      (z - DROP_LAYER_SIDE / 2.f + (layer & 1) * 0.5f) * spacing);
+
+    if (shape == PROP_SHAPE_BOX)
+      vector3f_set_3f(&extents, size, size * 1.5f, size);
+    else if (shape == PROP_SHAPE_SPHERE)
+      vector3f_set_3f(&extents, size, 0.f, 0.f);
+    else
+      vector3f_set_3f(&extents, size * 0.75f, size * 0.75f, 0.f);
+
+    if (prop_world_add(
+      world, shape, &position, &extents, 1.f) == PROP_WORLD_NONE)
+      break;
+    ++added;
+  }
+
+  return added;
+}
@@ -0,0 +1,352 @@
+/**
+ * @file ray_query.c
+ * @author khalilhenoud@gmail.com
+ * @brief batched ray queries against the level bvh, traversed in packets.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <assert.h>
+#include <math.h>
+#include <game/logic/bvh_query.h>
+#include <game/logic/collision_mesh.h>
+#include <game/logic/ray_query.h>
+#include <game/threading/job_system.h>
+#include <library/allocator/allocator.h>
+#include <math/face.h>
+#include <spatial/bvh/bvh.h>
+
+#if \
+  defined(__SSE__) || \
+  defined(_M_X64) || \
+  defined(_M_AMD64) || \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define RAY_QUERY_SSE
+#include <xmmintrin.h>
+#endif
+
+#define DETERMINANT_EPSILON       1e-8f
+
+
+// 'active' is the lane mask of the rays still traversing, the any hit rays
+// leave it on their first hit. 't_max' shrinks as the closest hits are found.
+typedef
+struct {
+  float origin[3][RAY_PACKET_WIDTH];
+  float direction[3][RAY_PACKET_WIDTH];
+  float inverse[3][RAY_PACKET_WIDTH];
+  float t_max[RAY_PACKET_WIDTH];
+  uint32_t face[RAY_PACKET_WIDTH];
+  uint32_t active;
+} ray_packet_t;
+
+typedef
+struct {
+  const collision_mesh_t *mesh;
+  const ray_t *rays;
+  ray_hit_t *hits;
+  ray_query_mode_t mode;
+} ray_batch_t;
+
+static
+void
+load_packet(
+  ray_packet_t *packet,
+  const ray_t *rays,
+  const uint32_t count)
+{
+  packet->active = 0;
+
+  for (uint32_t lane = 0; lane < RAY_PACKET_WIDTH; ++lane) {
+    // the padding lanes are inactive and never reported.
+    const ray_t *ray = rays + (lane < count ? lane : 0);
+
+    for (uint32_t axis = 0; axis < 3; ++axis) {
+      packet->origin[axis][lane] = ray->origin.data[axis];
+      packet->direction[axis][lane] = ray->direction.data[axis];
+      packet->inverse[axis][lane] = 1.f / ray->direction.data[axis];
+    }
+    packet->t_max[lane] = ray->length;
+    packet->face[lane] = RAY_HIT_NONE;
+    packet->active |= (uint32_t)(lane < count) << lane;
+  }
+}
+
+// returns the lane mask of the rays entering 'bounds' before their 't_max'.
+static
+uint32_t
+packet_bounds_mask(
+  const ray_packet_t *packet,
+  const bvh_aabb_t *bounds)
+{
+#if defined(RAY_QUERY_SSE)
+  __m128 t_near = _mm_setzero_ps();
+  __m128 t_far = _mm_loadu_ps(packet->t_max);
+
+  for (uint32_t axis = 0; axis < 3; ++axis) {
+    __m128 origin = _mm_loadu_ps(packet->origin[axis]);
+    __m128 inverse = _mm_loadu_ps(packet->inverse[axis]);
+    __m128 t0 = _mm_mul_ps(
+      _mm_sub_ps(_mm_set1_ps(bounds->min_max[0].data[axis]), origin), inverse);
+    __m128 t1 = _mm_mul_ps(
+      _mm_sub_ps(_mm_set1_ps(bounds->min_max[1].data[axis]), origin), inverse);
+    t_near = _mm_max_ps(t_near, _mm_min_ps(t0, t1));
+    t_far = _mm_min_ps(t_far, _mm_max_ps(t0, t1));
+  }
+
+  return
+    (uint32_t)_mm_movemask_ps(_mm_cmple_ps(t_near, t_far)) & packet->active;
+#else
+  uint32_t mask = 0;
+
+  for (uint32_t lane = 0; lane < RAY_PACKET_WIDTH; ++lane) {
+    float t_near = 0.f, t_far = packet->t_max[lane];
+    for (uint32_t axis = 0; axis < 3; ++axis) {
+      float origin = packet->origin[axis][lane];
+      float inverse = packet->inverse[axis][lane];
+      float t0 = (bounds->min_max[0].data[axis] - origin) * inverse;
+      float t1 = (bounds->min_max[1].data[axis] - origin) * inverse;
+      t_near = fmaxf(t_near, fminf(t0, t1));
+      t_far = fminf(t_far, fmaxf(t0, t1));
+    }
+    mask |= (uint32_t)(t_near <= t_far) << lane;
+  }
+
+  return mask & packet->active;
+#endif
+}
+
+// moller-trumbore of the face against the 'mask' lanes, the hits closer than
+// 't_max' are written to 't'. Returns the lane mask of the hits.
+static
+uint32_t
+packet_face_mask(
+  const ray_packet_t *packet,
+  const face_t *face,
+  const uint32_t mask,
+  float t[RAY_PACKET_WIDTH])
+{
+  vector3f e1 = diff_v3f(face->points + 1, face->points + 0);
+  vector3f e2 = diff_v3f(face->points + 2, face->points + 0);
+
+#if defined(RAY_QUERY_SSE)
+  const __m128 sign = _mm_set1_ps(-0.f);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.f);
+  __m128 dx = _mm_loadu_ps(packet->direction[0]);
+  __m128 dy = _mm_loadu_ps(packet->direction[1]);
+  __m128 dz = _mm_loadu_ps(packet->direction[2]);
+  __m128 e1x = _mm_set1_ps(e1.data[0]);
+  __m128 e1y = _mm_set1_ps(e1.data[1]);
+  __m128 e1z = _mm_set1_ps(e1.data[2]);
+  __m128 e2x = _mm_set1_ps(e2.data[0]);
+  __m128 e2y = _mm_set1_ps(e2.data[1]);
+  __m128 e2z = _mm_set1_ps(e2.data[2]);
+  // p = d x e2
+  __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+  __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+  __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+  __m128 det = _mm_add_ps(
+    _mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)),
+    _mm_mul_ps(e1z, pz));
+  __m128 inv_det = _mm_div_ps(one, det);
+  // s = o - p0
+  __m128 sx = _mm_sub_ps(
+    _mm_loadu_ps(packet->origin[0]), _mm_set1_ps(face->points[0].data[0]));
+  __m128 sy = _mm_sub_ps(
+    _mm_loadu_ps(packet->origin[1]), _mm_set1_ps(face->points[0].data[1]));
+  __m128 sz = _mm_sub_ps(
+    _mm_loadu_ps(packet->origin[2]), _mm_set1_ps(face->points[0].data[2]));
+  __m128 u = _mm_mul_ps(
+    _mm_add_ps(
+      _mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)),
+    inv_det);
+  // q = s x e1
+  __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+  __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+  __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+  __m128 v = _mm_mul_ps(
+    _mm_add_ps(
+      _mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)),
+    inv_det);
+  __m128 hit_t = _mm_mul_ps(
+    _mm_add_ps(
+      _mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)),
+      _mm_mul_ps(e2z, qz)),
+    inv_det);
+  __m128 hit = _mm_cmpgt_ps(
+    _mm_andnot_ps(sign, det), _mm_set1_ps(DETERMINANT_EPSILON));
+  hit = _mm_and_ps(hit, _mm_cmpge_ps(u, zero));
+  hit = _mm_and_ps(hit, _mm_cmpge_ps(v, zero));
+  hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), one));
+  hit = _mm_and_ps(hit, _mm_cmpge_ps(hit_t, zero));
+  hit = _mm_and_ps(hit, _mm_cmplt_ps(hit_t, _mm_loadu_ps(packet->t_max)));
+  _mm_storeu_ps(t, hit_t);
+  return (uint32_t)_mm_movemask_ps(hit) & mask;
+#else
+  uint32_t result = 0;
+
+  for (uint32_t lane = 0; lane < RAY_PACKET_WIDTH; ++lane) {
+    vector3f d, s, p, q;
+    float det, inv_det, u, v;
+
+    if (!(mask & (1u << lane)))
+      continue;
+
+    vector3f_set_3f(
+      &d,
+      packet->direction[0][lane],
+      packet->direction[1][lane],
+      packet->direction[2][lane]);
+    vector3f_set_3f(
+      &s,
+      packet->origin[0][lane] - face->points[0].data[0],
+      packet->origin[1][lane] - face->points[0].data[1],
+      packet->origin[2][lane] - face->points[0].data[2]);
+
+    p = cross_product_v3f(&d, &e2);
+    det = dot_product_v3f(&e1, &p);
+    if (fabsf(det) <= DETERMINANT_EPSILON)
+      continue;
+
+    inv_det = 1.f / det;
+    u = dot_product_v3f(&s, &p) * inv_det;
+    if (u < 0.f || u > 1.f)
+      continue;
+
+    q = cross_product_v3f(&s, &e1);
+    v = dot_product_v3f(&d, &q) * inv_det;
+    if (v < 0.f || u + v > 1.f)
+      continue;
+
+    t[lane] = dot_product_v3f(&e2, &q) * inv_det;
+    if (t[lane] >= 0.f && t[lane] < packet->t_max[lane])
+      result |= 1u << lane;
+  }
+
+  return result;
+#endif
+}
+
+static
+void
+trace_packet(
+  const collision_mesh_t *mesh,
+  ray_packet_t *packet,
+  const ray_query_mode_t mode)
+{
+  bvh_t *bvh = mesh->bvh;
+  uint32_t local[BVH_QUERY_STACK_SIZE];
+  uint32_t *stack = local;
+  uint32_t capacity = BVH_QUERY_STACK_SIZE;
+  uint32_t used = 0;
+  float t[RAY_PACKET_WIDTH];
+
+  if (!bvh->nodes.size)
+    return;
+
+  stack[used++] = 0;
+
+  while (used && packet->active) {
+    bvh_node_t *node = cvector_as(&bvh->nodes, stack[--used], bvh_node_t);
+    uint32_t mask = packet_bounds_mask(packet, &node->bounds);
+
+    if (!mask)
+      continue;
+
+    if (!node->tri_count) {
+      // the children are allocated in pairs, the right follows the left.
+      if (used + 2 > capacity)
+        stack = bvh_stack_grow(
+          stack, local, &capacity, sizeof(uint32_t), mesh->allocator);
+      stack[used++] = node->left_first + 1;
+      stack[used++] = node->left_first;
+      continue;
+    }
+
+    for (
+      uint32_t i = node->left_first, last = i + node->tri_count;
+      i < last && mask; ++i) {
+      uint32_t hits = packet_face_mask(
+        packet, cvector_as(&bvh->faces, i, face_t), mask, t);
+
+      for (uint32_t lane = 0; hits; ++lane, hits >>= 1) {
+        if (!(hits & 1))
+          continue;
+
+        packet->t_max[lane] = t[lane];
+        packet->face[lane] = i;
+      }
+
+      if (mode == RAY_QUERY_ANY_HIT) {
+        for (uint32_t lane = 0; lane < RAY_PACKET_WIDTH; ++lane)
+          if (packet->face[lane] != RAY_HIT_NONE)
+            packet->active &= ~(1u << lane);
+        mask &= packet->active;
+      }
+    }
+  }
+
+  if (stack != local)
+    mesh->allocator->mem_free(stack);
+}
+
+void
+ray_query(
+  const collision_mesh_t *mesh,
+  const ray_t *rays,
+  ray_hit_t *hits,
+  const uint32_t count,
+  const ray_query_mode_t mode)
+{
+  ray_packet_t packet;
+
+  assert(mesh && ((rays && hits) || !count));
+
+  for (uint32_t first = 0; first < count; first += RAY_PACKET_WIDTH) {
+    uint32_t size = count - first;
+    size = size > RAY_PACKET_WIDTH ? RAY_PACKET_WIDTH : size;
+
+    load_packet(&packet, rays + first, size);
+    trace_packet(mesh, &packet, mode);
+
+    for (uint32_t lane = 0; lane < size; ++lane) {
+      hits[first + lane].t = packet.t_max[lane];
+      hits[first + lane].face_index = packet.face[lane];
+    }
+  }
+}
+
+static
+void
+query_batch(uint32_t first, uint32_t last, void *user_data)
+{
+  ray_batch_t *batch = (ray_batch_t *)user_data;
+  ray_query(
+    batch->mesh,
+    batch->rays + first,
+    batch->hits + first,
+    last - first,
+    batch->mode);
+}
+
+void
+ray_query_batch(
+  const collision_mesh_t *mesh,
+  const ray_t *rays,
+  ray_hit_t *hits,
+  const uint32_t count,
+  const ray_query_mode_t mode)
+{
+  ray_batch_t batch;
+
+  assert(mesh);
+
+  batch.mesh = mesh;
+  batch.rays = rays;
+  batch.hits = hits;
+  batch.mode = mode;
+  parallel_for(count, RAY_QUERY_BATCH_SIZE, query_batch, &batch);
+}
@@ -0,0 +1,102 @@
+/**
+ * @file sweep_validation.c
+ * @author khalilhenoud@gmail.com
+ * @brief compares the iterative and the closed form time of impact solvers.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <assert.h>
+#include <math.h>
+#include <game/logic/capsule_sweep.h>
+#include <game/logic/sweep_validation.h>
+#include <collision/face.h>
+#include <math/capsule.h>
+#include <math/face.h>
+
+#define SWEEP_RECORD_MAX_COUNT      1024
+#define SWEEP_TOLERANCE             0.05f
+
+
+typedef
+struct {
+  capsule_t capsule;
+  face_t face;
+  vector3f normal;
+  vector3f displacement;
+  uint32_t iterations;
+  float limit_distance;
+} recorded_sweep_t;
+
+typedef
+struct {
+  recorded_sweep_t sweeps[SWEEP_RECORD_MAX_COUNT];
+  uint32_t used;
+  uint32_t next;
+} sweep_recording_t;
+
+////////////////////////////////////////////////////////////////////////////////
+static sweep_recording_t recording;
+
+void
+sweep_validation_record(
+  const capsule_t *capsule,
+  const face_t *face,
+  const vector3f *normal,
+  const vector3f *displacement,
+  const uint32_t iterations,
+  const float limit_distance)
+{
+  recorded_sweep_t *sweep = recording.sweeps + recording.next;
+  sweep->capsule = *capsule;
+  sweep->face = *face;
+  sweep->normal = *normal;
+  sweep->displacement = *displacement;
+  sweep->iterations = iterations;
+  sweep->limit_distance = limit_distance;
+
+  recording.next = (recording.next + 1) % SWEEP_RECORD_MAX_COUNT;
+  recording.used += recording.used < SWEEP_RECORD_MAX_COUNT ? 1 : 0;
+}
+
+void
+sweep_validation_run(sweep_validation_stats_t *stats)
+{
+  float total_error;
+
+  assert(stats);
+  total_error = stats->mean_error * stats->sweeps;
+
+  for (uint32_t i = 0; i < recording.used; ++i) {
+    recorded_sweep_t *sweep = recording.sweeps + i;
+    float length = length_v3f(&sweep->displacement);
+    float iterative = find_capsule_face_intersection_time(
+      sweep->capsule,
+      &sweep->face,
+      &sweep->normal,
+      sweep->displacement,
+      sweep->iterations,
+      sweep->limit_distance);
+    float analytic = sweep_capsule_face_time(
+      &sweep->capsule,
+      &sweep->face,
+      &sweep->normal,
+      &sweep->displacement,
+      sweep->limit_distance);
+    float error = fabsf(iterative - analytic) * length;
+
+    // the bisection resolves the time to 1/2^iterations of the displacement.
+    float tolerance =
+      fmaxf(SWEEP_TOLERANCE, ldexpf(length, -(int32_t)sweep->iterations));
+
+    stats->sweeps++;
+    stats->mismatches += error > tolerance ? 1 : 0;
+    stats->max_error = fmaxf(stats->max_error, error);
+    total_error += error;
+  }
+
+  stats->mean_error = stats->sweeps ? total_error / stats->sweeps : 0.f;
+  recording.used = recording.next = 0;
+}
@@ -0,0 +1,514 @@
+/**
+ * @file trigger_set.c
+ * @author khalilhenoud@gmail.com
+ * @brief static trigger volumes binned in a grid, with overlap events.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <game/logic/logic_utils.h>
+#include <game/logic/trigger_set.h>
+#include <library/allocator/allocator.h>
+#include <math/capsule.h>
+
+#define INITIAL_CAPACITY          64
+#define CELL_SCALE                2.f
+#define BENCH_ITERATIONS          8
+#define BENCH_SPACING             8.f
+
+
+static
+void
+get_volume_bounds(
+  const trigger_volume_t *volume,
+  float bounds[6])
+{
+  const float *extents = volume->extents.data;
+  float half[3];
+
+  switch (volume->shape) {
+    case TRIGGER_SHAPE_BOX:
+      half[0] = extents[0];
+      half[1] = extents[1];
+      half[2] = extents[2];
+      break;
+    case TRIGGER_SHAPE_SPHERE:
+      half[0] = half[1] = half[2] = extents[0];
+      break;
+    default:
+      half[0] = half[2] = extents[0];
+      half[1] = extents[0] + extents[1];
+      break;
+  }
+
+  for (uint32_t axis = 0; axis < 3; ++axis) {
+    bounds[axis] = volume->center.data[axis] - half[axis];
+    bounds[axis + 3] = volume->center.data[axis] + half[axis];
+  }
+}
+
+static
+void
+get_capsule_bounds(
+  const capsule_t *capsule,
+  float bounds[6])
+{
+  float half[3] = {
+    capsule->radius,
+    capsule->radius + capsule->half_height,
+    capsule->radius };
+
+  for (uint32_t axis = 0; axis < 3; ++axis) {
+    bounds[axis] = capsule->center.data[axis] - half[axis];
+    bounds[axis + 3] = capsule->center.data[axis] + half[axis];
+  }
+}
+
+static
+int32_t
+bounds_overlap(const float *a, const float *b)
+{
+  return
+    a[0] <= b[3] && a[3] >= b[0] &&
+    a[1] <= b[4] && a[4] >= b[1] &&
+    a[2] <= b[5] && a[5] >= b[2];
+}
+
+// NOTE: the capsules are upright, the distance to their segment splits into a
+// vertical gap and a horizontal one so every test is exact.
+int32_t
+trigger_volume_overlaps(
+  const trigger_volume_t *volume,
+  const capsule_t *capsule)
+{
+  const float *center = volume->center.data;
+  const float *extents = volume->extents.data;
+  const float *point = capsule->center.data;
+  float radius = capsule->radius;
+  float dx, dy, dz;
+
+  if (volume->shape == TRIGGER_SHAPE_BOX) {
+    dx = fmaxf(0.f, fabsf(point[0] - center[0]) - extents[0]);
+    dz = fmaxf(0.f, fabsf(point[2] - center[2]) - extents[2]);
+    dy = fmaxf(
+      0.f, fabsf(point[1] - center[1]) - extents[1] - capsule->half_height);
+  } else {
+    float half_height = volume->shape == TRIGGER_SHAPE_CAPSULE ?
+      extents[1] : 0.f;
+    dx = point[0] - center[0];
+    dz = point[2] - center[2];
+    dy = fmaxf(
+      0.f,
+      fabsf(point[1] - center[1]) - half_height - capsule->half_height);
+    radius += extents[0];
+  }
+
+  return dx * dx + dy * dy + dz * dz <= radius * radius;
+}
+
+static
+void
+get_cell(
+  const trigger_set_t *set,
+  const float x,
+  const float z,
+  int32_t cell[2])
+{
+  const float inverse = set->inverse_cell_size;
+  cell[0] = (int32_t)floorf((x - set->origin[0]) * inverse);
+  cell[1] = (int32_t)floorf((z - set->origin[1]) * inverse);
+  cell[0] = cell[0] < 0 ? 0 : cell[0];
+  cell[1] = cell[1] < 0 ? 0 : cell[1];
+  cell[0] = cell[0] >= (int32_t)set->cell_count[0] ?
+    (int32_t)set->cell_count[0] - 1 : cell[0];
+  cell[1] = cell[1] >= (int32_t)set->cell_count[1] ?
+    (int32_t)set->cell_count[1] - 1 : cell[1];
+}
+
+static
+void
+build_grid(trigger_set_t *set)
+{
+  const allocator_t *allocator = set->allocator;
+  float min[2] = { FLT_MAX, FLT_MAX };
+  float max[2] = { -FLT_MAX, -FLT_MAX };
+  float average = 0.f;
+  uint32_t cell_count;
+  uint32_t *cursors;
+
+  for (uint32_t i = 0; i < set->volume_count; ++i) {
+    const float *bounds = set->bounds + i * 6;
+    min[0] = fminf(min[0], bounds[0]);
+    min[1] = fminf(min[1], bounds[2]);
+    max[0] = fmaxf(max[0], bounds[3]);
+    max[1] = fmaxf(max[1], bounds[5]);
+    average += fmaxf(bounds[3] - bounds[0], bounds[5] - bounds[2]);
+  }
+
+  // a volume spans a couple of cells at most on average.
+  set->cell_size = fmaxf(average / set->volume_count * CELL_SCALE, 1.f);
+  for (;;) {
+    uint64_t total = 1;
+    for (uint32_t k = 0; k < 2; ++k) {
+      set->cell_count[k] = (uint32_t)((max[k] - min[k]) / set->cell_size) + 1;
+      total *= set->cell_count[k];
+    }
+
+    if (total <= TRIGGER_SET_MAX_CELLS)
+      break;
+    set->cell_size *= 2.f;
+  }
+
+  set->origin[0] = min[0];
+  set->origin[1] = min[1];
+  set->inverse_cell_size = 1.f / set->cell_size;
+  cell_count = set->cell_count[0] * set->cell_count[1];
+  set->starts = allocator->mem_alloc(sizeof(uint32_t) * (cell_count + 1));
+  cursors = allocator->mem_alloc(sizeof(uint32_t) * cell_count);
+  memset(set->starts, 0, sizeof(uint32_t) * (cell_count + 1));
+
+  for (uint32_t pass = 0; pass < 2; ++pass) {
+    for (uint32_t i = 0; i < set->volume_count; ++i) {
+      const float *bounds = set->bounds + i * 6;
+      int32_t first[2], last[2];
+      get_cell(set, bounds[0], bounds[2], first);
+      get_cell(set, bounds[3], bounds[5], last);
+
+      for (int32_t z = first[1]; z <= last[1]; ++z) {
+        for (int32_t x = first[0]; x <= last[0]; ++x) {
+          uint32_t cell = (uint32_t)x + (uint32_t)z * set->cell_count[0];
+          if (pass)
+            set->cells[cursors[cell]++] = i;
+          else
+            set->starts[cell + 1]++;
+        }
+      }
+    }
+
+    if (pass)
+      break;
+
+    for (uint32_t i = 0; i < cell_count; ++i) {
+      set->starts[i + 1] += set->starts[i];
+      cursors[i] = set->starts[i];
+    }
+
+    set->cells = allocator->mem_alloc(
+      sizeof(uint32_t) * (set->starts[cell_count] + 1));
+  }
+
+  allocator->mem_free(cursors);
+}
+
+void
+trigger_set_setup(
+  trigger_set_t *set,
+  const trigger_volume_t *volumes,
+  const uint32_t count,
+  const allocator_t *allocator)
+{
+  assert(set && (volumes || !count) && allocator);
+
+  memset(set, 0, sizeof(trigger_set_t));
+  set->allocator = allocator;
+  set->volume_count = count;
+  set->volumes = allocator->mem_alloc(sizeof(trigger_volume_t) * (count + 1));
+  set->bounds = allocator->mem_alloc(sizeof(float) * 6 * (count + 1));
+  set->stamps = allocator->mem_alloc(sizeof(uint32_t) * (count + 1));
+  memset(set->stamps, 0, sizeof(uint32_t) * (count + 1));
+  if (count)
+    memcpy(set->volumes, volumes, sizeof(trigger_volume_t) * count);
+
+  for (uint32_t i = 0; i < count; ++i)
+    get_volume_bounds(set->volumes + i, set->bounds + i * 6);
+
+  set->pair_capacity = set->event_capacity = INITIAL_CAPACITY;
+  set->pairs = allocator->mem_alloc(sizeof(uint64_t) * set->pair_capacity);
+  set->previous = allocator->mem_alloc(sizeof(uint64_t) * set->pair_capacity);
+  set->events =
+    allocator->mem_alloc(sizeof(trigger_event_t) * set->event_capacity);
+
+  if (count)
+    build_grid(set);
+}
+
+void
+trigger_set_cleanup(trigger_set_t *set)
+{
+  const allocator_t *allocator;
+  assert(set);
+
+  allocator = set->allocator;
+  allocator->mem_free(set->volumes);
+  allocator->mem_free(set->bounds);
+  allocator->mem_free(set->stamps);
+  allocator->mem_free(set->pairs);
+  allocator->mem_free(set->previous);
+  allocator->mem_free(set->events);
+  if (set->starts) {
+    allocator->mem_free(set->starts);
+    allocator->mem_free(set->cells);
+  }
+  memset(set, 0, sizeof(trigger_set_t));
+}
+
+static
+void
+push_pair(
+  trigger_set_t *set,
+  const uint32_t volume,
+  const uint32_t actor)
+{
+  // both buffers keep the same capacity, they are swapped every update.
+  if (set->pair_count == set->pair_capacity) {
+    const allocator_t *allocator = set->allocator;
+    set->pair_capacity *= 2;
+    set->pairs = allocator->mem_realloc(
+      set->pairs, sizeof(uint64_t) * set->pair_capacity);
+    set->previous = allocator->mem_realloc(
+      set->previous, sizeof(uint64_t) * set->pair_capacity);
+  }
+
+  set->pairs[set->pair_count++] = ((uint64_t)volume << 32) | actor;
+}
+
+static
+void
+push_event(
+  trigger_set_t *set,
+  const uint32_t type,
+  const uint64_t pair)
+{
+  trigger_event_t *event;
+
+  if (set->event_count == set->event_capacity) {
+    set->event_capacity *= 2;
+    set->events = set->allocator->mem_realloc(
+      set->events, sizeof(trigger_event_t) * set->event_capacity);
+  }
+
+  event = set->events + set->event_count++;
+  event->type = type;
+  event->volume = (uint32_t)(pair >> 32);
+  event->actor = (uint32_t)pair;
+  set->stats.events[type]++;
+}
+
+static
+void
+test_volume(
+  trigger_set_t *set,
+  const uint32_t volume,
+  const uint32_t actor,
+  const capsule_t *capsule,
+  const float *bounds)
+{
+  set->stats.tested++;
+  if (
+    bounds_overlap(set->bounds + volume * 6, bounds) &&
+    trigger_volume_overlaps(set->volumes + volume, capsule))
+    push_pair(set, volume, actor);
+}
+
+// writes the sorted overlaps of the actors to 'pairs', through the grid or by
+// testing every volume.
+static
+void
+collect_pairs(
+  trigger_set_t *set,
+  const capsule_t *actors,
+  const uint32_t actor_count,
+  const int32_t use_grid)
+{
+  set->pair_count = 0;
+
+  for (uint32_t a = 0; a < actor_count && set->volume_count; ++a) {
+    float bounds[6];
+    int32_t first[2], last[2];
+    uint32_t span;
+
+    get_capsule_bounds(actors + a, bounds);
+    get_cell(set, bounds[0], bounds[2], first);
+    get_cell(set, bounds[3], bounds[5], last);
+    span = (uint32_t)(last[0] - first[0] + 1) * (last[1] - first[1] + 1);
+
+    if (!use_grid || span > TRIGGER_SET_MAX_QUERY_CELLS) {
+      for (uint32_t i = 0; i < set->volume_count; ++i)
+        test_volume(set, i, a, actors + a, bounds);
+      continue;
+    }
+
+    // the stamps wrapped around, the stale ones must go.
+    if (++set->stamp == 0) {
+      memset(set->stamps, 0, sizeof(uint32_t) * set->volume_count);
+      set->stamp = 1;
+    }
+
+    set->stats.cells += span;
+    for (int32_t z = first[1]; z <= last[1]; ++z) {
+      for (int32_t x = first[0]; x <= last[0]; ++x) {
+        uint32_t cell = (uint32_t)x + (uint32_t)z * set->cell_count[0];
+        for (
+          uint32_t i = set->starts[cell], end = set->starts[cell + 1];
+          i < end; ++i) {
+          uint32_t volume = set->cells[i];
+          if (set->stamps[volume] == set->stamp)
+            continue;
+          set->stamps[volume] = set->stamp;
+          test_volume(set, volume, a, actors + a, bounds);
+        }
+      }
+    }
+  }
+
+  qsort(set->pairs, set->pair_count, sizeof(uint64_t), compare_uint64);
+}
+
+void
+trigger_set_update(
+  trigger_set_t *set,
+  const capsule_t *actors,
+  const uint32_t actor_count)
+{
+  double start = get_microseconds();
+  uint64_t *swap;
+  uint32_t i = 0, j = 0;
+
+  assert(set && (actors || !actor_count));
+
+  memset(&set->stats, 0, sizeof(trigger_set_stats_t));
+  set->stats.actors = actor_count;
+  set->event_count = 0;
+
+  swap = set->previous;
+  set->previous = set->pairs;
+  set->pairs = swap;
+  set->previous_count = set->pair_count;
+  collect_pairs(set, actors, actor_count, 1);
+
+  // both lists are sorted, a merge tells the new, kept and lost overlaps.
+  while (i < set->pair_count || j < set->previous_count) {
+    if (j == set->previous_count || (
+      i < set->pair_count && set->pairs[i] < set->previous[j]))
+      push_event(set, TRIGGER_EVENT_ENTER, set->pairs[i++]);
+    else if (i == set->pair_count || set->previous[j] < set->pairs[i])
+      push_event(set, TRIGGER_EVENT_EXIT, set->previous[j++]);
+    else {
+      push_event(set, TRIGGER_EVENT_STAY, set->pairs[i++]);
+      ++j;
+    }
+  }
+
+  set->stats.pairs = set->pair_count;
+  set->stats.update_us = (float)(get_microseconds() - start);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static
+uint32_t
+next_random(uint32_t *seed)
+{
+  // xorshift32, the seed must not be 0.
+  *seed ^= *seed << 13;
+  *seed ^= *seed >> 17;
+  *seed ^= *seed << 5;
+  return *seed;
+}
+
+// returns a value in [0, 1].
+static
+float
+next_unit(uint32_t *seed)
+{
+  return (float)(next_random(seed) & 0xffff) / 65535.f;
+}
+
+void
+trigger_set_benchmark(
+  const uint32_t actor_count,
+  const float actor_radius,
+  const allocator_t *allocator,
+  trigger_set_bench_t *bench)
+{
+  const uint32_t counts[3] = { 256, 1024, 4096 };
+  trigger_volume_t *volumes =
+    allocator->mem_alloc(sizeof(trigger_volume_t) * counts[2]);
+  capsule_t *actors =
+    allocator->mem_alloc(sizeof(capsule_t) * (actor_count + 1));
+  // every actor overlapping every volume bounds the pairs of any count.
+  uint64_t *expected =
+    allocator->mem_alloc(sizeof(uint64_t) * (counts[2] * actor_count + 1));
+  uint32_t expected_count;
+  uint32_t seed = 0x9e3779b9u;
+
+  assert(allocator && bench && actor_radius > 0.f);
+
+  memset(bench, 0, sizeof(trigger_set_bench_t));
+
+  for (uint32_t k = 0; k < 3; ++k) {
+    float side = sqrtf((float)counts[k]) * actor_radius * BENCH_SPACING;
+    trigger_set_t set;
+    double start;
+
+    for (uint32_t i = 0; i < counts[k]; ++i) {
+      trigger_volume_t *volume = volumes + i;
+      volume->shape = i % 3;
+      volume->id = i;
+      vector3f_set_3f(
+        &volume->center,
+        next_unit(&seed) * side,
+        next_unit(&seed) * actor_radius * 4.f,
+        next_unit(&seed) * side);
+      vector3f_set_3f(
+        &volume->extents,
+        actor_radius * (1.f + next_unit(&seed) * 3.f),
+        actor_radius * (1.f + next_unit(&seed) * 3.f),
+        actor_radius * (1.f + next_unit(&seed) * 3.f));
+    }
+
+    for (uint32_t i = 0; i < actor_count; ++i) {
+      actors[i].radius = actor_radius;
+      actors[i].half_height = actor_radius;
+      vector3f_set_3f(
+        &actors[i].center,
+        next_unit(&seed) * side,
+        next_unit(&seed) * actor_radius * 4.f,
+        next_unit(&seed) * side);
+    }
+
+    trigger_set_setup(&set, volumes, counts[k], allocator);
+
+    start = get_microseconds();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; ++i)
+      trigger_set_update(&set, actors, actor_count);
+    bench->grid_us[k] =
+      (float)((get_microseconds() - start) / BENCH_ITERATIONS);
+
+    memcpy(expected, set.pairs, sizeof(uint64_t) * set.pair_count);
+    expected_count = set.pair_count;
+
+    start = get_microseconds();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; ++i)
+      collect_pairs(&set, actors, actor_count, 0);
+    bench->brute_us[k] =
+      (float)((get_microseconds() - start) / BENCH_ITERATIONS);
+
+    bench->mismatches +=
+      expected_count != set.pair_count ||
+      memcmp(expected, set.pairs, sizeof(uint64_t) * expected_count);
+
+    bench->counts[k] = counts[k];
+    trigger_set_cleanup(&set);
+  }
+
+  allocator->mem_free(expected);
+  allocator->mem_free(actors);
+  allocator->mem_free(volumes);
+}
@@ -0,0 +1,653 @@
+/**
+ * @file wide_bvh.c
+ * @author khalilhenoud@gmail.com
+ * @brief 4 wide bvh with quantized child bounds, one node per cache line.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <game/logic/collision_mesh.h>
+#include <game/logic/collision_utils.h>
+#include <game/logic/wide_bvh.h>
+#include <library/allocator/allocator.h>
+#include <math/capsule.h>
+#include <math/face.h>
+
+#if \
+  defined(__SSE2__) || \
+  defined(_M_X64) || \
+  defined(_M_AMD64) || \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WIDE_BVH_SSE2
+#include <emmintrin.h>
+#endif
+
+#define QUANTIZED_MAX             65535.f
+#define CACHE_LINE_SIZE           64
+#define MAX_LINES_PER_QUERY       512
+
+
+// a binary node, or a range of faces split off a leaf too large for a child
+// when 'node' is WIDE_BVH_EMPTY.
+typedef
+struct {
+  uint32_t node;
+  uint32_t first;
+  uint32_t count;
+  bvh_aabb_t bounds;
+} item_t;
+
+typedef
+struct {
+  const bvh_t *bvh;
+  wide_bvh_node_t *nodes;
+  uint32_t count;
+  uint32_t capacity;
+  const allocator_t *allocator;
+} converter_t;
+
+static
+float
+get_area(const bvh_aabb_t *bounds)
+{
+  vector3f size = diff_v3f(bounds->min_max + 1, bounds->min_max + 0);
+  return 2.f * (
+    size.data[0] * size.data[1] +
+    size.data[1] * size.data[2] +
+    size.data[2] * size.data[0]);
+}
+
+static
+float
+get_step(const bvh_aabb_t *bounds, const uint32_t axis)
+{
+  return
+    (bounds->min_max[1].data[axis] - bounds->min_max[0].data[axis]) /
+    QUANTIZED_MAX;
+}
+
+static
+uint16_t
+quantize(const float value, const float origin, const float step, float round)
+{
+  float q = step > 0.f ? (value - origin) / step : 0.f;
+  q = round < 0.f ? floorf(q) - 1.f : ceilf(q) + 1.f;
+  q = q < 0.f ? 0.f : (q > QUANTIZED_MAX ? QUANTIZED_MAX : q);
+  return (uint16_t)q;
+}
+
+static
+void
+decode_child(
+  const wide_bvh_node_t *node,
+  const bvh_aabb_t *node_bounds,
+  const uint32_t child,
+  bvh_aabb_t *out)
+{
+  for (uint32_t axis = 0; axis < 3; ++axis) {
+    float origin = node_bounds->min_max[0].data[axis];
+    float step = get_step(node_bounds, axis);
+    out->min_max[0].data[axis] = origin + node->min[axis][child] * step;
+    out->min_max[1].data[axis] = origin + node->max[axis][child] * step;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static
+int32_t
+is_binary_leaf(const bvh_t *bvh, const uint32_t node)
+{
+  return cvector_as(&bvh->nodes, node, bvh_node_t)->tri_count != 0;
+}
+
+static
+int32_t
+is_leaf_item(const bvh_t *bvh, const item_t *item)
+{
+  return
+    (item->node == WIDE_BVH_EMPTY || is_binary_leaf(bvh, item->node)) &&
+    item->count <= WIDE_BVH_MAX_LEAF_SIZE;
+}
+
+static
+item_t
+get_node_item(const bvh_t *bvh, const uint32_t index)
+{
+  const bvh_node_t *node = cvector_as(&bvh->nodes, index, bvh_node_t);
+  item_t item;
+  item.node = index;
+  item.first = node->left_first;
+  item.count = node->tri_count;
+  item.bounds = node->bounds;
+  return item;
+}
+
+static
+item_t
+get_range_item(const bvh_t *bvh, const uint32_t first, const uint32_t count)
+{
+  item_t item;
+  item.node = WIDE_BVH_EMPTY;
+  item.first = first;
+  item.count = count;
+  item.bounds = *cvector_as(&bvh->bounds, first, bvh_aabb_t);
+
+  for (uint32_t i = first + 1; i < first + count; ++i) {
+    bvh_aabb_t merged;
+    merge_aabb(&merged, &item.bounds, cvector_as(&bvh->bounds, i, bvh_aabb_t));
+    item.bounds = merged;
+  }
+
+  return item;
+}
+
+static
+void
+expand_item(const bvh_t *bvh, const item_t *item, item_t out[2])
+{
+  if (item->node != WIDE_BVH_EMPTY && !is_binary_leaf(bvh, item->node)) {
+    uint32_t left = cvector_as(&bvh->nodes, item->node, bvh_node_t)->left_first;
+    out[0] = get_node_item(bvh, left);
+    out[1] = get_node_item(bvh, left + 1);
+  } else {
+    uint32_t half = item->count / 2;
+    out[0] = get_range_item(bvh, item->first, half);
+    out[1] = get_range_item(bvh, item->first + half, item->count - half);
+  }
+}
+
+/**
+ * Pulls the children of 'item' up until there are WIDE_BVH_WIDTH of them or
+ * all are leaves, the largest child is opened first. Returns the count.
+ */
+static
+uint32_t
+gather_children(
+  const bvh_t *bvh,
+  const item_t *item,
+  item_t children[WIDE_BVH_WIDTH])
+{
+  uint32_t count = 2;
+  expand_item(bvh, item, children);
+
+  while (count < WIDE_BVH_WIDTH) {
+    uint32_t best = WIDE_BVH_EMPTY;
+    float best_area = -1.f;
+    item_t split[2];
+
+    for (uint32_t i = 0; i < count; ++i) {
+      float area = get_area(&children[i].bounds);
+      if (!is_leaf_item(bvh, children + i) && area > best_area) {
+        best = i;
+        best_area = area;
+      }
+    }
+
+    if (best == WIDE_BVH_EMPTY)
+      break;
+
+    expand_item(bvh, children + best, split);
+    children[best] = split[0];
+    children[count++] = split[1];
+  }
+
+  return count;
+}
+
+static
+uint32_t
+allocate_node(converter_t *converter)
+{
+  if (converter->count == converter->capacity) {
+    converter->capacity *= 2;
+    converter->nodes = converter->allocator->mem_realloc(
+      converter->nodes, sizeof(wide_bvh_node_t) * converter->capacity);
+  }
+
+  return converter->count++;
+}
+
+static
+uint32_t
+convert(
+  converter_t *converter,
+  const item_t *children,
+  const uint32_t count,
+  const bvh_aabb_t *bounds)
+{
+  const bvh_t *bvh = converter->bvh;
+  uint32_t index = allocate_node(converter);
+  wide_bvh_node_t node;
+
+  for (uint32_t i = 0; i < WIDE_BVH_WIDTH; ++i) {
+    const item_t *child = children + i;
+    bvh_aabb_t decoded;
+
+    if (i >= count) {
+      for (uint32_t axis = 0; axis < 3; ++axis) {
+        node.min[axis][i] = (uint16_t)QUANTIZED_MAX;
+        node.max[axis][i] = 0;
+      }
+      node.children[i] = WIDE_BVH_EMPTY;
+      continue;
+    }
+
+    for (uint32_t axis = 0; axis < 3; ++axis) {
+      float origin = bounds->min_max[0].data[axis];
+      float step = get_step(bounds, axis);
+      node.min[axis][i] =
+        quantize(child->bounds.min_max[0].data[axis], origin, step, -1.f);
+      node.max[axis][i] =
+        quantize(child->bounds.min_max[1].data[axis], origin, step, 1.f);
+    }
+
+    if (is_leaf_item(bvh, child)) {
+      assert(child->first < (1u << (31 - WIDE_BVH_LEAF_COUNT_BITS)));
+      node.children[i] =
+        WIDE_BVH_LEAF_BIT |
+        (child->first << WIDE_BVH_LEAF_COUNT_BITS) |
+        (child->count - 1);
+      continue;
+    }
+
+    // the grand children are quantized against what the traversal decodes.
+    {
+      item_t grand_children[WIDE_BVH_WIDTH];
+      uint32_t grand_count = gather_children(bvh, child, grand_children);
+      decode_child(&node, bounds, i, &decoded);
+      node.children[i] =
+        convert(converter, grand_children, grand_count, &decoded);
+    }
+  }
+
+  converter->nodes[index] = node;
+  return index;
+}
+
+void
+wide_bvh_setup(
+  wide_bvh_t *wide,
+  const bvh_t *bvh,
+  const uint32_t revision,
+  const allocator_t *allocator)
+{
+  converter_t converter;
+  item_t root, children[WIDE_BVH_WIDTH];
+  uint32_t count;
+
+  assert(wide && bvh && allocator);
+
+  memset(wide, 0, sizeof(wide_bvh_t));
+  wide->revision = revision;
+  if (!bvh->nodes.size)
+    return;
+
+  converter.bvh = bvh;
+  converter.count = 0;
+  converter.capacity = (uint32_t)bvh->nodes.size / 2 + 1;
+  converter.allocator = allocator;
+  converter.nodes =
+    allocator->mem_alloc(sizeof(wide_bvh_node_t) * converter.capacity);
+
+  root = get_node_item(bvh, 0);
+  wide->bounds = root.bounds;
+  if (is_leaf_item(bvh, &root)) {
+    children[0] = root;
+    count = 1;
+  } else
+    count = gather_children(bvh, &root, children);
+  convert(&converter, children, count, &wide->bounds);
+
+  // one node per cache line.
+  wide->count = converter.count;
+  wide->allocation = allocator->mem_alloc(
+    sizeof(wide_bvh_node_t) * wide->count + CACHE_LINE_SIZE);
+  wide->nodes = (wide_bvh_node_t *)(
+    ((uintptr_t)wide->allocation + CACHE_LINE_SIZE - 1) &
+    ~(uintptr_t)(CACHE_LINE_SIZE - 1));
+  memcpy(
+    wide->nodes, converter.nodes, sizeof(wide_bvh_node_t) * wide->count);
+  allocator->mem_free(converter.nodes);
+}
+
+void
+wide_bvh_cleanup(
+  wide_bvh_t *wide,
+  const allocator_t *allocator)
+{
+  assert(wide && allocator);
+
+  if (wide->allocation)
+    allocator->mem_free(wide->allocation);
+  memset(wide, 0, sizeof(wide_bvh_t));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint32_t
+wide_bvh_node_mask(
+  const wide_bvh_node_t *node,
+  const bvh_aabb_t *node_bounds,
+  const bvh_aabb_t *bounds,
+  bvh_aabb_t out[WIDE_BVH_WIDTH])
+{
+  float min[3][WIDE_BVH_WIDTH];
+  float max[3][WIDE_BVH_WIDTH];
+  uint32_t mask;
+
+#if defined(WIDE_BVH_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  __m128 result = _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps());
+
+  for (uint32_t axis = 0; axis < 3; ++axis) {
+    __m128 origin = _mm_set1_ps(node_bounds->min_max[0].data[axis]);
+    __m128 step = _mm_set1_ps(get_step(node_bounds, axis));
+    __m128i q_min = _mm_loadl_epi64((const __m128i *)node->min[axis]);
+    __m128i q_max = _mm_loadl_epi64((const __m128i *)node->max[axis]);
+    __m128 c_min = _mm_add_ps(
+      origin,
+      _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(q_min, zero)), step));
+    __m128 c_max = _mm_add_ps(
+      origin,
+      _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(q_max, zero)), step));
+    result = _mm_and_ps(
+      result, _mm_cmple_ps(c_min, _mm_set1_ps(bounds->min_max[1].data[axis])));
+    result = _mm_and_ps(
+      result, _mm_cmpge_ps(c_max, _mm_set1_ps(bounds->min_max[0].data[axis])));
+    _mm_storeu_ps(min[axis], c_min);
+    _mm_storeu_ps(max[axis], c_max);
+  }
+
+  mask = (uint32_t)_mm_movemask_ps(result);
+#else
+  mask = 0;
+
+  for (uint32_t i = 0; i < WIDE_BVH_WIDTH; ++i) {
+    uint32_t inside = 1;
+    for (uint32_t axis = 0; axis < 3; ++axis) {
+      float origin = node_bounds->min_max[0].data[axis];
+      float step = get_step(node_bounds, axis);
+      min[axis][i] = origin + node->min[axis][i] * step;
+      max[axis][i] = origin + node->max[axis][i] * step;
+      inside &= min[axis][i] <= bounds->min_max[1].data[axis];
+      inside &= max[axis][i] >= bounds->min_max[0].data[axis];
+    }
+    mask |= inside << i;
+  }
+#endif
+
+  for (uint32_t i = 0; i < WIDE_BVH_WIDTH; ++i) {
+    if (node->children[i] == WIDE_BVH_EMPTY)
+      mask &= ~(1u << i);
+
+    for (uint32_t axis = 0; axis < 3; ++axis) {
+      out[i].min_max[0].data[axis] = min[axis][i];
+      out[i].min_max[1].data[axis] = max[axis][i];
+    }
+  }
+
+  return mask;
+}
+
+// the node indices and their bounds spill to the heap together.
+static
+void
+grow_stack(
+  uint32_t **stack,
+  const uint32_t *local,
+  bvh_aabb_t **stack_bounds,
+  const bvh_aabb_t *local_bounds,
+  uint32_t *capacity,
+  const allocator_t *allocator)
+{
+  uint32_t bounds_capacity = *capacity;
+  *stack = bvh_stack_grow(
+    *stack, local, capacity, sizeof(uint32_t), allocator);
+  *stack_bounds = bvh_stack_grow(
+    *stack_bounds, local_bounds, &bounds_capacity, sizeof(bvh_aabb_t),
+    allocator);
+}
+
+static
+void
+free_stack(
+  uint32_t *stack,
+  const uint32_t *local,
+  bvh_aabb_t *stack_bounds,
+  const bvh_aabb_t *local_bounds,
+  const allocator_t *allocator)
+{
+  if (stack != local)
+    allocator->mem_free(stack);
+  if (stack_bounds != local_bounds)
+    allocator->mem_free(stack_bounds);
+}
+
+int32_t
+wide_bvh_query_faces(
+  const collision_mesh_t *mesh,
+  const wide_bvh_t *wide,
+  bvh_aabb_t *bounds,
+  const bvh_sweep_t *sweep,
+  const capsule_t *capsule,
+  bvh_face_callback_t callback,
+  void *user_data,
+  uint32_t *visited)
+{
+  uint32_t local[BVH_QUERY_STACK_SIZE];
+  bvh_aabb_t local_bounds[BVH_QUERY_STACK_SIZE];
+  uint32_t *stack = local;
+  bvh_aabb_t *stack_bounds = local_bounds;
+  uint32_t capacity = BVH_QUERY_STACK_SIZE;
+  uint32_t used = 0;
+  uint32_t nodes = 0;
+  int32_t result = 1;
+
+  assert(mesh && wide && bounds && callback);
+
+  if (!wide->count || !bounds_intersect(bounds, &wide->bounds))
+    return 1;
+
+  stack[used] = 0;
+  stack_bounds[used++] = wide->bounds;
+
+  while (used) {
+    const wide_bvh_node_t *node = wide->nodes + stack[--used];
+    bvh_aabb_t node_bounds = stack_bounds[used];
+    bvh_aabb_t children[WIDE_BVH_WIDTH];
+    uint32_t mask = wide_bvh_node_mask(node, &node_bounds, bounds, children);
+    ++nodes;
+
+    // the children are pushed in reverse to be visited in order.
+    for (uint32_t i = WIDE_BVH_WIDTH; i--;) {
+      uint32_t child = node->children[i];
+
+      if (!(mask & (1u << i)))
+        continue;
+
+      if (sweep && !bvh_sweep_intersects(sweep, children + i))
+        continue;
+
+      if (child & WIDE_BVH_LEAF_BIT) {
+        uint32_t first =
+          (child & ~WIDE_BVH_LEAF_BIT) >> WIDE_BVH_LEAF_COUNT_BITS;
+        uint32_t count =
+          (child & (WIDE_BVH_MAX_LEAF_SIZE - 1)) + 1;
+        if (!bvh_query_leaf(
+          mesh, first, count, bounds, sweep, capsule, callback, user_data)) {
+          result = 0;
+          used = 0;
+          break;
+        }
+        continue;
+      }
+
+      if (used == capacity)
+        grow_stack(
+          &stack, local, &stack_bounds, local_bounds,
+          &capacity, mesh->allocator);
+      stack[used] = child;
+      stack_bounds[used++] = children[i];
+    }
+  }
+
+  free_stack(stack, local, stack_bounds, local_bounds, mesh->allocator);
+  if (visited)
+    *visited += nodes;
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+typedef
+struct {
+  uint32_t lines[MAX_LINES_PER_QUERY];
+  uint32_t line_count;
+  uint32_t visits;
+} visit_counter_t;
+
+static
+void
+touch(visit_counter_t *counter, const uint32_t line)
+{
+  counter->visits++;
+  for (uint32_t i = 0; i < counter->line_count; ++i)
+    if (counter->lines[i] == line)
+      return;
+
+  if (counter->line_count < MAX_LINES_PER_QUERY)
+    counter->lines[counter->line_count++] = line;
+}
+
+static
+void
+count_binary(
+  const collision_mesh_t *mesh,
+  const bvh_aabb_t *bounds,
+  visit_counter_t *counter)
+{
+  const bvh_t *bvh = mesh->bvh;
+  uint32_t local[BVH_QUERY_STACK_SIZE];
+  uint32_t *stack = local;
+  uint32_t capacity = BVH_QUERY_STACK_SIZE;
+  uint32_t used = 0;
+
+  stack[used++] = 0;
+  while (used) {
+    uint32_t index = stack[--used];
+    bvh_node_t *node = cvector_as(&bvh->nodes, index, bvh_node_t);
+
+    touch(
+      counter,
+      (uint32_t)(((uintptr_t)node) / CACHE_LINE_SIZE));
+    if (!bounds_intersect(bounds, &node->bounds) || node->tri_count)
+      continue;
+
+    if (used + 2 > capacity)
+      stack = bvh_stack_grow(
+        stack, local, &capacity, sizeof(uint32_t), mesh->allocator);
+    stack[used++] = node->left_first + 1;
+    stack[used++] = node->left_first;
+  }
+
+  if (stack != local)
+    mesh->allocator->mem_free(stack);
+}
+
+static
+void
+count_wide(
+  const collision_mesh_t *mesh,
+  const bvh_aabb_t *bounds,
+  visit_counter_t *counter)
+{
+  const wide_bvh_t *wide = &mesh->wide;
+  uint32_t local[BVH_QUERY_STACK_SIZE];
+  bvh_aabb_t local_bounds[BVH_QUERY_STACK_SIZE];
+  uint32_t *stack = local;
+  bvh_aabb_t *stack_bounds = local_bounds;
+  uint32_t capacity = BVH_QUERY_STACK_SIZE;
+  uint32_t used = 0;
+
+  stack[used] = 0;
+  stack_bounds[used++] = wide->bounds;
+  while (used) {
+    uint32_t index = stack[--used];
+    bvh_aabb_t node_bounds = stack_bounds[used];
+    bvh_aabb_t children[WIDE_BVH_WIDTH];
+    uint32_t mask;
+
+    touch(counter, index);
+    mask = wide_bvh_node_mask(
+      wide->nodes + index, &node_bounds, bounds, children);
+
+    for (uint32_t i = WIDE_BVH_WIDTH; i--;) {
+      uint32_t child = wide->nodes[index].children[i];
+      if ((mask & (1u << i)) && !(child & WIDE_BVH_LEAF_BIT)) {
+        if (used == capacity)
+          grow_stack(
+            &stack, local, &stack_bounds, local_bounds,
+            &capacity, mesh->allocator);
+        stack[used] = child;
+        stack_bounds[used++] = children[i];
+      }
+    }
+  }
+
+  free_stack(stack, local, stack_bounds, local_bounds, mesh->allocator);
+}
+
+void
+wide_bvh_compare(
+  const collision_mesh_t *mesh,
+  const capsule_t *capsule,
+  const uint32_t stride,
+  wide_bvh_stats_t *stats)
+{
+  const bvh_t *bvh = mesh->bvh;
+  const wide_bvh_t *wide = &mesh->wide;
+  visit_counter_t binary, wide_counter;
+  uint64_t binary_visits = 0, wide_visits = 0;
+  uint64_t binary_lines = 0, wide_lines = 0;
+
+  assert(mesh && capsule && stats);
+
+  memset(stats, 0, sizeof(wide_bvh_stats_t));
+  stats->binary_nodes = (uint32_t)bvh->nodes.size;
+  stats->wide_nodes = wide->count;
+  stats->binary_bytes = (uint32_t)(bvh->nodes.size * sizeof(bvh_node_t));
+  stats->wide_bytes = wide->count * (uint32_t)sizeof(wide_bvh_node_t);
+
+  if (!stride || !bvh->nodes.size || !wide->count)
+    return;
+
+  for (uint32_t i = 0; i < mesh->face_count; i += stride) {
+    const face_t *face = cvector_as(&bvh->faces, i, face_t);
+    capsule_t query = *capsule;
+    bvh_aabb_t bounds;
+
+    query.center = add_v3f(face->points + 0, face->points + 1);
+    add_set_v3f(&query.center, face->points + 2);
+    mult_set_v3f(&query.center, 1.f / 3.f);
+    populate_capsule_aabb(&bounds, &query, 1.f);
+
+    binary.line_count = binary.visits = 0;
+    wide_counter.line_count = wide_counter.visits = 0;
+    count_binary(mesh, &bounds, &binary);
+    count_wide(mesh, &bounds, &wide_counter);
+
+    binary_visits += binary.visits;
+    binary_lines += binary.line_count;
+    wide_visits += wide_counter.visits;
+    wide_lines += wide_counter.line_count;
+    stats->queries++;
+  }
+
+  stats->binary_visits = (float)binary_visits / stats->queries;
+  stats->binary_lines = (float)binary_lines / stats->queries;
+  stats->wide_visits = (float)wide_visits / stats->queries;
+  stats->wide_lines = (float)wide_lines / stats->queries;
+}
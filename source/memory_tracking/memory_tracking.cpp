@@ -12,6 +12,7 @@
 #include <cassert>
 #include <cstdint>
 #include <cstdlib>
+#include <mutex>
 #include <vector>
 #include <game/memory_tracking/memory_tracking.h>
 
@@ -19,10 +20,15 @@
 static
 std::vector<uintptr_t> allocated;
 
+// the collision queries may grow their buffers from the worker threads.
+static
+std::mutex allocated_mutex;
+
 void* allocate(size_t size)
 {
   void* block = malloc(size);
   assert(block);
+  std::lock_guard<std::mutex> lock(allocated_mutex);
   allocated.push_back(uintptr_t(block));
   return block;
 }
@@ -31,12 +37,14 @@ void* container_allocate(size_t count, size_t elem_size)
 {
   void* block = calloc(count, elem_size);
   assert(block);
+  std::lock_guard<std::mutex> lock(allocated_mutex);
   allocated.push_back(uintptr_t(block));
   return block;
 }
 
 void* reallocate(void* block, size_t size)
 {
+  std::lock_guard<std::mutex> lock(allocated_mutex);
   void* tmp = realloc(block, size);
   assert(tmp);
 
@@ -53,6 +61,7 @@ void* reallocate(void* block, size_t size)
 
 void free_block(void* block)
 {
+  std::lock_guard<std::mutex> lock(allocated_mutex);
   allocated.erase(
     std::remove_if(
       allocated.begin(),
@@ -75,5 +84,6 @@ track_allocator_memory(allocator_t *allocator)
 void
 ensure_no_leaks(void)
 {
+  std::lock_guard<std::mutex> lock(allocated_mutex);
   assert(allocated.size() == 0 && "Memory leak detected!");
 }
\ No newline at end of file
@@ -0,0 +1,182 @@
+/**
+ * @file job_system.cpp
+ * @author khalilhenoud@gmail.com
+ * @brief fixed pool of worker threads running data parallel loops.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <game/threading/job_system.h>
+
+
+// NOTE: 'active' counts the workers holding the job, the job lives on the
+// stack of 'parallel_for' and cannot be released before it drops to 0.
+struct job_t {
+  job_range_t job;
+  void *user_data;
+  uint32_t count;
+  uint32_t batch_size;
+  uint32_t batch_count;
+  std::atomic<uint32_t> next;
+  uint32_t active;
+};
+
+static
+std::vector<std::thread> workers;
+
+static
+std::mutex mutex;
+
+static
+std::condition_variable wake;
+
+static
+std::condition_variable finished;
+
+static
+job_t *current = nullptr;
+
+static
+uint64_t generation = 0;
+
+static
+bool quit = false;
+
+static
+thread_local uint32_t thread_slot = 0;
+
+static
+void
+drain(job_t *job)
+{
+  uint32_t batch;
+  while ((batch = job->next.fetch_add(1)) < job->batch_count) {
+    uint32_t first = batch * job->batch_size;
+    uint32_t last = std::min(first + job->batch_size, job->count);
+    job->job(first, last, job->user_data);
+  }
+}
+
+static
+void
+worker_loop(uint32_t slot)
+{
+  uint64_t seen = 0;
+  thread_slot = slot;
+
+  while (true) {
+    job_t *job;
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait(lock, [&] { return quit || generation != seen; });
+      if (quit)
+        return;
+
+      seen = generation;
+      job = current;
+      if (!job)
+        continue;
+      job->active++;
+    }
+
+    drain(job);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (--job->active == 0)
+        finished.notify_all();
+    }
+  }
+}
+
+void
+job_system_init(uint32_t worker_count)
+{
+  assert(workers.empty() && "job system already initialized!");
+
+  if (!worker_count) {
+    uint32_t hardware = std::thread::hardware_concurrency();
+    worker_count = hardware > 1 ? hardware - 1 : 0;
+  }
+  worker_count = std::min(worker_count, (uint32_t)JOB_SYSTEM_MAX_THREADS - 1);
+
+  quit = false;
+  for (uint32_t i = 0; i < worker_count; ++i)
+    workers.emplace_back(worker_loop, i + 1);
+}
+
+void
+job_system_shutdown(void)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    quit = true;
+  }
+
+  wake.notify_all();
+  for (auto &worker : workers)
+    worker.join();
+  workers.clear();
+}
+
+uint32_t
+job_system_thread_count(void)
+{
+  return (uint32_t)workers.size() + 1;
+}
+
+uint32_t
+job_system_thread_slot(void)
+{
+  return thread_slot;
+}
+
+void
+parallel_for(
+  const uint32_t count,
+  const uint32_t batch_size,
+  job_range_t job,
+  void *user_data)
+{
+  job_t task;
+  assert(job && batch_size);
+
+  task.job = job;
+  task.user_data = user_data;
+  task.count = count;
+  task.batch_size = batch_size;
+  task.batch_count = (count + batch_size - 1) / batch_size;
+  task.next = 0;
+  task.active = 0;
+
+  if (workers.empty() || task.batch_count <= 1) {
+    drain(&task);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    current = &task;
+    generation++;
+  }
+
+  wake.notify_all();
+  drain(&task);
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&] { return task.active == 0; });
+    current = nullptr;
+  }
+}
@@ -0,0 +1,522 @@
+/**
+ * @file collision_replay.cpp
+ * @author khalilhenoud@gmail.com
+ * @brief replays a collision recording against its room without a window.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <game/debug/flags.h>
+#include <game/logic/bvh_build.h>
+#include <game/logic/collision_context.h>
+#include <game/logic/collision_mesh.h>
+#include <game/logic/collision_recorder.h>
+#include <game/logic/collision_utils.h>
+#include <game/logic/collision_variant.h>
+#include <game/logic/face_grid.h>
+#include <game/logic/ground_grid.h>
+#include <game/logic/player.h>
+#include <game/logic/wide_bvh.h>
+#include <game/memory_tracking/memory_tracking.h>
+#include <entity/scene/scene.h>
+#include <library/allocator/allocator.h>
+#include <library/containers/cvector.h>
+#include <library/filesystem/io.h>
+#include <library/streams/binary_stream.h>
+#include <spatial/bvh/bvh.h>
+
+#define DEFAULT_TOLERANCE         0.0001f
+
+
+enum solver_t {
+  SOLVER_RECORDED,
+  SOLVER_ITERATIVE,
+  SOLVER_ANALYTIC
+};
+
+struct options_t {
+  const char *data_set;
+  const char *recording;
+  solver_t solver;
+  uint32_t repeat;
+  float tolerance;
+  uint32_t settings;
+  bool recorded_settings;
+  bool ground_grid;
+};
+
+struct replay_stats_t {
+  uint64_t queries;
+  uint64_t mismatches;
+  double seconds;
+  std::vector<double> latencies;
+};
+
+static
+void
+print_usage(void)
+{
+  std::printf(
+    "usage: collision_replay <data set> <recording> [options]\n"
+    "the settings recorded in the header are applied unless ignored, the\n"
+    "options below add to them\n"
+    "  --ignore-settings  do not apply the recorded settings\n"
+    "  --iterative        force the iterative time of impact solver\n"
+    "  --analytic         force the closed form time of impact solver\n"
+    "  --scalar           use the scalar collision path\n"
+    "  --no-cache         disable the candidate cache\n"
+    "  --legacy-buckets   use the pairwise bucket processing\n"
+    "  --wide-bvh         query the 4 wide bvh and compare the layouts\n"
+    "  --grid             use the face grid broadphase and compare it\n"
+    "  --ground-grid      replay the probes through the ground grid\n"
+    "                     even if it was off when recording\n"
+    "  --repeat <n>       replay the recording n times (1)\n"
+    "  --tolerance <t>    time of impact mismatch tolerance (%g)\n",
+    DEFAULT_TOLERANCE);
+}
+
+static
+bool
+parse_options(int argc, char **argv, options_t *options)
+{
+  if (argc < 3)
+    return false;
+
+  options->data_set = argv[1];
+  options->recording = argv[2];
+  options->solver = SOLVER_RECORDED;
+  options->repeat = 1;
+  options->tolerance = DEFAULT_TOLERANCE;
+  options->settings = 0;
+  options->recorded_settings = true;
+  options->ground_grid = false;
+
+  for (int i = 3; i < argc; ++i) {
+    if (!std::strcmp(argv[i], "--iterative"))
+      options->solver = SOLVER_ITERATIVE;
+    else if (!std::strcmp(argv[i], "--analytic"))
+      options->solver = SOLVER_ANALYTIC;
+    else if (!std::strcmp(argv[i], "--ignore-settings"))
+      options->recorded_settings = false;
+    else if (!std::strcmp(argv[i], "--scalar"))
+      options->settings |= COLLISION_RECORD_SCALAR;
+    else if (!std::strcmp(argv[i], "--no-cache"))
+      options->settings |= COLLISION_RECORD_NO_CACHE;
+    else if (!std::strcmp(argv[i], "--legacy-buckets"))
+      options->settings |= COLLISION_RECORD_LEGACY_BUCKETS;
+    else if (!std::strcmp(argv[i], "--wide-bvh"))
+      options->settings |= COLLISION_RECORD_WIDE_BVH;
+    else if (!std::strcmp(argv[i], "--grid"))
+      options->settings |= COLLISION_RECORD_GRID;
+    else if (!std::strcmp(argv[i], "--ground-grid"))
+      options->ground_grid = true;
+    else if (!std::strcmp(argv[i], "--repeat") && i + 1 < argc)
+      options->repeat = std::max(1, std::atoi(argv[++i]));
+    else if (!std::strcmp(argv[i], "--tolerance") && i + 1 < argc)
+      options->tolerance = (float)std::atof(argv[++i]);
+    else
+      return false;
+  }
+
+  return true;
+}
+
+// the recorded settings are merged with the command line ones, --ground-grid
+// turns the ground grid on even if it was off when recording.
+static
+void
+apply_settings(options_t &options, const uint32_t recorded)
+{
+  uint32_t settings =
+    options.settings | (options.recorded_settings ? recorded : 0);
+
+  // not a setting to compare, the face indices only hold in the same layout.
+  settings |= recorded & COLLISION_RECORD_REBUILT_BVH;
+
+  g_debug_flags.use_scalar_collision = !!(settings & COLLISION_RECORD_SCALAR);
+  g_debug_flags.disable_candidate_cache =
+    !!(settings & COLLISION_RECORD_NO_CACHE);
+  g_debug_flags.use_legacy_buckets =
+    !!(settings & COLLISION_RECORD_LEGACY_BUCKETS);
+  g_debug_flags.use_wide_bvh = !!(settings & COLLISION_RECORD_WIDE_BVH);
+  g_debug_flags.disable_fused_queries =
+    !!(settings & COLLISION_RECORD_NO_FUSION);
+  g_debug_flags.keep_internal_contacts =
+    !!(settings & COLLISION_RECORD_INTERNAL_CONTACTS);
+  g_debug_flags.use_merged_sweep_bounds =
+    !!(settings & COLLISION_RECORD_MERGED_SWEEP_BOUNDS);
+
+  options.ground_grid =
+    options.ground_grid || !(settings & COLLISION_RECORD_NO_GROUND_GRID);
+  g_debug_flags.disable_ground_grid = !options.ground_grid;
+  options.settings = settings;
+  collision_variant_select();
+}
+
+static
+bool
+read_recording(
+  const char *path,
+  char room[COLLISION_RECORD_ROOM_LENGTH],
+  uint32_t *settings,
+  std::vector<collision_record_t> &records)
+{
+  FILE *file = std::fopen(path, "rb");
+  collision_record_t record;
+
+  if (!file)
+    return false;
+
+  if (!collision_record_read_header(file, room, settings)) {
+    std::fclose(file);
+    return false;
+  }
+
+  while (collision_record_read(file, &record))
+    records.push_back(record);
+
+  std::fclose(file);
+  return true;
+}
+
+// returns the index of the first hit that differs from the recorded ones, or
+// -1 if the results match.
+static
+int32_t
+find_difference(
+  const collision_record_t &record,
+  const intersection_info_t *hits,
+  const uint32_t hit_count,
+  const float tolerance)
+{
+  uint32_t count = std::min(hit_count, record.hit_count);
+
+  for (uint32_t i = 0; i < count; ++i) {
+    if (
+      hits[i].bvh_face_index != record.hits[i].bvh_face_index ||
+      hits[i].flags != record.hits[i].flags ||
+      std::fabs(hits[i].time - record.hits[i].time) > tolerance)
+      return (int32_t)i;
+  }
+
+  return hit_count != record.hit_count ? (int32_t)count : -1;
+}
+
+static
+void
+print_hit(
+  const char *label,
+  const intersection_info_t *hits,
+  const uint32_t hit_count,
+  const uint32_t i)
+{
+  if (i < hit_count)
+    std::printf(
+      "  %s face %u  flags %u  time %.6f\n",
+      label, hits[i].bvh_face_index, (uint32_t)hits[i].flags, hits[i].time);
+  else
+    std::printf("  %s none\n", label);
+}
+
+static
+void
+print_mismatch(
+  const uint64_t query,
+  const collision_record_t &record,
+  const intersection_info_t *hits,
+  const uint32_t hit_count,
+  const uint32_t i)
+{
+  std::printf(
+    "mismatch at query %llu: %u hits, %u recorded, differs at hit %u\n",
+    (unsigned long long)query, hit_count, record.hit_count, i);
+  print_hit("replayed:", hits, hit_count, i);
+  print_hit("recorded:", record.hits, record.hit_count, i);
+}
+
+// the first pass is compared against the recorded hits, the latencies are
+// gathered over every pass.
+static
+void
+replay(
+  const options_t &options,
+  const std::vector<collision_record_t> &records,
+  std::vector<collision_context_t> &contexts,
+  replay_stats_t &stats)
+{
+  using clock = std::chrono::steady_clock;
+  intersection_info_t hits[256];
+
+  auto start = clock::now();
+  for (uint32_t pass = 0; pass < options.repeat; ++pass) {
+    for (const collision_record_t &record : records) {
+      collision_context_t *context = &contexts[record.context];
+      capsule_t capsule = record.capsule;
+
+      if (record.type == COLLISION_RECORD_PREFETCH) {
+        collision_context_prefetch(context, &capsule, &record.displacement);
+        continue;
+      }
+
+      g_debug_flags.use_analytic_toi =
+        options.solver == SOLVER_RECORDED ? record.analytic :
+        options.solver == SOLVER_ANALYTIC;
+      collision_variant_select();
+
+      uint32_t hit_count;
+      auto query_start = clock::now();
+      // the probes only see the floors, the time of impact sees every face.
+      if (record.type == COLLISION_RECORD_PROBE) {
+        fused_query_t probe = {};
+        probe.type = FUSED_QUERY_PROBE;
+        probe.capsule = &capsule;
+        probe.displacement = record.displacement;
+        probe.hits = hits;
+        get_fused_queries(
+          context, &probe, 1, record.iterations, record.limit_distance);
+        hit_count = probe.hit_count;
+      } else
+        hit_count = get_time_of_impact(
+          context,
+          &capsule,
+          record.displacement,
+          hits,
+          record.iterations,
+          record.limit_distance);
+      auto query_end = clock::now();
+
+      stats.latencies.push_back(
+        std::chrono::duration<double, std::micro>(
+          query_end - query_start).count());
+      ++stats.queries;
+
+      int32_t difference = pass == 0 ?
+        find_difference(record, hits, hit_count, options.tolerance) : -1;
+      if (difference >= 0) {
+        if (stats.mismatches < 16)
+          print_mismatch(
+            stats.queries - 1, record, hits, hit_count, (uint32_t)difference);
+        ++stats.mismatches;
+      }
+    }
+  }
+  stats.seconds = std::chrono::duration<double>(clock::now() - start).count();
+}
+
+// only the scene data of the room is read, the level resources (fonts,
+// textures, the render pipeline) are never touched.
+static
+scene_t *
+read_room(
+  const char *data_set,
+  const char *room,
+  const allocator_t *allocator)
+{
+  char path[1024] = { 0 };
+  uint8_t buffer[16 * 1024];
+  binary_stream_t stream;
+  file_handle_t file;
+  scene_t *scene;
+  size_t read;
+
+  std::snprintf(
+    path, sizeof(path), "%s\\rooms\\%s\\%s.bin", data_set, room, room);
+  file = open_file(path, FILE_OPEN_MODE_READ | FILE_OPEN_MODE_BINARY);
+  if (!(void *)file)
+    return NULL;
+
+  binary_stream_def(&stream);
+  binary_stream_setup(&stream, allocator);
+  do {
+    read = read_buffer(file, buffer, sizeof(uint8_t), sizeof(buffer));
+    binary_stream_write(&stream, buffer, read);
+  } while (read);
+  close_file(file);
+
+  scene = scene_create(NULL, allocator);
+  scene_deserialize(scene, allocator, &stream);
+  binary_stream_cleanup(&stream);
+  return scene;
+}
+
+static
+double
+get_percentile(const std::vector<double> &sorted, const double percentile)
+{
+  size_t index;
+  if (sorted.empty())
+    return 0.0;
+
+  index = (size_t)(percentile / 100.0 * (double)(sorted.size() - 1) + 0.5);
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+static
+void
+print_report(
+  const char *room,
+  const size_t record_count,
+  replay_stats_t &stats)
+{
+  std::sort(stats.latencies.begin(), stats.latencies.end());
+
+  std::printf("room:         %s\n", room);
+  std::printf("records:      %zu\n", record_count);
+  std::printf("queries:      %llu\n", (unsigned long long)stats.queries);
+  std::printf("total:        %.3f ms\n", stats.seconds * 1000.0);
+  std::printf(
+    "throughput:   %.0f queries/s\n",
+    stats.seconds > 0.0 ? (double)stats.queries / stats.seconds : 0.0);
+  std::printf(
+    "latency (us): p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n",
+    get_percentile(stats.latencies, 50.0),
+    get_percentile(stats.latencies, 90.0),
+    get_percentile(stats.latencies, 99.0),
+    stats.latencies.empty() ? 0.0 : stats.latencies.back());
+  std::printf("mismatches:   %llu\n", (unsigned long long)stats.mismatches);
+}
+
+static
+void
+print_layouts(const collision_mesh_t *mesh)
+{
+  wide_bvh_stats_t stats;
+  capsule_t capsule;
+
+  capsule.radius = PLAYER_CAPSULE_RADIUS;
+  capsule.half_height = PLAYER_CAPSULE_HALF_HEIGHT;
+  wide_bvh_compare(mesh, &capsule, 1, &stats);
+
+  std::printf(
+    "binary bvh:   %u nodes  %u bytes  %.1f visits  %.1f lines/query\n",
+    stats.binary_nodes, stats.binary_bytes,
+    stats.binary_visits, stats.binary_lines);
+  std::printf(
+    "wide bvh:     %u nodes  %u bytes  %.1f visits  %.1f lines/query\n",
+    stats.wide_nodes, stats.wide_bytes,
+    stats.wide_visits, stats.wide_lines);
+}
+
+static
+void
+print_broadphases(collision_mesh_t *mesh)
+{
+  face_grid_stats_t stats;
+  capsule_t capsule;
+
+  capsule.radius = PLAYER_CAPSULE_RADIUS;
+  capsule.half_height = PLAYER_CAPSULE_HALF_HEIGHT;
+  face_grid_benchmark(mesh, &capsule, 1, &stats);
+
+  std::printf(
+    "bvh:          %.3f us/query\n"
+    "grid:         %.3f us/query  %u bytes  %u mismatches\n",
+    stats.bvh_us, stats.grid_us, stats.bytes, stats.mismatches);
+}
+
+int
+main(int argc, char **argv)
+{
+  options_t options;
+  allocator_t allocator;
+  char room[COLLISION_RECORD_ROOM_LENGTH] = { 0 };
+  uint32_t settings = 0;
+  std::vector<collision_record_t> records;
+  replay_stats_t stats = {};
+  int result;
+
+  if (!parse_options(argc, argv, &options)) {
+    print_usage();
+    return 2;
+  }
+
+  if (!read_recording(options.recording, room, &settings, records)) {
+    std::printf("cannot read the recording '%s'\n", options.recording);
+    return 2;
+  }
+
+  // the replay only has the static room, the moved faces are not in it.
+  if (settings & COLLISION_RECORD_MOVED_FACES) {
+    std::printf(
+      "the recording '%s' has faces moved by the refit platform, it cannot "
+      "be replayed against the static room\n", options.recording);
+    return 2;
+  }
+
+  apply_settings(options, settings);
+
+  track_allocator_memory(&allocator);
+
+  scene_t *scene = read_room(options.data_set, room, &allocator);
+  if (!scene) {
+    std::printf("cannot read the room '%s'\n", room);
+    return 2;
+  }
+
+  if (!scene->bvh_repo.size) {
+    std::printf("the room '%s' has no bvh\n", room);
+    scene_free(scene, &allocator);
+    return 2;
+  }
+
+  {
+    bvh_t *bvh = cvector_as(&scene->bvh_repo, 0, bvh_t);
+    collision_mesh_t *mesh;
+    uint32_t context_count = 0;
+
+    // the recorded face indices refer to the rebuilt layout, the build is
+    // deterministic so the same faces end up at the same indices.
+    if (options.settings & COLLISION_RECORD_REBUILT_BVH) {
+      bvh_build_stats_t build_stats;
+      bvh_build_sah(bvh, &build_stats, &allocator);
+    }
+
+    mesh = load_collision_mesh(bvh, PLAYER_CAPSULE_RADIUS * 2.f, &allocator);
+
+    if (options.settings & COLLISION_RECORD_GRID) {
+      face_grid_setup(
+        &mesh->grid, bvh, PLAYER_CAPSULE_RADIUS, mesh->revision, &allocator);
+      mesh->broadphase = COLLISION_BROADPHASE_GRID;
+    }
+
+    // the probes are answered from the grid unless it was off when recording,
+    // the traversal gives the same floors.
+    if (options.ground_grid)
+      ground_grid_setup(
+        &mesh->ground, mesh, PLAYER_CAPSULE_RADIUS, &allocator);
+
+    for (const collision_record_t &record : records)
+      context_count = std::max(context_count, record.context + 1);
+
+    std::vector<collision_context_t> contexts(context_count);
+    for (collision_context_t &context : contexts)
+      collision_context_setup(&context, mesh, &allocator);
+
+    replay(options, records, contexts, stats);
+    if (g_debug_flags.use_wide_bvh)
+      print_layouts(mesh);
+    if (options.settings & COLLISION_RECORD_GRID)
+      print_broadphases(mesh);
+
+    for (collision_context_t &context : contexts)
+      collision_context_cleanup(&context);
+    free_collision_mesh(mesh, &allocator);
+  }
+
+  print_report(room, records.size(), stats);
+  result = stats.mismatches ? 1 : 0;
+
+  scene_free(scene, &allocator);
+  ensure_no_leaks();
+  return result;
+}
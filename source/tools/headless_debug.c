@@ -0,0 +1,36 @@
+/**
+ * @file headless_debug.c
+ * @author khalilhenoud@gmail.com
+ * @brief the debug state of the collision code without a renderer, for tools.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <game/debug/face.h>
+#include <game/debug/flags.h>
+#include <game/debug/text.h>
+
+
+// the tools set the flags directly, there is no input to toggle them.
+debug_flags_t g_debug_flags;
+
+// nothing is drawn without a window, the debug faces and text are dropped.
+void
+add_debug_face_to_frame(
+  face_t *face,
+  vector3f *normal,
+  debug_color_t color,
+  int32_t thickness)
+{
+}
+
+void
+add_debug_text_to_frame(
+  const char* text,
+  debug_color_t color,
+  float x,
+  float y)
+{
+}